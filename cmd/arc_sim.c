@@ -0,0 +1,494 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * arc_sim replays an ARC access trace, as dumped from the arc_trace kstat,
+ * against the ARC code in libzpool at one or more cache sizes, and prints
+ * the demand hit ratio and byte hit ratio the ARC would have had at each.
+ *
+ * Every cache size is simulated in a child process of its own, which
+ * initializes the ARC with zfs_arc_max set to that size and no simulated
+ * memory pressure.  Blocks are allocated for real, so simulating a cache
+ * size takes that much memory.  The ARC only promotes a block to the MFU
+ * if it is accessed again more than 62ms after it was cached, so the
+ * replay is paced by the timestamps in the trace, optionally sped up.
+ * Since every replay takes as long as the trace and mostly sleeps, all of
+ * them run at once, or up to -j to bound the memory used; each writes its
+ * results to a pipe, which is copied to stdout in the order of the sizes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/zfs_context.h>
+#include <sys/spa.h>
+#include <sys/arc.h>
+#include <sys/arc_impl.h>
+#include <libzutil.h>
+
+typedef struct sim_rec {
+	uint64_t	sr_time;
+	uint64_t	sr_spa;
+	dva_t		sr_dva;
+	uint64_t	sr_birth;
+	uint32_t	sr_lsize;
+	uint32_t	sr_psize;
+	uint32_t	sr_flags;
+	uint8_t		sr_event;
+	uint8_t		sr_type;
+	uint8_t		sr_class;
+} sim_rec_t;
+
+typedef struct sim_stats {
+	uint64_t	ss_accesses;	/* demand accesses */
+	uint64_t	ss_hits;
+	uint64_t	ss_bytes;	/* logical bytes accessed on demand */
+	uint64_t	ss_hit_bytes;
+} sim_stats_t;
+
+static sim_rec_t *recs;
+static uint64_t nrecs;
+static double speed = 1.0;
+static int verbose = 0;
+static long njobs = 0;
+
+#define	MAX_SIZES	64
+#define	MAX_GVARS	32
+
+static __attribute__((noreturn)) void
+usage(void)
+{
+	(void) fprintf(stderr,
+	    "Usage: arc_sim [-v] [-j jobs] [-o var=value]... "
+	    "[-s size[,size]...]\n"
+	    "               [-x speed] <trace>\n"
+	    "\n"
+	    "    -j jobs       number of sizes to simulate at once "
+	    "(default: all)\n"
+	    "    -o var=value  set a libzpool global variable, e.g. "
+	    "zfs_arc_admit=1\n"
+	    "    -s sizes      cache sizes to simulate (default: 64M "
+	    "doubling up\n"
+	    "                  to the footprint of the trace)\n"
+	    "    -v            verbose\n"
+	    "    -x speed      replay this many times faster than the "
+	    "trace was\n"
+	    "                  recorded, 0 for as fast as possible "
+	    "(default 1)\n");
+	exit(1);
+}
+
+static uint64_t
+parse_size(const char *str)
+{
+	char *end;
+	uint64_t val = strtoull(str, &end, 0);
+	const char *suffixes = "KMGT";
+	const char *s;
+
+	if (end == str)
+		usage();
+	if (*end != '\0') {
+		if ((s = strchr(suffixes, toupper(*end))) == NULL ||
+		    (end[1] != '\0' && (toupper(end[1]) != 'B' ||
+		    end[2] != '\0'))) {
+			(void) fprintf(stderr, "arc_sim: bad size: %s\n", str);
+			usage();
+		}
+		val <<= 10 * (s - suffixes + 1);
+	}
+	return (val);
+}
+
+static int
+parse_event(const char *str)
+{
+	if (strcmp(str, "hit") == 0)
+		return (ARC_TRACE_HIT);
+	if (strcmp(str, "iohit") == 0)
+		return (ARC_TRACE_IOHIT);
+	if (strcmp(str, "miss") == 0)
+		return (ARC_TRACE_MISS);
+	if (strcmp(str, "write") == 0)
+		return (ARC_TRACE_WRITE);
+	return (-1);
+}
+
+/*
+ * Read a trace, which may be several dumps of the kstat concatenated.
+ * Entries are stitched together by sequence number; entries already seen
+ * are skipped, and entries that were overwritten before being dumped are
+ * counted as lost.
+ */
+static void
+read_trace(const char *path)
+{
+	FILE *fp;
+	char *line = NULL;
+	size_t linecap = 0, alloc = 0;
+	uint64_t lastseq = 0, lost = 0;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		(void) fprintf(stderr, "arc_sim: cannot open %s: %s\n",
+		    path, strerror(errno));
+		exit(1);
+	}
+
+	while (getline(&line, &linecap, fp) > 0) {
+		u_longlong_t seq, time, spa, dva0, dva1, birth;
+		uint_t lsize, psize, class, flags;
+		char type[8], event[8], state[16];
+		sim_rec_t *sr;
+		int ev;
+
+		if (sscanf(line, "%llu %llu %llx %llx %llx %llu %u %u "
+		    "%7s %7s %15s %u %x", &seq, &time, &spa, &dva0, &dva1,
+		    &birth, &lsize, &psize, type, event, state, &class,
+		    &flags) != 13)
+			continue;	/* kstat and column headers */
+		if (seq <= lastseq)
+			continue;
+		if ((ev = parse_event(event)) < 0 ||
+		    class >= ARC_CLASS_COUNT || lsize == 0 || psize == 0 ||
+		    lsize > SPA_MAXBLOCKSIZE || psize > lsize) {
+			(void) fprintf(stderr, "arc_sim: bad trace entry: %s",
+			    line);
+			continue;
+		}
+		if (lastseq != 0)
+			lost += seq - lastseq - 1;
+		lastseq = seq;
+
+		if (nrecs == alloc) {
+			alloc = MAX(alloc * 2, 1024);
+			recs = realloc(recs, alloc * sizeof (sim_rec_t));
+			if (recs == NULL) {
+				(void) fprintf(stderr,
+				    "arc_sim: out of memory\n");
+				exit(1);
+			}
+		}
+		sr = &recs[nrecs++];
+		sr->sr_time = time;
+		sr->sr_spa = spa;
+		sr->sr_dva.dva_word[0] = dva0;
+		sr->sr_dva.dva_word[1] = dva1;
+		sr->sr_birth = birth;
+		sr->sr_lsize = lsize;
+		sr->sr_psize = psize;
+		sr->sr_flags = flags;
+		sr->sr_event = ev;
+		sr->sr_type = strcmp(type, "meta") == 0 ?
+		    ARC_BUFC_METADATA : ARC_BUFC_DATA;
+		sr->sr_class = class;
+	}
+	free(line);
+	(void) fclose(fp);
+
+	if (nrecs == 0) {
+		(void) fprintf(stderr, "arc_sim: no trace entries in %s\n",
+		    path);
+		exit(1);
+	}
+	if (lost != 0) {
+		(void) fprintf(stderr, "arc_sim: %llu trace entries were "
+		    "lost between dumps\n", (u_longlong_t)lost);
+	}
+}
+
+static int
+rec_compare(const void *a, const void *b)
+{
+	const sim_rec_t *ra = a, *rb = b;
+	int cmp;
+
+	if ((cmp = TREE_CMP(ra->sr_spa, rb->sr_spa)) != 0)
+		return (cmp);
+	if ((cmp = TREE_CMP(ra->sr_dva.dva_word[0],
+	    rb->sr_dva.dva_word[0])) != 0)
+		return (cmp);
+	if ((cmp = TREE_CMP(ra->sr_dva.dva_word[1],
+	    rb->sr_dva.dva_word[1])) != 0)
+		return (cmp);
+	return (TREE_CMP(ra->sr_birth, rb->sr_birth));
+}
+
+/*
+ * Return the number of bytes the ARC needs to cache every block in the
+ * trace, which is where the hit ratio curve flattens out.
+ */
+static uint64_t
+trace_footprint(void)
+{
+	sim_rec_t *sorted = malloc(nrecs * sizeof (sim_rec_t));
+	uint64_t bytes = 0;
+
+	if (sorted == NULL) {
+		(void) fprintf(stderr, "arc_sim: out of memory\n");
+		exit(1);
+	}
+	memcpy(sorted, recs, nrecs * sizeof (sim_rec_t));
+	qsort(sorted, nrecs, sizeof (sim_rec_t), rec_compare);
+	for (uint64_t i = 0; i < nrecs; i++) {
+		if (i == 0 || rec_compare(&sorted[i - 1], &sorted[i]) != 0)
+			bytes += sorted[i].sr_psize;
+	}
+	free(sorted);
+
+	return (bytes);
+}
+
+static void
+count_access(sim_stats_t *ss, const sim_rec_t *sr, boolean_t hit)
+{
+	if (sr->sr_event == ARC_TRACE_WRITE ||
+	    (sr->sr_flags & ARC_FLAG_PREFETCH))
+		return;
+	ss->ss_accesses++;
+	ss->ss_bytes += sr->sr_lsize;
+	if (hit) {
+		ss->ss_hits++;
+		ss->ss_hit_bytes += sr->sr_lsize;
+	}
+}
+
+static void
+print_stats(const char *label, const sim_stats_t *ss)
+{
+	(void) printf("%8s %12llu %12llu %7.2f %10.2f\n", label,
+	    (u_longlong_t)ss->ss_accesses, (u_longlong_t)ss->ss_hits,
+	    ss->ss_accesses == 0 ? 0.0 :
+	    100.0 * ss->ss_hits / ss->ss_accesses,
+	    ss->ss_bytes == 0 ? 0.0 :
+	    100.0 * ss->ss_hit_bytes / ss->ss_bytes);
+}
+
+/*
+ * Sleep until the wall clock time that corresponds to a trace timestamp.
+ */
+static void
+pace(hrtime_t start, uint64_t t0, uint64_t t)
+{
+	hrtime_t target, now;
+
+	if (speed == 0 || t <= t0)
+		return;
+	target = start + (hrtime_t)((t - t0) / speed);
+	now = gethrtime();
+	if (target - now > MSEC2NSEC(1)) {
+		struct timespec ts = {
+			.tv_sec = (target - now) / NANOSEC,
+			.tv_nsec = (target - now) % NANOSEC
+		};
+		(void) nanosleep(&ts, NULL);
+	}
+}
+
+/*
+ * Copy the output of a simulation to stdout, and wait for it to exit.
+ */
+static void
+reap(pid_t pid, int fd, uint64_t size)
+{
+	char buf[1024];
+	ssize_t len;
+	int status;
+
+	while ((len = read(fd, buf, sizeof (buf))) > 0 ||
+	    (len == -1 && errno == EINTR)) {
+		if (len > 0)
+			(void) fwrite(buf, 1, len, stdout);
+	}
+	(void) fflush(stdout);
+	(void) close(fd);
+	if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != 0) {
+		(void) fprintf(stderr, "arc_sim: simulation of size %llu "
+		    "failed\n", (u_longlong_t)size);
+		exit(1);
+	}
+}
+
+static void
+simulate(uint64_t size, char **gvars, int ngvars)
+{
+	sim_stats_t ss = { 0 };
+	hrtime_t start;
+	char label[16];
+
+	arc_random_pressure = 0;
+	zfs_arc_min = 2ULL << SPA_MAXBLOCKSHIFT;
+	zfs_arc_max = size;
+	for (int i = 0; i < ngvars; i++) {
+		if (set_global_var(gvars[i]) != 0) {
+			(void) fprintf(stderr,
+			    "arc_sim: failed to set global var '%s'\n",
+			    gvars[i]);
+			exit(1);
+		}
+	}
+
+	kernel_init(SPA_MODE_READ);
+	if (arc_c_max != size) {
+		zfs_nicenum(arc_c_max, label, sizeof (label));
+		(void) fprintf(stderr, "arc_sim: cache size %llu is out of "
+		    "range, using %s\n", (u_longlong_t)size, label);
+	}
+
+	start = gethrtime();
+	for (uint64_t i = 0; i < nrecs; i++) {
+		sim_rec_t *sr = &recs[i];
+		blkptr_t bp;
+
+		pace(start, recs[0].sr_time, sr->sr_time);
+
+		BP_ZERO(&bp);
+		bp.blk_dva[0] = sr->sr_dva;
+		BP_SET_LSIZE(&bp, sr->sr_lsize);
+		BP_SET_PSIZE(&bp, sr->sr_psize);
+		BP_SET_COMPRESS(&bp, sr->sr_psize < sr->sr_lsize ?
+		    ZIO_COMPRESS_LZ4 : ZIO_COMPRESS_OFF);
+		BP_SET_TYPE(&bp, sr->sr_type == ARC_BUFC_METADATA ?
+		    DMU_OT_DNODE : DMU_OT_PLAIN_FILE_CONTENTS);
+		BP_SET_BIRTH(&bp, sr->sr_birth, sr->sr_birth);
+
+		count_access(&ss, sr, arc_sim_access(sr->sr_spa, &bp,
+		    sr->sr_flags, sr->sr_class));
+	}
+
+	zfs_nicenum(size, label, sizeof (label));
+	print_stats(label, &ss);
+	if (verbose) {
+		(void) printf("%8s replayed in %.1fs, mru %llu mfu %llu\n", "",
+		    (double)(gethrtime() - start) / NANOSEC,
+		    (u_longlong_t)zfs_refcount_count(
+		    &ARC_mru.arcs_size[ARC_BUFC_DATA]) +
+		    zfs_refcount_count(&ARC_mru.arcs_size[ARC_BUFC_METADATA]),
+		    (u_longlong_t)zfs_refcount_count(
+		    &ARC_mfu.arcs_size[ARC_BUFC_DATA]) +
+		    zfs_refcount_count(&ARC_mfu.arcs_size[ARC_BUFC_METADATA]));
+	}
+	(void) fflush(stdout);
+}
+
+int
+main(int argc, char **argv)
+{
+	uint64_t sizes[MAX_SIZES];
+	pid_t pids[MAX_SIZES];
+	int fds[MAX_SIZES];
+	char *gvars[MAX_GVARS];
+	int nsizes = 0, ngvars = 0;
+	sim_stats_t trace = { 0 };
+	char *tok, *save;
+	int c;
+
+	while ((c = getopt(argc, argv, "j:o:s:vx:")) != -1) {
+		switch (c) {
+		case 'j':
+			njobs = strtol(optarg, NULL, 0);
+			if (njobs <= 0)
+				usage();
+			break;
+		case 'o':
+			if (ngvars == MAX_GVARS)
+				usage();
+			gvars[ngvars++] = optarg;
+			break;
+		case 's':
+			for (tok = strtok_r(optarg, ",", &save); tok != NULL;
+			    tok = strtok_r(NULL, ",", &save)) {
+				if (nsizes == MAX_SIZES)
+					usage();
+				sizes[nsizes++] = parse_size(tok);
+			}
+			break;
+		case 'v':
+			verbose++;
+			break;
+		case 'x':
+			speed = strtod(optarg, NULL);
+			if (speed < 0)
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc - 1)
+		usage();
+
+	read_trace(argv[optind]);
+
+	for (uint64_t i = 0; i < nrecs; i++) {
+		count_access(&trace, &recs[i],
+		    recs[i].sr_event != ARC_TRACE_MISS);
+	}
+
+	if (nsizes == 0) {
+		uint64_t footprint = trace_footprint();
+		uint64_t size = MIN_ARC_MAX;
+
+		do {
+			sizes[nsizes++] = size;
+			size <<= 1;
+		} while (size < 2 * footprint && nsizes < MAX_SIZES);
+	}
+
+	(void) printf("%8s %12s %12s %7s %10s\n", "size", "accesses", "hits",
+	    "hit%", "byte_hit%");
+	print_stats("trace", &trace);
+	(void) fflush(stdout);
+
+	if (njobs == 0 || njobs > nsizes)
+		njobs = nsizes;
+
+	for (int i = 0; i < nsizes; i++) {
+		int pipefd[2];
+
+		if (i >= njobs)
+			reap(pids[i - njobs], fds[i - njobs], sizes[i - njobs]);
+
+		if (pipe(pipefd) == -1 || (pids[i] = fork()) == -1) {
+			(void) fprintf(stderr, "arc_sim: fork failed: %s\n",
+			    strerror(errno));
+			exit(1);
+		}
+		if (pids[i] == 0) {
+			(void) close(pipefd[0]);
+			if (dup2(pipefd[1], STDOUT_FILENO) == -1)
+				exit(1);
+			(void) close(pipefd[1]);
+			simulate(sizes[i], gvars, ngvars);
+			exit(0);
+		}
+		(void) close(pipefd[1]);
+		fds[i] = pipefd[0];
+	}
+	for (int i = MAX(nsizes - njobs, 0); i < nsizes; i++)
+		reap(pids[i], fds[i], sizes[i]);
+
+	return (0);
+}
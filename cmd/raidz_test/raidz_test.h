@@ -36,6 +36,7 @@ static const char *const raidz_impl_names[] = {
 	"avx2",
 	"avx512f",
 	"avx512bw",
+	"gfni",
 	"aarch64_neon",
 	"aarch64_neonx2",
 	"powerpc_altivec",
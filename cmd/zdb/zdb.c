@@ -2461,7 +2461,8 @@ snprintf_zstd_header(spa_t *spa, char *blkbuf, size_t buflen,
 	zfs_zstdhdr_t zstd_hdr;
 	int error;
 
-	if (BP_GET_COMPRESS(bp) != ZIO_COMPRESS_ZSTD)
+	if (BP_GET_COMPRESS(bp) != ZIO_COMPRESS_ZSTD &&
+	    BP_GET_COMPRESS(bp) != ZIO_COMPRESS_ZSTD_FRAMES)
 		return;
 
 	if (BP_IS_HOLE(bp))
@@ -2602,7 +2603,7 @@ print_indirect(spa_t *spa, blkptr_t *bp, const zbookmark_phys_t *zb,
 	}
 
 	snprintf_blkptr_compact(blkbuf, sizeof (blkbuf), bp, B_FALSE);
-	if (dump_opt['Z'] && BP_GET_COMPRESS(bp) == ZIO_COMPRESS_ZSTD)
+	if (dump_opt['Z'])
 		snprintf_zstd_header(spa, blkbuf, sizeof (blkbuf), bp);
 	(void) printf("%s\n", blkbuf);
 }
@@ -8174,6 +8175,20 @@ mos_leak_log_spacemaps(spa_t *spa)
 		mos_obj_refd(sls->sls_sm_obj);
 }
 
+static void
+mos_leak_warm_list(spa_t *spa)
+{
+	uint64_t warm_obj;
+	int error = zap_lookup(spa_meta_objset(spa),
+	    DMU_POOL_DIRECTORY_OBJECT, DMU_POOL_WARM_LIST,
+	    sizeof (warm_obj), 1, &warm_obj);
+	if (error == ENOENT)
+		return;
+	ASSERT0(error);
+
+	mos_obj_refd(warm_obj);
+}
+
 static void
 errorlog_count_refd(objset_t *mos, uint64_t errlog)
 {
@@ -8228,6 +8243,7 @@ dump_mos_leaks(spa_t *spa)
 	if (spa->spa_syncing_log_sm != NULL)
 		mos_obj_refd(spa->spa_syncing_log_sm->sm_object);
 	mos_leak_log_spacemaps(spa);
+	mos_leak_warm_list(spa);
 
 	mos_obj_refd(spa->spa_condensing_indirect_phys.
 	    scip_next_mapping_object);
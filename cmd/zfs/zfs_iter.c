@@ -134,6 +134,13 @@ zfs_callback(zfs_handle_t *zhp, void *data)
 	    cb->cb_depth < cb->cb_depth_limit)) {
 		cb->cb_depth++;
 
+		/*
+		 * The iterators fetch only the properties in the props table
+		 * of the parent, so set it even if we are not listing zhp.
+		 */
+		if ((cb->cb_flags & ZFS_ITER_SELECTED_PROPS) && should_close)
+			zfs_prune_proplist(zhp, cb->cb_props_table);
+
 		/*
 		 * If we are not looking for filesystems, we don't need to
 		 * recurse into filesystems when we are at our depth limit.
@@ -483,6 +490,13 @@ zfs_for_each(int argc, char **argv, int flags, zfs_type_t types,
 
 		cb.cb_props_table[ZFS_PROP_ZONED] = B_TRUE;
 		cb.cb_props_table[ZFS_PROP_CREATETXG] = B_TRUE;
+
+		/*
+		 * The handles would be pruned anyway, so have the kernel
+		 * return only these properties in the first place.
+		 */
+		if (!(*cb.cb_proplist)->pl_all)
+			cb.cb_flags |= ZFS_ITER_SELECTED_PROPS;
 	} else {
 		(void) memset(cb.cb_props_table, B_TRUE,
 		    sizeof (cb.cb_props_table));
@@ -9712,6 +9712,15 @@ raidz_expand_status_nvlist(zpool_handle_t *zhp, status_cbdata_t *cb,
 		nice_num_str_nvlist(nv, "waiting_for_resilver",
 		    pres->pres_waiting_for_resilver, B_TRUE,
 		    cb->cb_json_as_int, ZFS_NICENUM_1024);
+		if (c > offsetof(pool_raidz_expand_stat_t,
+		    pres_pass_reflowed) / 8) {
+			nice_num_str_nvlist(nv, "pass_start",
+			    pres->pres_pass_start, cb->cb_literal,
+			    cb->cb_json_as_int, ZFS_NICE_TIMESTAMP);
+			nice_num_str_nvlist(nv, "pass_reflowed",
+			    pres->pres_pass_reflowed, cb->cb_literal,
+			    cb->cb_json_as_int, ZFS_NICENUM_BYTES);
+		}
 		fnvlist_add_nvlist(item, ZPOOL_CONFIG_RAIDZ_EXPAND_STATS, nv);
 		fnvlist_free(nv);
 		free(name);
@@ -10112,7 +10121,8 @@ print_removal_status(zpool_handle_t *zhp, pool_removal_stat_t *prs)
  * Print out detailed raidz expansion status.
  */
 static void
-print_raidz_expand_status(zpool_handle_t *zhp, pool_raidz_expand_stat_t *pres)
+print_raidz_expand_status(zpool_handle_t *zhp, pool_raidz_expand_stat_t *pres,
+    uint_t c)
 {
 	char copied_buf[7];
 
@@ -10167,10 +10177,23 @@ print_raidz_expand_status(zpool_handle_t *zhp, pool_raidz_expand_stat_t *pres)
 		total = pres->pres_to_reflow;
 		fraction_done = (double)copied / total;
 
+		/*
+		 * Use the rate of the current pass if the kernel reports it,
+		 * so that time spent paused (e.g. while the pool was
+		 * exported) does not skew the estimate.
+		 */
+		uint64_t pass_start = pres->pres_start_time;
+		uint64_t pass_copied = copied;
+		if (c > offsetof(pool_raidz_expand_stat_t,
+		    pres_pass_reflowed) / 8 && pres->pres_pass_start != 0) {
+			pass_start = pres->pres_pass_start;
+			pass_copied = pres->pres_pass_reflowed;
+		}
+
 		/* elapsed time for this pass */
-		elapsed = time(NULL) - pres->pres_start_time;
+		elapsed = time(NULL) - pass_start;
 		elapsed = elapsed > 0 ? elapsed : 1;
-		rate = copied / elapsed;
+		rate = pass_copied / elapsed;
 		rate = rate > 0 ? rate : 1;
 		secs_left = (total - copied) / rate;
 
@@ -10905,7 +10928,7 @@ status_callback(zpool_handle_t *zhp, void *data)
 		pool_raidz_expand_stat_t *pres = NULL;
 		(void) nvlist_lookup_uint64_array(nvroot,
 		    ZPOOL_CONFIG_RAIDZ_EXPAND_STATS, (uint64_t **)&pres, &c);
-		print_raidz_expand_status(zhp, pres);
+		print_raidz_expand_status(zhp, pres, c);
 
 		cbp->cb_namewidth = max_width(zhp, nvroot, 0, 0,
 		    cbp->cb_name_flags | VDEV_NAME_TYPE_ID);
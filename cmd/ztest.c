@@ -192,6 +192,7 @@ typedef struct ztest_shared_opts {
 	int zo_draid_spares;
 	int zo_datasets;
 	int zo_threads;
+	int zo_zil_writers;
 	uint64_t zo_passtime;
 	uint64_t zo_killrate;
 	int zo_verbose;
@@ -202,6 +203,7 @@ typedef struct ztest_shared_opts {
 	raidz_expand_test_state_t zo_raidz_expand_test;
 	int zo_mmp_test;
 	int zo_special_vdevs;
+	char zo_allocator[16];
 	int zo_dump_dbgmsg;
 	int zo_gvars_count;
 	char zo_gvars[ZO_GVARS_MAX_COUNT][ZO_GVARS_MAX_ARGLEN];
@@ -221,6 +223,7 @@ typedef struct ztest_shared_opts {
 #define	DEFAULT_DRAID_SPARES 1
 #define	DEFAULT_DATASETS_COUNT 7
 #define	DEFAULT_THREADS 23
+#define	DEFAULT_ZIL_WRITERS 0
 #define	DEFAULT_RUN_TIME 300 /* 300 seconds */
 #define	DEFAULT_RUN_TIME_STR "300 sec"
 #define	DEFAULT_PASS_TIME 60 /* 60 seconds */
@@ -251,6 +254,7 @@ static const ztest_shared_opts_t ztest_opts_defaults = {
 	.zo_draid_spares = DEFAULT_DRAID_SPARES, /* distributed spares */
 	.zo_datasets = DEFAULT_DATASETS_COUNT,
 	.zo_threads = DEFAULT_THREADS,
+	.zo_zil_writers = DEFAULT_ZIL_WRITERS,
 	.zo_passtime = DEFAULT_PASS_TIME,
 	.zo_killrate = DEFAULT_KILL_RATE,
 	.zo_verbose = 0,
@@ -260,10 +264,19 @@ static const ztest_shared_opts_t ztest_opts_defaults = {
 	.zo_maxloops = DEFAULT_MAX_LOOPS, /* max loops during spa_freeze() */
 	.zo_metaslab_force_ganging = DEFAULT_FORCE_GANGING,
 	.zo_special_vdevs = ZTEST_VDEV_CLASS_RND,
+	.zo_allocator = "dynamic",
 	.zo_gvars_count = 0,
 	.zo_raidz_expand_test = RAIDZ_EXPAND_NONE,
 };
 
+/*
+ * Metaslab allocators for -A, which picks one of them each pass when set
+ * to random.  new-dynamic is left out, as it cannot be selected yet.
+ */
+static const char *const ztest_allocators[] = {
+	"dynamic", "cursor", "segregated"
+};
+
 extern uint64_t metaslab_force_ganging;
 extern uint64_t metaslab_df_alloc_threshold;
 extern uint64_t zfs_deadman_synctime_ms;
@@ -416,6 +429,7 @@ ztest_func_t ztest_dmu_commit_callbacks;
 ztest_func_t ztest_zap;
 ztest_func_t ztest_zap_parallel;
 ztest_func_t ztest_zil_commit;
+ztest_func_t ztest_zil_commit_parallel;
 ztest_func_t ztest_zil_remount;
 ztest_func_t ztest_dmu_read_write_zcopy;
 ztest_func_t ztest_dmu_objset_create_destroy;
@@ -472,6 +486,7 @@ static ztest_info_t ztest_info[] = {
 	ZTI_INIT(ztest_zap_parallel, 100, &zopt_always),
 	ZTI_INIT(ztest_split_pool, 1, &zopt_sometimes),
 	ZTI_INIT(ztest_zil_commit, 1, &zopt_incessant),
+	ZTI_INIT(ztest_zil_commit_parallel, 1, &zopt_sometimes),
 	ZTI_INIT(ztest_zil_remount, 1, &zopt_sometimes),
 	ZTI_INIT(ztest_dmu_read_write_zcopy, 1, &zopt_often),
 	ZTI_INIT(ztest_dmu_objset_create_destroy, 1, &zopt_often),
@@ -779,6 +794,9 @@ static ztest_option_t option_table[] = {
 	    DEFAULT_DATASETS_COUNT, NULL},
 	{ 't',	"threads", "INTEGER", "Number of ztest threads",
 	    DEFAULT_THREADS, NULL},
+	{ 'W',	"zil-writers", "INTEGER",
+	    "Number of concurrent fsync writers in the ZIL commit test",
+	    DEFAULT_ZIL_WRITERS, NULL},
 	{ 'g',	"gang-block-threshold", "INTEGER",
 	    "Metaslab gang block threshold",
 	    NO_DEFAULT, DEFAULT_FORCE_GANGING_STR},
@@ -805,6 +823,9 @@ static ztest_option_t option_table[] = {
 	    NO_DEFAULT, NULL},
 	{ 'C',	"vdev-class-state", "on|off|random", "vdev class state",
 	    NO_DEFAULT, "random"},
+	{ 'A',	"allocator", "NAME",
+	    "Metaslab allocator: dynamic, cursor, segregated or random",
+	    NO_DEFAULT, "dynamic"},
 	{ 'X', "raidz-expansion", NULL,
 	    "Perform a dedicated raidz expansion test",
 	    NO_DEFAULT, NULL},
@@ -980,6 +1001,7 @@ process_options(int argc, char **argv)
 		case 'S':
 		case 'd':
 		case 't':
+		case 'W':
 		case 'g':
 		case 'i':
 		case 'k':
@@ -1022,6 +1044,9 @@ process_options(int argc, char **argv)
 		case 't':
 			zo->zo_threads = MAX(1, value);
 			break;
+		case 'W':
+			zo->zo_zil_writers = MAX(0, (int)value);
+			break;
 		case 'g':
 			zo->zo_metaslab_force_ganging =
 			    MAX(SPA_MINBLOCKSIZE << 1, value);
@@ -1076,6 +1101,20 @@ process_options(int argc, char **argv)
 		case 'C':
 			ztest_parse_name_value(optarg, zo);
 			break;
+		case 'A': {
+			int a = ARRAY_SIZE(ztest_allocators) - 1;
+
+			while (a >= 0 && strcmp(optarg, ztest_allocators[a]))
+				a--;
+			if (a < 0 && strcmp(optarg, "random") != 0) {
+				(void) fprintf(stderr,
+				    "invalid allocator '%s'\n", optarg);
+				usage(B_FALSE);
+			}
+			(void) strlcpy(zo->zo_allocator, optarg,
+			    sizeof (zo->zo_allocator));
+			break;
+		}
 		case 'o':
 			if (zo->zo_gvars_count >= ZO_GVARS_MAX_COUNT) {
 				(void) fprintf(stderr,
@@ -2979,6 +3018,90 @@ ztest_zil_commit(ztest_ds_t *zd, uint64_t id)
 	(void) pthread_rwlock_unlock(&zd->zd_zilog_lock);
 }
 
+#define	ZTEST_ZIL_OBJECTS	4
+#define	ZTEST_ZIL_WRITES	16
+
+typedef struct ztest_zil_writer {
+	ztest_ds_t	*zzw_zd;
+	uint64_t	zzw_object;
+	uint64_t	zzw_id;
+} ztest_zil_writer_t;
+
+/*
+ * One fsync writer: write a block tag and commit the ZIL for its object,
+ * like a write(2) followed by fsync(2), ZTEST_ZIL_WRITES times.
+ */
+static __attribute__((noreturn)) void
+ztest_zil_writer_thread(void *arg)
+{
+	ztest_zil_writer_t *zzw = arg;
+	ztest_ds_t *zd = zzw->zzw_zd;
+	ztest_block_tag_t wbt;
+	dmu_object_info_t doi;
+
+	VERIFY0(dmu_object_info(zd->zd_os, zzw->zzw_object, &doi));
+
+	for (int i = 0; i < ZTEST_ZIL_WRITES; i++) {
+		uint64_t offset = ((zzw->zzw_id * ZTEST_ZIL_WRITES + i) %
+		    ZTEST_RANGE_LOCKS) * doi.doi_data_block_size;
+
+		(void) pthread_rwlock_rdlock(&zd->zd_zilog_lock);
+		ztest_bt_generate(&wbt, zd->zd_os, zzw->zzw_object,
+		    doi.doi_dnodesize, offset, 0, 0, 0);
+		(void) ztest_write(zd, zzw->zzw_object, offset, sizeof (wbt),
+		    &wbt);
+		zil_commit(zd->zd_zilog, zzw->zzw_object);
+		(void) pthread_rwlock_unlock(&zd->zd_zilog_lock);
+	}
+
+	thread_exit();
+}
+
+/*
+ * Run ztest_opts.zo_zil_writers concurrent fsync writers against a handful
+ * of objects in one dataset, to stress itx assignment and commit batching
+ * when many threads are committing the same ZIL at once.
+ */
+void
+ztest_zil_commit_parallel(ztest_ds_t *zd, uint64_t id)
+{
+	int writers = ztest_opts.zo_zil_writers;
+	ztest_zil_writer_t *zzw;
+	kthread_t **threads;
+	ztest_od_t *od;
+
+	if (writers == 0)
+		return;
+
+	od = umem_alloc(sizeof (ztest_od_t) * ZTEST_ZIL_OBJECTS, UMEM_NOFAIL);
+	for (int i = 0; i < ZTEST_ZIL_OBJECTS; i++) {
+		ztest_od_init(od + i, id, FTAG, i, DMU_OT_UINT64_OTHER,
+		    0, 0, 0);
+	}
+	if (ztest_object_init(zd, od, sizeof (ztest_od_t) * ZTEST_ZIL_OBJECTS,
+	    B_FALSE) != 0) {
+		umem_free(od, sizeof (ztest_od_t) * ZTEST_ZIL_OBJECTS);
+		return;
+	}
+
+	zzw = umem_alloc(sizeof (ztest_zil_writer_t) * writers, UMEM_NOFAIL);
+	threads = umem_alloc(sizeof (kthread_t *) * writers, UMEM_NOFAIL);
+
+	for (int t = 0; t < writers; t++) {
+		zzw[t].zzw_zd = zd;
+		zzw[t].zzw_object = od[t % ZTEST_ZIL_OBJECTS].od_object;
+		zzw[t].zzw_id = t;
+		threads[t] = thread_create(NULL, 0, ztest_zil_writer_thread,
+		    &zzw[t], 0, NULL, TS_RUN | TS_JOINABLE, defclsyspri);
+	}
+	for (int t = 0; t < writers; t++)
+		VERIFY0(thread_join(threads[t]));
+
+	umem_free(threads, sizeof (kthread_t *) * writers);
+	umem_free(zzw, sizeof (ztest_zil_writer_t) * writers);
+	umem_free(od, sizeof (ztest_od_t) * ZTEST_ZIL_OBJECTS);
+}
+
 /*
  * This function is designed to simulate the operations that occur during a
  * mount/unmount operation.  We hold the dataset across these operations in an
@@ -6225,7 +6348,8 @@ ztest_dsl_prop_get_set(ztest_ds_t *zd, uint64_t id)
 		ZFS_PROP_CHECKSUM,
 		ZFS_PROP_COMPRESSION,
 		ZFS_PROP_COPIES,
-		ZFS_PROP_DEDUP
+		ZFS_PROP_DEDUP,
+		ZFS_PROP_ARCCLASS
 	};
 
 	(void) pthread_rwlock_rdlock(&ztest_name_lock);
@@ -8387,6 +8511,15 @@ ztest_run(ztest_shared_t *zs)
 	list_create(&zcl.zcl_callbacks, sizeof (ztest_cb_data_t),
 	    offsetof(ztest_cb_data_t, zcd_node));
 
+	if (strcmp(ztest_opts.zo_allocator, "random") == 0) {
+		zfs_active_allocator = ztest_allocators[
+		    ztest_random(ARRAY_SIZE(ztest_allocators))];
+	} else {
+		zfs_active_allocator = ztest_opts.zo_allocator;
+	}
+	if (ztest_opts.zo_verbose >= 3)
+		(void) printf("allocator: %s\n", zfs_active_allocator);
+
 	/*
 	 * Open our pool.  It may need to be imported first depending on
 	 * what tests were running when the previous pass was terminated.
@@ -704,6 +704,7 @@ _LIBZFS_H int zprop_collect_property(const char *, zprop_get_cbdata_t *,
 #define	ZFS_ITER_RECVD_PROPS		(1 << 4)
 #define	ZFS_ITER_LITERAL_PROPS		(1 << 5)
 #define	ZFS_ITER_SIMPLE			(1 << 6)
+#define	ZFS_ITER_SELECTED_PROPS		(1 << 7)
 
 typedef int (*zfs_iter_f)(zfs_handle_t *, void *);
 _LIBZFS_H int zfs_iter_root(libzfs_handle_t *, zfs_iter_f, void *);
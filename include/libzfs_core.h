@@ -61,6 +61,7 @@ _LIBZFS_CORE_H int lzc_destroy_snaps(nvlist_t *, boolean_t, nvlist_t **);
 _LIBZFS_CORE_H int lzc_bookmark(nvlist_t *, nvlist_t **);
 _LIBZFS_CORE_H int lzc_get_bookmarks(const char *, nvlist_t *, nvlist_t **);
 _LIBZFS_CORE_H int lzc_get_bookmark_props(const char *, nvlist_t **);
+_LIBZFS_CORE_H int lzc_list_batch(const char *, nvlist_t *, nvlist_t **);
 _LIBZFS_CORE_H int lzc_destroy_bookmarks(nvlist_t *, nvlist_t **);
 _LIBZFS_CORE_H int lzc_load_key(const char *, boolean_t, uint8_t *, uint_t);
 _LIBZFS_CORE_H int lzc_unload_key(const char *);
@@ -127,6 +128,7 @@ _LIBZFS_CORE_H int lzc_send_space_resume_redacted(const char *, const char *,
 _LIBZFS_CORE_H uint64_t lzc_send_progress(int);
 
 _LIBZFS_CORE_H boolean_t lzc_exists(const char *);
+_LIBZFS_CORE_H int lzc_get_space_stats(const char *, zfs_space_stats_t *);
 
 _LIBZFS_CORE_H int lzc_rollback(const char *, char *, int);
 _LIBZFS_CORE_H int lzc_rollback_to(const char *, const char *);
@@ -190,6 +190,15 @@ zfs_shani_available(void)
 	return (has_shani && __ymm_enabled());
 }
 
+/*
+ * Check if GFNI instruction set is available
+ */
+static inline boolean_t
+zfs_gfni_available(void)
+{
+	return ((cpu_stdext_feature2 & CPUID_STDEXT2_GFNI) != 0);
+}
+
 /*
  * AVX-512 family of instruction sets:
  *
@@ -55,6 +55,8 @@
  *
  *	zfs_shani_available()
  *
+ *	zfs_gfni_available()
+ *
  *	zfs_avx512f_available()
  *	zfs_avx512cd_available()
  *	zfs_avx512er_available()
@@ -610,6 +612,19 @@ zfs_shani_available(void)
 #endif
 }
 
+/*
+ * Check if GFNI instruction set is available
+ */
+static inline boolean_t
+zfs_gfni_available(void)
+{
+#if defined(X86_FEATURE_GFNI)
+	return (!!boot_cpu_has(X86_FEATURE_GFNI));
+#else
+	return (B_FALSE);
+#endif
+}
+
 /*
  * AVX-512 family of instruction sets:
  *
@@ -175,6 +175,7 @@ typedef enum cpuid_inst_sets {
 	PCLMULQDQ,
 	MOVBE,
 	SHANI,
+	GFNI,
 } cpuid_inst_sets_t;
 
 /*
@@ -200,6 +201,7 @@ typedef struct cpuid_feature_desc {
 #define	_PCLMULQDQ_BIT		(1U << 1)
 #define	_MOVBE_BIT		(1U << 22)
 #define	_SHANI_BIT		(1U << 29)
+#define	_GFNI_BIT		(1U << 8)
 
 /*
  * Descriptions of supported instruction sets
@@ -229,6 +231,7 @@ static const cpuid_feature_desc_t spl_cpuid_features[] = {
 	[PCLMULQDQ]	= {1U, 0U, _PCLMULQDQ_BIT,	ECX	},
 	[MOVBE]	= {1U, 0U, _MOVBE_BIT,	ECX	},
 	[SHANI]	= {1U, 0U, _SHANI_BIT,	EBX	},
+	[GFNI]	= {7U, 0U, _GFNI_BIT,	ECX	},
 };
 
 /*
@@ -298,6 +301,7 @@ CPUID_FEATURE_CHECK(avx512vl, AVX512VL);
 CPUID_FEATURE_CHECK(aes, AES);
 CPUID_FEATURE_CHECK(pclmulqdq, PCLMULQDQ);
 CPUID_FEATURE_CHECK(shani, SHANI);
+CPUID_FEATURE_CHECK(gfni, GFNI);
 CPUID_FEATURE_CHECK(movbe, MOVBE);
 
 
@@ -465,6 +469,15 @@ zfs_shani_available(void)
 	return (__cpuid_has_shani());
 }
 
+/*
+ * Check if GFNI instruction set is available
+ */
+static inline boolean_t
+zfs_gfni_available(void)
+{
+	return (__cpuid_has_gfni());
+}
+
 /*
  * AVX-512 family of instruction sets:
  *
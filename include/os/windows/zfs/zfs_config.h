@@ -105,6 +105,7 @@
 #define	HAVE_AVX512IFMA 1
 #define	HAVE_AVX512VBMI 1
 #define	HAVE_AVX512PF 1
+#define	HAVE_GFNI 1
 
 #define	LIBFETCH_IS_FETCH 1
 
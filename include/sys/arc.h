@@ -53,6 +53,14 @@ extern "C" {
  */
 #define	MIN_ARC_MAX	DMU_MAX_ACCESS
 
+/*
+ * Number of ARC classes selectable through the arcclass dataset property.
+ * Class 0 is the default and has no size targets; the others can be given
+ * a minimum and maximum size with the zfs_arc_class<N>_{min,max} tunables.
+ */
+#define	ARC_CLASS_COUNT		4
+#define	ARC_CLASS_DEFAULT	0
+
 #define	HDR_SET_LSIZE(hdr, x) do { \
 	ASSERT(IS_P2ALIGNED(x, 1U << SPA_MINBLOCKSHIFT)); \
 	(hdr)->b_lsize = ((x) >> SPA_MINBLOCKSHIFT); \
@@ -317,8 +325,18 @@ int arc_referenced(arc_buf_t *buf);
 int arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
     arc_read_done_func_t *done, void *priv, zio_priority_t priority,
     int flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb);
+int arc_read_class(zio_t *pio, spa_t *spa, const blkptr_t *bp,
+    arc_read_done_func_t *done, void *priv, zio_priority_t priority,
+    int flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb,
+    uint_t arc_class);
+#ifndef _KERNEL
+boolean_t arc_sim_access(uint64_t guid, const blkptr_t *bp,
+    arc_flags_t arc_flags, uint_t arc_class);
+boolean_t arc_bench_hash_find(uint64_t guid, const blkptr_t *bp);
+#endif
 zio_t *arc_write(zio_t *pio, spa_t *spa, uint64_t txg, blkptr_t *bp,
-    arc_buf_t *buf, boolean_t uncached, boolean_t l2arc, const zio_prop_t *zp,
+    arc_buf_t *buf, boolean_t uncached, boolean_t l2arc, uint_t arc_class,
+    const zio_prop_t *zp,
     arc_write_done_func_t *ready, arc_write_done_func_t *child_ready,
     arc_write_done_func_t *done, void *priv, zio_priority_t priority,
     int zio_flags, const zbookmark_phys_t *zb);
@@ -420,6 +420,13 @@ typedef struct l2arc_dev {
 	 */
 	zfs_refcount_t		l2ad_lb_count;
 	boolean_t		l2ad_trim_all; /* TRIM whole device */
+	/*
+	 * Feed scheduling, protected by l2arc_dev_mtx.  At most one feed
+	 * task runs for a device at a time.
+	 */
+	boolean_t		l2ad_feeding;	/* feed task in flight */
+	clock_t			l2ad_feed_next;	/* next feed due at lbolt */
+	uint_t			l2ad_feed_cursor; /* ARC sublist scan cursor */
 } l2arc_dev_t;
 
 /*
@@ -475,7 +482,7 @@ struct arc_buf_hdr {
 
 	arc_buf_contents_t	b_type;
 	uint8_t			b_complevel;
-	uint8_t			b_reserved1;	/* used for 4 byte alignment */
+	uint8_t			b_class;	/* ARC class, see arc.h */
 	uint16_t		b_l2size;	/* alignment or L2-only size */
 	arc_buf_hdr_t		*b_hash_next;
 	arc_flags_t		b_flags;
@@ -908,6 +915,25 @@ typedef struct arc_stats {
 	kstat_named_t arcstat_raw_size;
 	kstat_named_t arcstat_cached_only_in_progress;
 	kstat_named_t arcstat_abd_chunk_waste_size;
+	/*
+	 * Number of data misses the admission filter let into the
+	 * cache, and the number it turned away (cached only until released).
+	 */
+	kstat_named_t arcstat_admit_accepted;
+	kstat_named_t arcstat_admit_rejected;
+	/*
+	 * Per ARC class: logical size of the blocks cached in the MRU and
+	 * MFU states, hits, misses and bytes evicted.
+	 */
+	kstat_named_t arcstat_class_size[ARC_CLASS_COUNT];
+	kstat_named_t arcstat_class_hits[ARC_CLASS_COUNT];
+	kstat_named_t arcstat_class_misses[ARC_CLASS_COUNT];
+	kstat_named_t arcstat_class_evicted[ARC_CLASS_COUNT];
+	/*
+	 * Number of headers eviction stepped over because their ARC class
+	 * was protected.
+	 */
+	kstat_named_t arcstat_evict_class_skip;
 } arc_stats_t;
 
 typedef struct arc_sums {
@@ -1009,6 +1035,13 @@ typedef struct arc_sums {
 	wmsum_t arcstat_raw_size;
 	wmsum_t arcstat_cached_only_in_progress;
 	wmsum_t arcstat_abd_chunk_waste_size;
+	wmsum_t arcstat_admit_accepted;
+	wmsum_t arcstat_admit_rejected;
+	wmsum_t arcstat_class_size[ARC_CLASS_COUNT];
+	wmsum_t arcstat_class_hits[ARC_CLASS_COUNT];
+	wmsum_t arcstat_class_misses[ARC_CLASS_COUNT];
+	wmsum_t arcstat_class_evicted[ARC_CLASS_COUNT];
+	wmsum_t arcstat_evict_class_skip;
 } arc_sums_t;
 
 typedef struct arc_evict_waiter {
@@ -1058,6 +1091,8 @@ extern uint_t zfs_arc_pc_percent;
 extern uint_t arc_lotsfree_percent;
 extern uint64_t zfs_arc_min;
 extern uint64_t zfs_arc_max;
+extern int zfs_arc_admit;
+extern uint_t zfs_arc_admit_min_freq;
 
 extern uint64_t arc_reduce_target_size(uint64_t to_free);
 extern boolean_t arc_reclaim_needed(void);
@@ -1073,6 +1108,22 @@ extern void arc_tuning_update(boolean_t);
 extern void arc_register_hotplug(void);
 extern void arc_unregister_hotplug(void);
 
+#ifndef _KERNEL
+extern int arc_random_pressure;
+#endif
+
+typedef enum arc_trace_event {
+	ARC_TRACE_HIT,		/* found in the cache */
+	ARC_TRACE_IOHIT,	/* found with its read in progress */
+	ARC_TRACE_MISS,		/* read from disk */
+	ARC_TRACE_WRITE,	/* cached after being written */
+} arc_trace_event_t;
+
+extern void arc_trace_init(void);
+extern void arc_trace_fini(void);
+extern void arc_trace_record(const arc_buf_hdr_t *, arc_trace_event_t,
+    arc_flags_t);
+
 extern int param_set_arc_u64(ZFS_MODULE_PARAM_ARGS);
 extern int param_set_arc_int(ZFS_MODULE_PARAM_ARGS);
 extern int param_set_arc_min(ZFS_MODULE_PARAM_ARGS);
@@ -31,6 +31,7 @@
 #include <sys/dmu.h>
 #include <sys/kstat.h>
 #include <sys/zil.h>
+#include <sys/zio_compress.h>
 
 typedef struct dataset_sum_stats_t {
 	wmsum_t dss_writes;
@@ -57,6 +58,12 @@ typedef struct dataset_kstat_values {
 	 * entry is removed from the unlinked set
 	 */
 	kstat_named_t dkv_nunlinked;
+	/*
+	 * Writes stored uncompressed without calling the compressor because
+	 * the data looked incompressible, and their logical size
+	 */
+	kstat_named_t dkv_compress_skipped;
+	kstat_named_t dkv_compress_skipped_bytes;
 	/*
 	 * Per dataset zil kstats
 	 */
@@ -66,11 +73,13 @@ typedef struct dataset_kstat_values {
 typedef struct dataset_kstats {
 	dataset_sum_stats_t dk_sums;
 	zil_sums_t dk_zil_sums;
+	zio_compress_sums_t dk_compress_sums;
 	kstat_t *dk_kstats;
 } dataset_kstats_t;
 
 int dataset_kstats_create(dataset_kstats_t *, objset_t *);
 void dataset_kstats_destroy(dataset_kstats_t *);
+void dataset_kstats_attach(dataset_kstats_t *, objset_t *);
 void dataset_kstats_rename(dataset_kstats_t *dk, const char *);
 
 void dataset_kstats_update_write_kstats(dataset_kstats_t *, int64_t);
@@ -351,6 +351,7 @@ typedef struct dbuf_hash_table {
 } dbuf_hash_table_t;
 
 typedef void (*dbuf_prefetch_fn)(void *, uint64_t, uint64_t, boolean_t);
+typedef void (*dbuf_walk_fn)(dmu_buf_impl_t *, void *);
 
 extern kmem_cache_t *dbuf_dirty_kmem_cache;
 
@@ -386,6 +387,7 @@ void dbuf_rele_and_unlock(dmu_buf_impl_t *db, const void *tag,
 
 dmu_buf_impl_t *dbuf_find(struct objset *os, uint64_t object, uint8_t level,
     uint64_t blkid, uint64_t *hash_out);
+void dbuf_walk(spa_t *spa, dbuf_walk_fn func, void *arg);
 
 int dbuf_read(dmu_buf_impl_t *db, zio_t *zio, uint32_t flags);
 void dmu_buf_will_clone_or_dio(dmu_buf_t *db, dmu_tx_t *tx);
@@ -133,6 +133,7 @@ struct objset {
 	zfs_cache_type_t os_primary_cache;
 	zfs_cache_type_t os_secondary_cache;
 	zfs_prefetch_type_t os_prefetch;
+	uint8_t os_arc_class;
 	zfs_sync_type_t os_sync;
 	zfs_direct_t os_direct;
 	zfs_redundant_metadata_type_t os_redundant_metadata;
@@ -193,6 +194,13 @@ struct objset {
 	void *os_user_ptr;
 	sa_os_t *os_sa;
 
+	/*
+	 * Where to count writes stored uncompressed by
+	 * zio_compress_hopeless(): the dataset kstats of the owner, set by
+	 * dataset_kstats_attach() and cleared on disown, or NULL.
+	 */
+	zio_compress_sums_t *os_compress_sums;
+
 	/* kernel thread to upgrade this dataset */
 	kmutex_t os_upgrade_lock;
 	taskqid_t os_upgrade_id;
@@ -38,11 +38,14 @@ extern "C" {
 
 struct dnode;				/* so we can reference dnode */
 
+struct zpattern;			/* non-sequential access tracker */
+
 typedef struct zfetch {
 	kmutex_t	zf_lock;	/* protects zfetch structure */
 	list_t		zf_stream;	/* list of zstream_t's */
 	struct dnode	*zf_dnode;	/* dnode that owns this zfetch */
 	int		zf_numstreams;	/* number of zstream_t's */
+	struct zpattern	*zf_patterns;	/* allocated on first use */
 } zfetch_t;
 
 typedef struct zsrange {
@@ -73,6 +76,23 @@ typedef struct zstream {
 	zfs_refcount_t	zs_refs;
 } zstream_t;
 
+#define	ZFETCH_PATTERNS	4		/* strided/reverse trackers */
+
+/*
+ * Tracks one strided (including reverse-sequential) access pattern that
+ * the forward-sequential streams above can not follow.  The stride is
+ * learned from the distance between consecutive accesses, and zp_conf
+ * counts how many accesses in a row confirmed it.
+ */
+typedef struct zpattern {
+	uint64_t	zp_last;	/* blkid of the last access */
+	int64_t		zp_stride;	/* signed blkid distance, 0 if none */
+	uint64_t	zp_pf_next;	/* next blkid not yet prefetched */
+	uint_t		zp_atime;	/* time of the last access */
+	uint_t		zp_conf;	/* confidence score */
+	zstream_t	*zp_stream;	/* references of pending blocks */
+} zpattern_t;
+
 void		zfetch_init(void);
 void		zfetch_fini(void);
 
@@ -163,6 +163,7 @@ int dsl_dir_get_filesystem_count(dsl_dir_t *dd, uint64_t *count);
 int dsl_dir_get_snapshot_count(dsl_dir_t *dd, uint64_t *count);
 
 void dsl_dir_stats(dsl_dir_t *dd, nvlist_t *nv);
+void dsl_dir_space_stats(dsl_dir_t *dd, zfs_space_stats_t *zss);
 uint64_t dsl_dir_space_available(dsl_dir_t *dd,
     dsl_dir_t *ancestor, int64_t delta, int ondiskonly);
 void dsl_dir_dirty(dsl_dir_t *dd, dmu_tx_t *tx);
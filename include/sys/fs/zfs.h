@@ -199,6 +199,7 @@ typedef enum {
 	ZFS_PROP_LONGNAME,
 	ZFS_PROP_MIMIC,			/* Windows: mimic=ntfs */
 	ZFS_PROP_DRIVELETTER,
+	ZFS_PROP_ARCCLASS,
 	ZFS_NUM_PROPS
 } zfs_prop_t;
 
@@ -1207,6 +1208,10 @@ typedef struct pool_raidz_expand_stat {
 	uint64_t pres_to_reflow; /* bytes that need to be moved */
 	uint64_t pres_reflowed; /* bytes moved so far */
 	uint64_t pres_waiting_for_resilver;
+
+	/* values not stored on disk */
+	uint64_t pres_pass_start; /* start time of this reflow pass */
+	uint64_t pres_pass_reflowed; /* bytes moved in this reflow pass */
 } pool_raidz_expand_stat_t;
 
 typedef enum dsl_scan_state {
@@ -1563,6 +1568,8 @@ typedef enum zfs_ioc {
 	ZFS_IOC_POOL_SCRUB,			/* 0x5a57 */
 	ZFS_IOC_POOL_PREFETCH,			/* 0x5a58 */
 	ZFS_IOC_DDT_PRUNE,			/* 0x5a59 */
+	ZFS_IOC_LIST_BATCH,			/* 0x5a5a */
+	ZFS_IOC_OBJSET_SPACE,			/* 0x5a5b */
 
 	/*
 	 * Per-platform (Optional) - 8/128 numbers reserved.
@@ -1814,6 +1821,55 @@ typedef enum {
 #define	DDT_PRUNE_UNIT		"ddt_prune_unit"
 #define	DDT_PRUNE_AMOUNT	"ddt_prune_amount"
 
+/*
+ * The following are names used when invoking ZFS_IOC_LIST_BATCH.
+ */
+#define	ZFS_LIST_BATCH_SNAPSHOTS	"list_snapshots"
+#define	ZFS_LIST_BATCH_COOKIE		"list_cookie"
+#define	ZFS_LIST_BATCH_COUNT		"list_count"
+#define	ZFS_LIST_BATCH_PROPS		"list_props"
+#define	ZFS_LIST_BATCH_USERPROPS	"list_userprops"
+#define	ZFS_LIST_BATCH_ENTRIES		"list_entries"
+#define	ZFS_LIST_BATCH_STATS		"list_stats"
+
+/*
+ * Space usage and identity of a dataset, returned by ZFS_IOC_OBJSET_SPACE
+ * in a fixed layout so that they can be read without packing and unpacking
+ * an nvlist of properties.  Each field holds the value of the property of
+ * the same name.  The dataset-level fields (quota, reservation, logicalused
+ * and the used breakdown) are zero for snapshots, which do not have these
+ * properties.
+ *
+ * Fields may only be appended.  The kernel fills in as much of the
+ * structure as fits in the caller's buffer, and reports how much it filled.
+ */
+typedef struct zfs_space_stats {
+	uint64_t	zss_flags;		/* ZSS_* */
+	uint64_t	zss_guid;
+	uint64_t	zss_creation;
+	uint64_t	zss_createtxg;
+	uint64_t	zss_used;
+	uint64_t	zss_referenced;
+	uint64_t	zss_available;
+	uint64_t	zss_logicalused;
+	uint64_t	zss_logicalreferenced;
+	uint64_t	zss_compressratio;
+	uint64_t	zss_refratio;
+	uint64_t	zss_usedsnap;
+	uint64_t	zss_usedds;
+	uint64_t	zss_usedchild;
+	uint64_t	zss_usedrefreserv;
+	uint64_t	zss_quota;
+	uint64_t	zss_reservation;
+	uint64_t	zss_refquota;
+	uint64_t	zss_refreservation;
+	uint64_t	zss_written;
+} zfs_space_stats_t;
+
+#define	ZSS_SNAPSHOT		(1ULL << 0)	/* dataset is a snapshot */
+#define	ZSS_USED_BREAKDOWN	(1ULL << 1)	/* zss_used{snap,...} are set */
+#define	ZSS_WRITTEN		(1ULL << 2)	/* zss_written is set */
+
 /*
  * Flags for ZFS_IOC_VDEV_SET_STATE
  */
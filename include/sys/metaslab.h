@@ -63,12 +63,14 @@ uint64_t metaslab_unflushed_changes_memused(metaslab_t *);
 int metaslab_load(metaslab_t *);
 void metaslab_unload(metaslab_t *);
 boolean_t metaslab_flush(metaslab_t *, dmu_tx_t *);
+void metaslab_condense_thread_start(spa_t *);
 
 uint64_t metaslab_allocated_space(metaslab_t *);
 
 void metaslab_sync(metaslab_t *, uint64_t);
 void metaslab_sync_done(metaslab_t *, uint64_t);
 void metaslab_sync_reassess(metaslab_group_t *);
+void metaslab_preload_import(spa_t *, boolean_t);
 uint64_t metaslab_largest_allocatable(metaslab_t *);
 
 /*
@@ -142,6 +144,13 @@ extern int metaslab_debug_load;
 range_seg_type_t metaslab_calculate_range_tree_type(vdev_t *vdev,
     metaslab_t *msp, uint64_t *start, uint64_t *shift);
 
+#ifndef _KERNEL
+metaslab_t *metaslab_bench_create(const char *, uint64_t, uint64_t);
+void metaslab_bench_destroy(metaslab_t *);
+uint64_t metaslab_bench_alloc(metaslab_t *, uint64_t);
+void metaslab_bench_free(metaslab_t *, uint64_t, uint64_t);
+#endif
+
 #ifdef	__cplusplus
 }
 #endif
@@ -426,6 +426,29 @@ struct metaslab {
 	boolean_t	ms_condensing;	/* condensing? */
 	boolean_t	ms_condense_wanted;
 
+	/*
+	 * State of background condensing [see metaslab_condense_prepare()].
+	 * While ms_condense_allocs is set, ms_condense_buf holds the
+	 * encoded free space of the metaslab as of when it was prepared,
+	 * and ms_condense_{allocs,frees} hold the changes that have been
+	 * synced since.  ms_condense_node and ms_condense_queued are
+	 * protected by the spa_ms_condense_lock, the rest by the ms_lock.
+	 * While ms_condense_preparing is set, ms_allocatable is being
+	 * encoded without the ms_lock held: the metaslab is not allocated
+	 * from, and anything else that changes ms_allocatable waits on
+	 * ms_condense_cv first.
+	 */
+	list_node_t	ms_condense_node;
+	boolean_t	ms_condense_queued;
+	boolean_t	ms_condense_preparing;
+	kcondvar_t	ms_condense_cv;
+	range_tree_t	*ms_condense_allocs;
+	range_tree_t	*ms_condense_frees;
+	uint64_t	*ms_condense_buf;
+	uint64_t	ms_condense_bufsize;	/* bytes allocated */
+	uint64_t	ms_condense_nwords;	/* words used */
+	uint64_t	ms_condense_space;	/* free space encoded in buf */
+
 	/*
 	 * The number of consumers which have disabled the metaslab.
 	 */
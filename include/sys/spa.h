@@ -910,6 +910,7 @@ typedef struct spa_stats {
 	spa_history_list_t	read_history;
 	spa_history_list_t	txg_history;
 	spa_history_kstat_t	tx_assign_histogram;
+	spa_history_kstat_t	txg_sync_histogram;
 	spa_history_list_t	mmp_history;
 	spa_history_kstat_t	state;		/* pool state */
 	spa_history_kstat_t	guid;		/* pool guid */
@@ -960,6 +961,13 @@ typedef struct spa_iostats {
 	kstat_named_t	direct_read_bytes;
 	kstat_named_t	direct_write_count;
 	kstat_named_t	direct_write_bytes;
+	kstat_named_t	warm_saved_blocks;
+	kstat_named_t	warm_restore_blocks;
+	kstat_named_t	warm_restore_issued;
+	kstat_named_t	warm_restore_skipped;
+	kstat_named_t	warm_restore_failed;
+	kstat_named_t	scan_queues_drained;
+	kstat_named_t	scan_queues_held;
 } spa_iostats_t;
 
 extern void spa_stats_init(spa_t *spa);
@@ -973,6 +981,7 @@ extern txg_stat_t *spa_txg_history_init_io(spa_t *, uint64_t,
     struct dsl_pool *);
 extern void spa_txg_history_fini_io(spa_t *, txg_stat_t *);
 extern void spa_tx_assign_add_nsecs(spa_t *spa, uint64_t nsecs);
+extern void spa_txg_sync_add_nsecs(spa_t *spa, uint64_t nsecs);
 extern int spa_mmp_history_set_skip(spa_t *spa, uint64_t mmp_kstat_id);
 extern int spa_mmp_history_set(spa_t *spa, uint64_t mmp_kstat_id, int io_error,
     hrtime_t duration);
@@ -987,6 +996,10 @@ extern void spa_iostats_read_add(spa_t *spa, uint64_t size, uint64_t iops,
     uint32_t flags);
 extern void spa_iostats_write_add(spa_t *spa, uint64_t size, uint64_t iops,
     uint32_t flags);
+extern void spa_iostats_warm_add(spa_t *spa, uint64_t saved,
+    uint64_t restore, uint64_t issued, uint64_t skipped, uint64_t failed);
+extern void spa_iostats_scan_add(spa_t *spa, uint64_t drained,
+    uint64_t held);
 extern void spa_import_progress_add(spa_t *spa);
 extern void spa_import_progress_remove(uint64_t spa_guid);
 extern int spa_import_progress_set_mmp_check(uint64_t pool_guid,
@@ -1211,6 +1224,10 @@ extern void name_to_errphys(char *buf, zbookmark_err_phys_t *zep);
 extern void vdev_mirror_stat_init(void);
 extern void vdev_mirror_stat_fini(void);
 
+/* vdev queue */
+extern void vdev_queue_stat_init(void);
+extern void vdev_queue_stat_fini(void);
+
 /* Initialization and termination */
 extern void spa_init(spa_mode_t mode);
 extern void spa_fini(void);
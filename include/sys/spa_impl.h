@@ -361,11 +361,22 @@ struct spa {
 	list_t		spa_log_summary;
 	uint64_t	spa_log_flushall_txg;
 
+	kmutex_t	spa_ms_condense_lock;	/* for the fields below */
+	list_t		spa_ms_condense_list;	/* metaslabs to condense */
+	uint64_t	spa_ms_condense_txg;	/* txg of ms_condense_bytes */
+	uint64_t	spa_ms_condense_bytes;	/* condensed in that txg */
+	zthr_t		*spa_ms_condense_zthr;	/* background condensing */
+
 	zthr_t		*spa_livelist_delete_zthr; /* deleting livelists */
 	zthr_t		*spa_livelist_condense_zthr; /* condensing livelists */
 	uint64_t	spa_livelists_to_delete; /* set of livelists to free */
 	livelist_condense_entry_t	spa_to_condense; /* next to condense */
 
+	zthr_t		*spa_warm_zthr;	/* warm restart list save/restore */
+	boolean_t	spa_warm_restore_pending; /* list not yet restored */
+	uint64_t	spa_warm_restore_pos; /* next list entry to restore */
+	hrtime_t	spa_warm_last_save; /* last list update */
+
 	char		*spa_root;		/* alternate root directory */
 	uint64_t	spa_ena;		/* spa-wide ereport ENA */
 	int		spa_last_open_failed;	/* error if last open failed */
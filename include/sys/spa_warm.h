@@ -0,0 +1,61 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+#ifndef _SYS_SPA_WARM_H
+#define	_SYS_SPA_WARM_H
+
+#include <sys/spa.h>
+#include <sys/zthr.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define	SPA_WARM_MAGIC		0x5741524d4c495354ULL	/* "WARMLIST" */
+#define	SPA_WARM_LEVEL_SHIFT	56
+
+/*
+ * On-disk format of the warm list.  The MOS object referenced by
+ * DMU_POOL_WARM_LIST holds a spa_warm_phys_t followed by swp_count
+ * entries, the first swp_mfu of which were in the MFU state when the list
+ * was taken.  Each run is sorted by objset, object, level (descending) and
+ * block id, so that restoring it reads indirect blocks before the blocks
+ * below them.
+ */
+typedef struct spa_warm_phys {
+	uint64_t swp_magic;
+	uint64_t swp_count;	/* number of entries */
+	uint64_t swp_mfu;	/* leading entries taken from the MFU */
+} spa_warm_phys_t;
+
+typedef struct spa_warm_ent {
+	uint64_t swe_objset;	/* dataset object number */
+	uint64_t swe_object;
+	uint64_t swe_blkid;	/* level in the top byte */
+} spa_warm_ent_t;
+
+void spa_start_warm_thread(spa_t *);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* _SYS_SPA_WARM_H */
@@ -228,6 +228,10 @@ uint64_t space_map_nblocks(space_map_t *sm);
 
 void space_map_write(space_map_t *sm, range_tree_t *rt, maptype_t maptype,
     uint64_t vdev_id, dmu_tx_t *tx);
+uint64_t space_map_encode(space_map_t *sm, range_tree_t *rt, maptype_t maptype,
+    uint64_t *buf, uint64_t nwords);
+void space_map_write_encoded(space_map_t *sm, const uint64_t *buf,
+    uint64_t nwords, maptype_t maptype, uint64_t space, dmu_tx_t *tx);
 uint64_t space_map_estimate_optimal_size(space_map_t *sm, range_tree_t *rt,
     uint64_t vdev_id);
 void space_map_truncate(space_map_t *sm, int blocksize, dmu_tx_t *tx);
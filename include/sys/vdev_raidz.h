@@ -109,6 +109,13 @@ typedef struct vdev_raidz_expand {
 	 */
 	uint64_t vre_bytes_copied_pertxg[TXG_SIZE];
 
+	/*
+	 * Start time and bytes already copied when the expansion thread
+	 * last (re)started, used to report the rate of the current pass.
+	 */
+	uint64_t vre_pass_start;
+	uint64_t vre_pass_copied_base;
+
 	/*
 	 * The rangelock prevents normal read/write zio's from happening while
 	 * there are expansion (reflow) i/os in progress to the same offsets.
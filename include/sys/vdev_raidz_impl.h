@@ -184,6 +184,9 @@ extern const raidz_impl_ops_t vdev_raidz_avx512f_impl;
 #if defined(__x86_64) && defined(HAVE_AVX512BW)	/* only x86_64 for now */
 extern const raidz_impl_ops_t vdev_raidz_avx512bw_impl;
 #endif
+#if defined(__x86_64) && defined(HAVE_AVX512F) && defined(HAVE_GFNI)
+extern const raidz_impl_ops_t vdev_raidz_gfni_impl;
+#endif
 #if defined(__aarch64__)
 extern const raidz_impl_ops_t vdev_raidz_aarch64_neon_impl;
 extern const raidz_impl_ops_t vdev_raidz_aarch64_neonx2_impl;
@@ -159,10 +159,24 @@ typedef struct itxs {
 	avl_tree_t	i_async_tree;	/* tree of foids for async itxs */
 } itxs_t;
 
+/*
+ * Sync itxs are queued on per-CPU sublists so that concurrent synchronous
+ * writers don't all serialize on itxg_lock.  Each itx is stamped with a
+ * per-zilog sequence number while its list lock is held, which keeps every
+ * list sorted and lets zil_get_commit_list() merge them back into the order
+ * the itxs were assigned in.  itxg_txg and itxg_itxs may only be changed
+ * with itxg_lock and all of the sublist locks held.
+ */
+typedef struct itx_sublist {
+	kmutex_t	is_lock;	/* protects is_list */
+	list_t		is_list;	/* sync itxs queued from this CPU */
+} ____cacheline_aligned itx_sublist_t;
+
 typedef struct itxg {
 	kmutex_t	itxg_lock;	/* lock for this structure */
 	uint64_t	itxg_txg;	/* txg for this chain */
 	itxs_t		*itxg_itxs;	/* sync and async itxs */
+	itx_sublist_t	*itxg_sublists;	/* per-CPU sync itx lists */
 } itxg_t;
 
 /* for async nodes we build up an AVL tree of lists of async itxs per file */
@@ -215,6 +229,8 @@ struct zilog {
 	uint64_t	zl_parse_blk_count; /* number of blocks parsed */
 	uint64_t	zl_parse_lr_count; /* number of log records parsed */
 	itxg_t		zl_itxg[TXG_SIZE]; /* intent log txg chains */
+	uint_t		zl_itx_nsublists; /* per-CPU sync lists per itxg */
+	uint64_t	zl_itx_seq;	/* itx assignment order */
 	list_t		zl_itx_commit_list; /* itx list to be committed */
 	uint64_t	zl_cur_size;	/* current burst full size */
 	uint64_t	zl_cur_left;	/* current burst remaining size */
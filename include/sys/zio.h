@@ -363,6 +363,7 @@ typedef struct zio_prop {
 	uint8_t			zp_mac[ZIO_DATA_MAC_LEN];
 	uint32_t		zp_zpl_smallblk;
 	dmu_object_type_t	zp_storage_type;
+	struct zio_compress_sums *zp_compress_sums;
 } zio_prop_t;
 
 typedef struct zio_cksum_report zio_cksum_report_t;
@@ -410,6 +411,7 @@ typedef struct zio_transform {
 	uint64_t		zt_orig_size;
 	uint64_t		zt_bufsize;
 	zio_transform_func_t	*zt_transform;
+	struct abd		*zt_linear_abd;
 	struct zio_transform	*zt_next;
 } zio_transform_t;
 
@@ -484,6 +486,7 @@ struct zio {
 	/* Data represented by this I/O */
 	struct abd	*io_abd;
 	struct abd	*io_orig_abd;
+	struct abd	*io_verified_abd;	/* checksummed linear copy */
 	uint64_t	io_size;
 	uint64_t	io_orig_size;
 
@@ -499,6 +502,7 @@ struct zio {
 		avl_node_t a;
 	} io_queue_node ____cacheline_aligned;	/* allocator and vdev queues */
 	avl_node_t	io_offset_node;	/* vdev offset queues */
+	list_node_t	io_deadline_node; /* vdev async read FIFO */
 	uint64_t	io_offset;
 	hrtime_t	io_timestamp;	/* submitted at */
 	hrtime_t	io_queued_timestamp;
@@ -662,6 +666,8 @@ extern enum zio_compress zio_compress_select(spa_t *spa,
     enum zio_compress child, enum zio_compress parent);
 extern uint8_t zio_complevel_select(spa_t *spa, enum zio_compress compress,
     uint8_t child, uint8_t parent);
+extern enum zio_compress zio_compress_for_block(spa_t *spa,
+    enum zio_compress c, uint64_t lsize);
 
 extern void zio_suspend(spa_t *spa, zio_t *zio, zio_suspend_reason_t);
 extern int zio_resume(spa_t *spa);
@@ -138,6 +138,8 @@ extern zio_checksum_tmpl_free_t abd_checksum_blake3_tmpl_free;
 _SYS_ZIO_CHECKSUM_H zio_abd_checksum_func_t fletcher_4_abd_ops;
 extern zio_checksum_t abd_fletcher_4_native;
 extern zio_checksum_t abd_fletcher_4_byteswap;
+extern void abd_fletcher_4_copy_native(struct abd *, void *, uint64_t,
+    zio_cksum_t *);
 
 extern int zio_checksum_equal(spa_t *, blkptr_t *, enum zio_checksum,
     void *, uint64_t, uint64_t, zio_bad_cksum_t *);
@@ -146,6 +148,9 @@ extern void zio_checksum_compute(zio_t *, enum zio_checksum,
 extern int zio_checksum_error_impl(spa_t *, const blkptr_t *, enum zio_checksum,
     struct abd *, uint64_t, uint64_t, zio_bad_cksum_t *);
 extern int zio_checksum_error(zio_t *zio, zio_bad_cksum_t *out);
+extern int zio_checksum_error_copy(zio_t *zio, struct abd *dst,
+    zio_bad_cksum_t *out);
+extern int zio_checksum_verify_fused(zio_t *zio, zio_bad_cksum_t *out);
 extern enum zio_checksum spa_dedup_checksum(spa_t *spa);
 extern void zio_checksum_templates_free(spa_t *spa);
 extern spa_feature_t zio_checksum_to_feature(enum zio_checksum cksum);
@@ -32,6 +32,7 @@
 #define	_SYS_ZIO_COMPRESS_H
 
 #include <sys/abd.h>
+#include <sys/wmsum.h>
 
 #ifdef	__cplusplus
 extern "C" {
@@ -55,13 +56,15 @@ enum zio_compress {
 	ZIO_COMPRESS_ZLE,
 	ZIO_COMPRESS_LZ4,
 	ZIO_COMPRESS_ZSTD,
+	ZIO_COMPRESS_ZSTD_FRAMES,
 	ZIO_COMPRESS_FUNCTIONS
 };
 
 /* Compression algorithms that have levels */
 #define	ZIO_COMPRESS_HASLEVEL(compress)	((compress == ZIO_COMPRESS_ZSTD || \
-					(compress >= ZIO_COMPRESS_GZIP_1 && \
-					compress <= ZIO_COMPRESS_GZIP_9)))
+				compress == ZIO_COMPRESS_ZSTD_FRAMES || \
+				(compress >= ZIO_COMPRESS_GZIP_1 && \
+				compress <= ZIO_COMPRESS_GZIP_9)))
 
 #define	ZIO_COMPLEVEL_INHERIT	0
 #define	ZIO_COMPLEVEL_DEFAULT	255
@@ -180,6 +183,21 @@ extern int zio_decompress_data(enum zio_compress c, abd_t *src, abd_t *abd,
     size_t s_len, size_t d_len, uint8_t *level);
 extern int zio_compress_to_feature(enum zio_compress comp);
 
+/*
+ * Writes for which compression was skipped because the data looked
+ * incompressible, kept per objset and reported through dataset kstats.
+ */
+typedef struct zio_compress_sums {
+	wmsum_t zcs_skipped;
+	wmsum_t zcs_skipped_bytes;
+} zio_compress_sums_t;
+
+extern void zio_compress_init(void);
+extern void zio_compress_fini(void);
+extern boolean_t zio_compress_hopeless(abd_t *src, size_t s_len);
+extern void zio_compress_sums_init(zio_compress_sums_t *zcs);
+extern void zio_compress_sums_fini(zio_compress_sums_t *zcs);
+
 #define	ZFS_COMPRESS_WRAP_DECL(name)					\
 size_t									\
 name(abd_t *src, abd_t *dst, size_t s_len, size_t d_len, int n)		\
@@ -74,6 +74,32 @@ typedef struct zfs_zstd_meta {
 	uint32_t version;
 } zfs_zstdmeta_t;
 
+/*
+ * Blocks compressed with ZIO_COMPRESS_ZSTD_FRAMES are a series of
+ * independent frames, each covering zft_frame_size bytes of the input, so
+ * that the frames can be compressed and decompressed in parallel.  The
+ * frames are concatenated in zfs_zstdhdr_t.data and c_len covers all of
+ * them.  The frame table follows immediately after the last frame.  All
+ * fields are stored big-endian, like the header.
+ *
+ * The frame size is part of the on-disk format: the same record must always
+ * compress to the same bytes, or nopwrite, dedup and recompression for the
+ * L2ARC would stop matching the blocks already written.
+ */
+#define	ZFS_ZSTD_FRAME_MAGIC	0x5a465446	/* "ZFTF" */
+#define	ZFS_ZSTD_FRAME_SIZE	(1U << 20)
+#define	ZFS_ZSTD_FRAMES_MIN_SIZE	(2 * ZFS_ZSTD_FRAME_SIZE)
+
+typedef struct zfs_zstd_frame_table {
+	uint32_t zft_magic;
+	uint32_t zft_nframes;
+	uint32_t zft_frame_size;
+	uint32_t zft_frame_len[];	/* compressed size of each frame */
+} zfs_zstd_frametable_t;
+
+#define	ZFS_ZSTD_FRAMETABLE_SIZE(n)	\
+	(sizeof (zfs_zstd_frametable_t) + (n) * sizeof (uint32_t))
+
 /*
  * kstat helper macros
  */
@@ -97,6 +123,12 @@ int zfs_zstd_decompress_level(abd_t *src, abd_t *dst, size_t s_len,
     size_t d_len, uint8_t *level);
 int zfs_zstd_decompress(abd_t *src, abd_t *dst, size_t s_len,
     size_t d_len, int n);
+size_t zfs_zstd_compress_frames(abd_t *src, abd_t *dst, size_t s_len,
+    size_t d_len, int level);
+int zfs_zstd_decompress_frames_level(abd_t *src, abd_t *dst, size_t s_len,
+    size_t d_len, uint8_t *level);
+int zfs_zstd_decompress_frames(abd_t *src, abd_t *dst, size_t s_len,
+    size_t d_len, int n);
 void zfs_zstd_cache_reap_now(void);
 
 /*
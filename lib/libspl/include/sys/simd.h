@@ -101,7 +101,8 @@ typedef enum cpuid_inst_sets {
 	AES,
 	PCLMULQDQ,
 	MOVBE,
-	SHA_NI
+	SHA_NI,
+	GFNI
 } cpuid_inst_sets_t;
 
 /*
@@ -127,6 +128,7 @@ typedef struct cpuid_feature_desc {
 #define	_PCLMULQDQ_BIT		(1U << 1)
 #define	_MOVBE_BIT		(1U << 22)
 #define	_SHA_NI_BIT		(1U << 29)
+#define	_GFNI_BIT		(1U << 8)
 
 /*
  * Descriptions of supported instruction sets
@@ -156,6 +158,7 @@ static const cpuid_feature_desc_t cpuid_features[] = {
 	[PCLMULQDQ]	= {1U, 0U, _PCLMULQDQ_BIT,	ECX	},
 	[MOVBE]		= {1U, 0U, _MOVBE_BIT,		ECX	},
 	[SHA_NI]	= {7U, 0U, _SHA_NI_BIT,		EBX	},
+	[GFNI]		= {7U, 0U, _GFNI_BIT,		ECX	},
 };
 
 /*
@@ -230,6 +233,7 @@ CPUID_FEATURE_CHECK(aes, AES);
 CPUID_FEATURE_CHECK(pclmulqdq, PCLMULQDQ);
 CPUID_FEATURE_CHECK(movbe, MOVBE);
 CPUID_FEATURE_CHECK(shani, SHA_NI);
+CPUID_FEATURE_CHECK(gfni, GFNI);
 
 /*
  * Detect register set support
@@ -380,6 +384,15 @@ zfs_shani_available(void)
 	return (__cpuid_has_shani());
 }
 
+/*
+ * Check if GFNI instruction set is available
+ */
+static inline boolean_t
+zfs_gfni_available(void)
+{
+	return (__cpuid_has_gfni());
+}
+
 /*
  * AVX-512 family of instruction sets:
  *
@@ -377,15 +377,9 @@ get_recvd_props_ioctl(zfs_handle_t *zhp)
 }
 
 static int
-put_stats_zhdl(zfs_handle_t *zhp, zfs_cmd_t *zc)
+put_props_zhdl(zfs_handle_t *zhp, nvlist_t *allprops)
 {
-	nvlist_t *allprops, *userprops;
-
-	zhp->zfs_dmustats = zc->zc_objset_stats; /* structure assignment */
-
-	if (zcmd_read_dst_nvlist(zhp->zfs_hdl, zc, &allprops) != 0) {
-		return (-1);
-	}
+	nvlist_t *userprops;
 
 	/*
 	 * XXX Why do we store the user props separately, in addition to
@@ -401,10 +395,26 @@ put_stats_zhdl(zfs_handle_t *zhp, zfs_cmd_t *zc)
 
 	zhp->zfs_props = allprops;
 	zhp->zfs_user_props = userprops;
+	zhp->zfs_props_table = NULL;
+	zhp->zfs_props_partial = B_FALSE;
 
 	return (0);
 }
 
+static int
+put_stats_zhdl(zfs_handle_t *zhp, zfs_cmd_t *zc)
+{
+	nvlist_t *allprops;
+
+	zhp->zfs_dmustats = zc->zc_objset_stats; /* structure assignment */
+
+	if (zcmd_read_dst_nvlist(zhp->zfs_hdl, zc, &allprops) != 0) {
+		return (-1);
+	}
+
+	return (put_props_zhdl(zhp, allprops));
+}
+
 static int
 get_stats(zfs_handle_t *zhp)
 {
@@ -435,11 +445,8 @@ zfs_refresh_properties(zfs_handle_t *zhp)
  * zfs_iter_* to create child handles on the fly.
  */
 static int
-make_dataset_handle_common(zfs_handle_t *zhp, zfs_cmd_t *zc)
+make_dataset_handle_type(zfs_handle_t *zhp)
 {
-	if (put_stats_zhdl(zhp, zc) != 0)
-		return (-1);
-
 	/*
 	 * We've managed to open the dataset and gather statistics.  Determine
 	 * the high-level type.
@@ -473,6 +480,15 @@ make_dataset_handle_common(zfs_handle_t *zhp, zfs_cmd_t *zc)
 	return (0);
 }
 
+static int
+make_dataset_handle_common(zfs_handle_t *zhp, zfs_cmd_t *zc)
+{
+	if (put_stats_zhdl(zhp, zc) != 0)
+		return (-1);
+
+	return (make_dataset_handle_type(zhp));
+}
+
 zfs_handle_t *
 make_dataset_handle(libzfs_handle_t *hdl, const char *path)
 {
@@ -558,6 +574,54 @@ make_dataset_simple_handle_zc(zfs_handle_t *pzhp, zfs_cmd_t *zc)
 	return (zhp);
 }
 
+/*
+ * Makes a handle from an entry returned by ZFS_IOC_LIST_BATCH.  If the entry
+ * only holds the properties in props_table, the handle fetches the others
+ * when they are first needed.
+ */
+zfs_handle_t *
+make_dataset_handle_batch(zfs_handle_t *pzhp, const char *name,
+    nvlist_t *entry, uint8_t *props_table)
+{
+	zfs_handle_t *zhp;
+	nvlist_t *props;
+	uint8_t *stats;
+	uint_t len;
+
+	if (nvlist_lookup_uint8_array(entry, ZFS_LIST_BATCH_STATS, &stats,
+	    &len) != 0 || len != sizeof (dmu_objset_stats_t)) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	if (nvlist_lookup_nvlist(entry, ZFS_LIST_BATCH_PROPS, &props) != 0) {
+		zfs_cmd_t zc = {"\0"};
+
+		(void) strlcpy(zc.zc_name, name, sizeof (zc.zc_name));
+		memcpy(&zc.zc_objset_stats, stats, len);
+		return (make_dataset_simple_handle_zc(pzhp, &zc));
+	}
+
+	if ((zhp = calloc(1, sizeof (zfs_handle_t))) == NULL)
+		return (NULL);
+
+	zhp->zfs_hdl = pzhp->zfs_hdl;
+	(void) strlcpy(zhp->zfs_name, name, sizeof (zhp->zfs_name));
+	memcpy(&zhp->zfs_dmustats, stats, len);
+	if (put_props_zhdl(zhp, fnvlist_dup(props)) != 0 ||
+	    make_dataset_handle_type(zhp) != 0) {
+		nvlist_free(zhp->zfs_props);
+		nvlist_free(zhp->zfs_user_props);
+		free(zhp);
+		return (NULL);
+	}
+	if (props_table != NULL) {
+		zhp->zfs_props_table = props_table;
+		zhp->zfs_props_partial = B_TRUE;
+	}
+	return (zhp);
+}
+
 zfs_handle_t *
 zfs_handle_dup(zfs_handle_t *zhp_orig)
 {
@@ -602,6 +666,7 @@ zfs_handle_dup(zfs_handle_t *zhp_orig)
 		    zhp_orig->zfs_mntopts);
 	}
 	zhp->zfs_props_table = zhp_orig->zfs_props_table;
+	zhp->zfs_props_partial = zhp_orig->zfs_props_partial;
 	return (zhp);
 }
 
@@ -2086,6 +2151,20 @@ error:
 	return (ret);
 }
 
+/*
+ * A handle made by an iterator with ZFS_ITER_SELECTED_PROPS only holds the
+ * properties in its zfs_props_table (and user properties).  Fetch all the
+ * properties if prop is not one of them, or is ZPROP_INVAL, unless we are
+ * looking at the received properties.
+ */
+static void
+zfs_props_complete(zfs_handle_t *zhp, zfs_prop_t prop)
+{
+	if (zhp->zfs_props_partial && zhp->zfs_props != zhp->zfs_recvd_props &&
+	    (prop == ZPROP_INVAL || !zhp->zfs_props_table[prop]))
+		(void) get_stats(zhp);
+}
+
 /*
  * True DSL properties are stored in an nvlist.  The following two functions
  * extract them appropriately.
@@ -2097,6 +2176,7 @@ getprop_uint64(zfs_handle_t *zhp, zfs_prop_t prop, const char **source)
 	uint64_t value;
 
 	*source = NULL;
+	zfs_props_complete(zhp, prop);
 	if (nvlist_lookup_nvlist(zhp->zfs_props,
 	    zfs_prop_to_name(prop), &nv) == 0) {
 		value = fnvlist_lookup_uint64(nv, ZPROP_VALUE);
@@ -2118,6 +2198,7 @@ getprop_string(zfs_handle_t *zhp, zfs_prop_t prop, const char **source)
 	const char *value;
 
 	*source = NULL;
+	zfs_props_complete(zhp, prop);
 	if (nvlist_lookup_nvlist(zhp->zfs_props,
 	    zfs_prop_to_name(prop), &nv) == 0) {
 		value = fnvlist_lookup_string(nv, ZPROP_VALUE);
@@ -2512,6 +2593,7 @@ zfs_get_clones_nvl(zfs_handle_t *zhp)
 {
 	nvlist_t *nv, *value;
 
+	zfs_props_complete(zhp, ZFS_PROP_CLONES);
 	if (nvlist_lookup_nvlist(zhp->zfs_props,
 	    zfs_prop_to_name(ZFS_PROP_CLONES), &nv) != 0) {
 		struct get_clones_arg gca;
@@ -2576,6 +2658,7 @@ get_rsnaps_string(zfs_handle_t *zhp, char *propbuf, size_t proplen)
 	uint64_t *snaps;
 	uint_t nsnaps;
 
+	zfs_props_complete(zhp, ZFS_PROP_REDACT_SNAPS);
 	if (nvlist_lookup_nvlist(zhp->zfs_props,
 	    zfs_prop_to_name(ZFS_PROP_REDACT_SNAPS), &value) != 0)
 		return (-1);
@@ -4698,6 +4781,7 @@ error:
 nvlist_t *
 zfs_get_all_props(zfs_handle_t *zhp)
 {
+	zfs_props_complete(zhp, ZPROP_INVAL);
 	return (zhp->zfs_props);
 }
 
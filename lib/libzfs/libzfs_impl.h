@@ -87,6 +87,7 @@ struct zfs_handle {
 	boolean_t zfs_mntcheck;
 	char *zfs_mntopts;
 	uint8_t *zfs_props_table;
+	boolean_t zfs_props_partial; /* only zfs_props_table props fetched */
 };
 
 /*
@@ -141,6 +142,8 @@ extern int zpool_standard_error_fmt(libzfs_handle_t *, int, const char *, ...)
 
 extern zfs_handle_t *make_dataset_handle_zc(libzfs_handle_t *, zfs_cmd_t *);
 extern zfs_handle_t *make_dataset_simple_handle_zc(zfs_handle_t *, zfs_cmd_t *);
+extern zfs_handle_t *make_dataset_handle_batch(zfs_handle_t *, const char *,
+    nvlist_t *, uint8_t *);
 
 extern int zprop_parse_value(libzfs_handle_t *, nvpair_t *, int, zfs_type_t,
     nvlist_t *, const char **, uint64_t *, const char *);
@@ -99,6 +99,98 @@ top:
 	return (rc);
 }
 
+/*
+ * Iterate over the child filesystems, or the snapshots, of zhp with
+ * ZFS_IOC_LIST_BATCH, which returns many of them per call.  With
+ * ZFS_ITER_SELECTED_PROPS, only the properties in the props table of zhp
+ * (see zfs_prune_proplist()) and the user properties are fetched.  Sets
+ * *unavail if the kernel does not support the ioctl, or if __ZFS_LIST_NO_BATCH
+ * is set in the environment, so that the caller can fall back to listing one
+ * dataset per call.
+ */
+static int
+zfs_iter_batch(zfs_handle_t *zhp, int flags, boolean_t snapshots,
+    zfs_iter_f func, void *data, uint64_t min_txg, uint64_t max_txg,
+    boolean_t *unavail)
+{
+	libzfs_handle_t *hdl = zhp->zfs_hdl;
+	nvlist_t *args, *sel = NULL, *result, *entries;
+	uint8_t *props_table = NULL;
+	uint64_t cookie = 0;
+	boolean_t done = B_FALSE;
+	int ret = 0;
+
+	*unavail = (getenv("__ZFS_LIST_NO_BATCH") != NULL);
+	if (*unavail)
+		return (0);
+
+	args = fnvlist_alloc();
+	if (snapshots)
+		fnvlist_add_boolean(args, ZFS_LIST_BATCH_SNAPSHOTS);
+	if (min_txg != 0)
+		fnvlist_add_uint64(args, SNAP_ITER_MIN_TXG, min_txg);
+	if (max_txg != 0)
+		fnvlist_add_uint64(args, SNAP_ITER_MAX_TXG, max_txg);
+
+	if (flags & ZFS_ITER_SIMPLE) {
+		sel = fnvlist_alloc();
+	} else if ((flags & ZFS_ITER_SELECTED_PROPS) &&
+	    zhp->zfs_props_table != NULL) {
+		props_table = zhp->zfs_props_table;
+		sel = fnvlist_alloc();
+		for (zfs_prop_t p = 0; p < ZFS_NUM_PROPS; p++) {
+			if (props_table[p])
+				fnvlist_add_boolean(sel, zfs_prop_to_name(p));
+		}
+		fnvlist_add_boolean(args, ZFS_LIST_BATCH_USERPROPS);
+	}
+	if (sel != NULL) {
+		fnvlist_add_nvlist(args, ZFS_LIST_BATCH_PROPS, sel);
+		fnvlist_free(sel);
+	}
+
+	while (!done && ret == 0) {
+		fnvlist_add_uint64(args, ZFS_LIST_BATCH_COOKIE, cookie);
+		int err = lzc_list_batch(zhp->zfs_name, args, &result);
+		if (err != 0) {
+			/*
+			 * ENOENT indicates that the dataset has been removed
+			 * since we obtained the handle.
+			 */
+			if (err == ZFS_ERR_IOC_CMD_UNAVAIL)
+				*unavail = B_TRUE;
+			else if (err != ENOENT)
+				ret = zfs_standard_error(hdl, err,
+				    dgettext(TEXT_DOMAIN,
+				    "cannot iterate filesystems"));
+			break;
+		}
+
+		entries = fnvlist_lookup_nvlist(result,
+		    ZFS_LIST_BATCH_ENTRIES);
+		for (nvpair_t *pair = nvlist_next_nvpair(entries, NULL);
+		    pair != NULL; pair = nvlist_next_nvpair(entries, pair)) {
+			zfs_handle_t *nzhp = make_dataset_handle_batch(zhp,
+			    nvpair_name(pair), fnvpair_value_nvlist(pair),
+			    props_table);
+			/*
+			 * Silently ignore errors, as the only plausible
+			 * explanation is that the pool has since been removed.
+			 */
+			if (nzhp == NULL)
+				continue;
+
+			if ((ret = func(nzhp, data)) != 0)
+				break;
+		}
+		done = nvlist_lookup_uint64(result, ZFS_LIST_BATCH_COOKIE,
+		    &cookie) != 0;
+		fnvlist_free(result);
+	}
+	fnvlist_free(args);
+	return (ret);
+}
+
 /*
  * Iterate over all child filesystems
  */
@@ -114,11 +206,16 @@ zfs_iter_filesystems_v2(zfs_handle_t *zhp, int flags, zfs_iter_f func,
 {
 	zfs_cmd_t zc = {"\0"};
 	zfs_handle_t *nzhp;
+	boolean_t unavail;
 	int ret;
 
 	if (zhp->zfs_type != ZFS_TYPE_FILESYSTEM)
 		return (0);
 
+	ret = zfs_iter_batch(zhp, flags, B_FALSE, func, data, 0, 0, &unavail);
+	if (!unavail)
+		return (ret);
+
 	zcmd_alloc_dst_nvlist(zhp->zfs_hdl, &zc, 0);
 
 	if ((flags & ZFS_ITER_SIMPLE) == ZFS_ITER_SIMPLE)
@@ -163,6 +260,7 @@ zfs_iter_snapshots_v2(zfs_handle_t *zhp, int flags, zfs_iter_f func,
 {
 	zfs_cmd_t zc = {"\0"};
 	zfs_handle_t *nzhp;
+	boolean_t unavail;
 	int ret;
 	nvlist_t *range_nvl = NULL;
 
@@ -170,6 +268,11 @@ zfs_iter_snapshots_v2(zfs_handle_t *zhp, int flags, zfs_iter_f func,
 	    zhp->zfs_type == ZFS_TYPE_BOOKMARK)
 		return (0);
 
+	ret = zfs_iter_batch(zhp, flags, B_TRUE, func, data, min_txg, max_txg,
+	    &unavail);
+	if (!unavail)
+		return (ret);
+
 	zc.zc_simple = (flags & ZFS_ITER_SIMPLE) != 0;
 
 	zcmd_alloc_dst_nvlist(zhp->zfs_hdl, &zc, 0);
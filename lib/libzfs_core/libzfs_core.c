@@ -493,6 +493,33 @@ lzc_exists(const char *dataset)
 	return (lzc_ioctl_fd(g_fd, ZFS_IOC_OBJSET_STATS, &zc) == 0);
 }
 
+/*
+ * Get the space usage and identity of a dataset (see zfs_space_stats_t)
+ * without going through an nvlist of all of its properties, which makes
+ * this much cheaper than fetching the properties when polling many
+ * datasets.  Fields that the kernel does not know about are left zero.
+ */
+int
+lzc_get_space_stats(const char *dataset, zfs_space_stats_t *zss)
+{
+	/*
+	 * The objset_space ioctl is legacy, so we need to construct our
+	 * own zfs_cmd_t rather than using lzc_ioctl().
+	 */
+	zfs_cmd_t zc = {"\0"};
+
+	ASSERT3S(g_refcount, >, 0);
+	VERIFY3S(g_fd, !=, -1);
+
+	memset(zss, 0, sizeof (*zss));
+	(void) strlcpy(zc.zc_name, dataset, sizeof (zc.zc_name));
+	zc.zc_nvlist_dst = (uint64_t)(uintptr_t)zss;
+	zc.zc_nvlist_dst_size = sizeof (*zss);
+	if (lzc_ioctl_fd(g_fd, ZFS_IOC_OBJSET_SPACE, &zc) != 0)
+		return (errno);
+	return (0);
+}
+
 /*
  * outnvl is unused.
  * It was added to preserve the function signature in case it is
@@ -1451,6 +1478,49 @@ lzc_get_bookmarks(const char *fsname, nvlist_t *props, nvlist_t **bmarks)
 	return (lzc_ioctl(ZFS_IOC_GET_BOOKMARKS, fsname, props, bmarks));
 }
 
+/*
+ * List the child file systems, or the snapshots, of the given dataset in
+ * batches.
+ *
+ * The args nvlist may contain:
+ * "list_snapshots" - (boolean) list snapshots rather than child datasets
+ * "list_cookie" - (uint64) the cookie returned by the previous call, to
+ *     continue the listing
+ * "list_count" - (uint64) maximum number of entries to return
+ * "list_props" - nvlist of property names (with no values) to return for
+ *     each entry; all properties if not given, none if empty
+ * "list_userprops" - (boolean) also return all user properties
+ * "snap_iter_min_txg", "snap_iter_max_txg" - (uint64) only list snapshots
+ *     created in this range of txgs
+ *
+ * The format of the returned nvlist is as follows:
+ * {
+ *     "list_cookie" -> uint64, absent once the listing is complete
+ *     "list_entries" -> {
+ *         <name of dataset> -> {
+ *             "list_stats" -> uint8 array, a dmu_objset_stats_t
+ *             "list_props" -> {
+ *                 <name of property> -> {
+ *                     "value" -> ...
+ *                     "source" -> string
+ *                 }
+ *                 ...
+ *             }
+ *         }
+ *         ...
+ *     }
+ * }
+ *
+ * A batch may hold fewer entries than requested even when the listing is not
+ * complete.  Fails with ZFS_ERR_IOC_CMD_UNAVAIL if the kernel predates this
+ * interface.
+ */
+int
+lzc_list_batch(const char *fsname, nvlist_t *args, nvlist_t **result)
+{
+	return (lzc_ioctl(ZFS_IOC_LIST_BATCH, fsname, args, result));
+}
+
 /*
  * Get bookmark properties.
  *
@@ -45,13 +45,20 @@ arc_default_max(uint64_t min, uint64_t allmem)
 	return (MAX(allmem * 5 / 8, size));
 }
 
+/*
+ * Simulate occasional memory pressure, so that ztest exercises the ARC
+ * reclaim paths.  arc_sim turns this off to replay a trace at a fixed
+ * cache size.
+ */
+int arc_random_pressure = 1;
+
 int64_t
 arc_available_memory(void)
 {
 	int64_t lowest = INT64_MAX;
 
 	/* Every 100 calls, free a small amount */
-	if (random_in_range(100) == 0)
+	if (arc_random_pressure && random_in_range(100) == 0)
 		lowest = -1024;
 
 	return (lowest);
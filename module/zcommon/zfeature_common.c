@@ -785,6 +785,19 @@ zpool_feature_init(void)
 		    ZFEATURE_TYPE_BOOLEAN, large_microzap_deps, sfeatures);
 	}
 
+	{
+		static const spa_feature_t zstd_frames_deps[] = {
+			SPA_FEATURE_EXTENSIBLE_DATASET,
+			SPA_FEATURE_ZSTD_COMPRESS,
+			SPA_FEATURE_NONE
+		};
+		zfeature_register(SPA_FEATURE_ZSTD_FRAMES,
+		    "org.openzfs:zstd_frames", "zstd_frames",
+		    "Large zstd records stored as independent frames.",
+		    ZFEATURE_FLAG_PER_DATASET, ZFEATURE_TYPE_BOOLEAN,
+		    zstd_frames_deps, sfeatures);
+	}
+
 	zfs_mod_list_supported_free(sfeatures);
 }
 
@@ -290,6 +290,14 @@ zfs_prop_init(void)
 		{ NULL }
 	};
 
+	static const zprop_index_t arcclass_table[] = {
+		{ "0",		0 },
+		{ "1",		1 },
+		{ "2",		2 },
+		{ "3",		3 },
+		{ NULL }
+	};
+
 	/*
 	 * Use the unique flags we have to send to u8_strcmp() and/or
 	 * u8_textprep() to represent the various normalization property
@@ -481,6 +489,9 @@ zfs_prop_init(void)
 	    ZFS_PREFETCH_ALL, PROP_INHERIT,
 	    ZFS_TYPE_FILESYSTEM | ZFS_TYPE_SNAPSHOT | ZFS_TYPE_VOLUME,
 	    "none | metadata | all", "PREFETCH", prefetch_table, sfeatures);
+	zprop_register_index(ZFS_PROP_ARCCLASS, "arcclass", 0, PROP_INHERIT,
+	    ZFS_TYPE_FILESYSTEM | ZFS_TYPE_SNAPSHOT | ZFS_TYPE_VOLUME,
+	    "0 | 1 | 2 | 3", "ARCCLASS", arcclass_table, sfeatures);
 	zprop_register_index(ZFS_PROP_LOGBIAS, "logbias", ZFS_LOGBIAS_LATENCY,
 	    PROP_INHERIT, ZFS_TYPE_FILESYSTEM | ZFS_TYPE_VOLUME,
 	    "latency | throughput", "LOGBIAS", logbias_table, sfeatures);
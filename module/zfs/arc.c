@@ -333,7 +333,9 @@ static int arc_state_evict_marker_count;
 
 static kmutex_t arc_evict_lock;
 static boolean_t arc_evict_needed = B_FALSE;
+static boolean_t arc_evict_classes_needed = B_FALSE;
 static clock_t arc_last_uncached_flush;
+static clock_t arc_last_classes_evict;
 
 /*
  * Count of bytes evicted since boot.
@@ -366,6 +368,67 @@ static uint_t zfs_arc_eviction_pct = 200;
  */
 static uint_t zfs_arc_evict_batch_limit = 10;
 
+/*
+ * The number of headers of protected ARC classes arc_evict_state_impl()
+ * may step over before dropping the sublist lock.  Skipped headers do not
+ * count against zfs_arc_evict_batch_limit, so without this bound a sublist
+ * made up mostly of protected headers would be walked end to end with its
+ * lock held.
+ */
+static uint_t zfs_arc_evict_class_skip_limit = 100;
+
+/*
+ * Size targets of the ARC classes selected by the arcclass property, in
+ * logical bytes cached in the MRU and MFU states.  While a class is at or
+ * below its minimum, arc_evict() does not evict from it, unless the
+ * protected classes together hold more than half of arc_c.  A class above
+ * its maximum is evicted from down to its maximum, even if the ARC as a
+ * whole is not over its target.  Zero disables a target.  Class 0 has no
+ * targets.
+ */
+static uint64_t zfs_arc_class1_min = 0;
+static uint64_t zfs_arc_class1_max = 0;
+static uint64_t zfs_arc_class2_min = 0;
+static uint64_t zfs_arc_class2_max = 0;
+static uint64_t zfs_arc_class3_min = 0;
+static uint64_t zfs_arc_class3_max = 0;
+
+static uint64_t *const arc_class_min[ARC_CLASS_COUNT] = {
+	NULL, &zfs_arc_class1_min, &zfs_arc_class2_min, &zfs_arc_class3_min
+};
+static uint64_t *const arc_class_max[ARC_CLASS_COUNT] = {
+	NULL, &zfs_arc_class1_max, &zfs_arc_class2_max, &zfs_arc_class3_max
+};
+
+#define	ARC_CLASS_ALL	((1U << ARC_CLASS_COUNT) - 1)
+
+/*
+ * Admission filter.  When enabled and the ARC is at its target size, a
+ * data block that misses is only admitted to the MRU if a count-min
+ * sketch of recent accesses has seen it at least zfs_arc_admit_min_freq
+ * times; otherwise it is read as uncached and dropped once released.
+ * This keeps a single pass over a large file from displacing blocks that
+ * are being reused.  The sketch is sized relative to the buf_hash table
+ * and holds two 4-bit counters per byte.  After ARC_SKETCH_SAMPLE
+ * accesses per counter column the arc_evict zthr halves every counter,
+ * so old frequencies fade.
+ */
+int zfs_arc_admit = 0;
+uint_t zfs_arc_admit_min_freq = 2;
+
+#define	ARC_SKETCH_DEPTH	4
+#define	ARC_SKETCH_CTR_MAX	15
+#define	ARC_SKETCH_SAMPLE	10
+
+typedef struct arc_sketch {
+	uint8_t		*as_ctrs;	/* ARC_SKETCH_DEPTH rows, 2 per byte */
+	uint64_t	as_mask;	/* columns per row - 1 */
+	wmsum_t		as_count;	/* accesses since last aging */
+} arc_sketch_t;
+
+static arc_sketch_t arc_sketch;
+static boolean_t arc_sketch_age_needed = B_FALSE;
+
 /* number of seconds before growing cache again */
 uint_t arc_grow_retry = 5;
 
@@ -628,6 +691,33 @@ arc_stats_t arc_stats = {
 	{ "arc_raw_size",		KSTAT_DATA_UINT64 },
 	{ "cached_only_in_progress",	KSTAT_DATA_UINT64 },
 	{ "abd_chunk_waste_size",	KSTAT_DATA_UINT64 },
+	{ "admit_accepted",		KSTAT_DATA_UINT64 },
+	{ "admit_rejected",		KSTAT_DATA_UINT64 },
+	{
+		{ "class0_size",	KSTAT_DATA_UINT64 },
+		{ "class1_size",	KSTAT_DATA_UINT64 },
+		{ "class2_size",	KSTAT_DATA_UINT64 },
+		{ "class3_size",	KSTAT_DATA_UINT64 },
+	},
+	{
+		{ "class0_hits",	KSTAT_DATA_UINT64 },
+		{ "class1_hits",	KSTAT_DATA_UINT64 },
+		{ "class2_hits",	KSTAT_DATA_UINT64 },
+		{ "class3_hits",	KSTAT_DATA_UINT64 },
+	},
+	{
+		{ "class0_misses",	KSTAT_DATA_UINT64 },
+		{ "class1_misses",	KSTAT_DATA_UINT64 },
+		{ "class2_misses",	KSTAT_DATA_UINT64 },
+		{ "class3_misses",	KSTAT_DATA_UINT64 },
+	},
+	{
+		{ "class0_evicted",	KSTAT_DATA_UINT64 },
+		{ "class1_evicted",	KSTAT_DATA_UINT64 },
+		{ "class2_evicted",	KSTAT_DATA_UINT64 },
+		{ "class3_evicted",	KSTAT_DATA_UINT64 },
+	},
+	{ "evict_class_skip",		KSTAT_DATA_UINT64 },
 };
 
 arc_sums_t arc_sums;
@@ -700,6 +790,9 @@ taskq_t *arc_prune_taskq;
 	((state) == arc_mru_ghost || (state) == arc_mfu_ghost ||	\
 	(state) == arc_l2c_only)
 
+/* States whose headers count towards the size of their ARC class. */
+#define	CLASS_STATE(state)	((state) == arc_mru || (state) == arc_mfu)
+
 #define	HDR_IN_HASH_TABLE(hdr)	((hdr)->b_flags & ARC_FLAG_IN_HASH_TABLE)
 #define	HDR_IO_IN_PROGRESS(hdr)	((hdr)->b_flags & ARC_FLAG_IO_IN_PROGRESS)
 #define	HDR_IO_ERROR(hdr)	((hdr)->b_flags & ARC_FLAG_IO_ERROR)
@@ -757,22 +850,40 @@ taskq_t *arc_prune_taskq;
 
 /*
  * Hash table routines
+ *
+ * Each bucket chain is protected by one of a set of striped locks.  The
+ * number of stripes is scaled with the CPU count at buf_init() time so
+ * that lookups issued from many threads spread across more locks, and
+ * each lock is padded out to its own cache line so that hot neighbouring
+ * stripes do not false-share.
  */
 
-#define	BUF_LOCKS 2048
+#define	BUF_LOCKS_MIN		2048
+#define	BUF_LOCKS_PER_CPU	64
+#define	BUF_LOCKS_MAX		(1 << 16)
+
+typedef struct buf_hash_lock {
+	kmutex_t bhl_lock;
+} ____cacheline_aligned buf_hash_lock_t;
+
 typedef struct buf_hash_table {
 	uint64_t ht_mask;
 	arc_buf_hdr_t **ht_table;
-	kmutex_t ht_locks[BUF_LOCKS] ____cacheline_aligned;
+	uint64_t ht_lock_mask;
+	buf_hash_lock_t *ht_locks;
 } buf_hash_table_t;
 
 static buf_hash_table_t buf_hash_table;
 
 #define	BUF_HASH_INDEX(spa, dva, birth) \
 	(buf_hash(spa, dva, birth) & buf_hash_table.ht_mask)
-#define	BUF_HASH_LOCK(idx)	(&buf_hash_table.ht_locks[idx & (BUF_LOCKS-1)])
+#define	BUF_HASH_LOCK(idx)	\
+	(&buf_hash_table.ht_locks[(idx) & buf_hash_table.ht_lock_mask].bhl_lock)
 #define	HDR_LOCK(hdr) \
 	(BUF_HASH_LOCK(BUF_HASH_INDEX(hdr->b_spa, &hdr->b_dva, hdr->b_birth)))
+/* Unlocked check for an empty bucket; see buf_hash_find(). */
+#define	BUF_HASH_EMPTY(idx)	\
+	(*(volatile uintptr_t *)&buf_hash_table.ht_table[(idx)] == 0)
 
 uint64_t zfs_crc64_table[256];
 
@@ -832,7 +943,6 @@ static uint_t l2arc_meta_percent = 33;	/* limit on headers size */
 static list_t L2ARC_dev_list;			/* device list */
 static list_t *l2arc_dev_list;			/* device list pointer */
 static kmutex_t l2arc_dev_mtx;			/* device list mutex */
-static l2arc_dev_t *l2arc_dev_last;		/* last device used */
 static list_t L2ARC_free_on_write;		/* free after write buf list */
 static list_t *l2arc_free_on_write;		/* free after write list ptr */
 static kmutex_t l2arc_free_on_write_mtx;	/* mutex for list */
@@ -871,6 +981,7 @@ typedef enum arc_ovf_level {
 static kmutex_t l2arc_feed_thr_lock;
 static kcondvar_t l2arc_feed_thr_cv;
 static uint8_t l2arc_thread_exit;
+static taskq_t *l2arc_feed_taskq;		/* per-device feed tasks */
 
 static kmutex_t l2arc_rebuild_thr_lock;
 static kcondvar_t l2arc_rebuild_thr_cv;
@@ -1031,6 +1142,105 @@ buf_discard_identity(arc_buf_hdr_t *hdr)
 	hdr->b_birth = 0;
 }
 
+static inline uint_t
+arc_sketch_get(const arc_sketch_t *as, uint64_t idx)
+{
+	return ((as->as_ctrs[idx >> 1] >> ((idx & 1) * 4)) & 0xf);
+}
+
+static inline void
+arc_sketch_set(arc_sketch_t *as, uint64_t idx, uint_t val)
+{
+	uint8_t *p = &as->as_ctrs[idx >> 1];
+	uint_t shift = (idx & 1) * 4;
+
+	*p = (*p & ~(0xf << shift)) | (val << shift);
+}
+
+/*
+ * Return the admission sketch's estimate of how often a block has been
+ * accessed, including the current access.  If count is set the access is
+ * recorded; prefetches only look, since the demand read that follows will
+ * be counted.  Only the smallest counters are incremented (conservative
+ * update).  The counters are updated without locks; a lost update only
+ * makes the estimate slightly less accurate.
+ */
+static uint_t
+arc_sketch_touch(uint64_t spa, const blkptr_t *bp, boolean_t count)
+{
+	arc_sketch_t *as = &arc_sketch;
+	uint64_t h = buf_hash(spa, BP_IDENTITY(bp), BP_GET_BIRTH(bp));
+	uint64_t h1 = h & UINT32_MAX, h2 = (h >> 32) | 1;
+	uint64_t idx[ARC_SKETCH_DEPTH];
+	uint_t est = ARC_SKETCH_CTR_MAX;
+
+	for (int i = 0; i < ARC_SKETCH_DEPTH; i++) {
+		idx[i] = i * (as->as_mask + 1) + ((h1 + i * h2) & as->as_mask);
+		est = MIN(est, arc_sketch_get(as, idx[i]));
+	}
+	if (!count)
+		return (est + 1);
+	if (est < ARC_SKETCH_CTR_MAX) {
+		for (int i = 0; i < ARC_SKETCH_DEPTH; i++) {
+			if (arc_sketch_get(as, idx[i]) == est)
+				arc_sketch_set(as, idx[i], est + 1);
+		}
+		est++;
+	}
+	wmsum_add(&as->as_count, 1);
+
+	return (est);
+}
+
+/*
+ * Called from arc_evict_cb_check(): return true once enough accesses
+ * have been counted since the sketch was last aged.
+ */
+static boolean_t
+arc_sketch_age_due(void)
+{
+	arc_sketch_t *as = &arc_sketch;
+
+	return (zfs_arc_admit && wmsum_value(&as->as_count) >=
+	    (as->as_mask + 1) * ARC_SKETCH_SAMPLE);
+}
+
+/*
+ * Age the sketch by halving every counter.  Sixteen counters are halved
+ * at once by shifting a word and masking off the bits that moved in from
+ * the neighbouring counters.  Only the arc_evict zthr ages the sketch.
+ */
+static void
+arc_sketch_age(void)
+{
+	arc_sketch_t *as = &arc_sketch;
+	uint64_t *w = (uint64_t *)as->as_ctrs;
+	uint64_t words = ARC_SKETCH_DEPTH * (as->as_mask + 1) / 2 /
+	    sizeof (uint64_t);
+	uint64_t count = wmsum_value(&as->as_count);
+
+	for (uint64_t i = 0; i < words; i++)
+		w[i] = (w[i] >> 1) & 0x7777777777777777ULL;
+	wmsum_add(&as->as_count, -(int64_t)count);
+}
+
+/*
+ * Decide whether a demand data block that missed should be admitted to
+ * the cache.  Blocks are always admitted while the ARC is below its
+ * target, since caching them then displaces nothing.
+ */
+static boolean_t
+arc_admit(uint_t freq)
+{
+	if (aggsum_upper_bound(&arc_sums.arcstat_size) < arc_c ||
+	    freq >= zfs_arc_admit_min_freq) {
+		ARCSTAT_BUMP(arcstat_admit_accepted);
+		return (B_TRUE);
+	}
+	ARCSTAT_BUMP(arcstat_admit_rejected);
+	return (B_FALSE);
+}
+
 static arc_buf_hdr_t *
 buf_hash_find(uint64_t spa, const blkptr_t *bp, kmutex_t **lockp)
 {
@@ -1040,6 +1250,23 @@ buf_hash_find(uint64_t spa, const blkptr_t *bp, kmutex_t **lockp)
 	kmutex_t *hash_lock = BUF_HASH_LOCK(idx);
 	arc_buf_hdr_t *hdr;
 
+	/*
+	 * Most misses land on an empty bucket, since the table is sized for
+	 * an average chain length below one.  The bucket head is a single
+	 * aligned pointer, so it can be sampled without taking the lock.
+	 * A racing insert is indistinguishable from one that happens just
+	 * after we return, which callers already handle by re-checking in
+	 * buf_hash_insert() under the lock.  The volatile read keeps the
+	 * compiler from reusing or tearing the load.  Hits and misses on
+	 * non-empty buckets still walk the chain under the lock, since the
+	 * headers on it can be freed once it is dropped, and callers expect
+	 * a found header to be returned with its hash lock held.
+	 */
+	if (BUF_HASH_EMPTY(idx)) {
+		*lockp = NULL;
+		return (NULL);
+	}
+
 	mutex_enter(hash_lock);
 	for (hdr = buf_hash_table.ht_table[idx]; hdr != NULL;
 	    hdr = hdr->b_hash_next) {
@@ -1148,8 +1375,18 @@ buf_fini(void)
 	kmem_free(buf_hash_table.ht_table,
 	    (buf_hash_table.ht_mask + 1) * sizeof (void *));
 #endif
-	for (int i = 0; i < BUF_LOCKS; i++)
-		mutex_destroy(BUF_HASH_LOCK(i));
+	vmem_free(arc_sketch.as_ctrs,
+	    ARC_SKETCH_DEPTH * (arc_sketch.as_mask + 1) / 2);
+	wmsum_fini(&arc_sketch.as_count);
+	for (uint64_t i = 0; i <= buf_hash_table.ht_lock_mask; i++)
+		mutex_destroy(&buf_hash_table.ht_locks[i].bhl_lock);
+#if defined(_KERNEL)
+	vmem_free(buf_hash_table.ht_locks,
+	    (buf_hash_table.ht_lock_mask + 1) * sizeof (buf_hash_lock_t));
+#else
+	kmem_free(buf_hash_table.ht_locks,
+	    (buf_hash_table.ht_lock_mask + 1) * sizeof (buf_hash_lock_t));
+#endif
 	kmem_cache_destroy(hdr_full_cache);
 	kmem_cache_destroy(hdr_l2only_cache);
 	kmem_cache_destroy(buf_cache);
@@ -1245,6 +1482,7 @@ buf_init(void)
 {
 	uint64_t *ct = NULL;
 	uint64_t hsize = 1ULL << 12;
+	uint64_t nlocks = BUF_LOCKS_MIN;
 	int i, j;
 
 	/*
@@ -1274,6 +1512,11 @@ retry:
 		goto retry;
 	}
 
+	/* Four sketch rows take an eighth of the hash table's memory. */
+	arc_sketch.as_mask = hsize * 2 / ARC_SKETCH_DEPTH - 1;
+	arc_sketch.as_ctrs = vmem_zalloc(hsize, KM_SLEEP);
+	wmsum_init(&arc_sketch.as_count, 0);
+
 	hdr_full_cache = kmem_cache_create("arc_buf_hdr_t_full", HDR_FULL_SIZE,
 	    0, hdr_full_cons, hdr_full_dest, NULL, NULL, NULL, KMC_RECLAIMABLE);
 	hdr_l2only_cache = kmem_cache_create("arc_buf_hdr_t_l2only",
@@ -1286,8 +1529,30 @@ retry:
 		for (ct = zfs_crc64_table + i, *ct = i, j = 8; j > 0; j--)
 			*ct = (*ct >> 1) ^ (-(*ct & 1) & ZFS_CRC64_POLY);
 
-	for (i = 0; i < BUF_LOCKS; i++)
-		mutex_init(BUF_HASH_LOCK(i), NULL, MUTEX_DEFAULT, NULL);
+	/*
+	 * Scale the lock stripes with the number of CPUs, but never use
+	 * more stripes than there are buckets to protect.
+	 */
+	while (nlocks < (uint64_t)boot_ncpus * BUF_LOCKS_PER_CPU &&
+	    nlocks < BUF_LOCKS_MAX && nlocks < hsize)
+		nlocks <<= 1;
+	buf_hash_table.ht_lock_mask = nlocks - 1;
+#if defined(_KERNEL)
+	/*
+	 * At least 128K of locks; vmem_zalloc() avoids the large kmem_alloc()
+	 * warning and returns page aligned memory, which keeps each padded
+	 * lock on its own cache line.
+	 */
+	buf_hash_table.ht_locks =
+	    vmem_zalloc(nlocks * sizeof (buf_hash_lock_t), KM_SLEEP);
+#else
+	buf_hash_table.ht_locks =
+	    kmem_zalloc(nlocks * sizeof (buf_hash_lock_t), KM_SLEEP);
+#endif
+	for (uint64_t l = 0; l < nlocks; l++) {
+		mutex_init(&buf_hash_table.ht_locks[l].bhl_lock, NULL,
+		    MUTEX_DEFAULT, NULL);
+	}
 }
 
 #define	ARC_MINTIME	(hz>>4) /* 62 ms */
@@ -1993,10 +2258,14 @@ arc_buf_untransform_in_place(arc_buf_t *buf)
  * uncompressed data, and (since we haven't added support for it yet) if you
  * want compressed data your buf must already be marked as compressed and have
  * the correct-sized data buffer.
+ *
+ * If lpabd is not NULL, it is a linear copy of the hdr's b_pabd made while
+ * verifying its checksum, which is decompressed from instead of borrowing
+ * another linear copy of b_pabd.
  */
 static int
 arc_buf_fill(arc_buf_t *buf, spa_t *spa, const zbookmark_phys_t *zb,
-    arc_fill_flags_t flags)
+    arc_fill_flags_t flags, abd_t *lpabd)
 {
 	int error = 0;
 	arc_buf_hdr_t *hdr = buf->b_hdr;
@@ -2140,7 +2409,7 @@ arc_buf_fill(arc_buf_t *buf, spa_t *spa, const zbookmark_phys_t *zb,
 			abd_get_from_buf_struct(&dabd, buf->b_data,
 			    HDR_GET_LSIZE(hdr));
 			error = zio_decompress_data(HDR_GET_COMPRESS(hdr),
-			    hdr->b_l1hdr.b_pabd, &dabd,
+			    lpabd != NULL ? lpabd : hdr->b_l1hdr.b_pabd, &dabd,
 			    HDR_GET_PSIZE(hdr), HDR_GET_LSIZE(hdr),
 			    &hdr->b_complevel);
 			abd_free(&dabd);
@@ -2194,7 +2463,7 @@ arc_untransform(arc_buf_t *buf, spa_t *spa, const zbookmark_phys_t *zb,
 	if (in_place)
 		flags |= ARC_FILL_IN_PLACE;
 
-	ret = arc_buf_fill(buf, spa, zb, flags);
+	ret = arc_buf_fill(buf, spa, zb, flags, NULL);
 	if (ret == ECKSUM) {
 		/*
 		 * Convert authentication and decryption errors to EIO
@@ -2585,6 +2854,19 @@ arc_change_state(arc_state_t *new_state, arc_buf_hdr_t *hdr)
 		}
 	}
 
+	/*
+	 * The class of a header only changes while it is in neither of
+	 * these states, see arc_read_class() and arc_write().
+	 */
+	if (CLASS_STATE(old_state)) {
+		ARCSTAT_INCR(arcstat_class_size[hdr->b_class],
+		    -(int64_t)HDR_GET_LSIZE(hdr));
+	}
+	if (CLASS_STATE(new_state)) {
+		ARCSTAT_INCR(arcstat_class_size[hdr->b_class],
+		    HDR_GET_LSIZE(hdr));
+	}
+
 	if (HDR_HAS_L1HDR(hdr)) {
 		hdr->b_l1hdr.b_state = new_state;
 
@@ -2731,7 +3013,7 @@ arc_can_share(arc_buf_hdr_t *hdr, arc_buf_t *buf)
 static int
 arc_buf_alloc_impl(arc_buf_hdr_t *hdr, spa_t *spa, const zbookmark_phys_t *zb,
     const void *tag, boolean_t encrypted, boolean_t compressed,
-    boolean_t noauth, boolean_t fill, arc_buf_t **ret)
+    boolean_t noauth, boolean_t fill, abd_t *lpabd, arc_buf_t **ret)
 {
 	arc_buf_t *buf;
 	arc_fill_flags_t flags = ARC_FILL_LOCKED;
@@ -2822,7 +3104,7 @@ arc_buf_alloc_impl(arc_buf_hdr_t *hdr, spa_t *spa, const zbookmark_phys_t *zb,
 	 */
 	if (fill) {
 		ASSERT3P(zb, !=, NULL);
-		return (arc_buf_fill(buf, spa, zb, flags));
+		return (arc_buf_fill(buf, spa, zb, flags, lpabd));
 	}
 
 	return (0);
@@ -3279,6 +3561,7 @@ arc_hdr_alloc(uint64_t spa, int32_t psize, int32_t lsize,
 	HDR_SET_LSIZE(hdr, lsize);
 	hdr->b_spa = spa;
 	hdr->b_type = type;
+	hdr->b_class = ARC_CLASS_DEFAULT;
 	hdr->b_flags = 0;
 	arc_hdr_set_flags(hdr, arc_bufc_to_flags(type) | ARC_FLAG_HAS_L1HDR);
 	arc_hdr_set_compress(hdr, compression_type);
@@ -3451,7 +3734,7 @@ arc_alloc_buf(spa_t *spa, const void *tag, arc_buf_contents_t type,
 
 	arc_buf_t *buf = NULL;
 	VERIFY0(arc_buf_alloc_impl(hdr, spa, NULL, tag, B_FALSE, B_FALSE,
-	    B_FALSE, B_FALSE, &buf));
+	    B_FALSE, B_FALSE, NULL, &buf));
 	arc_buf_thaw(buf);
 
 	return (buf);
@@ -3475,7 +3758,7 @@ arc_alloc_compressed_buf(spa_t *spa, const void *tag, uint64_t psize,
 
 	arc_buf_t *buf = NULL;
 	VERIFY0(arc_buf_alloc_impl(hdr, spa, NULL, tag, B_FALSE,
-	    B_TRUE, B_FALSE, B_FALSE, &buf));
+	    B_TRUE, B_FALSE, B_FALSE, NULL, &buf));
 	arc_buf_thaw(buf);
 
 	/*
@@ -3522,7 +3805,7 @@ arc_alloc_raw_buf(spa_t *spa, const void *tag, uint64_t dsobj,
 	 */
 	buf = NULL;
 	VERIFY0(arc_buf_alloc_impl(hdr, spa, NULL, tag, B_TRUE, B_TRUE,
-	    B_FALSE, B_FALSE, &buf));
+	    B_FALSE, B_FALSE, NULL, &buf));
 	arc_buf_thaw(buf);
 
 	return (buf);
@@ -3842,6 +4125,10 @@ arc_evict_hdr(arc_buf_hdr_t *hdr, uint64_t *real_evicted)
 
 	bytes_evicted += arc_hdr_size(hdr);
 	*real_evicted += arc_hdr_size(hdr);
+	if (CLASS_STATE(state)) {
+		ARCSTAT_INCR(arcstat_class_evicted[hdr->b_class],
+		    HDR_GET_LSIZE(hdr));
+	}
 
 	/*
 	 * If this hdr is being evicted and has a compressed buffer then we
@@ -3882,21 +4169,24 @@ arc_set_need_free(void)
 
 static uint64_t
 arc_evict_state_impl(multilist_t *ml, int idx, arc_buf_hdr_t *marker,
-    uint64_t spa, uint64_t bytes)
+    uint64_t spa, uint_t classes, uint64_t bytes, uint64_t *skipped)
 {
 	multilist_sublist_t *mls;
 	uint64_t bytes_evicted = 0, real_evicted = 0;
 	arc_buf_hdr_t *hdr;
 	kmutex_t *hash_lock;
 	uint_t evict_count = zfs_arc_evict_batch_limit;
+	uint_t skip_count = MAX(zfs_arc_evict_class_skip_limit, 1);
 
 	ASSERT3P(marker, !=, NULL);
 
+	*skipped = 0;
 	mls = multilist_sublist_lock_idx(ml, idx);
 
 	for (hdr = multilist_sublist_prev(mls, marker); likely(hdr != NULL);
 	    hdr = multilist_sublist_prev(mls, marker)) {
-		if ((evict_count == 0) || (bytes_evicted >= bytes))
+		if ((evict_count == 0) || (skip_count == 0) ||
+		    (bytes_evicted >= bytes))
 			break;
 
 		/*
@@ -3930,6 +4220,13 @@ arc_evict_state_impl(multilist_t *ml, int idx, arc_buf_hdr_t *marker,
 			continue;
 		}
 
+		/* nor in buffers of a protected class */
+		if (!(classes & (1U << hdr->b_class))) {
+			skip_count--;
+			(*skipped)++;
+			continue;
+		}
+
 		hash_lock = HDR_LOCK(hdr);
 
 		/*
@@ -3966,6 +4263,9 @@ arc_evict_state_impl(multilist_t *ml, int idx, arc_buf_hdr_t *marker,
 
 	multilist_sublist_unlock(mls);
 
+	if (*skipped != 0)
+		ARCSTAT_INCR(arcstat_evict_class_skip, *skipped);
+
 	/*
 	 * Increment the count of evicted bytes, and wake up any threads that
 	 * are waiting for the count to reach this value.  Since the list is
@@ -4059,10 +4359,12 @@ arc_state_free_markers(arc_buf_hdr_t **markers, int count)
  * If bytes is specified using the special value ARC_EVICT_ALL, this
  * will evict all available (i.e. unlocked and evictable) buffers from
  * the given arc state; which is used by arc_flush().
+ *
+ * Only buffers of the ARC classes set in the "classes" mask are evicted.
  */
 static uint64_t
 arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
-    uint64_t bytes)
+    uint_t classes, uint64_t bytes)
 {
 	uint64_t total_evicted = 0;
 	multilist_t *ml = &state->arcs_list[type];
@@ -4098,7 +4400,7 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 	 */
 	while (total_evicted < bytes) {
 		int sublist_idx = multilist_get_random_index(ml);
-		uint64_t scan_evicted = 0;
+		uint64_t scan_evicted = 0, scan_skipped = 0;
 
 		/*
 		 * Start eviction using a randomly selected sublist,
@@ -4110,6 +4412,7 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 		for (int i = 0; i < num_sublists; i++) {
 			uint64_t bytes_remaining;
 			uint64_t bytes_evicted;
+			uint64_t hdrs_skipped;
 
 			if (total_evicted < bytes)
 				bytes_remaining = bytes - total_evicted;
@@ -4117,9 +4420,11 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 				break;
 
 			bytes_evicted = arc_evict_state_impl(ml, sublist_idx,
-			    markers[sublist_idx], spa, bytes_remaining);
+			    markers[sublist_idx], spa, classes,
+			    bytes_remaining, &hdrs_skipped);
 
 			scan_evicted += bytes_evicted;
+			scan_skipped += hdrs_skipped;
 			total_evicted += bytes_evicted;
 
 			/* we've reached the end, wrap to the beginning */
@@ -4130,8 +4435,12 @@ arc_evict_state(arc_state_t *state, arc_buf_contents_t type, uint64_t spa,
 		/*
 		 * If we didn't evict anything during this scan, we have
 		 * no reason to believe we'll evict more during another
-		 * scan, so break the loop.
+		 * scan, so break the loop.  A scan that only stepped over
+		 * protected headers has moved the markers past them, so
+		 * there may still be evictable headers further up.
 		 */
+		if (scan_skipped != 0 && scan_evicted == 0)
+			continue;
 		if (scan_evicted == 0) {
 			/* This isn't possible, let's make that obvious */
 			ASSERT3S(bytes, !=, 0);
@@ -4184,7 +4493,8 @@ arc_flush_state(arc_state_t *state, uint64_t spa, arc_buf_contents_t type,
 	uint64_t evicted = 0;
 
 	while (zfs_refcount_count(&state->arcs_esize[type]) != 0) {
-		evicted += arc_evict_state(state, type, spa, ARC_EVICT_ALL);
+		evicted += arc_evict_state(state, type, spa, ARC_CLASS_ALL,
+		    ARC_EVICT_ALL);
 
 		if (!retry)
 			break;
@@ -4201,14 +4511,15 @@ arc_flush_state(arc_state_t *state, uint64_t spa, arc_buf_contents_t type,
  * evict everything it can, when passed a negative value for "bytes".
  */
 static uint64_t
-arc_evict_impl(arc_state_t *state, arc_buf_contents_t type, int64_t bytes)
+arc_evict_impl(arc_state_t *state, arc_buf_contents_t type, uint_t classes,
+    int64_t bytes)
 {
 	uint64_t delta;
 
 	if (bytes > 0 && zfs_refcount_count(&state->arcs_esize[type]) > 0) {
 		delta = MIN(zfs_refcount_count(&state->arcs_esize[type]),
 		    bytes);
-		return (arc_evict_state(state, type, 0, delta));
+		return (arc_evict_state(state, type, 0, classes, delta));
 	}
 
 	return (0);
@@ -4266,6 +4577,77 @@ arc_mf(uint64_t x, uint64_t multiplier, uint64_t divisor)
 	return ((q * multiplier) + ((r * multiplier) / divisor));
 }
 
+static uint64_t
+arc_class_size(int c)
+{
+	return (MAX((int64_t)wmsum_value(&arc_sums.arcstat_class_size[c]), 0));
+}
+
+/*
+ * Return the mask of ARC classes arc_evict() may evict from: all except
+ * those at or below their minimum size, unless those hold more than half
+ * of arc_c between them.
+ */
+static uint_t
+arc_class_evictable(void)
+{
+	uint_t classes = ARC_CLASS_ALL;
+	uint64_t protected = 0;
+
+	for (int c = 0; c < ARC_CLASS_COUNT; c++) {
+		if (arc_class_min[c] == NULL || *arc_class_min[c] == 0)
+			continue;
+
+		uint64_t size = arc_class_size(c);
+		if (size <= *arc_class_min[c]) {
+			classes &= ~(1U << c);
+			protected += size;
+		}
+	}
+
+	return (protected > arc_c / 2 ? ARC_CLASS_ALL : classes);
+}
+
+static boolean_t
+arc_class_over_max(void)
+{
+	for (int c = 0; c < ARC_CLASS_COUNT; c++) {
+		if (arc_class_max[c] != NULL && *arc_class_max[c] != 0 &&
+		    arc_class_size(c) > *arc_class_max[c])
+			return (B_TRUE);
+	}
+
+	return (B_FALSE);
+}
+
+/*
+ * Evict buffers of the ARC classes which are over their maximum size,
+ * MRU before MFU and data before metadata.
+ */
+static uint64_t
+arc_evict_classes(void)
+{
+	arc_state_t *const states[] = { arc_mru, arc_mfu };
+	const arc_buf_contents_t types[] = { ARC_BUFC_DATA, ARC_BUFC_METADATA };
+	uint64_t total_evicted = 0;
+
+	for (int c = 0; c < ARC_CLASS_COUNT; c++) {
+		if (arc_class_max[c] == NULL || *arc_class_max[c] == 0)
+			continue;
+
+		for (int i = 0; i < ARRAY_SIZE(states) * ARRAY_SIZE(types);
+		    i++) {
+			int64_t e = arc_class_size(c) - *arc_class_max[c];
+			if (e <= 0)
+				break;
+			total_evicted += arc_evict_impl(states[i / 2],
+			    types[i % 2], 1U << c, e);
+		}
+	}
+
+	return (total_evicted);
+}
+
 /*
  * Evict buffers from the cache, such that arcstat_size is capped by arc_c.
  */
@@ -4273,6 +4655,7 @@ static uint64_t
 arc_evict(void)
 {
 	uint64_t bytes, total_evicted = 0;
+	uint_t classes = arc_class_evictable();
 	int64_t e, mrud, mrum, mfud, mfum, w;
 	static uint64_t ogrd, ogrm, ogfd, ogfm;
 	static uint64_t gsrd, gsrm, gsfd, gsfm;
@@ -4340,7 +4723,7 @@ arc_evict(void)
 	/* Evict MRU metadata. */
 	w = wt * (int64_t)(arc_meta * arc_pm >> 48) >> 16;
 	e = MIN((int64_t)(asize - ac), (int64_t)(mrum - w));
-	bytes = arc_evict_impl(arc_mru, ARC_BUFC_METADATA, e);
+	bytes = arc_evict_impl(arc_mru, ARC_BUFC_METADATA, classes, e);
 	total_evicted += bytes;
 	mrum -= bytes;
 	asize -= bytes;
@@ -4348,7 +4731,7 @@ arc_evict(void)
 	/* Evict MFU metadata. */
 	w = wt * (int64_t)(arc_meta >> 16) >> 16;
 	e = MIN((int64_t)(asize - ac), (int64_t)(m - bytes - w));
-	bytes = arc_evict_impl(arc_mfu, ARC_BUFC_METADATA, e);
+	bytes = arc_evict_impl(arc_mfu, ARC_BUFC_METADATA, classes, e);
 	total_evicted += bytes;
 	mfum -= bytes;
 	asize -= bytes;
@@ -4357,14 +4740,14 @@ arc_evict(void)
 	wt -= m - total_evicted;
 	w = wt * (int64_t)(arc_pd >> 16) >> 16;
 	e = MIN((int64_t)(asize - ac), (int64_t)(mrud - w));
-	bytes = arc_evict_impl(arc_mru, ARC_BUFC_DATA, e);
+	bytes = arc_evict_impl(arc_mru, ARC_BUFC_DATA, classes, e);
 	total_evicted += bytes;
 	mrud -= bytes;
 	asize -= bytes;
 
 	/* Evict MFU data. */
 	e = asize - ac;
-	bytes = arc_evict_impl(arc_mfu, ARC_BUFC_DATA, e);
+	bytes = arc_evict_impl(arc_mfu, ARC_BUFC_DATA, classes, e);
 	mfud -= bytes;
 	total_evicted += bytes;
 
@@ -4382,22 +4765,24 @@ arc_evict(void)
 	gsrd = (mrum + mfud + mfum) / 2;
 	e = zfs_refcount_count(&arc_mru_ghost->arcs_size[ARC_BUFC_DATA]) -
 	    gsrd;
-	(void) arc_evict_impl(arc_mru_ghost, ARC_BUFC_DATA, e);
+	(void) arc_evict_impl(arc_mru_ghost, ARC_BUFC_DATA, ARC_CLASS_ALL, e);
 
 	gsrm = (mrud + mfud + mfum) / 2;
 	e = zfs_refcount_count(&arc_mru_ghost->arcs_size[ARC_BUFC_METADATA]) -
 	    gsrm;
-	(void) arc_evict_impl(arc_mru_ghost, ARC_BUFC_METADATA, e);
+	(void) arc_evict_impl(arc_mru_ghost, ARC_BUFC_METADATA, ARC_CLASS_ALL,
+	    e);
 
 	gsfd = (mrud + mrum + mfum) / 2;
 	e = zfs_refcount_count(&arc_mfu_ghost->arcs_size[ARC_BUFC_DATA]) -
 	    gsfd;
-	(void) arc_evict_impl(arc_mfu_ghost, ARC_BUFC_DATA, e);
+	(void) arc_evict_impl(arc_mfu_ghost, ARC_BUFC_DATA, ARC_CLASS_ALL, e);
 
 	gsfm = (mrud + mrum + mfud) / 2;
 	e = zfs_refcount_count(&arc_mfu_ghost->arcs_size[ARC_BUFC_METADATA]) -
 	    gsfm;
-	(void) arc_evict_impl(arc_mfu_ghost, ARC_BUFC_METADATA, e);
+	(void) arc_evict_impl(arc_mfu_ghost, ARC_BUFC_METADATA, ARC_CLASS_ALL,
+	    e);
 
 	return (total_evicted);
 }
@@ -4653,6 +5038,21 @@ arc_evict_cb_check(void *arg, zthr_t *zthr)
 	if (arc_evict_needed)
 		return (B_TRUE);
 
+	/*
+	 * Trim classes over their maximum size, at most once a second, so
+	 * that they are kept small even while the ARC is not full.
+	 */
+	if (ddi_get_lbolt() - arc_last_classes_evict >= SEC_TO_TICK(1) &&
+	    arc_class_over_max()) {
+		arc_evict_classes_needed = B_TRUE;
+		return (B_TRUE);
+	}
+
+	if (arc_sketch_age_due()) {
+		arc_sketch_age_needed = B_TRUE;
+		return (B_TRUE);
+	}
+
 	/*
 	 * If we have buffers in uncached state, evict them periodically.
 	 */
@@ -4679,6 +5079,19 @@ arc_evict_cb(void *arg, zthr_t *zthr)
 	evicted += arc_flush_state(arc_uncached, 0, ARC_BUFC_DATA, B_FALSE);
 	evicted += arc_flush_state(arc_uncached, 0, ARC_BUFC_METADATA, B_FALSE);
 
+	/* Keep the ARC classes below their maximum size. */
+	if (arc_evict_classes_needed) {
+		arc_evict_classes_needed = B_FALSE;
+		arc_last_classes_evict = ddi_get_lbolt();
+		evicted += arc_evict_classes();
+	}
+
+	/* Let old admission sketch frequencies fade. */
+	if (arc_sketch_age_needed || arc_sketch_age_due()) {
+		arc_sketch_age_needed = B_FALSE;
+		arc_sketch_age();
+	}
+
 	/* Evict from other states only if told to. */
 	if (arc_evict_needed)
 		evicted += arc_evict();
@@ -5329,12 +5742,15 @@ arc_buf_access(arc_buf_t *buf)
 	    hdr->b_l1hdr.b_state == arc_uncached);
 
 	DTRACE_PROBE1(arc__hit, arc_buf_hdr_t *, hdr);
+	arc_trace_record(hdr, ARC_TRACE_HIT, 0);
 	arc_access(hdr, 0, B_TRUE);
+	uint_t arc_class = hdr->b_class;
 	mutex_exit(hash_lock);
 
 	ARCSTAT_BUMP(arcstat_hits);
 	ARCSTAT_CONDSTAT(B_TRUE /* demand */, demand, prefetch,
 	    !HDR_ISTYPE_METADATA(hdr), data, metadata, hits);
+	ARCSTAT_BUMP(arcstat_class_hits[arc_class]);
 }
 
 /* a generic arc_read_done_func_t which you can use */
@@ -5468,6 +5884,18 @@ arc_read_done(zio_t *zio)
 	ASSERT3P(callback_list, !=, NULL);
 	hdr->b_l1hdr.b_acb = NULL;
 
+	/*
+	 * The zio may have left a linear copy of the compressed data it
+	 * checksummed; see zio_checksum_verify_fused().
+	 */
+	abd_t *lpabd = NULL;
+	if (zio->io_verified_abd != NULL &&
+	    zio->io_abd == hdr->b_l1hdr.b_pabd) {
+		ASSERT3U(abd_get_size(zio->io_verified_abd), ==,
+		    HDR_GET_PSIZE(hdr));
+		lpabd = zio->io_verified_abd;
+	}
+
 	/*
 	 * If a read request has a callback (i.e. acb_done is not NULL), then we
 	 * make a buf containing the data according to the parameters which were
@@ -5490,7 +5918,7 @@ arc_read_done(zio_t *zio)
 
 		int error = arc_buf_alloc_impl(hdr, zio->io_spa,
 		    &acb->acb_zb, acb->acb_private, acb->acb_encrypted,
-		    acb->acb_compressed, acb->acb_noauth, B_TRUE,
+		    acb->acb_compressed, acb->acb_noauth, B_TRUE, lpabd,
 		    &acb->acb_buf);
 
 		/*
@@ -5669,6 +6097,21 @@ int
 arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
     arc_read_done_func_t *done, void *private, zio_priority_t priority,
     int zio_flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb)
+{
+	return (arc_read_class(pio, spa, bp, done, private, priority,
+	    zio_flags, arc_flags, zb, ARC_CLASS_DEFAULT));
+}
+
+/*
+ * Like arc_read(), but account the access to, and cache a missing block
+ * in, the given ARC class.  A block that is already cached keeps the
+ * class it was cached for.
+ */
+int
+arc_read_class(zio_t *pio, spa_t *spa, const blkptr_t *bp,
+    arc_read_done_func_t *done, void *private, zio_priority_t priority,
+    int zio_flags, arc_flags_t *arc_flags, const zbookmark_phys_t *zb,
+    uint_t arc_class)
 {
 	arc_buf_hdr_t *hdr = NULL;
 	kmutex_t *hash_lock = NULL;
@@ -5681,13 +6124,16 @@ arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
 	    (zio_flags & ZIO_FLAG_RAW_ENCRYPT) != 0;
 	boolean_t embedded_bp = !!BP_IS_EMBEDDED(bp);
 	boolean_t no_buf = *arc_flags & ARC_FLAG_NO_BUF;
+	boolean_t uncached = !!(*arc_flags & ARC_FLAG_UNCACHED);
 	arc_buf_t *buf = NULL;
+	uint_t freq = 0;
 	int rc = 0;
 
 	ASSERT(!embedded_bp ||
 	    BPE_GET_ETYPE(bp) == BP_EMBEDDED_TYPE_DATA);
 	ASSERT(!BP_IS_HOLE(bp));
 	ASSERT(!BP_IS_REDACTED(bp));
+	ASSERT3U(arc_class, <, ARC_CLASS_COUNT);
 
 	/*
 	 * Normally SPL_FSTRANS will already be set since kernel threads which
@@ -5700,6 +6146,13 @@ arc_read(zio_t *pio, spa_t *spa, const blkptr_t *bp,
 	 * on the hash_lock always set and clear the bit.
 	 */
 	fstrans_cookie_t cookie = spl_fstrans_mark();
+
+	if (zfs_arc_admit && !embedded_bp &&
+	    BP_GET_BUFC_TYPE(bp) == ARC_BUFC_DATA &&
+	    !(*arc_flags & ARC_FLAG_CACHED_ONLY)) {
+		freq = arc_sketch_touch(guid, bp,
+		    !(*arc_flags & ARC_FLAG_PREFETCH));
+	}
 top:
 	if (!embedded_bp) {
 		/*
@@ -5740,6 +6193,7 @@ top:
 				goto done;
 			}
 
+			arc_trace_record(hdr, ARC_TRACE_IOHIT, *arc_flags);
 			zio_t *head_zio = hdr->b_l1hdr.b_acb->acb_zio_head;
 			ASSERT3P(head_zio, !=, NULL);
 			if ((hdr->b_flags & ARC_FLAG_PRIO_ASYNC_READ) &&
@@ -5827,6 +6281,7 @@ top:
 		    hdr->b_l1hdr.b_state == arc_uncached);
 
 		DTRACE_PROBE1(arc__hit, arc_buf_hdr_t *, hdr);
+		arc_trace_record(hdr, ARC_TRACE_HIT, *arc_flags);
 		arc_access(hdr, *arc_flags, B_TRUE);
 
 		if (done && !no_buf) {
@@ -5835,7 +6290,7 @@ top:
 			/* Get a buf with the desired data in it. */
 			rc = arc_buf_alloc_impl(hdr, spa, zb, private,
 			    encrypted_read, compressed_read, noauth_read,
-			    B_TRUE, &buf);
+			    B_TRUE, NULL, &buf);
 			if (rc == ECKSUM) {
 				/*
 				 * Convert authentication and decryption errors
@@ -5864,6 +6319,7 @@ top:
 		ARCSTAT_BUMP(arcstat_hits);
 		ARCSTAT_CONDSTAT(!(*arc_flags & ARC_FLAG_PREFETCH),
 		    demand, prefetch, is_data, data, metadata, hits);
+		ARCSTAT_BUMP(arcstat_class_hits[arc_class]);
 		*arc_flags |= ARC_FLAG_CACHED;
 		goto done;
 	} else {
@@ -5977,12 +6433,23 @@ top:
 				goto top;
 			}
 		}
-		if (*arc_flags & ARC_FLAG_UNCACHED) {
+		/*
+		 * A data block that is new to the cache must pass the
+		 * admission filter, or it is only cached until released.
+		 */
+		if (freq != 0 && !uncached &&
+		    hdr->b_l1hdr.b_state == arc_anon && !arc_admit(freq))
+			uncached = B_TRUE;
+		if (uncached) {
 			arc_hdr_set_flags(hdr, ARC_FLAG_UNCACHED);
 			if (!encrypted_read)
 				alloc_flags |= ARC_HDR_ALLOC_LINEAR;
 		}
 
+		/* A header already in the MRU or MFU keeps its class. */
+		if (!CLASS_STATE(hdr->b_l1hdr.b_state))
+			hdr->b_class = arc_class;
+
 		/*
 		 * Take additional reference for IO_IN_PROGRESS.  It stops
 		 * arc_access() from putting this header without any buffers
@@ -5990,8 +6457,10 @@ top:
 		 * the evictable list of MRU or MFU state.
 		 */
 		add_reference(hdr, hdr);
-		if (!embedded_bp)
+		if (!embedded_bp) {
+			arc_trace_record(hdr, ARC_TRACE_MISS, *arc_flags);
 			arc_access(hdr, *arc_flags, B_FALSE);
+		}
 		arc_hdr_set_flags(hdr, ARC_FLAG_IO_IN_PROGRESS);
 		arc_hdr_alloc_abd(hdr, alloc_flags);
 		if (encrypted_read) {
@@ -6078,6 +6547,7 @@ top:
 			ARCSTAT_CONDSTAT(!(*arc_flags & ARC_FLAG_PREFETCH),
 			    demand, prefetch, !HDR_ISTYPE_METADATA(hdr), data,
 			    metadata, misses);
+			ARCSTAT_BUMP(arcstat_class_misses[arc_class]);
 			zfs_racct_read(spa, size, 1, 0);
 		}
 
@@ -6238,6 +6708,100 @@ done:
 	goto out;
 }
 
+#ifndef _KERNEL
+/*
+ * Replay an access to a block for arc_sim: cache it as arc_read() or
+ * arc_write() would, but without any I/O, and release it at once.  Returns
+ * B_TRUE if the block was already cached.
+ */
+boolean_t
+arc_sim_access(uint64_t guid, const blkptr_t *bp, arc_flags_t arc_flags,
+    uint_t arc_class)
+{
+	arc_buf_contents_t type = BP_GET_BUFC_TYPE(bp);
+	boolean_t uncached = !!(arc_flags & ARC_FLAG_UNCACHED);
+	arc_buf_hdr_t *hdr, *exists;
+	kmutex_t *hash_lock;
+	int alloc_flags = 0;
+	uint_t freq = 0;
+
+	ASSERT(!BP_IS_EMBEDDED(bp));
+	ASSERT3U(arc_class, <, ARC_CLASS_COUNT);
+
+	if (zfs_arc_admit && type == ARC_BUFC_DATA) {
+		freq = arc_sketch_touch(guid, bp,
+		    !(arc_flags & ARC_FLAG_PREFETCH));
+	}
+top:
+	hdr = buf_hash_find(guid, bp, &hash_lock);
+	if (hdr != NULL && HDR_HAS_L1HDR(hdr) &&
+	    hdr->b_l1hdr.b_pabd != NULL) {
+		/*
+		 * Hold the header like a reader's buffer would, so that
+		 * releasing it moves it to the head of its list.
+		 */
+		add_reference(hdr, FTAG);
+		arc_access(hdr, arc_flags, B_TRUE);
+		(void) remove_reference(hdr, FTAG);
+		mutex_exit(hash_lock);
+		return (B_TRUE);
+	}
+
+	if (hdr == NULL) {
+		hdr = arc_hdr_alloc(guid, BP_GET_PSIZE(bp), BP_GET_LSIZE(bp),
+		    B_FALSE, BP_GET_COMPRESS(bp), 0, type);
+		hdr->b_dva = *BP_IDENTITY(bp);
+		hdr->b_birth = BP_GET_BIRTH(bp);
+		exists = buf_hash_insert(hdr, &hash_lock);
+		if (exists != NULL) {
+			mutex_exit(hash_lock);
+			buf_discard_identity(hdr);
+			arc_hdr_destroy(hdr);
+			goto top;
+		}
+	} else if (!HDR_HAS_L1HDR(hdr)) {
+		hdr = arc_hdr_realloc(hdr, hdr_l2only_cache, hdr_full_cache);
+	}
+	ASSERT(hdr->b_l1hdr.b_state == arc_anon ||
+	    GHOST_STATE(hdr->b_l1hdr.b_state));
+
+	if (freq != 0 && !uncached &&
+	    hdr->b_l1hdr.b_state == arc_anon && !arc_admit(freq))
+		uncached = B_TRUE;
+	if (uncached) {
+		arc_hdr_set_flags(hdr, ARC_FLAG_UNCACHED);
+		alloc_flags |= ARC_HDR_ALLOC_LINEAR;
+	}
+	hdr->b_class = arc_class;
+
+	add_reference(hdr, hdr);
+	arc_access(hdr, arc_flags, B_FALSE);
+	arc_hdr_set_flags(hdr, ARC_FLAG_IO_IN_PROGRESS);
+	arc_hdr_alloc_abd(hdr, alloc_flags);
+	arc_hdr_clear_flags(hdr, ARC_FLAG_IO_IN_PROGRESS);
+	(void) remove_reference(hdr, hdr);
+	mutex_exit(hash_lock);
+
+	return (B_FALSE);
+}
+
+/*
+ * Look a block up in the hash table the way arc_read() does, for
+ * buf_hash_bench.  Returns B_TRUE if it is cached.
+ */
+boolean_t
+arc_bench_hash_find(uint64_t guid, const blkptr_t *bp)
+{
+	kmutex_t *hash_lock;
+	arc_buf_hdr_t *hdr = buf_hash_find(guid, bp, &hash_lock);
+
+	if (hdr == NULL)
+		return (B_FALSE);
+	mutex_exit(hash_lock);
+	return (B_TRUE);
+}
+#endif
+
 arc_prune_t *
 arc_add_prune_callback(arc_prune_func_t *func, void *private)
 {
@@ -6545,6 +7109,7 @@ arc_release(arc_buf_t *buf, const void *tag)
 
 		nhdr = arc_hdr_alloc(spa, psize, lsize, protected,
 		    compress, hdr->b_complevel, type);
+		nhdr->b_class = hdr->b_class;
 		ASSERT3P(nhdr->b_l1hdr.b_buf, ==, NULL);
 		ASSERT0(zfs_refcount_count(&nhdr->b_l1hdr.b_refcnt));
 		VERIFY3U(nhdr->b_type, ==, type);
@@ -6832,8 +7397,11 @@ arc_write_done(zio_t *zio)
 		arc_hdr_clear_flags(hdr, ARC_FLAG_IO_IN_PROGRESS);
 		VERIFY3S(remove_reference(hdr, hdr), >, 0);
 		/* if it's not anon, we are doing a scrub */
-		if (exists == NULL && hdr->b_l1hdr.b_state == arc_anon)
+		if (exists == NULL && hdr->b_l1hdr.b_state == arc_anon) {
+			arc_trace_record(hdr, ARC_TRACE_WRITE,
+			    HDR_UNCACHED(hdr) ? ARC_FLAG_UNCACHED : 0);
 			arc_access(hdr, 0, B_FALSE);
+		}
 		mutex_exit(hash_lock);
 	} else {
 		arc_hdr_clear_flags(hdr, ARC_FLAG_IO_IN_PROGRESS);
@@ -6849,7 +7417,7 @@ arc_write_done(zio_t *zio)
 zio_t *
 arc_write(zio_t *pio, spa_t *spa, uint64_t txg,
     blkptr_t *bp, arc_buf_t *buf, boolean_t uncached, boolean_t l2arc,
-    const zio_prop_t *zp, arc_write_done_func_t *ready,
+    uint_t arc_class, const zio_prop_t *zp, arc_write_done_func_t *ready,
     arc_write_done_func_t *children_ready, arc_write_done_func_t *done,
     void *private, zio_priority_t priority, int zio_flags,
     const zbookmark_phys_t *zb)
@@ -6869,6 +7437,8 @@ arc_write(zio_t *pio, spa_t *spa, uint64_t txg,
 		arc_hdr_set_flags(hdr, ARC_FLAG_UNCACHED);
 	else if (l2arc)
 		arc_hdr_set_flags(hdr, ARC_FLAG_L2CACHE);
+	ASSERT(!CLASS_STATE(hdr->b_l1hdr.b_state));
+	hdr->b_class = arc_class;
 
 	if (ARC_BUF_ENCRYPTED(buf)) {
 		ASSERT(ARC_BUF_COMPRESSED(buf));
@@ -7306,6 +7876,21 @@ arc_kstat_update(kstat_t *ksp, int rw)
 	    wmsum_value(&arc_sums.arcstat_cached_only_in_progress);
 	as->arcstat_abd_chunk_waste_size.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_abd_chunk_waste_size);
+	as->arcstat_admit_accepted.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_admit_accepted);
+	as->arcstat_admit_rejected.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_admit_rejected);
+	for (int c = 0; c < ARC_CLASS_COUNT; c++) {
+		as->arcstat_class_size[c].value.ui64 = arc_class_size(c);
+		as->arcstat_class_hits[c].value.ui64 =
+		    wmsum_value(&arc_sums.arcstat_class_hits[c]);
+		as->arcstat_class_misses[c].value.ui64 =
+		    wmsum_value(&arc_sums.arcstat_class_misses[c]);
+		as->arcstat_class_evicted[c].value.ui64 =
+		    wmsum_value(&arc_sums.arcstat_class_evicted[c]);
+	}
+	as->arcstat_evict_class_skip.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_evict_class_skip);
 
 	return (0);
 }
@@ -7613,6 +8198,15 @@ arc_state_init(void)
 	wmsum_init(&arc_sums.arcstat_raw_size, 0);
 	wmsum_init(&arc_sums.arcstat_cached_only_in_progress, 0);
 	wmsum_init(&arc_sums.arcstat_abd_chunk_waste_size, 0);
+	wmsum_init(&arc_sums.arcstat_admit_accepted, 0);
+	wmsum_init(&arc_sums.arcstat_admit_rejected, 0);
+	for (int c = 0; c < ARC_CLASS_COUNT; c++) {
+		wmsum_init(&arc_sums.arcstat_class_size[c], 0);
+		wmsum_init(&arc_sums.arcstat_class_hits[c], 0);
+		wmsum_init(&arc_sums.arcstat_class_misses[c], 0);
+		wmsum_init(&arc_sums.arcstat_class_evicted[c], 0);
+	}
+	wmsum_init(&arc_sums.arcstat_evict_class_skip, 0);
 
 	arc_anon->arcs_state = ARC_STATE_ANON;
 	arc_mru->arcs_state = ARC_STATE_MRU;
@@ -7772,6 +8366,15 @@ arc_state_fini(void)
 	wmsum_fini(&arc_sums.arcstat_raw_size);
 	wmsum_fini(&arc_sums.arcstat_cached_only_in_progress);
 	wmsum_fini(&arc_sums.arcstat_abd_chunk_waste_size);
+	wmsum_fini(&arc_sums.arcstat_admit_accepted);
+	wmsum_fini(&arc_sums.arcstat_admit_rejected);
+	for (int c = 0; c < ARC_CLASS_COUNT; c++) {
+		wmsum_fini(&arc_sums.arcstat_class_size[c]);
+		wmsum_fini(&arc_sums.arcstat_class_hits[c]);
+		wmsum_fini(&arc_sums.arcstat_class_misses[c]);
+		wmsum_fini(&arc_sums.arcstat_class_evicted[c]);
+	}
+	wmsum_fini(&arc_sums.arcstat_evict_class_skip);
 }
 
 uint64_t
@@ -7858,6 +8461,7 @@ arc_init(void)
 	arc_state_init();
 
 	buf_init();
+	arc_trace_init();
 
 	list_create(&arc_prune_list, sizeof (arc_prune_t),
 	    offsetof(arc_prune_t, p_node));
@@ -7974,6 +8578,8 @@ arc_fini(void)
 	mutex_destroy(&arc_evict_lock);
 	list_destroy(&arc_evict_waiters);
 
+	arc_trace_fini();
+
 	/*
 	 * Free any buffers that were tagged for destruction.  This needs
 	 * to occur before arc_state_fini() runs and destroys the aggsum
@@ -8112,7 +8718,11 @@ arc_fini(void)
  * 6. Writes to the L2ARC devices are grouped and sent in-sequence, so that
  * the vdev queue can aggregate them into larger and fewer writes.  Each
  * device is written to in a rotor fashion, sweeping writes through
- * available space then repeating.
+ * available space then repeating.  Devices are fed independently of each
+ * other: l2arc_feed_thread() dispatches a l2arc_feed_dev() task for every
+ * device that is due, so several cache devices fill in parallel, each
+ * pacing itself with l2arc_write_interval() and scanning the ARC sublists
+ * from its own cursor.
  *
  * 7. The L2ARC does not store dirty content.  It never needs to flush
  * write buffers back to disk based storage.
@@ -8338,68 +8948,6 @@ l2arc_dev_invalid(const l2arc_dev_t *dev)
 	    dev->l2ad_spa == NULL || dev->l2ad_spa->spa_is_exporting);
 }
 
-/*
- * Cycle through L2ARC devices.  This is how L2ARC load balances.
- * If a device is returned, this also returns holding the spa config lock.
- */
-static l2arc_dev_t *
-l2arc_dev_get_next(void)
-{
-	l2arc_dev_t *first, *next = NULL;
-
-	/*
-	 * Lock out the removal of spas (spa_namespace_lock), then removal
-	 * of cache devices (l2arc_dev_mtx).  Once a device has been selected,
-	 * both locks will be dropped and a spa config lock held instead.
-	 */
-	mutex_enter(&spa_namespace_lock);
-	mutex_enter(&l2arc_dev_mtx);
-
-	/* if there are no vdevs, there is nothing to do */
-	if (l2arc_ndev == 0)
-		goto out;
-
-	first = NULL;
-	next = l2arc_dev_last;
-	do {
-		/* loop around the list looking for a non-faulted vdev */
-		if (next == NULL) {
-			next = list_head(l2arc_dev_list);
-		} else {
-			next = list_next(l2arc_dev_list, next);
-			if (next == NULL)
-				next = list_head(l2arc_dev_list);
-		}
-
-		/* if we have come back to the start, bail out */
-		if (first == NULL)
-			first = next;
-		else if (next == first)
-			break;
-
-		ASSERT3P(next, !=, NULL);
-	} while (l2arc_dev_invalid(next));
-
-	/* if we were unable to find any usable vdevs, return NULL */
-	if (l2arc_dev_invalid(next))
-		next = NULL;
-
-	l2arc_dev_last = next;
-
-out:
-	mutex_exit(&l2arc_dev_mtx);
-
-	/*
-	 * Grab the config lock to prevent the 'next' device from being
-	 * removed while we are writing to it.
-	 */
-	if (next != NULL)
-		spa_config_enter(next->l2ad_spa, SCL_L2ARC, next, RW_READER);
-	mutex_exit(&spa_namespace_lock);
-
-	return (next);
-}
-
 /*
  * Free buffers that were tagged for destruction.
  */
@@ -8848,7 +9396,7 @@ l2arc_read_done(zio_t *zio)
  * the lock pointer.
  */
 static multilist_sublist_t *
-l2arc_sublist_lock(int list_num)
+l2arc_sublist_lock(l2arc_dev_t *dev, int list_num)
 {
 	multilist_t *ml = NULL;
 	unsigned int idx;
@@ -8873,12 +9421,13 @@ l2arc_sublist_lock(int list_num)
 	}
 
 	/*
-	 * Return a randomly-selected sublist. This is acceptable
-	 * because the caller feeds only a little bit of data for each
-	 * call (8MB). Subsequent calls will result in different
-	 * sublists being selected.
+	 * Each device walks the sublists round-robin from its own cursor,
+	 * which l2arc_write_buffers() advances once per call.  The caller
+	 * feeds only a little bit of data for each call (8MB), so this
+	 * covers all sublists over time, and devices fed in parallel start
+	 * from different random positions and rarely scan the same one.
 	 */
-	idx = multilist_get_random_index(ml);
+	idx = dev->l2ad_feed_cursor % multilist_get_num_sublists(ml);
 	return (multilist_sublist_lock_idx(ml, idx));
 }
 
@@ -9321,7 +9870,7 @@ l2arc_write_buffers(spa_t *spa, l2arc_dev_t *dev, uint64_t target_sz)
 		 * Until the ARC is warm and starts to evict, read from the
 		 * head of the ARC lists rather than the tail.
 		 */
-		multilist_sublist_t *mls = l2arc_sublist_lock(pass);
+		multilist_sublist_t *mls = l2arc_sublist_lock(dev, pass);
 		ASSERT3P(mls, !=, NULL);
 		if (from_head)
 			hdr = multilist_sublist_head(mls);
@@ -9507,6 +10056,7 @@ next:
 	}
 
 	arc_state_free_marker(marker);
+	dev->l2ad_feed_cursor++;
 
 	/* No buffers selected for writing? */
 	if (pio == NULL) {
@@ -9555,78 +10105,38 @@ l2arc_hdr_limit_reached(void)
 }
 
 /*
- * This thread feeds the L2ARC at regular intervals.  This is the beating
- * heart of the L2ARC.
+ * Feed a single L2ARC device.  This runs on l2arc_feed_taskq, so that each
+ * cache device is written by its own task and fill bandwidth scales with
+ * the number of devices.  The spa config lock protecting the device from
+ * removal was taken by l2arc_feed_dispatch() and is dropped here.
  */
-static  __attribute__((noreturn)) void
-l2arc_feed_thread(void *unused)
+static void
+l2arc_feed_dev(void *arg)
 {
-	(void) unused;
-	callb_cpr_t cpr;
-	l2arc_dev_t *dev;
-	spa_t *spa;
+	l2arc_dev_t *dev = arg;
+	spa_t *spa = dev->l2ad_spa;
 	uint64_t size, wrote;
-	clock_t begin, next = ddi_get_lbolt();
+	clock_t begin, next;
 	fstrans_cookie_t cookie;
 
-	CALLB_CPR_INIT(&cpr, &l2arc_feed_thr_lock, callb_generic_cpr, FTAG);
-
-	mutex_enter(&l2arc_feed_thr_lock);
+	ASSERT3P(spa, !=, NULL);
 
 	cookie = spl_fstrans_mark();
-	while (l2arc_thread_exit == 0) {
-		CALLB_CPR_SAFE_BEGIN(&cpr);
-		(void) cv_timedwait_idle(&l2arc_feed_thr_cv,
-		    &l2arc_feed_thr_lock, next);
-		CALLB_CPR_SAFE_END(&cpr, &l2arc_feed_thr_lock);
-		next = ddi_get_lbolt() + hz;
-
-		/*
-		 * Quick check for L2ARC devices.
-		 */
-		mutex_enter(&l2arc_dev_mtx);
-		if (l2arc_ndev == 0) {
-			mutex_exit(&l2arc_dev_mtx);
-			continue;
-		}
-		mutex_exit(&l2arc_dev_mtx);
-		begin = ddi_get_lbolt();
-
-		/*
-		 * This selects the next l2arc device to write to, and in
-		 * doing so the next spa to feed from: dev->l2ad_spa.   This
-		 * will return NULL if there are now no l2arc devices or if
-		 * they are all faulted.
-		 *
-		 * If a device is returned, its spa's config lock is also
-		 * held to prevent device removal.  l2arc_dev_get_next()
-		 * will grab and release l2arc_dev_mtx.
-		 */
-		if ((dev = l2arc_dev_get_next()) == NULL)
-			continue;
-
-		spa = dev->l2ad_spa;
-		ASSERT3P(spa, !=, NULL);
+	begin = ddi_get_lbolt();
+	next = begin + hz;
 
+	if (!spa_writeable(spa)) {
 		/*
-		 * If the pool is read-only then force the feed thread to
-		 * sleep a little longer.
+		 * If the pool is read-only then force the device to sleep
+		 * a little longer.
 		 */
-		if (!spa_writeable(spa)) {
-			next = ddi_get_lbolt() + 5 * l2arc_feed_secs * hz;
-			spa_config_exit(spa, SCL_L2ARC, dev);
-			continue;
-		}
-
+		next = begin + 5 * l2arc_feed_secs * hz;
+	} else if (l2arc_hdr_limit_reached()) {
 		/*
 		 * Avoid contributing to memory pressure.
 		 */
-		if (l2arc_hdr_limit_reached()) {
-			ARCSTAT_BUMP(arcstat_l2_abort_lowmem);
-			spa_config_exit(spa, SCL_L2ARC, dev);
-			continue;
-		}
-
+		ARCSTAT_BUMP(arcstat_l2_abort_lowmem);
+	} else {
 		ARCSTAT_BUMP(arcstat_l2_feeds);
 
 		size = l2arc_write_size(dev);
@@ -9645,7 +10155,117 @@ l2arc_feed_thread(void *unused)
 		 * Calculate interval between writes.
 		 */
 		next = l2arc_write_interval(begin, size, wrote);
-		spa_config_exit(spa, SCL_L2ARC, dev);
+	}
+
+	mutex_enter(&l2arc_dev_mtx);
+	dev->l2ad_feed_next = next;
+	dev->l2ad_feeding = B_FALSE;
+	mutex_exit(&l2arc_dev_mtx);
+	spa_config_exit(spa, SCL_L2ARC, dev);
+	spl_fstrans_unmark(cookie);
+
+	/*
+	 * Let the feed thread reconsider when to run next.
+	 */
+	mutex_enter(&l2arc_feed_thr_lock);
+	cv_signal(&l2arc_feed_thr_cv);
+	mutex_exit(&l2arc_feed_thr_lock);
+}
+
+/*
+ * Dispatch a feed task for every usable L2ARC device that is due to be fed
+ * and does not have a task in flight already.  Returns the time at which
+ * the next idle device is due.
+ *
+ * The spa_namespace_lock locks out the removal of spas and cache devices
+ * while the spa config lock is taken on behalf of each dispatched task.
+ */
+static clock_t
+l2arc_feed_dispatch(void)
+{
+	l2arc_dev_t *dev, **devs;
+	clock_t now = ddi_get_lbolt();
+	clock_t next = now + hz;
+	uint64_t ndevs = 0, maxdevs;
+
+	mutex_enter(&spa_namespace_lock);
+	mutex_enter(&l2arc_dev_mtx);
+
+	maxdevs = l2arc_ndev;
+	if (maxdevs == 0) {
+		mutex_exit(&l2arc_dev_mtx);
+		mutex_exit(&spa_namespace_lock);
+		return (next);
+	}
+	devs = kmem_alloc(maxdevs * sizeof (l2arc_dev_t *), KM_SLEEP);
+
+	for (dev = list_head(l2arc_dev_list); dev != NULL;
+	    dev = list_next(l2arc_dev_list, dev)) {
+		if (dev->l2ad_feeding || l2arc_dev_invalid(dev))
+			continue;
+		if (dev->l2ad_feed_next > now) {
+			next = MIN(next, dev->l2ad_feed_next);
+			continue;
+		}
+		ASSERT3U(ndevs, <, maxdevs);
+		dev->l2ad_feeding = B_TRUE;
+		devs[ndevs++] = dev;
+	}
+	mutex_exit(&l2arc_dev_mtx);
+
+	/*
+	 * Grab the config lock to prevent the device from being removed
+	 * while its feed task is writing to it.
+	 */
+	for (uint64_t i = 0; i < ndevs; i++) {
+		dev = devs[i];
+		spa_config_enter(dev->l2ad_spa, SCL_L2ARC, dev, RW_READER);
+		(void) taskq_dispatch(l2arc_feed_taskq, l2arc_feed_dev, dev,
+		    TQ_SLEEP);
+	}
+	mutex_exit(&spa_namespace_lock);
+
+	kmem_free(devs, maxdevs * sizeof (l2arc_dev_t *));
+
+	return (next);
+}
+
+/*
+ * This thread feeds the L2ARC at regular intervals.  This is the beating
+ * heart of the L2ARC.  The writes themselves are issued by per-device feed
+ * tasks; this thread only decides which devices are due.
+ */
+static  __attribute__((noreturn)) void
+l2arc_feed_thread(void *unused)
+{
+	(void) unused;
+	callb_cpr_t cpr;
+	clock_t next = ddi_get_lbolt();
+	fstrans_cookie_t cookie;
+
+	CALLB_CPR_INIT(&cpr, &l2arc_feed_thr_lock, callb_generic_cpr, FTAG);
+
+	mutex_enter(&l2arc_feed_thr_lock);
+
+	cookie = spl_fstrans_mark();
+	while (l2arc_thread_exit == 0) {
+		CALLB_CPR_SAFE_BEGIN(&cpr);
+		(void) cv_timedwait_idle(&l2arc_feed_thr_cv,
+		    &l2arc_feed_thr_lock, next);
+		CALLB_CPR_SAFE_END(&cpr, &l2arc_feed_thr_lock);
+		next = ddi_get_lbolt() + hz;
+
+		/*
+		 * Quick check for L2ARC devices.
+		 */
+		mutex_enter(&l2arc_dev_mtx);
+		if (l2arc_ndev == 0) {
+			mutex_exit(&l2arc_dev_mtx);
+			continue;
+		}
+		mutex_exit(&l2arc_dev_mtx);
+
+		next = l2arc_feed_dispatch();
 	}
 	spl_fstrans_unmark(cookie);
 
@@ -9790,6 +10410,7 @@ l2arc_add_vdev(spa_t *spa, vdev_t *vd)
 	adddev->l2ad_first = B_TRUE;
 	adddev->l2ad_writing = B_FALSE;
 	adddev->l2ad_trim_all = B_FALSE;
+	adddev->l2ad_feed_cursor = random_in_range(UINT32_MAX);
 	list_link_init(&adddev->l2ad_node);
 	adddev->l2ad_dev_hdr = kmem_zalloc(l2dhdr_asize, KM_SLEEP);
 
@@ -9945,8 +10566,8 @@ l2arc_remove_vdev(vdev_t *vd)
 	 */
 	ASSERT(spa_config_held(spa, SCL_L2ARC, RW_WRITER) & SCL_L2ARC);
 	mutex_enter(&l2arc_dev_mtx);
+	ASSERT(!remdev->l2ad_feeding);
 	list_remove(l2arc_dev_list, remdev);
-	l2arc_dev_last = NULL;		/* may have been invalidated */
 	atomic_dec_64(&l2arc_ndev);
 
 	/* During a pool export spa & vdev will no longer be valid */
@@ -10008,6 +10629,8 @@ l2arc_start(void)
 	if (!(spa_mode_global & SPA_MODE_WRITE))
 		return;
 
+	l2arc_feed_taskq = taskq_create("l2arc_feed", MAX(boot_ncpus, 1),
+	    defclsyspri, 1, INT_MAX, TASKQ_DYNAMIC);
 	(void) thread_create(NULL, 0, l2arc_feed_thread, NULL, 0, &p0,
 	    TS_RUN, defclsyspri);
 }
@@ -10024,6 +10647,10 @@ l2arc_stop(void)
 	while (l2arc_thread_exit != 0)
 		cv_wait(&l2arc_feed_thr_cv, &l2arc_feed_thr_lock);
 	mutex_exit(&l2arc_feed_thr_lock);
+
+	/* Wait for the feed tasks still in flight. */
+	taskq_destroy(l2arc_feed_taskq);
+	l2arc_feed_taskq = NULL;
 }
 
 /*
@@ -11089,8 +11716,35 @@ ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, dnode_reduce_percent, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, eviction_pct, UINT, ZMOD_RW,
 	"When full, ARC allocation waits for eviction of this % of alloc size");
 
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, class1_min, U64, ZMOD_RW,
+	"Min size in bytes of ARC class 1");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, class1_max, U64, ZMOD_RW,
+	"Max size in bytes of ARC class 1");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, class2_min, U64, ZMOD_RW,
+	"Min size in bytes of ARC class 2");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, class2_max, U64, ZMOD_RW,
+	"Max size in bytes of ARC class 2");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, class3_min, U64, ZMOD_RW,
+	"Min size in bytes of ARC class 3");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, class3_max, U64, ZMOD_RW,
+	"Max size in bytes of ARC class 3");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, admit, INT, ZMOD_RW,
+	"Filter demand data blocks admitted to a full ARC by access frequency");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, admit_min_freq, UINT, ZMOD_RW,
+	"Accesses a block needs to be admitted to a full ARC");
+
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, evict_batch_limit, UINT, ZMOD_RW,
 	"The number of headers to evict per sublist before moving to the next");
 
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, evict_class_skip_limit, UINT, ZMOD_RW,
+	"Protected class headers to skip per sublist before moving on");
+
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, prune_task_threads, INT, ZMOD_RW,
 	"Number of arc_prune threads");
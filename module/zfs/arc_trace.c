@@ -0,0 +1,236 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * ARC access trace
+ *
+ * When zfs_arc_trace_entries is set at module load, every ARC read (hit,
+ * hit on a read in progress, or miss) and every block cached after being
+ * written is recorded in a ring buffer of that many entries.  Recording
+ * takes one atomic increment and a 64-byte store, and takes no locks.
+ * The ring is exported through the "arc_trace" kstat, oldest entry first;
+ * each entry carries a sequence number so that successive dumps can be
+ * stitched together.  The trace can be replayed against the ARC code at
+ * different cache sizes with arc_sim(1).
+ */
+
+#include <sys/zfs_context.h>
+#include <sys/arc.h>
+#include <sys/arc_impl.h>
+
+/*
+ * Number of entries in the ARC access trace ring, 0 to disable tracing.
+ * Only read when the ARC is initialized.
+ */
+uint_t zfs_arc_trace_entries = 0;
+
+typedef struct arc_trace_ent {
+	uint64_t	ate_seq;	/* sequence number, 0 while written */
+	hrtime_t	ate_time;
+	uint64_t	ate_spa;	/* pool load guid */
+	dva_t		ate_dva;
+	uint64_t	ate_birth;
+	uint32_t	ate_lsize;
+	uint32_t	ate_psize;
+	uint32_t	ate_flags;	/* arc_flags_t of the request */
+	uint8_t		ate_event;	/* arc_trace_event_t */
+	uint8_t		ate_state;	/* arc_state_type_t before access */
+	uint8_t		ate_type;	/* arc_buf_contents_t */
+	uint8_t		ate_class;	/* ARC class */
+} arc_trace_ent_t;
+
+typedef struct arc_trace {
+	kmutex_t	at_lock;	/* kstat reader lock */
+	kstat_t		*at_kstat;
+	arc_trace_ent_t	*at_ring;
+	uint64_t	at_size;	/* entries in at_ring */
+	uint64_t	at_seq;		/* last sequence number handed out */
+	uint64_t	at_first;	/* first sequence number being read */
+	uint64_t	at_last;	/* last sequence number being read */
+	arc_trace_ent_t	at_ent;		/* entry being formatted */
+} arc_trace_t;
+
+static arc_trace_t arc_trace;
+
+static const char *const arc_trace_event_names[] = {
+	"hit", "iohit", "miss", "write"
+};
+
+static const char *const arc_trace_state_names[] = {
+	"anon", "mru", "mru_ghost", "mfu", "mfu_ghost", "l2c_only", "uncached"
+};
+
+/*
+ * Flags of the request that affect how a block is cached, and so are worth
+ * replaying.
+ */
+#define	ARC_TRACE_FLAGS	(ARC_FLAG_PREFETCH | ARC_FLAG_PRESCIENT_PREFETCH | \
+	ARC_FLAG_UNCACHED | ARC_FLAG_L2CACHE)
+
+void
+arc_trace_record(const arc_buf_hdr_t *hdr, arc_trace_event_t event,
+    arc_flags_t flags)
+{
+	arc_trace_t *at = &arc_trace;
+	arc_trace_ent_t *ate;
+	uint64_t seq;
+
+	if (at->at_ring == NULL)
+		return;
+
+	ASSERT(hdr->b_flags & ARC_FLAG_HAS_L1HDR);
+	seq = atomic_inc_64_nv(&at->at_seq);
+	ate = &at->at_ring[(seq - 1) % at->at_size];
+
+	/*
+	 * Clear the sequence number first, so that a reader racing with us
+	 * skips the entry instead of returning a mix of two accesses.
+	 */
+	ate->ate_seq = 0;
+	membar_producer();
+	ate->ate_time = gethrtime();
+	ate->ate_spa = hdr->b_spa;
+	ate->ate_dva = hdr->b_dva;
+	ate->ate_birth = hdr->b_birth;
+	ate->ate_lsize = HDR_GET_LSIZE(hdr);
+	ate->ate_psize = HDR_GET_PSIZE(hdr);
+	ate->ate_flags = flags & ARC_TRACE_FLAGS;
+	ate->ate_event = event;
+	ate->ate_state = hdr->b_l1hdr.b_state->arcs_state;
+	ate->ate_type = (hdr->b_flags & ARC_FLAG_BUFC_METADATA) ?
+	    ARC_BUFC_METADATA : ARC_BUFC_DATA;
+	ate->ate_class = hdr->b_class;
+	membar_producer();
+	ate->ate_seq = seq;
+}
+
+static int
+arc_trace_headers(char *buf, size_t size)
+{
+	(void) snprintf(buf, size,
+	    "%-10s %-16s %-16s %-16s %-16s %-10s %-8s %-8s "
+	    "%-4s %-5s %-9s %-5s %s\n",
+	    "seq", "time", "spa", "dva0", "dva1", "birth", "lsize", "psize",
+	    "type", "event", "state", "class", "flags");
+
+	return (0);
+}
+
+static int
+arc_trace_data(char *buf, size_t size, void *data)
+{
+	arc_trace_ent_t *ate = data;
+
+	(void) snprintf(buf, size,
+	    "%-10llu %-16llu %016llx %016llx %016llx %-10llu %-8u %-8u "
+	    "%-4s %-5s %-9s %-5u 0x%x\n",
+	    (u_longlong_t)ate->ate_seq, (u_longlong_t)ate->ate_time,
+	    (u_longlong_t)ate->ate_spa,
+	    (u_longlong_t)ate->ate_dva.dva_word[0],
+	    (u_longlong_t)ate->ate_dva.dva_word[1],
+	    (u_longlong_t)ate->ate_birth, ate->ate_lsize, ate->ate_psize,
+	    ate->ate_type == ARC_BUFC_METADATA ? "meta" : "data",
+	    arc_trace_event_names[ate->ate_event],
+	    arc_trace_state_names[ate->ate_state],
+	    ate->ate_class, ate->ate_flags);
+
+	return (0);
+}
+
+static void *
+arc_trace_addr(kstat_t *ksp, loff_t n)
+{
+	arc_trace_t *at = ksp->ks_private;
+	arc_trace_ent_t *ate;
+
+	ASSERT(MUTEX_HELD(&at->at_lock));
+
+	/*
+	 * Only return the entries that were in the ring when the read
+	 * started, so that a busy system does not keep the reader going.
+	 */
+	if (n == 0) {
+		at->at_last = atomic_load_64(&at->at_seq);
+		at->at_first = at->at_last > at->at_size ?
+		    at->at_last - at->at_size + 1 : 1;
+	}
+
+	/* Skip over entries that are being, or have been, overwritten. */
+	for (uint64_t seq = at->at_first + n; seq <= at->at_last;
+	    seq++, at->at_first++) {
+		ate = &at->at_ring[(seq - 1) % at->at_size];
+		at->at_ent = *ate;
+		membar_consumer();
+		if (at->at_ent.ate_seq == seq && ate->ate_seq == seq)
+			return (&at->at_ent);
+	}
+
+	return (NULL);
+}
+
+void
+arc_trace_init(void)
+{
+	arc_trace_t *at = &arc_trace;
+	kstat_t *ksp;
+
+	mutex_init(&at->at_lock, NULL, MUTEX_DEFAULT, NULL);
+	if (zfs_arc_trace_entries == 0)
+		return;
+
+	at->at_size = zfs_arc_trace_entries;
+	at->at_ring = vmem_zalloc(at->at_size * sizeof (arc_trace_ent_t),
+	    KM_SLEEP);
+
+	ksp = kstat_create("zfs", 0, "arc_trace", "misc",
+	    KSTAT_TYPE_RAW, 0, KSTAT_FLAG_VIRTUAL);
+	at->at_kstat = ksp;
+
+	if (ksp) {
+		ksp->ks_lock = &at->at_lock;
+		ksp->ks_ndata = UINT32_MAX;
+		ksp->ks_private = at;
+		kstat_set_raw_ops(ksp, arc_trace_headers, arc_trace_data,
+		    arc_trace_addr);
+		kstat_install(ksp);
+	}
+}
+
+void
+arc_trace_fini(void)
+{
+	arc_trace_t *at = &arc_trace;
+
+	if (at->at_kstat != NULL) {
+		kstat_delete(at->at_kstat);
+		at->at_kstat = NULL;
+	}
+	if (at->at_ring != NULL) {
+		vmem_free(at->at_ring, at->at_size * sizeof (arc_trace_ent_t));
+		at->at_ring = NULL;
+	}
+	at->at_size = 0;
+	at->at_seq = 0;
+	mutex_destroy(&at->at_lock);
+}
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, trace_entries, UINT, ZMOD_RD,
+	"Number of entries in the ARC access trace, 0 to disable");
@@ -37,6 +37,8 @@ static dataset_kstat_values_t empty_dataset_kstats = {
 	{ "nread",	KSTAT_DATA_UINT64 },
 	{ "nunlinks",	KSTAT_DATA_UINT64 },
 	{ "nunlinked",	KSTAT_DATA_UINT64 },
+	{ "compress_skipped",	KSTAT_DATA_UINT64 },
+	{ "compress_skipped_bytes",	KSTAT_DATA_UINT64 },
 	{
 	{ "zil_commit_count",			KSTAT_DATA_UINT64 },
 	{ "zil_commit_writer_count",		KSTAT_DATA_UINT64 },
@@ -84,6 +86,11 @@ dataset_kstats_update(kstat_t *ksp, int rw)
 	dkv->dkv_nunlinked.value.ui64 =
 	    wmsum_value(&dk->dk_sums.dss_nunlinked);
 
+	dkv->dkv_compress_skipped.value.ui64 =
+	    wmsum_value(&dk->dk_compress_sums.zcs_skipped);
+	dkv->dkv_compress_skipped_bytes.value.ui64 =
+	    wmsum_value(&dk->dk_compress_sums.zcs_skipped_bytes);
+
 	zil_kstat_values_update(&dkv->dkv_zil_stats, &dk->dk_zil_sums);
 
 	return (0);
@@ -173,9 +180,11 @@ dataset_kstats_create(dataset_kstats_t *dk, objset_t *objset)
 	wmsum_init(&dk->dk_sums.dss_nunlinks, 0);
 	wmsum_init(&dk->dk_sums.dss_nunlinked, 0);
 	zil_sums_init(&dk->dk_zil_sums);
+	zio_compress_sums_init(&dk->dk_compress_sums);
 
 	dk->dk_kstats = kstat;
 	kstat_install(kstat);
+	dataset_kstats_attach(dk, objset);
 	return (0);
 }
 
@@ -199,6 +208,20 @@ dataset_kstats_destroy(dataset_kstats_t *dk)
 	wmsum_fini(&dk->dk_sums.dss_nunlinks);
 	wmsum_fini(&dk->dk_sums.dss_nunlinked);
 	zil_sums_fini(&dk->dk_zil_sums);
+	zio_compress_sums_fini(&dk->dk_compress_sums);
+}
+
+/*
+ * Point the objset, which the owner of these kstats must own, at the
+ * counters that are kept here rather than in the objset, so that they
+ * carry on when the owner reopens the objset (e.g. across a rollback).
+ * dmu_objset_disown() detaches them again.
+ */
+void
+dataset_kstats_attach(dataset_kstats_t *dk, objset_t *os)
+{
+	os->os_compress_sums = dk->dk_kstats != NULL ?
+	    &dk->dk_compress_sums : NULL;
 }
 
 void
@@ -367,6 +367,35 @@ dbuf_find(objset_t *os, uint64_t obj, uint8_t level, uint64_t blkid,
 	return (NULL);
 }
 
+/*
+ * Call func for every dbuf in the hash table which belongs to the given pool
+ * and is not being evicted.  The hash chain lock and db_mtx are held across
+ * the call, so func must neither block nor allocate memory.
+ */
+void
+dbuf_walk(spa_t *spa, dbuf_walk_fn func, void *arg)
+{
+	dbuf_hash_table_t *h = &dbuf_hash_table;
+
+	for (uint64_t idx = 0; idx <= h->hash_table_mask; idx++) {
+		if (h->hash_table[idx] == NULL)
+			continue;
+
+		mutex_enter(DBUF_HASH_MUTEX(h, idx));
+		for (dmu_buf_impl_t *db = h->hash_table[idx]; db != NULL;
+		    db = db->db_hash_next) {
+			if (db->db_objset->os_spa != spa)
+				continue;
+
+			mutex_enter(&db->db_mtx);
+			if (db->db_state != DB_EVICTING)
+				func(db, arg);
+			mutex_exit(&db->db_mtx);
+		}
+		mutex_exit(DBUF_HASH_MUTEX(h, idx));
+	}
+}
+
 static dmu_buf_impl_t *
 dbuf_find_bonus(objset_t *os, uint64_t object)
 {
@@ -1661,9 +1690,9 @@ dbuf_read_impl(dmu_buf_impl_t *db, dnode_t *dn, zio_t *zio, uint32_t flags,
 	 */
 	blkptr_t copy = *bp;
 	dmu_buf_unlock_parent(db, dblt, tag);
-	return (arc_read(zio, db->db_objset->os_spa, &copy,
+	return (arc_read_class(zio, db->db_objset->os_spa, &copy,
 	    dbuf_read_done, db, ZIO_PRIORITY_SYNC_READ, zio_flags,
-	    &aflags, &zb));
+	    &aflags, &zb, db->db_objset->os_arc_class));
 
 early_unlock:
 	mutex_exit(&db->db_mtx);
@@ -3526,6 +3555,7 @@ typedef struct dbuf_prefetch_arg {
 	zio_priority_t dpa_prio; /* The priority I/Os should be issued at. */
 	zio_t *dpa_zio; /* The parent zio_t for all prefetches. */
 	arc_flags_t dpa_aflags; /* Flags to pass to the final prefetch. */
+	uint_t dpa_arc_class; /* ARC class to cache the blocks in. */
 	dbuf_prefetch_fn dpa_cb; /* prefetch completion callback */
 	void *dpa_arg; /* prefetch completion arg */
 } dbuf_prefetch_arg_t;
@@ -3580,9 +3610,10 @@ dbuf_issue_final_prefetch(dbuf_prefetch_arg_t *dpa, blkptr_t *bp)
 	ASSERT3U(dpa->dpa_curlevel, ==, BP_GET_LEVEL(bp));
 	ASSERT3U(dpa->dpa_curlevel, ==, dpa->dpa_zb.zb_level);
 	ASSERT(dpa->dpa_zio != NULL);
-	(void) arc_read(dpa->dpa_zio, dpa->dpa_spa, bp,
+	(void) arc_read_class(dpa->dpa_zio, dpa->dpa_spa, bp,
 	    dbuf_issue_final_prefetch_done, dpa,
-	    dpa->dpa_prio, zio_flags, &aflags, &dpa->dpa_zb);
+	    dpa->dpa_prio, zio_flags, &aflags, &dpa->dpa_zb,
+	    dpa->dpa_arc_class);
 }
 
 /*
@@ -3674,11 +3705,11 @@ dbuf_prefetch_indirect_done(zio_t *zio, const zbookmark_phys_t *zb,
 		SET_BOOKMARK(&zb, dpa->dpa_zb.zb_objset,
 		    dpa->dpa_zb.zb_object, dpa->dpa_curlevel, nextblkid);
 
-		(void) arc_read(dpa->dpa_zio, dpa->dpa_spa,
+		(void) arc_read_class(dpa->dpa_zio, dpa->dpa_spa,
 		    bp, dbuf_prefetch_indirect_done, dpa,
 		    ZIO_PRIORITY_SYNC_READ,
 		    ZIO_FLAG_CANFAIL | ZIO_FLAG_SPECULATIVE,
-		    &iter_aflags, &zb);
+		    &iter_aflags, &zb, dpa->dpa_arc_class);
 	}
 
 	arc_buf_destroy(abuf, private);
@@ -3780,6 +3811,7 @@ dbuf_prefetch_impl(dnode_t *dn, int64_t level, uint64_t blkid,
 	dpa->dpa_prio = prio;
 	dpa->dpa_aflags = aflags;
 	dpa->dpa_spa = dn->dn_objset->os_spa;
+	dpa->dpa_arc_class = dn->dn_objset->os_arc_class;
 	dpa->dpa_dnode = dn;
 	dpa->dpa_epbs = epbs;
 	dpa->dpa_zio = pio;
@@ -3811,11 +3843,11 @@ dbuf_prefetch_impl(dnode_t *dn, int64_t level, uint64_t blkid,
 
 		SET_BOOKMARK(&zb, ds != NULL ? ds->ds_object : DMU_META_OBJSET,
 		    dn->dn_object, curlevel, curblkid);
-		(void) arc_read(dpa->dpa_zio, dpa->dpa_spa,
+		(void) arc_read_class(dpa->dpa_zio, dpa->dpa_spa,
 		    &bp, dbuf_prefetch_indirect_done, dpa,
 		    ZIO_PRIORITY_SYNC_READ,
 		    ZIO_FLAG_CANFAIL | ZIO_FLAG_SPECULATIVE,
-		    &iter_aflags, &zb);
+		    &iter_aflags, &zb, dpa->dpa_arc_class);
 	}
 	/*
 	 * We use pio here instead of dpa_zio since it's possible that
@@ -5377,8 +5409,8 @@ dbuf_write(dbuf_dirty_record_t *dr, arc_buf_t *data, dmu_tx_t *tx)
 
 		dr->dr_zio = arc_write(pio, os->os_spa, txg,
 		    &dr->dr_bp_copy, data, !DBUF_IS_CACHEABLE(db),
-		    dbuf_is_l2cacheable(db, NULL), &zp, dbuf_write_ready,
-		    children_ready_cb, dbuf_write_done, db,
+		    dbuf_is_l2cacheable(db, NULL), os->os_arc_class, &zp,
+		    dbuf_write_ready, children_ready_cb, dbuf_write_done, db,
 		    ZIO_PRIORITY_ASYNC_WRITE, ZIO_FLAG_MUSTSUCCEED, &zb);
 	}
 }
@@ -229,6 +229,13 @@ static kmem_cache_t *ddt_entry_trad_cache;
  */
 int zfs_dedup_prefetch = 0;
 
+/*
+ * When an entry is not in the first store object searched, prefetch it from
+ * all the remaining ones before searching them one by one, so that the reads
+ * for the other classes are issued together instead of back to back.
+ */
+static int zfs_dedup_lookup_prefetch = 1;
+
 /*
  * If the dedup class cannot satisfy a DDT allocation, treat as over quota
  * for this many TXGs.
@@ -310,6 +317,10 @@ typedef struct {
 	kstat_named_t dds_lookup_stored_hit;
 	kstat_named_t dds_lookup_stored_miss;
 
+	/* store objects prefetched together, and time spent searching them */
+	kstat_named_t dds_lookup_stored_prefetch;
+	kstat_named_t dds_lookup_stored_nsec;
+
 	/* number of entries on log trees */
 	kstat_named_t dds_log_active_entries;
 	kstat_named_t dds_log_flushing_entries;
@@ -333,6 +344,8 @@ static const ddt_kstats_t ddt_kstats_template = {
 	{ "lookup_log_miss",		KSTAT_DATA_UINT64 },
 	{ "lookup_stored_hit",		KSTAT_DATA_UINT64 },
 	{ "lookup_stored_miss",		KSTAT_DATA_UINT64 },
+	{ "lookup_stored_prefetch",	KSTAT_DATA_UINT64 },
+	{ "lookup_stored_nsec",		KSTAT_DATA_UINT64 },
 	{ "log_active_entries",		KSTAT_DATA_UINT64 },
 	{ "log_flushing_entries",	KSTAT_DATA_UINT64 },
 	{ "log_ingest_rate",		KSTAT_DATA_UINT32 },
@@ -531,6 +544,27 @@ ddt_object_prefetch(ddt_t *ddt, ddt_type_t type, ddt_class_t class,
 	    ddt->ddt_object[type][class], ddk);
 }
 
+/*
+ * Prefetch a key from every store object searched after the given one, and
+ * count them.
+ */
+static void
+ddt_lookup_prefetch_stored(ddt_t *ddt, ddt_type_t type, ddt_class_t class,
+    const ddt_key_t *ddk)
+{
+	uint64_t nobjs __maybe_unused = 0;
+
+	for (class++; type < DDT_TYPES; type++, class = 0) {
+		for (; class < DDT_CLASSES; class++) {
+			if (!ddt_object_exists(ddt, type, class))
+				continue;
+			ddt_object_prefetch(ddt, type, class, ddk);
+			nobjs++;
+		}
+	}
+	DDT_KSTAT_ADD(ddt, dds_lookup_stored_prefetch, nobjs);
+}
+
 static void
 ddt_object_prefetch_all(ddt_t *ddt, ddt_type_t type, ddt_class_t class)
 {
@@ -1229,20 +1263,37 @@ ddt_lookup(ddt_t *ddt, const blkptr_t *bp)
 	 */
 	ddt_exit(ddt);
 
-	/* Search all store objects for the entry. */
+	hrtime_t lookup_start __maybe_unused = gethrtime();
+
+	/*
+	 * Search all store objects for the entry. Most entries are found in
+	 * the first object, so that one is read on its own; if it misses, get
+	 * the reads for all the remaining objects going before waiting on the
+	 * next one.
+	 */
+	boolean_t prefetched = !zfs_dedup_lookup_prefetch;
 	error = ENOENT;
 	for (type = 0; type < DDT_TYPES; type++) {
 		for (class = 0; class < DDT_CLASSES; class++) {
+			if (!ddt_object_exists(ddt, type, class))
+				continue;
 			error = ddt_object_lookup(ddt, type, class, dde);
 			if (error != ENOENT) {
 				ASSERT0(error);
 				break;
 			}
+			if (!prefetched) {
+				ddt_lookup_prefetch_stored(ddt, type, class,
+				    &search);
+				prefetched = B_TRUE;
+			}
 		}
 		if (error != ENOENT)
 			break;
 	}
 
+	DDT_KSTAT_ADD(ddt, dds_lookup_stored_nsec, gethrtime() - lookup_start);
+
 	ddt_enter(ddt);
 
 	ASSERT(!(dde->dde_flags & DDE_FLAG_LOADED));
@@ -2762,6 +2813,9 @@ ddt_prune_unique_entries(spa_t *spa, zpool_ddt_prune_unit_t unit,
 ZFS_MODULE_PARAM(zfs_dedup, zfs_dedup_, prefetch, INT, ZMOD_RW,
 	"Enable prefetching dedup-ed blks");
 
+ZFS_MODULE_PARAM(zfs_dedup, zfs_dedup_, lookup_prefetch, INT, ZMOD_RW,
+	"Prefetch DDT entries from all store objects before searching them");
+
 ZFS_MODULE_PARAM(zfs_dedup, zfs_dedup_, log_flush_passes_max, UINT, ZMOD_RW,
 	"Max number of incremental dedup log flush passes per transaction");
 
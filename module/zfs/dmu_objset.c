@@ -277,6 +277,18 @@ prefetch_changed_cb(void *arg, uint64_t newval)
 	os->os_prefetch = newval;
 }
 
+static void
+arcclass_changed_cb(void *arg, uint64_t newval)
+{
+	objset_t *os = arg;
+
+	/*
+	 * Inheritance should have been done by now.
+	 */
+	ASSERT3U(newval, <, ARC_CLASS_COUNT);
+	os->os_arc_class = newval;
+}
+
 static void
 sync_changed_cb(void *arg, uint64_t newval)
 {
@@ -581,6 +593,11 @@ dmu_objset_open_impl(spa_t *spa, dsl_dataset_t *ds, blkptr_t *bp,
 			    zfs_prop_to_name(ZFS_PROP_PREFETCH),
 			    prefetch_changed_cb, os);
 		}
+		if (err == 0) {
+			err = dsl_prop_register(ds,
+			    zfs_prop_to_name(ZFS_PROP_ARCCLASS),
+			    arcclass_changed_cb, os);
+		}
 		if (!ds->ds_is_snapshot) {
 			if (err == 0) {
 				err = dsl_prop_register(ds,
@@ -660,6 +677,7 @@ dmu_objset_open_impl(spa_t *spa, dsl_dataset_t *ds, blkptr_t *bp,
 		os->os_secondary_cache = ZFS_CACHE_ALL;
 		os->os_dnodesize = DNODE_MIN_SIZE;
 		os->os_prefetch = ZFS_PREFETCH_ALL;
+		os->os_arc_class = ARC_CLASS_DEFAULT;
 	}
 
 	if (ds == NULL || !ds->ds_is_snapshot)
@@ -941,6 +959,7 @@ dmu_objset_disown(objset_t *os, boolean_t decrypt, const void *tag)
 	 * Stop upgrading thread
 	 */
 	dmu_objset_upgrade_stop(os);
+	os->os_compress_sums = NULL;
 	dsl_dataset_disown(os->os_dsl_dataset, flags, tag);
 }
 
@@ -1785,8 +1804,9 @@ dmu_objset_sync(objset_t *os, zio_t *pio, dmu_tx_t *tx)
 
 	zio = arc_write(pio, os->os_spa, tx->tx_txg,
 	    blkptr_copy, os->os_phys_buf, B_FALSE, dmu_os_is_l2cacheable(os),
-	    &zp, dmu_objset_write_ready, NULL, dmu_objset_write_done,
-	    os, ZIO_PRIORITY_ASYNC_WRITE, ZIO_FLAG_MUSTSUCCEED, &zb);
+	    os->os_arc_class, &zp, dmu_objset_write_ready, NULL,
+	    dmu_objset_write_done, os, ZIO_PRIORITY_ASYNC_WRITE,
+	    ZIO_FLAG_MUSTSUCCEED, &zb);
 
 	/*
 	 * Sync special dnodes - the parent IO for the sync is the root block
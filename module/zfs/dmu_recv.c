@@ -71,6 +71,7 @@
 static uint_t zfs_recv_queue_length = SPA_MAXBLOCKSIZE;
 static uint_t zfs_recv_queue_ff = 20;
 static uint_t zfs_recv_write_batch_size = 1024 * 1024;
+static uint_t zfs_recv_write_threads = 8;
 static int zfs_recv_best_effort_corrective = 0;
 
 static const void *const dmu_recv_tag = "dmu_recv_tag";
@@ -126,6 +127,24 @@ struct receive_writer_arg {
 
 	list_t write_batch;
 
+	/*
+	 * Write lanes.  When nlanes != 0, WRITE and FREE records are applied
+	 * by lanes[object % nlanes], so that the records of one object are
+	 * applied in stream order while different objects are written
+	 * concurrently.  Other records wait for their object's lane, or for
+	 * all of the lanes, before they are processed.
+	 */
+	taskq_t **lanes;
+	uint_t nlanes;
+	kmutex_t lane_lock;
+	kcondvar_t lane_cv;
+	uint64_t lane_bytes;	/* payload bytes queued to the lanes */
+	int lane_err;		/* first error hit by a lane */
+	boolean_t lane_resume;	/* resume object/offset below are pending */
+	uint64_t lane_resume_object;
+	uint64_t lane_resume_offset;
+	uint64_t lane_barrier_bytes; /* bytes_read at the last full barrier */
+
 	/* Encryption parameters for the last received DRR_OBJECT_RANGE */
 	boolean_t or_crypt_params_present;
 	uint64_t or_firstobj;
@@ -1605,14 +1624,11 @@ deduce_nblkptr(dmu_object_type_t bonus_type, uint64_t bonus_size)
 }
 
 static void
-save_resume_state(struct receive_writer_arg *rwa,
+save_resume_state_impl(struct receive_writer_arg *rwa,
     uint64_t object, uint64_t offset, dmu_tx_t *tx)
 {
 	int txgoff = dmu_tx_get_txg(tx) & TXG_MASK;
 
-	if (!rwa->resumable)
-		return;
-
 	/*
 	 * We use ds_resume_bytes[] != 0 to indicate that we need to
 	 * update this on disk, so it must not be 0.
@@ -1641,6 +1657,28 @@ save_resume_state(struct receive_writer_arg *rwa,
 	rwa->os->os_dsl_dataset->ds_resume_bytes[txgoff] = rwa->bytes_read;
 }
 
+static void
+save_resume_state(struct receive_writer_arg *rwa,
+    uint64_t object, uint64_t offset, dmu_tx_t *tx)
+{
+	if (!rwa->resumable)
+		return;
+
+	/*
+	 * The write lanes may still be applying earlier records, so we can
+	 * only remember the position here.  receive_lanes_barrier() saves
+	 * it once everything before it is known to be in the pool.
+	 */
+	if (rwa->nlanes != 0) {
+		rwa->lane_resume = B_TRUE;
+		rwa->lane_resume_object = object;
+		rwa->lane_resume_offset = offset;
+		return;
+	}
+
+	save_resume_state_impl(rwa, object, offset, tx);
+}
+
 static int
 receive_object_is_same_generation(objset_t *os, uint64_t object,
     dmu_object_type_t old_bonus_type, dmu_object_type_t new_bonus_type,
@@ -2202,26 +2240,30 @@ receive_freeobjects(struct receive_writer_arg *rwa,
 }
 
 /*
+ * Write out a batch of WRITE records for the given object.  This is called
+ * either from the receive_writer_thread on rwa->write_batch, or from a
+ * write lane on a batch that was handed off to it.
+ *
  * Note: if this fails, the caller will clean up any records left on the
- * rwa->write_batch list.
+ * batch list.
  */
 static int
-flush_write_batch_impl(struct receive_writer_arg *rwa)
+flush_write_batch_impl(struct receive_writer_arg *rwa, list_t *batch,
+    uint64_t object)
 {
 	dnode_t *dn;
 	int err;
 
-	if (dnode_hold(rwa->os, rwa->last_object, FTAG, &dn) != 0)
+	if (dnode_hold(rwa->os, object, FTAG, &dn) != 0)
 		return (SET_ERROR(EINVAL));
 
-	struct receive_record_arg *last_rrd = list_tail(&rwa->write_batch);
+	struct receive_record_arg *last_rrd = list_tail(batch);
 	struct drr_write *last_drrw = &last_rrd->header.drr_u.drr_write;
 
-	struct receive_record_arg *first_rrd = list_head(&rwa->write_batch);
+	struct receive_record_arg *first_rrd = list_head(batch);
 	struct drr_write *first_drrw = &first_rrd->header.drr_u.drr_write;
 
-	ASSERT3U(rwa->last_object, ==, last_drrw->drr_object);
-	ASSERT3U(rwa->last_offset, ==, last_drrw->drr_offset);
+	ASSERT3U(object, ==, last_drrw->drr_object);
 
 	dmu_tx_t *tx = dmu_tx_create(rwa->os);
 	dmu_tx_hold_write_by_dnode(tx, dn, first_drrw->drr_offset,
@@ -2235,11 +2277,11 @@ flush_write_batch_impl(struct receive_writer_arg *rwa)
 	}
 
 	struct receive_record_arg *rrd;
-	while ((rrd = list_head(&rwa->write_batch)) != NULL) {
+	while ((rrd = list_head(batch)) != NULL) {
 		struct drr_write *drrw = &rrd->header.drr_u.drr_write;
 		abd_t *abd = rrd->abd;
 
-		ASSERT3U(drrw->drr_object, ==, rwa->last_object);
+		ASSERT3U(drrw->drr_object, ==, object);
 
 		if (drrw->drr_logical_size != dn->dn_datablksz) {
 			/*
@@ -2346,10 +2388,15 @@ flush_write_batch_impl(struct receive_writer_arg *rwa)
 		 * start with the same record that we last successfully
 		 * received (as opposed to the next record), so that we can
 		 * verify that we are resuming from the correct location.
+		 * With write lanes the position was already noted when the
+		 * batch was dispatched.
 		 */
-		save_resume_state(rwa, drrw->drr_object, drrw->drr_offset, tx);
+		if (rwa->nlanes == 0) {
+			save_resume_state(rwa, drrw->drr_object,
+			    drrw->drr_offset, tx);
+		}
 
-		list_remove(&rwa->write_batch, rrd);
+		list_remove(batch, rrd);
 		kmem_free(rrd, sizeof (*rrd));
 	}
 
@@ -2358,21 +2405,259 @@ flush_write_batch_impl(struct receive_writer_arg *rwa)
 	return (err);
 }
 
+static void
+free_write_batch(list_t *batch)
+{
+	struct receive_record_arg *rrd;
+	while ((rrd = list_remove_head(batch)) != NULL) {
+		abd_free(rrd->abd);
+		kmem_free(rrd, sizeof (*rrd));
+	}
+}
+
+/*
+ * A unit of work for a write lane: either a batch of WRITE records for one
+ * object, or (if the batch is empty) a FREE of a range of that object.
+ */
+typedef struct receive_lane_work {
+	struct receive_writer_arg *rlw_rwa;
+	list_t rlw_batch;
+	uint64_t rlw_object;
+	uint64_t rlw_offset;
+	uint64_t rlw_length;
+	uint64_t rlw_bytes;
+} receive_lane_work_t;
+
+/*
+ * Don't let more than this many stream bytes go by without a full barrier
+ * on a resumable receive, so that the on-disk resume state keeps up.
+ */
+#define	RECV_LANE_RESUME_BYTES	(64ULL << 20)
+
+static receive_lane_work_t *
+receive_lane_work_alloc(struct receive_writer_arg *rwa, uint64_t object)
+{
+	receive_lane_work_t *rlw = kmem_zalloc(sizeof (*rlw), KM_SLEEP);
+	rlw->rlw_rwa = rwa;
+	rlw->rlw_object = object;
+	list_create(&rlw->rlw_batch, sizeof (struct receive_record_arg),
+	    offsetof(struct receive_record_arg, node.bqn_node));
+	return (rlw);
+}
+
+static void
+receive_lane_work_free(receive_lane_work_t *rlw)
+{
+	free_write_batch(&rlw->rlw_batch);
+	list_destroy(&rlw->rlw_batch);
+	kmem_free(rlw, sizeof (*rlw));
+}
+
+static void
+receive_lane_func(void *arg)
+{
+	receive_lane_work_t *rlw = arg;
+	struct receive_writer_arg *rwa = rlw->rlw_rwa;
+	fstrans_cookie_t cookie = spl_fstrans_mark();
+
+	/*
+	 * Once any lane has failed the receive is going to be torn down,
+	 * so there is no point in applying anything else.  It's ok if we
+	 * miss an update here, we'll just do some extra work.
+	 */
+	int err = rwa->lane_err;
+	if (err == 0) {
+		if (!list_is_empty(&rlw->rlw_batch)) {
+			err = flush_write_batch_impl(rwa, &rlw->rlw_batch,
+			    rlw->rlw_object);
+		} else {
+			err = dmu_free_long_range(rwa->os, rlw->rlw_object,
+			    rlw->rlw_offset, rlw->rlw_length);
+		}
+	}
+
+	mutex_enter(&rwa->lane_lock);
+	if (err != 0 && rwa->lane_err == 0)
+		rwa->lane_err = err;
+	ASSERT3U(rwa->lane_bytes, >=, rlw->rlw_bytes);
+	rwa->lane_bytes -= rlw->rlw_bytes;
+	cv_broadcast(&rwa->lane_cv);
+	mutex_exit(&rwa->lane_lock);
+
+	receive_lane_work_free(rlw);
+	spl_fstrans_unmark(cookie);
+}
+
+static int
+receive_lanes_error(struct receive_writer_arg *rwa)
+{
+	mutex_enter(&rwa->lane_lock);
+	int err = rwa->lane_err;
+	mutex_exit(&rwa->lane_lock);
+	return (err);
+}
+
+/*
+ * Wait for every lane to drain, and then write out the resume state for
+ * the last record that was handed to them.
+ */
+static int
+receive_lanes_barrier(struct receive_writer_arg *rwa)
+{
+	if (rwa->nlanes == 0)
+		return (0);
+
+	for (uint_t i = 0; i < rwa->nlanes; i++)
+		taskq_wait(rwa->lanes[i]);
+	rwa->lane_barrier_bytes = rwa->bytes_read;
+
+	int err = receive_lanes_error(rwa);
+	if (err != 0 || !rwa->lane_resume)
+		return (err);
+
+	dmu_tx_t *tx = dmu_tx_create(rwa->os);
+	err = dmu_tx_assign(tx, TXG_WAIT);
+	if (err != 0) {
+		dmu_tx_abort(tx);
+		return (err);
+	}
+	save_resume_state_impl(rwa, rwa->lane_resume_object,
+	    rwa->lane_resume_offset, tx);
+	dsl_dataset_dirty(rwa->os->os_dsl_dataset, tx);
+	dmu_tx_commit(tx);
+	rwa->lane_resume = B_FALSE;
+	return (0);
+}
+
+/*
+ * Hand a unit of work to its object's lane, blocking while the lanes already
+ * hold a full receive queue's worth of data.
+ */
+static int
+receive_lane_dispatch(struct receive_writer_arg *rwa,
+    receive_lane_work_t *rlw)
+{
+	uint64_t limit = MAX(zfs_recv_queue_length, 2 * zfs_max_recordsize);
+
+	mutex_enter(&rwa->lane_lock);
+	while (rwa->lane_err == 0 && rwa->lane_bytes != 0 &&
+	    rwa->lane_bytes + rlw->rlw_bytes > limit)
+		cv_wait(&rwa->lane_cv, &rwa->lane_lock);
+	int err = rwa->lane_err;
+	if (err == 0)
+		rwa->lane_bytes += rlw->rlw_bytes;
+	mutex_exit(&rwa->lane_lock);
+
+	if (err != 0) {
+		receive_lane_work_free(rlw);
+		return (err);
+	}
+
+	VERIFY3U(taskq_dispatch(rwa->lanes[rlw->rlw_object % rwa->nlanes],
+	    receive_lane_func, rlw, TQ_SLEEP), !=, TASKQID_INVALID);
+
+	if (rwa->resumable &&
+	    rwa->bytes_read - rwa->lane_barrier_bytes >= RECV_LANE_RESUME_BYTES)
+		return (receive_lanes_barrier(rwa));
+	return (0);
+}
+
+/*
+ * Before a non-WRITE record is processed, make sure that whatever it may
+ * depend on has been applied.  Records that only touch one object need to
+ * wait for that object's lane; anything else waits for all of them.
+ */
+static int
+receive_lanes_wait(struct receive_writer_arg *rwa, dmu_replay_record_t *drr)
+{
+	uint64_t object;
+
+	if (rwa->nlanes == 0)
+		return (0);
+
+	switch (drr->drr_type) {
+	case DRR_FREE:
+		/* Applied by the lane itself, see receive_free(). */
+		return (receive_lanes_error(rwa));
+	case DRR_OBJECT:
+		object = drr->drr_u.drr_object.drr_object;
+		break;
+	case DRR_WRITE_EMBEDDED:
+		object = drr->drr_u.drr_write_embedded.drr_object;
+		break;
+	case DRR_SPILL:
+		object = drr->drr_u.drr_spill.drr_object;
+		break;
+	default:
+		return (receive_lanes_barrier(rwa));
+	}
+
+	taskq_wait(rwa->lanes[object % rwa->nlanes]);
+	return (receive_lanes_error(rwa));
+}
+
+static void
+receive_lanes_init(struct receive_writer_arg *rwa)
+{
+	uint_t nlanes = MIN(zfs_recv_write_threads, boot_ncpus);
+
+	/* Corrective receives only rewrite damaged blocks, in place. */
+	if (nlanes <= 1 || rwa->heal)
+		return;
+
+	mutex_init(&rwa->lane_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&rwa->lane_cv, NULL, CV_DEFAULT, NULL);
+	rwa->lanes = kmem_alloc(nlanes * sizeof (taskq_t *), KM_SLEEP);
+	for (uint_t i = 0; i < nlanes; i++) {
+		rwa->lanes[i] = taskq_create("z_recv_write", 1, minclsyspri,
+		    1, INT_MAX, TASKQ_PREPOPULATE);
+	}
+	rwa->nlanes = nlanes;
+}
+
+static void
+receive_lanes_fini(struct receive_writer_arg *rwa)
+{
+	if (rwa->nlanes == 0)
+		return;
+
+	for (uint_t i = 0; i < rwa->nlanes; i++)
+		taskq_destroy(rwa->lanes[i]);
+	kmem_free(rwa->lanes, rwa->nlanes * sizeof (taskq_t *));
+	ASSERT0(rwa->lane_bytes);
+	cv_destroy(&rwa->lane_cv);
+	mutex_destroy(&rwa->lane_lock);
+	rwa->nlanes = 0;
+}
+
 noinline static int
 flush_write_batch(struct receive_writer_arg *rwa)
 {
 	if (list_is_empty(&rwa->write_batch))
 		return (0);
 	int err = rwa->err;
-	if (err == 0)
-		err = flush_write_batch_impl(rwa);
-	if (err != 0) {
-		struct receive_record_arg *rrd;
-		while ((rrd = list_remove_head(&rwa->write_batch)) != NULL) {
-			abd_free(rrd->abd);
-			kmem_free(rrd, sizeof (*rrd));
-		}
+	if (err == 0 && rwa->nlanes != 0) {
+		struct receive_record_arg *last_rrd =
+		    list_tail(&rwa->write_batch);
+		struct drr_write *last_drrw =
+		    &last_rrd->header.drr_u.drr_write;
+		receive_lane_work_t *rlw =
+		    receive_lane_work_alloc(rwa, rwa->last_object);
+
+		for (struct receive_record_arg *rrd =
+		    list_head(&rwa->write_batch); rrd != NULL;
+		    rrd = list_next(&rwa->write_batch, rrd))
+			rlw->rlw_bytes += abd_get_size(rrd->abd);
+		list_move_tail(&rlw->rlw_batch, &rwa->write_batch);
+		save_resume_state(rwa, last_drrw->drr_object,
+		    last_drrw->drr_offset, NULL);
+		return (receive_lane_dispatch(rwa, rlw));
 	}
+	if (err == 0)
+		err = flush_write_batch_impl(rwa, &rwa->write_batch,
+		    rwa->last_object);
+	if (err != 0)
+		free_write_batch(&rwa->write_batch);
 	ASSERT(list_is_empty(&rwa->write_batch));
 	return (err);
 }
@@ -2390,6 +2675,12 @@ receive_process_write_record(struct receive_writer_arg *rwa,
 	    !DMU_OT_IS_VALID(drrw->drr_type))
 		return (SET_ERROR(EINVAL));
 
+	/* Raw streams carry framed zstd blocks as they are stored. */
+	if (drrw->drr_compressiontype == ZIO_COMPRESS_ZSTD_FRAMES &&
+	    !spa_feature_is_enabled(dmu_objset_spa(rwa->os),
+	    SPA_FEATURE_ZSTD_FRAMES))
+		return (SET_ERROR(ENOTSUP));
+
 	if (rwa->heal) {
 		blkptr_t *bp;
 		dmu_buf_t *dbp;
@@ -2631,6 +2922,14 @@ receive_free(struct receive_writer_arg *rwa, struct drr_free *drrf)
 	if (drrf->drr_object > rwa->max_object)
 		rwa->max_object = drrf->drr_object;
 
+	if (rwa->nlanes != 0) {
+		receive_lane_work_t *rlw =
+		    receive_lane_work_alloc(rwa, drrf->drr_object);
+		rlw->rlw_offset = drrf->drr_offset;
+		rlw->rlw_length = drrf->drr_length;
+		return (receive_lane_dispatch(rwa, rlw));
+	}
+
 	err = dmu_free_long_range(rwa->os, drrf->drr_object,
 	    drrf->drr_offset, drrf->drr_length);
 
@@ -3112,6 +3411,8 @@ receive_process_record(struct receive_writer_arg *rwa,
 
 	if (!rwa->heal && rrd->header.drr_type != DRR_WRITE) {
 		err = flush_write_batch(rwa);
+		if (err == 0)
+			err = receive_lanes_wait(rwa, &rrd->header);
 		if (err != 0) {
 			if (rrd->abd != NULL) {
 				abd_free(rrd->abd);
@@ -3261,6 +3562,13 @@ receive_writer_thread(void *arg)
 		int err = flush_write_batch(rwa);
 		if (rwa->err == 0)
 			rwa->err = err;
+		/*
+		 * Always drain the lanes, even on error, since they still
+		 * reference the objset.
+		 */
+		err = receive_lanes_barrier(rwa);
+		if (rwa->err == 0)
+			rwa->err = err;
 	}
 	mutex_enter(&rwa->mutex);
 	rwa->done = B_TRUE;
@@ -3412,6 +3720,7 @@ dmu_recv_stream(dmu_recv_cookie_t *drc, offset_t *voffp)
 	}
 	list_create(&rwa->write_batch, sizeof (struct receive_record_arg),
 	    offsetof(struct receive_record_arg, node.bqn_node));
+	receive_lanes_init(rwa);
 
 	(void) thread_create(NULL, 0, receive_writer_thread, rwa, 0, curproc,
 	    TS_RUN, minclsyspri);
@@ -3499,6 +3808,7 @@ dmu_recv_stream(dmu_recv_cookie_t *drc, offset_t *voffp)
 	mutex_destroy(&rwa->mutex);
 	bqueue_destroy(&rwa->q);
 	list_destroy(&rwa->write_batch);
+	receive_lanes_fini(rwa);
 	if (err == 0)
 		err = rwa->err;
 
@@ -3846,5 +4156,8 @@ ZFS_MODULE_PARAM(zfs_recv, zfs_recv_, queue_ff, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_recv, zfs_recv_, write_batch_size, UINT, ZMOD_RW,
 	"Maximum amount of writes to batch into one transaction");
 
+ZFS_MODULE_PARAM(zfs_recv, zfs_recv_, write_threads, UINT, ZMOD_RW,
+	"Number of threads applying write and free records in parallel");
+
 ZFS_MODULE_PARAM(zfs_recv, zfs_recv_, best_effort_corrective, INT, ZMOD_RW,
 	"Ignore errors during corrective receive");
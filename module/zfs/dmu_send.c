@@ -94,6 +94,15 @@ static uint_t zfs_send_no_prefetch_queue_length = 1024 * 1024;
 static uint_t zfs_send_queue_ff = 20;
 static uint_t zfs_send_no_prefetch_queue_ff = 20;
 
+/*
+ * This tunable controls the amount of stream data (measured in bytes) that the
+ * main send thread may queue up for the writer thread, which writes it to the
+ * output while the main thread moves on to the next records.  Data blocks are
+ * queued without copying, so this also bounds the ARC buffers held by the
+ * writer.  Set to 0 to write the stream from the main thread.
+ */
+static uint_t zfs_send_writer_queue_length = SPA_MAXBLOCKSIZE;
+
 /*
  * Use this to override the recordsize calculation for fast zfs send estimates.
  */
@@ -205,9 +214,44 @@ typedef enum {
 	PENDING_REDACT
 } dmu_pendop_t;
 
+/*
+ * Stream records queued for the writer thread.  A record carries a copy of
+ * the replay record and its payload, which is either a private copy or
+ * points into the data of a send_range.  Such ranges are released through
+ * the queue too, after the records that use them.
+ */
+typedef enum {
+	SEND_WRITE_RECORD,
+	SEND_WRITE_RELEASE,
+	SEND_WRITE_EOS
+} send_write_type_t;
+
+struct send_write_rec {
+	bqueue_node_t		swr_ln;
+	send_write_type_t	swr_type;
+	dmu_replay_record_t	swr_drr;
+	void			*swr_payload;
+	int			swr_payload_len;
+	boolean_t		swr_payload_copied;
+	struct send_range	*swr_range;
+};
+
+struct send_writer_thread_arg {
+	bqueue_t		q;
+	objset_t		*os;
+	dmu_send_outparams_t	*dso;
+	kmutex_t		lock;
+	kcondvar_t		cv;
+	boolean_t		done;
+	int			error;
+};
+
 typedef struct dmu_send_cookie {
 	dmu_replay_record_t *dsc_drr;
 	dmu_send_outparams_t *dsc_dso;
+	struct send_writer_thread_arg *dsc_writer;
+	boolean_t dsc_payload_in_range;
+	boolean_t dsc_range_held;
 	offset_t *dsc_off;
 	objset_t *dsc_os;
 	zio_cksum_t dsc_zc;
@@ -225,6 +269,8 @@ typedef struct dmu_send_cookie {
 } dmu_send_cookie_t;
 
 static int do_dump(dmu_send_cookie_t *dscp, struct send_range *range);
+static int send_writer_enqueue(dmu_send_cookie_t *dscp, void *payload,
+    int payload_len);
 
 static void
 range_free(struct send_range *range)
@@ -281,6 +327,17 @@ dump_record(dmu_send_cookie_t *dscp, void *payload, int payload_len)
 	    drr_u.drr_checksum.drr_checksum,
 	    sizeof (zio_cksum_t), &dscp->dsc_zc);
 	*dscp->dsc_off += sizeof (dmu_replay_record_t);
+	if (dscp->dsc_writer != NULL) {
+		if (payload_len != 0) {
+			*dscp->dsc_off += payload_len;
+			(void) fletcher_4_incremental_native(
+			    payload, payload_len, &dscp->dsc_zc);
+			ASSERT((payload_len % 8 == 0) ||
+			    (dscp->dsc_featureflags &
+			    DMU_BACKUP_FEATURE_RAW));
+		}
+		return (send_writer_enqueue(dscp, payload, payload_len));
+	}
 	dscp->dsc_err = dso->dso_outfunc(dscp->dsc_os, dscp->dsc_drr,
 	    sizeof (dmu_replay_record_t), dso->dso_arg);
 	if (dscp->dsc_err != 0)
@@ -859,6 +916,13 @@ send_do_embed(const blkptr_t *bp, uint64_t featureflags)
 	    !(featureflags & DMU_BACKUP_FEATURE_ZSTD)))
 		return (B_FALSE);
 
+	/*
+	 * There is no stream feature for framed zstd blocks, so they are
+	 * never sent embedded.
+	 */
+	if (BP_GET_COMPRESS(bp) == ZIO_COMPRESS_ZSTD_FRAMES)
+		return (B_FALSE);
+
 	/*
 	 * Embed type must be explicitly enabled.
 	 */
@@ -974,6 +1038,12 @@ do_dump(dmu_send_cookie_t *dscp, struct send_range *range)
 
 		uint64_t offset = range->start_blkid * srdp->datablksz;
 
+		/*
+		 * The data stays with the range, so the writer thread can
+		 * write it directly from the arc buf.
+		 */
+		dscp->dsc_payload_in_range = B_TRUE;
+
 		/*
 		 * If we have large blocks stored on disk but the send flags
 		 * don't allow us to send large blocks, we split the data from
@@ -1004,6 +1074,7 @@ do_dump(dmu_send_cookie_t *dscp, struct send_range *range)
 			    srdp->datablksz, srdp->datasz, bp,
 			    srdp->io_compressed, data);
 		}
+		dscp->dsc_payload_in_range = B_FALSE;
 		return (err);
 	}
 	case HOLE: {
@@ -1611,11 +1682,14 @@ issue_data_read(struct send_reader_thread_arg *srta, struct send_range *range)
 	 *  - this isn't an embedded block
 	 *  - this isn't metadata (if receiving on a different endian
 	 *    system it can be byteswapped more easily)
+	 *  - this isn't a framed zstd block, which the receiver may not
+	 *    support; it recompresses the data by its own settings instead
 	 */
 	boolean_t request_compressed =
 	    (srta->featureflags & DMU_BACKUP_FEATURE_COMPRESSED) &&
 	    !split_large_blocks && !BP_SHOULD_BYTESWAP(bp) &&
-	    !BP_IS_EMBEDDED(bp) && !DMU_OT_IS_METADATA(BP_GET_TYPE(bp));
+	    !BP_IS_EMBEDDED(bp) && !DMU_OT_IS_METADATA(BP_GET_TYPE(bp)) &&
+	    BP_GET_COMPRESS(bp) != ZIO_COMPRESS_ZSTD_FRAMES;
 
 	zio_flag_t zioflags = ZIO_FLAG_CANFAIL;
 
@@ -2155,6 +2229,151 @@ setup_merge_thread(struct send_merge_thread_arg *smt_arg,
 	    TS_RUN, minclsyspri);
 }
 
+static __attribute__((noreturn)) void
+send_writer_thread(void *arg)
+{
+	struct send_writer_thread_arg *swta = arg;
+	dmu_send_outparams_t *dso = swta->dso;
+	fstrans_cookie_t cookie = spl_fstrans_mark();
+	struct send_write_rec *swr;
+	int err = 0;
+
+	while ((swr = bqueue_dequeue(&swta->q))->swr_type != SEND_WRITE_EOS) {
+		if (swr->swr_type == SEND_WRITE_RELEASE) {
+			range_free(swr->swr_range);
+		} else if (err == 0) {
+			err = dso->dso_outfunc(swta->os, &swr->swr_drr,
+			    sizeof (dmu_replay_record_t), dso->dso_arg);
+			if (err == 0 && swr->swr_payload_len != 0) {
+				err = dso->dso_outfunc(swta->os,
+				    swr->swr_payload, swr->swr_payload_len,
+				    dso->dso_arg);
+			}
+			/*
+			 * Once we have failed, keep draining the queue so the
+			 * main thread doesn't block, but don't write anything.
+			 */
+			if (err != 0)
+				swta->error = err;
+		}
+		if (swr->swr_payload_copied)
+			kmem_free(swr->swr_payload, swr->swr_payload_len);
+		kmem_free(swr, sizeof (*swr));
+	}
+	kmem_free(swr, sizeof (*swr));
+
+	mutex_enter(&swta->lock);
+	swta->done = B_TRUE;
+	cv_broadcast(&swta->cv);
+	mutex_exit(&swta->lock);
+
+	spl_fstrans_unmark(cookie);
+	thread_exit();
+}
+
+/*
+ * Queue the current record for the writer thread.  The checksum and stream
+ * offset have already been updated by dump_record().
+ */
+static int
+send_writer_enqueue(dmu_send_cookie_t *dscp, void *payload, int payload_len)
+{
+	struct send_writer_thread_arg *swta = dscp->dsc_writer;
+
+	if (swta->error != 0) {
+		dscp->dsc_err = swta->error;
+		return (SET_ERROR(EINTR));
+	}
+
+	struct send_write_rec *swr = kmem_zalloc(sizeof (*swr), KM_SLEEP);
+	swr->swr_type = SEND_WRITE_RECORD;
+	swr->swr_drr = *dscp->dsc_drr;
+	swr->swr_payload_len = payload_len;
+	if (payload_len != 0) {
+		ASSERT3P(payload, !=, NULL);
+		if (dscp->dsc_payload_in_range) {
+			swr->swr_payload = payload;
+			dscp->dsc_range_held = B_TRUE;
+		} else {
+			swr->swr_payload = kmem_alloc(payload_len, KM_SLEEP);
+			memcpy(swr->swr_payload, payload, payload_len);
+			swr->swr_payload_copied = B_TRUE;
+		}
+	}
+	bqueue_enqueue(&swta->q, swr, sizeof (*swr) + payload_len);
+	return (0);
+}
+
+/*
+ * We are done with a range in the main thread.  If the writer thread still
+ * has to write data out of it, pass it along to be freed after that.
+ */
+static void
+send_writer_release(dmu_send_cookie_t *dscp, struct send_range *range)
+{
+	if (!dscp->dsc_range_held) {
+		range_free(range);
+		return;
+	}
+
+	struct send_write_rec *swr = kmem_zalloc(sizeof (*swr), KM_SLEEP);
+	swr->swr_type = SEND_WRITE_RELEASE;
+	swr->swr_range = range;
+	bqueue_enqueue(&dscp->dsc_writer->q, swr, sizeof (*swr));
+	dscp->dsc_range_held = B_FALSE;
+}
+
+static void
+setup_writer_thread(dmu_send_cookie_t *dscp, struct dmu_send_params *dspp)
+{
+	if (dspp->dso->dso_dryrun || zfs_send_writer_queue_length == 0)
+		return;
+
+	struct send_writer_thread_arg *swta = kmem_zalloc(sizeof (*swta),
+	    KM_SLEEP);
+	VERIFY0(bqueue_init(&swta->q, zfs_send_queue_ff,
+	    MAX(zfs_send_writer_queue_length, 2 * zfs_max_recordsize),
+	    offsetof(struct send_write_rec, swr_ln)));
+	mutex_init(&swta->lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&swta->cv, NULL, CV_DEFAULT, NULL);
+	swta->os = dscp->dsc_os;
+	swta->dso = dspp->dso;
+	dscp->dsc_writer = swta;
+	(void) thread_create(NULL, 0, send_writer_thread, swta, 0,
+	    curproc, TS_RUN, minclsyspri);
+}
+
+/*
+ * Wait for the writer thread to write out everything queued and return
+ * the first error it hit.  Later records are written by the main thread.
+ */
+static int
+send_writer_fini(dmu_send_cookie_t *dscp)
+{
+	struct send_writer_thread_arg *swta = dscp->dsc_writer;
+
+	if (swta == NULL)
+		return (0);
+
+	ASSERT(!dscp->dsc_range_held);
+	struct send_write_rec *swr = kmem_zalloc(sizeof (*swr), KM_SLEEP);
+	swr->swr_type = SEND_WRITE_EOS;
+	bqueue_enqueue_flush(&swta->q, swr, sizeof (*swr));
+
+	mutex_enter(&swta->lock);
+	while (!swta->done)
+		cv_wait(&swta->cv, &swta->lock);
+	mutex_exit(&swta->lock);
+
+	int err = swta->error;
+	bqueue_destroy(&swta->q);
+	cv_destroy(&swta->cv);
+	mutex_destroy(&swta->lock);
+	kmem_free(swta, sizeof (*swta));
+	dscp->dsc_writer = NULL;
+	return (err);
+}
+
 static void
 setup_reader_thread(struct send_reader_thread_arg *srt_arg,
     struct dmu_send_params *dspp, struct send_merge_thread_arg *smt_arg,
@@ -2564,15 +2783,23 @@ dmu_send_impl(struct dmu_send_params *dspp)
 	setup_redact_list_thread(rlt_arg, dspp, redact_rl, dssp);
 	setup_merge_thread(smt_arg, dspp, from_arg, to_arg, rlt_arg, os);
 	setup_reader_thread(srt_arg, dspp, smt_arg, featureflags);
+	setup_writer_thread(&dsc, dspp);
 
 	range = bqueue_dequeue(&srt_arg->q);
 	while (err == 0 && !range->eos_marker) {
 		err = do_dump(&dsc, range);
-		range = get_next_range(&srt_arg->q, range);
+		struct send_range *next =
+		    get_next_range_nofree(&srt_arg->q, range);
+		send_writer_release(&dsc, range);
+		range = next;
 		if (issig())
 			err = SET_ERROR(EINTR);
 	}
 
+	int werr = send_writer_fini(&dsc);
+	if (err == 0 && werr != 0)
+		err = werr;
+
 	/*
 	 * If we hit an error or are interrupted, cancel our worker threads and
 	 * clear the queue of any pending records.  The threads will pass the
@@ -3135,5 +3362,8 @@ ZFS_MODULE_PARAM(zfs_send, zfs_send_, queue_ff, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_send, zfs_send_, no_prefetch_queue_ff, UINT, ZMOD_RW,
 	"Send queue fill fraction for non-prefetch queues");
 
+ZFS_MODULE_PARAM(zfs_send, zfs_send_, writer_queue_length, UINT, ZMOD_RW,
+	"Maximum send stream data queued for the writer thread");
+
 ZFS_MODULE_PARAM(zfs_send, zfs_, override_estimate_recordsize, UINT, ZMOD_RW,
 	"Override block size estimate with fixed size");
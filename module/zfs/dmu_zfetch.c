@@ -69,6 +69,13 @@ unsigned int	zfetch_max_idistance = 128 * 1024 * 1024;
 unsigned int	zfetch_max_reorder = 16 * 1024 * 1024;
 /* Max log2 fraction of holes in a stream */
 unsigned int	zfetch_hole_shift = 2;
+/* max bytes between accesses of a strided pattern, 0 disables (64MB) */
+static unsigned int	zfetch_max_stride = 64 * 1024 * 1024;
+/* strided pattern confirmations required before prefetching */
+static unsigned int	zfetch_min_confidence = 2;
+
+/* Confidence scores saturate here, bounding the prefetch depth growth. */
+#define	ZPATTERN_CONF_MAX	16
 
 typedef struct zfetch_stats {
 	kstat_named_t zfetchstat_hits;
@@ -79,6 +86,10 @@ typedef struct zfetch_stats {
 	kstat_named_t zfetchstat_max_streams;
 	kstat_named_t zfetchstat_io_issued;
 	kstat_named_t zfetchstat_io_active;
+	kstat_named_t zfetchstat_strided_hits;
+	kstat_named_t zfetchstat_strided_misses;
+	kstat_named_t zfetchstat_reverse_hits;
+	kstat_named_t zfetchstat_reverse_misses;
 } zfetch_stats_t;
 
 static zfetch_stats_t zfetch_stats = {
@@ -90,6 +101,10 @@ static zfetch_stats_t zfetch_stats = {
 	{ "max_streams",		KSTAT_DATA_UINT64 },
 	{ "io_issued",			KSTAT_DATA_UINT64 },
 	{ "io_active",			KSTAT_DATA_UINT64 },
+	{ "strided_hits",		KSTAT_DATA_UINT64 },
+	{ "strided_misses",		KSTAT_DATA_UINT64 },
+	{ "reverse_hits",		KSTAT_DATA_UINT64 },
+	{ "reverse_misses",		KSTAT_DATA_UINT64 },
 };
 
 struct {
@@ -101,6 +116,10 @@ struct {
 	wmsum_t zfetchstat_max_streams;
 	wmsum_t zfetchstat_io_issued;
 	aggsum_t zfetchstat_io_active;
+	wmsum_t zfetchstat_strided_hits;
+	wmsum_t zfetchstat_strided_misses;
+	wmsum_t zfetchstat_reverse_hits;
+	wmsum_t zfetchstat_reverse_misses;
 } zfetch_sums;
 
 #define	ZFETCHSTAT_BUMP(stat)					\
@@ -134,6 +153,14 @@ zfetch_kstats_update(kstat_t *ksp, int rw)
 	    wmsum_value(&zfetch_sums.zfetchstat_io_issued);
 	zs->zfetchstat_io_active.value.ui64 =
 	    aggsum_value(&zfetch_sums.zfetchstat_io_active);
+	zs->zfetchstat_strided_hits.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_strided_hits);
+	zs->zfetchstat_strided_misses.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_strided_misses);
+	zs->zfetchstat_reverse_hits.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_reverse_hits);
+	zs->zfetchstat_reverse_misses.value.ui64 =
+	    wmsum_value(&zfetch_sums.zfetchstat_reverse_misses);
 	return (0);
 }
 
@@ -148,6 +175,10 @@ zfetch_init(void)
 	wmsum_init(&zfetch_sums.zfetchstat_max_streams, 0);
 	wmsum_init(&zfetch_sums.zfetchstat_io_issued, 0);
 	aggsum_init(&zfetch_sums.zfetchstat_io_active, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_strided_hits, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_strided_misses, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_reverse_hits, 0);
+	wmsum_init(&zfetch_sums.zfetchstat_reverse_misses, 0);
 
 	zfetch_ksp = kstat_create("zfs", 0, "zfetchstats", "misc",
 	    KSTAT_TYPE_NAMED, sizeof (zfetch_stats) / sizeof (kstat_named_t),
@@ -177,6 +208,10 @@ zfetch_fini(void)
 	wmsum_fini(&zfetch_sums.zfetchstat_io_issued);
 	ASSERT0(aggsum_value(&zfetch_sums.zfetchstat_io_active));
 	aggsum_fini(&zfetch_sums.zfetchstat_io_active);
+	wmsum_fini(&zfetch_sums.zfetchstat_strided_hits);
+	wmsum_fini(&zfetch_sums.zfetchstat_strided_misses);
+	wmsum_fini(&zfetch_sums.zfetchstat_reverse_hits);
+	wmsum_fini(&zfetch_sums.zfetchstat_reverse_misses);
 }
 
 /*
@@ -191,6 +226,7 @@ dmu_zfetch_init(zfetch_t *zf, dnode_t *dno)
 		return;
 	zf->zf_dnode = dno;
 	zf->zf_numstreams = 0;
+	zf->zf_patterns = NULL;
 
 	list_create(&zf->zf_stream, sizeof (zstream_t),
 	    offsetof(zstream_t, zs_node));
@@ -230,6 +266,17 @@ dmu_zfetch_fini(zfetch_t *zf)
 	mutex_enter(&zf->zf_lock);
 	while ((zs = list_head(&zf->zf_stream)) != NULL)
 		dmu_zfetch_stream_remove(zf, zs);
+	if (zf->zf_patterns != NULL) {
+		for (int i = 0; i < ZFETCH_PATTERNS; i++) {
+			zs = zf->zf_patterns[i].zp_stream;
+			if (zs != NULL &&
+			    zfs_refcount_remove(&zs->zs_refs, NULL) == 0)
+				dmu_zfetch_stream_fini(zs);
+		}
+		kmem_free(zf->zf_patterns,
+		    ZFETCH_PATTERNS * sizeof (zpattern_t));
+		zf->zf_patterns = NULL;
+	}
 	mutex_exit(&zf->zf_lock);
 	list_destroy(&zf->zf_stream);
 	mutex_destroy(&zf->zf_lock);
@@ -453,6 +500,197 @@ dmu_zfetch_future(zstream_t *zs, uint64_t blkid, uint64_t nblks)
 	return (0);
 }
 
+/*
+ * Feed an access that is not part of any sequential stream to the strided
+ * pattern trackers.  Each tracker learns the signed distance between two
+ * consecutive accesses near each other and gains confidence every time the
+ * next access lands exactly one stride further; a negative stride covers
+ * reverse-sequential scans.  Once a pattern is confirmed at least
+ * zfetch_min_confidence times, return the number of further strides to
+ * prefetch, with the first blkid in *startp and the stride in *stridep.
+ * The depth doubles with each confirmation up to zfetch_max_distance, and
+ * strides already prefetched on earlier hits are skipped.
+ */
+static uint64_t
+dmu_zfetch_pattern(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
+    uint64_t maxblkid, uint64_t *startp, int64_t *stridep, zstream_t **zsp)
+{
+	unsigned int dbs = zf->zf_dnode->dn_datablkshift;
+	uint64_t max_stride = zfetch_max_stride >> dbs;
+	uint_t now = gethrestime_sec();
+	zpattern_t *zp, *zp_train = NULL, *zp_old = NULL;
+	uint64_t dist, best = UINT64_MAX;
+	int i;
+
+	ASSERT(MUTEX_HELD(&zf->zf_lock));
+
+	if (max_stride == 0 || nblks == 0)
+		return (0);
+	if (zf->zf_patterns == NULL) {
+		zf->zf_patterns = kmem_zalloc(ZFETCH_PATTERNS *
+		    sizeof (zpattern_t), KM_SLEEP);
+	}
+
+	for (i = 0; i < ZFETCH_PATTERNS; i++) {
+		zp = &zf->zf_patterns[i];
+		if (zp->zp_stride != 0 && blkid == zp->zp_last + zp->zp_stride)
+			goto match;
+	}
+
+	/*
+	 * No prediction matched.  Confident patterns this access lands near
+	 * lose some confidence, but keep their position in case it was just
+	 * an interleaved unrelated access.  Learn a new stride in the closest
+	 * unconfident tracker, or restart the least recently used one.
+	 */
+	for (i = 0; i < ZFETCH_PATTERNS; i++) {
+		zp = &zf->zf_patterns[i];
+		dist = (blkid > zp->zp_last) ? blkid - zp->zp_last :
+		    zp->zp_last - blkid;
+		if (zp->zp_atime != 0 && dist <= max_stride) {
+			if (zp->zp_conf > 0) {
+				if (zp->zp_conf >= zfetch_min_confidence) {
+					if (zp->zp_stride < 0) {
+						ZFETCHSTAT_BUMP(
+						    zfetchstat_reverse_misses);
+					} else {
+						ZFETCHSTAT_BUMP(
+						    zfetchstat_strided_misses);
+					}
+				}
+				zp->zp_conf--;
+				continue;
+			}
+			if (dist < best) {
+				best = dist;
+				zp_train = zp;
+			}
+		}
+		if (zp_old == NULL ||
+		    (int)(zp_old->zp_atime - zp->zp_atime) > 0)
+			zp_old = zp;
+	}
+	if (zp_train != NULL) {
+		int64_t stride = (int64_t)(blkid - zp_train->zp_last);
+
+		/* Forward sequential accesses are left to the streams. */
+		zp = zp_train;
+		zp->zp_stride = (stride < 0 || (uint64_t)stride > nblks) ?
+		    stride : 0;
+	} else {
+		zp = zp_old;
+		zp->zp_stride = 0;
+	}
+	zp->zp_last = blkid;
+	zp->zp_pf_next = blkid;
+	zp->zp_atime = now;
+	zp->zp_conf = 0;
+	return (0);
+
+match:
+	zp->zp_last = blkid;
+	zp->zp_atime = now;
+	if (zp->zp_conf < ZPATTERN_CONF_MAX)
+		zp->zp_conf++;
+	if (zp->zp_conf < zfetch_min_confidence)
+		return (0);
+	if (zp->zp_stride < 0)
+		ZFETCHSTAT_BUMP(zfetchstat_reverse_hits);
+	else
+		ZFETCHSTAT_BUMP(zfetchstat_strided_hits);
+
+	/*
+	 * Like the streams, don't prefetch more than the next stride if we
+	 * have more than ~6% of ARC held by active prefetches.
+	 */
+	int64_t stride = zp->zp_stride;
+	uint64_t nbytes = nblks << dbs;
+	uint64_t depth = 1;
+	if (aggsum_compare(&zfetch_sums.zfetchstat_io_active,
+	    arc_c_max >> (4 + dbs)) < 0) {
+		depth = MAX(MIN(nbytes << zp->zp_conf,
+		    zfetch_max_distance) / nbytes, 1);
+	}
+	uint64_t start = blkid + stride;
+	int64_t done = (int64_t)(zp->zp_pf_next - start) / stride;
+	if (done > 0) {
+		if ((uint64_t)done >= depth)
+			return (0);
+		start += done * stride;
+		depth -= done;
+	}
+
+	/* Do not run off either end of the file. */
+	if (stride > 0) {
+		if (start > maxblkid)
+			return (0);
+		depth = MIN(depth, (maxblkid - start) / (uint64_t)stride + 1);
+	} else {
+		if (blkid < (uint64_t)-stride || start > maxblkid)
+			return (0);
+		depth = MIN(depth, start / (uint64_t)-stride + 1);
+	}
+	zp->zp_pf_next = start + depth * stride;
+
+	/*
+	 * The prefetches are issued on behalf of a stream of the tracker's
+	 * own, which is never on zf_stream, so that they are accounted and
+	 * completed by dmu_zfetch_done() like the sequential ones.  It has
+	 * one reference for the tracker and one for dmu_zfetch_pattern_run().
+	 */
+	zstream_t *zs = zp->zp_stream;
+	if (zs == NULL) {
+		zs = zp->zp_stream = kmem_zalloc(sizeof (*zs), KM_SLEEP);
+		zfs_refcount_create(&zs->zs_callers);
+		zfs_refcount_create(&zs->zs_refs);
+		zfs_refcount_add(&zs->zs_refs, NULL);
+	}
+	zfs_refcount_add(&zs->zs_refs, NULL);
+
+	*startp = start;
+	*stridep = stride;
+	*zsp = zs;
+	return (depth);
+}
+
+/*
+ * Issue the prefetch planned by dmu_zfetch_pattern(): nblks data blocks at
+ * each of depth positions stride blocks apart, for the stream zs.  Consumes
+ * the stream reference taken by dmu_zfetch_pattern().  Returns the I/O
+ * count.
+ */
+static int
+dmu_zfetch_pattern_run(zfetch_t *zf, zstream_t *zs, uint64_t start,
+    int64_t stride, uint64_t depth, uint64_t nblks, uint64_t maxblkid)
+{
+	int64_t planned = 0;
+	int issued = 0;
+
+	for (uint64_t k = 0; k < depth; k++) {
+		uint64_t blk = start + k * stride;
+		if (blk <= maxblkid)
+			planned += MIN(nblks, maxblkid - blk + 1);
+	}
+	if (planned > 1) {
+		/* More references on top of taken in dmu_zfetch_pattern(). */
+		zfs_refcount_add_few(&zs->zs_refs, planned - 1, NULL);
+	} else if (planned == 0) {
+		if (zfs_refcount_remove(&zs->zs_refs, NULL) == 0)
+			dmu_zfetch_stream_fini(zs);
+		return (0);
+	}
+	aggsum_add(&zfetch_sums.zfetchstat_io_active, planned);
+
+	for (uint64_t k = 0; k < depth; k++) {
+		uint64_t blk = start + k * stride;
+		for (uint64_t b = 0; b < nblks && blk + b <= maxblkid; b++) {
+			issued += dbuf_prefetch_impl(zf->zf_dnode, 0, blk + b,
+			    ZIO_PRIORITY_ASYNC_READ, 0, dmu_zfetch_done, zs);
+		}
+	}
+	return (issued);
+}
+
 /*
  * This is the predictive prefetch entry point.  dmu_zfetch_prepare()
  * associates dnode access specified with blkid and nblks arguments with
@@ -473,6 +711,10 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	spa_t *spa = zf->zf_dnode->dn_objset->os_spa;
 	zfs_prefetch_type_t os_prefetch = zf->zf_dnode->dn_objset->os_prefetch;
 	int64_t ipf_start, ipf_end;
+	uint64_t pat_nblks = nblks, pat_start = 0, pat_depth = 0;
+	int64_t pat_stride = 0;
+	zstream_t *pat_zs = NULL;
+	boolean_t pat_track = B_FALSE;
 
 	if (zfs_prefetch_disable || os_prefetch == ZFS_PREFETCH_NONE)
 		return (NULL);
@@ -550,10 +792,12 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 					goto future;
 				}
 				nblks = dmu_zfetch_future(zs, blkid, nblks);
-				if (nblks > 0)
+				if (nblks > 0) {
 					ZFETCHSTAT_BUMP(zfetchstat_stride);
-				else
+				} else {
 					ZFETCHSTAT_BUMP(zfetchstat_future);
+					pat_track = B_TRUE;
+				}
 				goto future;
 			}
 		} else if (end_blkid >= zs->zs_blkid) {
@@ -564,6 +808,7 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 		    (int)(zs->zs_atime - t) >= 0) {
 			ZFETCHSTAT_BUMP(zfetchstat_past);
 			zs->zs_atime = gethrestime_sec();
+			pat_track = fetch_data;
 			goto out;
 		}
 	}
@@ -575,6 +820,10 @@ dmu_zfetch_prepare(zfetch_t *zf, uint64_t blkid, uint64_t nblks,
 	ASSERT0P(zs);
 	if (end_blkid < maxblkid)
 		dmu_zfetch_stream_create(zf, end_blkid);
+	if (fetch_data) {
+		pat_depth = dmu_zfetch_pattern(zf, blkid, nblks, maxblkid,
+		    &pat_start, &pat_stride, &pat_zs);
+	}
 	mutex_exit(&zf->zf_lock);
 	ZFETCHSTAT_BUMP(zfetchstat_misses);
 	ipf_start = 0;
@@ -596,7 +845,18 @@ future:
 	if (end_blkid >= maxblkid) {
 		dmu_zfetch_stream_remove(zf, zs);
 out:
+		if (pat_track) {
+			pat_depth = dmu_zfetch_pattern(zf, blkid, pat_nblks,
+			    maxblkid, &pat_start, &pat_stride, &pat_zs);
+		}
 		mutex_exit(&zf->zf_lock);
+		if (pat_depth > 0) {
+			int issued = dmu_zfetch_pattern_run(zf, pat_zs,
+			    pat_start, pat_stride, pat_depth, pat_nblks,
+			    maxblkid);
+			if (issued)
+				ZFETCHSTAT_ADD(zfetchstat_io_issued, issued);
+		}
 		if (!have_lock)
 			rw_exit(&zf->zf_dnode->dn_struct_rwlock);
 		return (NULL);
@@ -679,6 +939,10 @@ prescient:
 		issued += dbuf_prefetch(zf->zf_dnode, 1, iblk,
 		    ZIO_PRIORITY_SYNC_READ, ARC_FLAG_PRESCIENT_PREFETCH);
 	}
+	if (pat_depth > 0) {
+		issued += dmu_zfetch_pattern_run(zf, pat_zs, pat_start,
+		    pat_stride, pat_depth, nblks, maxblkid);
+	}
 
 	if (!have_lock)
 		rw_exit(&zf->zf_dnode->dn_struct_rwlock);
@@ -795,3 +1059,9 @@ ZFS_MODULE_PARAM(zfs_prefetch, zfetch_, max_reorder, UINT, ZMOD_RW,
 
 ZFS_MODULE_PARAM(zfs_prefetch, zfetch_, hole_shift, UINT, ZMOD_RW,
 	"Max log2 fraction of holes in a stream");
+
+ZFS_MODULE_PARAM(zfs_prefetch, zfetch_, max_stride, UINT, ZMOD_RW,
+	"Max bytes between accesses of a strided or reverse pattern");
+
+ZFS_MODULE_PARAM(zfs_prefetch, zfetch_, min_confidence, UINT, ZMOD_RW,
+	"Strided pattern confirmations required before prefetching");
@@ -2869,6 +2869,40 @@ dsl_dataset_stats(dsl_dataset_t *ds, nvlist_t *nv)
 	}
 }
 
+/*
+ * Fill in a zfs_space_stats_t with the values that dsl_dataset_stats() adds
+ * to the nvlist of properties for the space usage and identity of ds.
+ */
+void
+dsl_dataset_space_stats(dsl_dataset_t *ds, zfs_space_stats_t *zss)
+{
+	dsl_pool_t *dp __maybe_unused = ds->ds_dir->dd_pool;
+
+	ASSERT(dsl_pool_config_held(dp));
+
+	memset(zss, 0, sizeof (*zss));
+	zss->zss_guid = dsl_get_guid(ds);
+	zss->zss_creation = dsl_get_creation(ds);
+	zss->zss_createtxg = dsl_get_creationtxg(ds);
+	zss->zss_used = dsl_get_used(ds);
+	zss->zss_referenced = dsl_get_referenced(ds);
+	zss->zss_available = dsl_get_available(ds);
+	zss->zss_logicalreferenced = dsl_get_logicalreferenced(ds);
+	zss->zss_compressratio = dsl_get_compressratio(ds);
+	zss->zss_refratio = dsl_get_refratio(ds);
+	zss->zss_refquota = dsl_get_refquota(ds);
+	zss->zss_refreservation = dsl_get_refreservation(ds);
+
+	if (ds->ds_is_snapshot)
+		zss->zss_flags |= ZSS_SNAPSHOT;
+	else
+		dsl_dir_space_stats(ds->ds_dir, zss);
+
+	if (dsl_dataset_phys(ds)->ds_prev_snap_obj != 0 &&
+	    dsl_get_written(ds, &zss->zss_written) == 0)
+		zss->zss_flags |= ZSS_WRITTEN;
+}
+
 void
 dsl_dataset_fast_stat(dsl_dataset_t *ds, dmu_objset_stats_t *stat)
 {
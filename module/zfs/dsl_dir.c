@@ -1145,6 +1145,27 @@ dsl_dir_stats(dsl_dir_t *dd, nvlist_t *nv)
 
 }
 
+/*
+ * Fill in the dsl_dir part of a zfs_space_stats_t, as dsl_dir_stats() does
+ * for the nvlist of properties.
+ */
+void
+dsl_dir_space_stats(dsl_dir_t *dd, zfs_space_stats_t *zss)
+{
+	mutex_enter(&dd->dd_lock);
+	zss->zss_quota = dsl_dir_get_quota(dd);
+	zss->zss_reservation = dsl_dir_get_reservation(dd);
+	zss->zss_logicalused = dsl_dir_get_logicalused(dd);
+	if (dsl_dir_phys(dd)->dd_flags & DD_FLAG_USED_BREAKDOWN) {
+		zss->zss_flags |= ZSS_USED_BREAKDOWN;
+		zss->zss_usedsnap = dsl_dir_get_usedsnap(dd);
+		zss->zss_usedds = dsl_dir_get_usedds(dd);
+		zss->zss_usedrefreserv = dsl_dir_get_usedrefreserv(dd);
+		zss->zss_usedchild = dsl_dir_get_usedchild(dd);
+	}
+	mutex_exit(&dd->dd_lock);
+}
+
 void
 dsl_dir_dirty(dsl_dir_t *dd, dmu_tx_t *tx)
 {
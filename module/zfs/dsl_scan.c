@@ -187,6 +187,9 @@ static uint_t zfs_scan_mem_lim_fact = 20;
 /* fraction of mem lim above */
 static uint_t zfs_scan_mem_lim_soft_fact = 20;
 
+/* only clear the queues of vdevs above their share of the memory limit */
+static int zfs_scan_mem_lim_per_vdev = B_TRUE;
+
 /* minimum milliseconds to scrub per txg */
 static uint_t zfs_scrub_min_time_ms = 1000;
 
@@ -326,6 +329,7 @@ struct dsl_scan_io_queue {
 	avl_tree_t	q_sios_by_addr;
 	uint64_t	q_sio_memused;
 	uint64_t	q_last_ext_addr;
+	boolean_t	q_clearing; /* issue extents while scn_clearing */
 
 	/* members for zio rate limiting */
 	uint64_t	q_maxinflight_bytes;
@@ -1573,22 +1577,44 @@ scan_ds_queue_sync(dsl_scan_t *scn, dmu_tx_t *tx)
  *	worth of queues is about 1.2 GiB of on-pool data, so scanning
  *	that should take at least a decent fraction of a second).
  */
-static boolean_t
-dsl_scan_should_clear(dsl_scan_t *scn)
+static void
+dsl_scan_mem_limits(dsl_scan_t *scn, uint64_t *mlim_hard, uint64_t *mlim_soft)
 {
 	spa_t *spa = scn->scn_dp->dp_spa;
-	vdev_t *rvd = scn->scn_dp->dp_spa->spa_root_vdev;
-	uint64_t alloc, mlim_hard, mlim_soft, mused;
+	uint64_t alloc;
 
 	alloc = metaslab_class_get_alloc(spa_normal_class(spa));
 	alloc += metaslab_class_get_alloc(spa_special_class(spa));
 	alloc += metaslab_class_get_alloc(spa_dedup_class(spa));
 
-	mlim_hard = MAX((physmem / zfs_scan_mem_lim_fact) * PAGESIZE,
+	*mlim_hard = MAX((physmem / zfs_scan_mem_lim_fact) * PAGESIZE,
 	    zfs_scan_mem_lim_min);
-	mlim_hard = MIN(mlim_hard, alloc / 20);
-	mlim_soft = mlim_hard - MIN(mlim_hard / zfs_scan_mem_lim_soft_fact,
+	*mlim_hard = MIN(*mlim_hard, alloc / 20);
+	*mlim_soft = *mlim_hard - MIN(*mlim_hard / zfs_scan_mem_lim_soft_fact,
 	    zfs_scan_mem_lim_soft_max);
+}
+
+static uint64_t
+scan_io_queue_mem_used(dsl_scan_io_queue_t *queue)
+{
+	ASSERT(MUTEX_HELD(&queue->q_vd->vdev_scan_io_queue_lock));
+
+	/*
+	 * # of extents in exts_by_addr = # in exts_by_size.
+	 * B-tree efficiency is ~75%, but can be as low as 50%.
+	 */
+	return (zfs_btree_numnodes(&queue->q_exts_by_size) *
+	    ((sizeof (range_seg_gap_t) + sizeof (uint64_t)) * 3 / 2) +
+	    queue->q_sio_memused);
+}
+
+static boolean_t
+dsl_scan_should_clear(dsl_scan_t *scn)
+{
+	vdev_t *rvd = scn->scn_dp->dp_spa->spa_root_vdev;
+	uint64_t mlim_hard, mlim_soft, mused;
+
+	dsl_scan_mem_limits(scn, &mlim_hard, &mlim_soft);
 	mused = 0;
 	for (uint64_t i = 0; i < rvd->vdev_children; i++) {
 		vdev_t *tvd = rvd->vdev_child[i];
@@ -1596,15 +1622,8 @@ dsl_scan_should_clear(dsl_scan_t *scn)
 
 		mutex_enter(&tvd->vdev_scan_io_queue_lock);
 		queue = tvd->vdev_scan_io_queue;
-		if (queue != NULL) {
-			/*
-			 * # of extents in exts_by_addr = # in exts_by_size.
-			 * B-tree efficiency is ~75%, but can be as low as 50%.
-			 */
-			mused += zfs_btree_numnodes(&queue->q_exts_by_size) *
-			    ((sizeof (range_seg_gap_t) + sizeof (uint64_t)) *
-			    3 / 2) + queue->q_sio_memused;
-		}
+		if (queue != NULL)
+			mused += scan_io_queue_mem_used(queue);
 		mutex_exit(&tvd->vdev_scan_io_queue_lock);
 	}
 
@@ -1626,6 +1645,65 @@ dsl_scan_should_clear(dsl_scan_t *scn)
 		return (scn->scn_clearing);
 }
 
+/*
+ * Select the queues that issue I/O while we are clearing memory. Every
+ * top-level vdev is entitled to a share of the soft memory limit that is
+ * proportional to its allocated space, and only the queues above their
+ * share are drained. The other vdevs keep accumulating extents, which may
+ * still grow into sequential runs, rather than issuing their small
+ * fragments just because another vdev's queue is large. If no queue is
+ * over its share (the shares are only an estimate of where the blocks
+ * are), the largest queue is drained so that clearing always progresses.
+ * When checkpointing every queue is drained. The scan_queues_drained and
+ * scan_queues_held pool iostats count the queues selected and passed over.
+ */
+static void
+dsl_scan_select_clearing_queues(dsl_scan_t *scn)
+{
+	vdev_t *rvd = scn->scn_dp->dp_spa->spa_root_vdev;
+	boolean_t all = scn->scn_checkpointing || !zfs_scan_mem_lim_per_vdev;
+	uint64_t mlim_hard, mlim_soft, total_alloc = 0;
+	uint64_t largest_mused = 0, nqueues = 0, nclearing = 0;
+	dsl_scan_io_queue_t *largest = NULL;
+
+	dsl_scan_mem_limits(scn, &mlim_hard, &mlim_soft);
+	for (uint64_t i = 0; i < rvd->vdev_children; i++)
+		total_alloc += rvd->vdev_child[i]->vdev_stat.vs_alloc;
+
+	for (uint64_t i = 0; i < rvd->vdev_children; i++) {
+		vdev_t *tvd = rvd->vdev_child[i];
+		dsl_scan_io_queue_t *queue;
+
+		mutex_enter(&tvd->vdev_scan_io_queue_lock);
+		queue = tvd->vdev_scan_io_queue;
+		if (queue != NULL) {
+			uint64_t mused = scan_io_queue_mem_used(queue);
+			uint64_t share = (mlim_soft >> 10) *
+			    (tvd->vdev_stat.vs_alloc /
+			    MAX(total_alloc >> 10, 1));
+
+			queue->q_clearing = (all || mused > share);
+			nqueues++;
+			if (queue->q_clearing)
+				nclearing++;
+			if (mused > largest_mused) {
+				largest_mused = mused;
+				largest = queue;
+			}
+		}
+		mutex_exit(&tvd->vdev_scan_io_queue_lock);
+	}
+
+	if (nclearing == 0 && largest != NULL) {
+		mutex_enter(&largest->q_vd->vdev_scan_io_queue_lock);
+		largest->q_clearing = B_TRUE;
+		mutex_exit(&largest->q_vd->vdev_scan_io_queue_lock);
+		nclearing++;
+	}
+	spa_iostats_scan_add(scn->scn_dp->dp_spa, nclearing,
+	    nqueues - nclearing);
+}
+
 static boolean_t
 dsl_scan_check_suspend(dsl_scan_t *scn, const zbookmark_phys_t *zb)
 {
@@ -3408,6 +3486,10 @@ scan_io_queue_fetch_ext(dsl_scan_io_queue_t *queue)
 	if (!scn->scn_checkpointing && !scn->scn_clearing)
 		return (NULL);
 
+	/* this vdev is within its share of the memory limit */
+	if (!queue->q_clearing)
+		return (NULL);
+
 	/*
 	 * During normal clearing, we want to issue our largest segments
 	 * first, keeping IO as sequential as possible, and leaving the
@@ -3582,7 +3664,8 @@ scan_io_queues_run(dsl_scan_t *scn)
 		vdev_t *vd = spa->spa_root_vdev->vdev_child[i];
 
 		mutex_enter(&vd->vdev_scan_io_queue_lock);
-		if (vd->vdev_scan_io_queue != NULL) {
+		if (vd->vdev_scan_io_queue != NULL &&
+		    vd->vdev_scan_io_queue->q_clearing) {
 			VERIFY(taskq_dispatch(scn->scn_taskq,
 			    scan_io_queues_run_one, vd->vdev_scan_io_queue,
 			    TQ_SLEEP) != TASKQID_INVALID);
@@ -4630,6 +4713,7 @@ dsl_scan_sync(dsl_pool_t *dp, dmu_tx_t *tx)
 		ASSERT(scn->scn_clearing);
 
 		/* need to issue scrubbing IOs from per-vdev queues */
+		dsl_scan_select_clearing_queues(scn);
 		scn->scn_zio_root = zio_root(dp->dp_spa, NULL,
 		    NULL, ZIO_FLAG_CANFAIL);
 		scan_io_queues_run(scn);
@@ -5363,6 +5447,9 @@ ZFS_MODULE_PARAM(zfs, zfs_, scan_max_ext_gap, U64, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs, zfs_, scan_mem_lim_soft_fact, UINT, ZMOD_RW,
 	"Fraction of hard limit used as soft limit");
 
+ZFS_MODULE_PARAM(zfs, zfs_, scan_mem_lim_per_vdev, INT, ZMOD_RW,
+	"Only issue from vdevs above their share of the memory limit");
+
 ZFS_MODULE_PARAM(zfs, zfs_, scan_strict_mem_lim, INT, ZMOD_RW,
 	"Tunable to attempt to reduce lock contention");
 
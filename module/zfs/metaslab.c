@@ -101,6 +101,23 @@ uint_t zfs_condense_pct = 200;
  */
 static const int zfs_metaslab_condense_block_threshold = 4;
 
+/*
+ * When set, the space map of a metaslab that needs condensing is encoded
+ * by a background thread, outside of syncing context, and spa_sync() only
+ * copies the encoded entries into the new space map [see
+ * metaslab_condense_prepare()].  Condenses that are forced, for example to
+ * upgrade an old space map, are still done entirely in syncing context.
+ */
+static int zfs_metaslab_condense_async = 1;
+
+/*
+ * Upper bound on the size of the space maps prepared in the background
+ * that are committed in one txg, so that a burst of metaslabs that need
+ * condensing is spread over several txgs.  At least one space map is
+ * committed per txg.
+ */
+static uint64_t zfs_metaslab_condense_max_bytes = 16 << 20;
+
 /*
  * The zfs_mg_noalloc_threshold defines which metaslab groups should
  * be eligible for allocation. The value is defined as a percentage of
@@ -226,6 +243,12 @@ uint_t metaslab_preload_limit = 10;
  */
 static int metaslab_preload_enabled = B_TRUE;
 
+/*
+ * Enable/disable preloading of the best metaslabs of every group, in
+ * parallel, when a pool is imported.
+ */
+static int metaslab_preload_import_enabled = B_TRUE;
+
 /*
  * Enable/disable fragmentation weighting on metaslabs.
  */
@@ -345,6 +368,8 @@ static void metaslab_check_free_impl(vdev_t *, uint64_t, uint64_t);
 static void metaslab_passivate(metaslab_t *msp, uint64_t weight);
 static uint64_t metaslab_weight_from_range_tree(metaslab_t *msp);
 static void metaslab_flush_update(metaslab_t *, dmu_tx_t *);
+static void metaslab_condense_cancel(metaslab_t *);
+static void metaslab_condense_prepare_wait(metaslab_t *);
 static unsigned int metaslab_idx_func(multilist_t *, void *);
 static void metaslab_evict(metaslab_t *, uint64_t);
 static void metaslab_rt_add(range_tree_t *rt, range_seg_t *rs, void *arg);
@@ -355,6 +380,9 @@ typedef struct metaslab_stats {
 	kstat_named_t metaslabstat_reload_tree;
 	kstat_named_t metaslabstat_too_many_tries;
 	kstat_named_t metaslabstat_try_hard;
+	kstat_named_t metaslabstat_condense_sync;
+	kstat_named_t metaslabstat_condense_async;
+	kstat_named_t metaslabstat_condense_cancelled;
 } metaslab_stats_t;
 
 static metaslab_stats_t metaslab_stats = {
@@ -362,6 +390,9 @@ static metaslab_stats_t metaslab_stats = {
 	{ "reload_tree",		KSTAT_DATA_UINT64 },
 	{ "too_many_tries",		KSTAT_DATA_UINT64 },
 	{ "try_hard",			KSTAT_DATA_UINT64 },
+	{ "condense_sync",		KSTAT_DATA_UINT64 },
+	{ "condense_async",		KSTAT_DATA_UINT64 },
+	{ "condense_cancelled",		KSTAT_DATA_UINT64 },
 };
 
 #define	METASLABSTAT_BUMP(stat) \
@@ -1373,9 +1404,43 @@ metaslab_rangesize64_compare(const void *x1, const void *x2)
 	return (cmp + !cmp * TREE_CMP(r1->rs_start, r2->rs_start));
 }
 
+/*
+ * Comparison function for the offset-ordered size class trees of the
+ * segregated allocator using 32-bit ranges.
+ */
+__attribute__((always_inline)) inline
+static int
+metaslab_rangeoffset32_compare(const void *x1, const void *x2)
+{
+	const range_seg32_t *r1 = x1;
+	const range_seg32_t *r2 = x2;
+
+	return (TREE_CMP(r1->rs_start, r2->rs_start));
+}
+
+/*
+ * Comparison function for the offset-ordered size class trees of the
+ * segregated allocator using 64-bit ranges.
+ */
+__attribute__((always_inline)) inline
+static int
+metaslab_rangeoffset64_compare(const void *x1, const void *x2)
+{
+	const range_seg64_t *r1 = x1;
+	const range_seg64_t *r2 = x2;
+
+	return (TREE_CMP(r1->rs_start, r2->rs_start));
+}
+
 typedef struct metaslab_rt_arg {
 	zfs_btree_t *mra_bt;
 	uint32_t mra_floor_shift;
+	/*
+	 * For the segregated allocator, an array of MAX_LBAS trees holding
+	 * every segment of each power of 2 size class, ordered by offset.
+	 * NULL for all other allocators.
+	 */
+	zfs_btree_t *mra_class_bt;
 } metaslab_rt_arg_t;
 
 struct mssa_arg {
@@ -1395,6 +1460,21 @@ metaslab_size_sorted_add(void *arg, uint64_t start, uint64_t size)
 	metaslab_rt_add(rt, &seg, mrap);
 }
 
+/*
+ * Like metaslab_size_sorted_add(), but leave the size class trees alone,
+ * since unlike the size-sorted tree they always hold every segment.
+ */
+static void
+metaslab_size_tree_add(void *arg, uint64_t start, uint64_t size)
+{
+	struct mssa_arg *mssap = arg;
+	range_tree_t *rt = mssap->rt;
+	range_seg_max_t seg = {0};
+	rs_set_start(&seg, rt, start);
+	rs_set_end(&seg, rt, start + size);
+	zfs_btree_add(mssap->mra->mra_bt, &seg);
+}
+
 static void
 metaslab_size_tree_full_load(range_tree_t *rt)
 {
@@ -1405,7 +1485,7 @@ metaslab_size_tree_full_load(range_tree_t *rt)
 	struct mssa_arg arg = {0};
 	arg.rt = rt;
 	arg.mra = mrap;
-	range_tree_walk(rt, metaslab_size_sorted_add, &arg);
+	range_tree_walk(rt, metaslab_size_tree_add, &arg);
 }
 
 
@@ -1415,9 +1495,16 @@ ZFS_BTREE_FIND_IN_BUF_FUNC(metaslab_rt_find_rangesize32_in_buf,
 ZFS_BTREE_FIND_IN_BUF_FUNC(metaslab_rt_find_rangesize64_in_buf,
     range_seg64_t, metaslab_rangesize64_compare)
 
+ZFS_BTREE_FIND_IN_BUF_FUNC(metaslab_rt_find_rangeoffset32_in_buf,
+    range_seg32_t, metaslab_rangeoffset32_compare)
+
+ZFS_BTREE_FIND_IN_BUF_FUNC(metaslab_rt_find_rangeoffset64_in_buf,
+    range_seg64_t, metaslab_rangeoffset64_compare)
+
 /*
  * Create any block allocator specific components. The current allocators
- * rely on using both a size-ordered range_tree_t and an array of uint64_t's.
+ * rely on using both a size-ordered range_tree_t and an array of uint64_t's,
+ * and the segregated allocator also on its size class trees.
  */
 static void
 metaslab_rt_create(range_tree_t *rt, void *arg)
@@ -1427,23 +1514,35 @@ metaslab_rt_create(range_tree_t *rt, void *arg)
 
 	size_t size;
 	int (*compare) (const void *, const void *);
-	bt_find_in_buf_f bt_find;
+	int (*class_compare) (const void *, const void *);
+	bt_find_in_buf_f bt_find, class_bt_find;
 	switch (rt->rt_type) {
 	case RANGE_SEG32:
 		size = sizeof (range_seg32_t);
 		compare = metaslab_rangesize32_compare;
 		bt_find = metaslab_rt_find_rangesize32_in_buf;
+		class_compare = metaslab_rangeoffset32_compare;
+		class_bt_find = metaslab_rt_find_rangeoffset32_in_buf;
 		break;
 	case RANGE_SEG64:
 		size = sizeof (range_seg64_t);
 		compare = metaslab_rangesize64_compare;
 		bt_find = metaslab_rt_find_rangesize64_in_buf;
+		class_compare = metaslab_rangeoffset64_compare;
+		class_bt_find = metaslab_rt_find_rangeoffset64_in_buf;
 		break;
 	default:
 		panic("Invalid range seg type %d", rt->rt_type);
 	}
 	zfs_btree_create(size_tree, compare, bt_find, size);
 	mrap->mra_floor_shift = metaslab_by_size_min_shift;
+
+	if (mrap->mra_class_bt != NULL) {
+		for (int c = 0; c < MAX_LBAS; c++) {
+			zfs_btree_create(&mrap->mra_class_bt[c],
+			    class_compare, class_bt_find, size);
+		}
+	}
 }
 
 static void
@@ -1454,6 +1553,12 @@ metaslab_rt_destroy(range_tree_t *rt, void *arg)
 	zfs_btree_t *size_tree = mrap->mra_bt;
 
 	zfs_btree_destroy(size_tree);
+	if (mrap->mra_class_bt != NULL) {
+		for (int c = 0; c < MAX_LBAS; c++)
+			zfs_btree_destroy(&mrap->mra_class_bt[c]);
+		kmem_free(mrap->mra_class_bt,
+		    MAX_LBAS * sizeof (zfs_btree_t));
+	}
 	kmem_free(mrap, sizeof (*mrap));
 }
 
@@ -1462,9 +1567,12 @@ metaslab_rt_add(range_tree_t *rt, range_seg_t *rs, void *arg)
 {
 	metaslab_rt_arg_t *mrap = arg;
 	zfs_btree_t *size_tree = mrap->mra_bt;
+	uint64_t size = rs_get_end(rs, rt) - rs_get_start(rs, rt);
+
+	if (mrap->mra_class_bt != NULL)
+		zfs_btree_add(&mrap->mra_class_bt[highbit64(size) - 1], rs);
 
-	if (rs_get_end(rs, rt) - rs_get_start(rs, rt) <
-	    (1ULL << mrap->mra_floor_shift))
+	if (size < (1ULL << mrap->mra_floor_shift))
 		return;
 
 	zfs_btree_add(size_tree, rs);
@@ -1475,9 +1583,12 @@ metaslab_rt_remove(range_tree_t *rt, range_seg_t *rs, void *arg)
 {
 	metaslab_rt_arg_t *mrap = arg;
 	zfs_btree_t *size_tree = mrap->mra_bt;
+	uint64_t size = rs_get_end(rs, rt) - rs_get_start(rs, rt);
+
+	if (mrap->mra_class_bt != NULL)
+		zfs_btree_remove(&mrap->mra_class_bt[highbit64(size) - 1], rs);
 
-	if (rs_get_end(rs, rt) - rs_get_start(rs, rt) < (1ULL <<
-	    mrap->mra_floor_shift))
+	if (size < (1ULL << mrap->mra_floor_shift))
 		return;
 
 	zfs_btree_remove(size_tree, rs);
@@ -1490,6 +1601,12 @@ metaslab_rt_vacate(range_tree_t *rt, void *arg)
 	zfs_btree_t *size_tree = mrap->mra_bt;
 	zfs_btree_clear(size_tree);
 	zfs_btree_destroy(size_tree);
+	if (mrap->mra_class_bt != NULL) {
+		for (int c = 0; c < MAX_LBAS; c++) {
+			zfs_btree_clear(&mrap->mra_class_bt[c]);
+			zfs_btree_destroy(&mrap->mra_class_bt[c]);
+		}
+	}
 
 	metaslab_rt_create(rt, arg);
 }
@@ -1652,12 +1769,14 @@ metaslab_block_picker(range_tree_t *rt, uint64_t *cursor, uint64_t size,
 static uint64_t metaslab_df_alloc(metaslab_t *msp, uint64_t size);
 static uint64_t metaslab_cf_alloc(metaslab_t *msp, uint64_t size);
 static uint64_t metaslab_ndf_alloc(metaslab_t *msp, uint64_t size);
+static uint64_t metaslab_sf_alloc(metaslab_t *msp, uint64_t size);
 metaslab_ops_t *metaslab_allocator(spa_t *spa);
 
 static metaslab_ops_t metaslab_allocators[] = {
 	{ "dynamic", metaslab_df_alloc },
 	{ "cursor", metaslab_cf_alloc },
 	{ "new-dynamic", metaslab_ndf_alloc },
+	{ "segregated", metaslab_sf_alloc },
 };
 
 static int
@@ -1888,6 +2007,131 @@ metaslab_ndf_alloc(metaslab_t *msp, uint64_t size)
 	return (-1ULL);
 }
 
+/*
+ * ==========================================================================
+ * Segregated fit allocator -
+ * Keep the free segments of each power of 2 size class in their own
+ * offset-ordered tree, and allocate from the lowest offset of the smallest
+ * size class whose segments are all large enough. The number of segments
+ * in each class is the ms_allocatable histogram, so finding that class
+ * takes at most MAX_LBAS steps however fragmented the metaslab is, and
+ * there are no free space thresholds at which the allocator changes its
+ * behavior. If none of those classes has a free segment, fall back to the
+ * smallest segment that fits, as the dynamic fit allocator does.
+ * ==========================================================================
+ */
+static uint64_t
+metaslab_sf_alloc(metaslab_t *msp, uint64_t size)
+{
+	range_tree_t *rt = msp->ms_allocatable;
+	metaslab_rt_arg_t *mrap = rt->rt_arg;
+	zfs_btree_index_t where;
+	range_seg_t *rs;
+
+	ASSERT(MUTEX_HELD(&msp->ms_lock));
+	ASSERT3P(mrap->mra_class_bt, !=, NULL);
+
+	/* Segments of class c are at least 2^c bytes. */
+	for (int c = highbit64(size - 1); c < MAX_LBAS; c++) {
+		if (rt->rt_histogram[c] == 0)
+			continue;
+		rs = zfs_btree_first(&mrap->mra_class_bt[c], NULL);
+		ASSERT3P(rs, !=, NULL);
+		ASSERT3U(rs_get_end(rs, rt) - rs_get_start(rs, rt), >=, size);
+		return (rs_get_start(rs, rt));
+	}
+
+	if (zfs_btree_numnodes(&msp->ms_allocatable_by_size) == 0)
+		metaslab_size_tree_full_load(rt);
+	rs = metaslab_block_find(&msp->ms_allocatable_by_size, rt,
+	    msp->ms_start, size, &where);
+	if (rs != NULL && rs_get_start(rs, rt) + size <= rs_get_end(rs, rt))
+		return (rs_get_start(rs, rt));
+
+	return (-1ULL);
+}
+
+#ifndef _KERNEL
+/*
+ * For metaslab_alloc_bench: create a loaded metaslab covering [0, size)
+ * that belongs to no pool, with all of its space free and the range tree
+ * ops and size class trees the named allocator uses.  Returns NULL if
+ * there is no such allocator.
+ */
+metaslab_t *
+metaslab_bench_create(const char *allocator, uint64_t size, uint64_t shift)
+{
+	int a = spa_find_allocator_byname(allocator);
+	if (a < 0)
+		return (NULL);
+
+	metaslab_class_t *mc = kmem_zalloc(sizeof (*mc), KM_SLEEP);
+	mc->mc_ops = &metaslab_allocators[a];
+	metaslab_group_t *mg = kmem_zalloc(sizeof (*mg), KM_SLEEP);
+	mg->mg_class = mc;
+
+	metaslab_t *msp = kmem_zalloc(sizeof (*msp), KM_SLEEP);
+	mutex_init(&msp->ms_lock, NULL, MUTEX_DEFAULT, NULL);
+	msp->ms_group = mg;
+	msp->ms_start = 0;
+	msp->ms_size = size;
+	msp->ms_loaded = B_TRUE;
+
+	metaslab_rt_arg_t *mrap = kmem_zalloc(sizeof (*mrap), KM_SLEEP);
+	mrap->mra_bt = &msp->ms_allocatable_by_size;
+	mrap->mra_floor_shift = metaslab_by_size_min_shift;
+	if (mc->mc_ops->msop_alloc == metaslab_sf_alloc) {
+		mrap->mra_class_bt = kmem_zalloc(MAX_LBAS *
+		    sizeof (zfs_btree_t), KM_SLEEP);
+	}
+	range_seg_type_t type = (size >> shift) <= UINT32_MAX ?
+	    RANGE_SEG32 : RANGE_SEG64;
+	msp->ms_allocatable = range_tree_create(&metaslab_rt_ops, type, mrap,
+	    0, shift);
+	range_tree_add(msp->ms_allocatable, 0, size);
+
+	return (msp);
+}
+
+void
+metaslab_bench_destroy(metaslab_t *msp)
+{
+	metaslab_group_t *mg = msp->ms_group;
+
+	range_tree_vacate(msp->ms_allocatable, NULL, NULL);
+	range_tree_destroy(msp->ms_allocatable);
+	mutex_destroy(&msp->ms_lock);
+	kmem_free(mg->mg_class, sizeof (metaslab_class_t));
+	kmem_free(mg, sizeof (metaslab_group_t));
+	kmem_free(msp, sizeof (metaslab_t));
+}
+
+/*
+ * Allocate and free space like metaslab_block_alloc() and a synced free
+ * would, leaving out the txg trees of a metaslab that is part of a pool.
+ */
+uint64_t
+metaslab_bench_alloc(metaslab_t *msp, uint64_t size)
+{
+	metaslab_class_t *mc = msp->ms_group->mg_class;
+
+	mutex_enter(&msp->ms_lock);
+	uint64_t start = mc->mc_ops->msop_alloc(msp, size);
+	if (start != -1ULL)
+		range_tree_remove(msp->ms_allocatable, start, size);
+	mutex_exit(&msp->ms_lock);
+	return (start);
+}
+
+void
+metaslab_bench_free(metaslab_t *msp, uint64_t start, uint64_t size)
+{
+	mutex_enter(&msp->ms_lock);
+	range_tree_add(msp->ms_allocatable, start, size);
+	mutex_exit(&msp->ms_lock);
+}
+#endif
+
 /*
  * ==========================================================================
  * Metaslabs
@@ -2342,6 +2586,11 @@ metaslab_load_impl(metaslab_t *msp)
 	}
 	mrap->mra_bt = &msp->ms_allocatable_by_size;
 	mrap->mra_floor_shift = metaslab_by_size_min_shift;
+	if (mrap->mra_class_bt == NULL &&
+	    msp->ms_group->mg_class->mc_ops->msop_alloc == metaslab_sf_alloc) {
+		mrap->mra_class_bt = kmem_zalloc(MAX_LBAS *
+		    sizeof (zfs_btree_t), KM_SLEEP);
+	}
 
 	if (msp->ms_sm != NULL) {
 		error = space_map_load_length(msp->ms_sm, msp->ms_allocatable,
@@ -2581,9 +2830,11 @@ metaslab_unload(metaslab_t *msp)
 	 * metaslab_potentially_evict) and then unloaded during spa_sync (via
 	 * metaslab_class_evict_old).
 	 */
+	metaslab_condense_prepare_wait(msp);
 	if (!msp->ms_loaded)
 		return;
 
+	metaslab_condense_cancel(msp);
 	range_tree_vacate(msp->ms_allocatable, NULL, NULL);
 	msp->ms_loaded = B_FALSE;
 	msp->ms_unload_time = gethrtime();
@@ -2699,6 +2950,7 @@ metaslab_init(metaslab_group_t *mg, uint64_t id, uint64_t object,
 	mutex_init(&ms->ms_sync_lock, NULL, MUTEX_DEFAULT, NULL);
 	cv_init(&ms->ms_load_cv, NULL, CV_DEFAULT, NULL);
 	cv_init(&ms->ms_flush_cv, NULL, CV_DEFAULT, NULL);
+	cv_init(&ms->ms_condense_cv, NULL, CV_DEFAULT, NULL);
 	multilist_link_init(&ms->ms_class_txg_node);
 
 	ms->ms_id = id;
@@ -2831,6 +3083,13 @@ metaslab_fini(metaslab_t *msp)
 
 	metaslab_fini_flush_data(msp);
 
+	mutex_enter(&spa->spa_ms_condense_lock);
+	if (msp->ms_condense_queued) {
+		list_remove(&spa->spa_ms_condense_list, msp);
+		msp->ms_condense_queued = B_FALSE;
+	}
+	mutex_exit(&spa->spa_ms_condense_lock);
+
 	metaslab_group_remove(mg, msp);
 
 	mutex_enter(&msp->ms_lock);
@@ -2882,6 +3141,7 @@ metaslab_fini(metaslab_t *msp)
 	mutex_exit(&msp->ms_lock);
 	cv_destroy(&msp->ms_load_cv);
 	cv_destroy(&msp->ms_flush_cv);
+	cv_destroy(&msp->ms_condense_cv);
 	mutex_destroy(&msp->ms_lock);
 	mutex_destroy(&msp->ms_sync_lock);
 	ASSERT3U(msp->ms_allocator, ==, -1);
@@ -3593,6 +3853,164 @@ metaslab_group_preload(metaslab_group_t *mg)
 	mutex_exit(&mg->mg_lock);
 }
 
+typedef struct metaslab_import_load {
+	spa_t		*mil_spa;
+	uint64_t	mil_total;
+	uint64_t	mil_done;
+} metaslab_import_load_t;
+
+typedef struct metaslab_import_load_arg {
+	metaslab_t		*mila_msp;
+	metaslab_import_load_t	*mila_mil;
+} metaslab_import_load_arg_t;
+
+static void
+metaslab_import_load(void *arg)
+{
+	metaslab_import_load_arg_t *mila = arg;
+	metaslab_import_load_t *mil = mila->mila_mil;
+	metaslab_t *msp = mila->mila_msp;
+	fstrans_cookie_t cookie = spl_fstrans_mark();
+
+	mutex_enter(&msp->ms_lock);
+	VERIFY0(metaslab_load(msp));
+	metaslab_set_selected_txg(msp, 0);
+	mutex_exit(&msp->ms_lock);
+
+	/*
+	 * Report progress through the import notes, roughly once for
+	 * every percent of the metaslabs loaded.
+	 */
+	uint64_t done = atomic_inc_64_nv(&mil->mil_done);
+	if (done == mil->mil_total ||
+	    done % MAX(mil->mil_total / 100, 1) == 0) {
+		spa_import_progress_set_notes_nolog(mil->mil_spa,
+		    "Loading metaslabs (%llu/%llu)", (u_longlong_t)done,
+		    (u_longlong_t)mil->mil_total);
+	}
+	spl_fstrans_unmark(cookie);
+}
+
+/*
+ * Load metaslabs of all the pool's metaslab groups in parallel on the
+ * metaslab taskq.  Each group is walked in weight order and the groups
+ * are interleaved, so that the best metaslabs of every vdev are queued
+ * ahead of the second best of any vdev, and the I/O is spread across all
+ * vdevs from the start.
+ *
+ * If "all" is set, every metaslab with a space map is loaded and we wait
+ * for the loads to complete, reporting progress in the import notes
+ * (this is used by metaslab_debug_load).  Otherwise up to
+ * metaslab_preload_limit metaslabs of each active group are queued in
+ * the background, ahead of the first allocations after import.
+ */
+void
+metaslab_preload_import(spa_t *spa, boolean_t all)
+{
+	vdev_t *rvd = spa->spa_root_vdev;
+	uint64_t maxgroups = 2 * rvd->vdev_children;
+	uint64_t ngroups = 0, nmsps = 0, maxrank = 0;
+
+	if (!all && (spa_shutting_down(spa) || !metaslab_preload_enabled ||
+	    !metaslab_preload_import_enabled))
+		return;
+
+	metaslab_group_t **mgs = kmem_zalloc(maxgroups * sizeof (*mgs),
+	    KM_SLEEP);
+	for (uint64_t c = 0; c < rvd->vdev_children; c++) {
+		vdev_t *vd = rvd->vdev_child[c];
+		metaslab_group_t *vmgs[] = { vd->vdev_mg, vd->vdev_log_mg };
+
+		for (int i = 0; i < ARRAY_SIZE(vmgs); i++) {
+			metaslab_group_t *mg = vmgs[i];
+
+			if (mg == NULL || vd->vdev_ms_count == 0 ||
+			    (!all && mg->mg_activation_count <= 0))
+				continue;
+			mgs[ngroups++] = mg;
+			nmsps += vd->vdev_ms_count;
+		}
+	}
+	if (nmsps == 0) {
+		kmem_free(mgs, maxgroups * sizeof (*mgs));
+		return;
+	}
+
+	/*
+	 * Take a snapshot of every group's candidates in weight order.  The
+	 * trees are re-sorted as metaslabs get loaded, so they can't be
+	 * walked while the loads are being dispatched.
+	 */
+	metaslab_t **msps = vmem_alloc(nmsps * sizeof (*msps), KM_SLEEP);
+	uint64_t *first = kmem_zalloc(ngroups * sizeof (uint64_t), KM_SLEEP);
+	uint64_t *count = kmem_zalloc(ngroups * sizeof (uint64_t), KM_SLEEP);
+	uint64_t n = 0;
+	for (uint64_t g = 0; g < ngroups; g++) {
+		metaslab_group_t *mg = mgs[g];
+		avl_tree_t *t = &mg->mg_metaslab_tree;
+
+		first[g] = n;
+		mutex_enter(&mg->mg_lock);
+		for (metaslab_t *msp = avl_first(t); msp != NULL;
+		    msp = AVL_NEXT(t, msp)) {
+			if (all ? msp->ms_sm == NULL :
+			    count[g] >= metaslab_preload_limit)
+				continue;
+			ASSERT3U(n, <, nmsps);
+			msps[n++] = msp;
+			count[g]++;
+		}
+		mutex_exit(&mg->mg_lock);
+		maxrank = MAX(maxrank, count[g]);
+	}
+
+	metaslab_import_load_t mil = {
+		.mil_spa = spa,
+		.mil_total = n,
+		.mil_done = 0,
+	};
+	metaslab_import_load_arg_t *milas = NULL;
+	if (all && n > 0) {
+		milas = vmem_alloc(n * sizeof (*milas), KM_SLEEP);
+		spa_import_progress_set_notes(spa,
+		    "Loading metaslabs (0/%llu)", (u_longlong_t)n);
+	}
+
+	uint64_t dispatched = 0;
+	for (uint64_t r = 0; r < maxrank; r++) {
+		for (uint64_t g = 0; g < ngroups; g++) {
+			if (r >= count[g])
+				continue;
+			metaslab_t *msp = msps[first[g] + r];
+			if (all) {
+				metaslab_import_load_arg_t *mila =
+				    &milas[dispatched];
+				mila->mila_msp = msp;
+				mila->mila_mil = &mil;
+				VERIFY(taskq_dispatch(spa->spa_metaslab_taskq,
+				    metaslab_import_load, mila, TQ_SLEEP) !=
+				    TASKQID_INVALID);
+			} else {
+				VERIFY(taskq_dispatch(spa->spa_metaslab_taskq,
+				    metaslab_preload, msp, TQ_SLEEP) !=
+				    TASKQID_INVALID);
+			}
+			dispatched++;
+		}
+	}
+	ASSERT3U(dispatched, ==, n);
+
+	if (milas != NULL) {
+		taskq_wait_outstanding(spa->spa_metaslab_taskq, 0);
+		ASSERT3U(mil.mil_done, ==, n);
+		vmem_free(milas, n * sizeof (*milas));
+	}
+	kmem_free(count, ngroups * sizeof (uint64_t));
+	kmem_free(first, ngroups * sizeof (uint64_t));
+	vmem_free(msps, nmsps * sizeof (*msps));
+	kmem_free(mgs, maxgroups * sizeof (*mgs));
+}
+
 /*
  * Determine if the space map's on-disk footprint is past our tolerance for
  * inefficiency. We would like to use the following criteria to make our
@@ -3643,6 +4061,384 @@ metaslab_should_condense(metaslab_t *msp)
 	    object_size > zfs_metaslab_condense_block_threshold * record_size);
 }
 
+/*
+ * Truncate the space map of msp so that it can be rewritten in condensed
+ * form, and record its new object if it had to be reallocated.
+ */
+static void
+metaslab_condense_truncate(metaslab_t *msp, dmu_tx_t *tx)
+{
+	spa_t *spa = msp->ms_group->mg_vd->vdev_spa;
+	uint64_t object = space_map_object(msp->ms_sm);
+
+	space_map_truncate(msp->ms_sm,
+	    spa_feature_is_enabled(spa, SPA_FEATURE_LOG_SPACEMAP) ?
+	    zfs_metaslab_sm_blksz_with_log : zfs_metaslab_sm_blksz_no_log, tx);
+
+	/*
+	 * space_map_truncate() may have reallocated the spacemap object.
+	 * If so, update the vdev_ms_array.
+	 */
+	if (space_map_object(msp->ms_sm) != object) {
+		object = space_map_object(msp->ms_sm);
+		dmu_write(spa->spa_meta_objset,
+		    msp->ms_group->mg_vd->vdev_ms_array, sizeof (uint64_t) *
+		    msp->ms_id, sizeof (uint64_t), &object, tx);
+	}
+}
+
+/*
+ * Discard the condensed space map prepared for msp, if any.
+ */
+static void
+metaslab_condense_cancel(metaslab_t *msp)
+{
+	ASSERT(MUTEX_HELD(&msp->ms_lock));
+
+	if (msp->ms_condense_allocs == NULL)
+		return;
+
+	range_tree_vacate(msp->ms_condense_allocs, NULL, NULL);
+	range_tree_destroy(msp->ms_condense_allocs);
+	range_tree_vacate(msp->ms_condense_frees, NULL, NULL);
+	range_tree_destroy(msp->ms_condense_frees);
+	vmem_free(msp->ms_condense_buf, msp->ms_condense_bufsize);
+	msp->ms_condense_allocs = NULL;
+	msp->ms_condense_frees = NULL;
+	msp->ms_condense_buf = NULL;
+	msp->ms_condense_bufsize = 0;
+	msp->ms_condense_nwords = 0;
+	msp->ms_condense_space = 0;
+	METASLABSTAT_BUMP(metaslabstat_condense_cancelled);
+}
+
+/*
+ * Wait until metaslab_condense_prepare() is done reading ms_allocatable,
+ * before changing it.
+ */
+static void
+metaslab_condense_prepare_wait(metaslab_t *msp)
+{
+	ASSERT(MUTEX_HELD(&msp->ms_lock));
+
+	while (msp->ms_condense_preparing)
+		cv_wait(&msp->ms_condense_cv, &msp->ms_lock);
+}
+
+/*
+ * Prepare a condensed space map for msp outside of syncing context. We take
+ * a snapshot of the free space of the metaslab as of the last changes that
+ * metaslab_sync() has written out, and encode it as space map entries. From
+ * then on, metaslab_sync() records the allocations and frees it writes out
+ * in ms_condense_allocs and ms_condense_frees, until
+ * metaslab_condense_commit() writes the encoded snapshot followed by these
+ * changes as the new space map.
+ *
+ * The snapshot is the union of ms_allocatable, the ms_defer trees, the
+ * ms_allocating trees (allocations that have not been synced yet), and
+ * ms_freed (frees that have been synced but are not allocatable yet).
+ * metaslab_sync() moves the changes it has written out of ms_allocating
+ * and ms_freeing, and records them, under the same hold of the ms_lock,
+ * so whenever we hold the ms_lock this union is the free space described
+ * by the space map (and the log space maps) plus the changes recorded.
+ *
+ * The small trees are copied under the ms_lock.  ms_allocatable, which
+ * holds most of the segments, is encoded after dropping the ms_lock, with
+ * ms_condense_preparing set so that it does not change in the meantime:
+ * allocations skip the metaslab as they do while it is condensing, and
+ * metaslab_sync_done(), metaslab_unload(), metaslab_unalloc_dva() and
+ * metaslab_claim_concrete() wait in metaslab_condense_prepare_wait().
+ * Frees only go to ms_freeing and are not held up.
+ */
+static void
+metaslab_condense_prepare(metaslab_t *msp)
+{
+	vdev_t *vd = msp->ms_group->mg_vd;
+	space_map_t *sm;
+
+	mutex_enter(&msp->ms_lock);
+	sm = msp->ms_sm;
+	if (!msp->ms_loaded || msp->ms_condensing || sm == NULL ||
+	    msp->ms_condense_allocs != NULL) {
+		mutex_exit(&msp->ms_lock);
+		return;
+	}
+
+	range_seg_type_t type;
+	uint64_t shift, start;
+	type = metaslab_calculate_range_tree_type(vd, msp, &start, &shift);
+
+	range_tree_t *condense_tree = range_tree_create(NULL, type, NULL,
+	    start, shift);
+	for (int t = 0; t < TXG_DEFER_SIZE; t++) {
+		range_tree_walk(msp->ms_defer[t],
+		    range_tree_add, condense_tree);
+	}
+	for (int t = 0; t < TXG_SIZE; t++) {
+		range_tree_walk(msp->ms_allocating[t],
+		    range_tree_add, condense_tree);
+	}
+	range_tree_walk(msp->ms_freed, range_tree_add, condense_tree);
+
+	uint64_t bufsize = MAX(space_map_estimate_optimal_size(sm,
+	    msp->ms_allocatable, SM_NO_VDEVID) +
+	    space_map_estimate_optimal_size(sm, condense_tree, SM_NO_VDEVID),
+	    sizeof (uint64_t));
+	uint64_t nwords = bufsize / sizeof (uint64_t);
+	uint64_t allocatable = range_tree_space(msp->ms_allocatable);
+	uint64_t space = allocatable + range_tree_space(condense_tree);
+
+	/* metaslab_sync() records its changes from here on. */
+	msp->ms_condense_allocs = range_tree_create(NULL, type, NULL, start,
+	    shift);
+	msp->ms_condense_frees = range_tree_create(NULL, type, NULL, start,
+	    shift);
+	msp->ms_condense_preparing = B_TRUE;
+	mutex_exit(&msp->ms_lock);
+
+	uint64_t *buf = vmem_alloc(bufsize, KM_SLEEP);
+	uint64_t used = space_map_encode(sm, msp->ms_allocatable, SM_FREE,
+	    buf, nwords);
+	used += space_map_encode(sm, condense_tree, SM_FREE, buf + used,
+	    nwords - used);
+	range_tree_vacate(condense_tree, NULL, NULL);
+	range_tree_destroy(condense_tree);
+
+	mutex_enter(&msp->ms_lock);
+	msp->ms_condense_preparing = B_FALSE;
+	cv_broadcast(&msp->ms_condense_cv);
+
+	msp->ms_condense_buf = buf;
+	msp->ms_condense_bufsize = bufsize;
+	msp->ms_condense_nwords = used;
+	msp->ms_condense_space = space;
+
+	/*
+	 * Nothing that could invalidate the snapshot should have happened
+	 * while we were encoding, but check before handing it to the
+	 * syncing thread.
+	 */
+	ASSERT3U(range_tree_space(msp->ms_allocatable), ==, allocatable);
+	if (!msp->ms_loaded || msp->ms_sm != sm ||
+	    range_tree_space(msp->ms_allocatable) != allocatable)
+		metaslab_condense_cancel(msp);
+	mutex_exit(&msp->ms_lock);
+}
+
+/*
+ * Queue msp for metaslab_condense_thread().
+ */
+static void
+metaslab_condense_queue(metaslab_t *msp)
+{
+	spa_t *spa = msp->ms_group->mg_vd->vdev_spa;
+
+	ASSERT(MUTEX_HELD(&msp->ms_lock));
+
+	mutex_enter(&spa->spa_ms_condense_lock);
+	if (!msp->ms_condense_queued) {
+		list_insert_tail(&spa->spa_ms_condense_list, msp);
+		msp->ms_condense_queued = B_TRUE;
+	}
+	mutex_exit(&spa->spa_ms_condense_lock);
+
+	if (spa->spa_ms_condense_zthr != NULL)
+		zthr_wakeup(spa->spa_ms_condense_zthr);
+}
+
+/*
+ * Account for committing the condensed space map prepared for msp in
+ * this txg, unless it would exceed zfs_metaslab_condense_max_bytes.
+ */
+static boolean_t
+metaslab_condense_reserve(metaslab_t *msp, uint64_t txg)
+{
+	spa_t *spa = msp->ms_group->mg_vd->vdev_spa;
+	uint64_t bytes = msp->ms_condense_nwords * sizeof (uint64_t);
+	boolean_t reserved;
+
+	mutex_enter(&spa->spa_ms_condense_lock);
+	if (spa->spa_ms_condense_txg != txg) {
+		spa->spa_ms_condense_txg = txg;
+		spa->spa_ms_condense_bytes = 0;
+	}
+	reserved = (spa->spa_ms_condense_bytes == 0 ||
+	    spa->spa_ms_condense_bytes + bytes <=
+	    zfs_metaslab_condense_max_bytes);
+	if (reserved)
+		spa->spa_ms_condense_bytes += bytes;
+	mutex_exit(&spa->spa_ms_condense_lock);
+
+	return (reserved);
+}
+
+/*
+ * Decide whether to condense the space map of msp in this txg. With
+ * zfs_metaslab_condense_async, a metaslab that needs condensing is queued
+ * for metaslab_condense_thread() instead, and is condensed in a later txg
+ * once its condensed space map has been prepared.
+ */
+static boolean_t
+metaslab_condense_check(metaslab_t *msp, uint64_t txg)
+{
+	ASSERT(MUTEX_HELD(&msp->ms_lock));
+	ASSERT(msp->ms_loaded);
+
+	/* Still being prepared, try again in a later txg. */
+	if (msp->ms_condense_preparing)
+		return (B_FALSE);
+
+	if (msp->ms_condense_allocs != NULL) {
+		return (msp->ms_condense_wanted ||
+		    metaslab_condense_reserve(msp, txg));
+	}
+
+	if (!metaslab_should_condense(msp))
+		return (B_FALSE);
+
+	if (!zfs_metaslab_condense_async || msp->ms_condense_wanted)
+		return (B_TRUE);
+
+	metaslab_condense_queue(msp);
+	return (B_FALSE);
+}
+
+static boolean_t
+metaslab_condense_thread_check(void *arg, zthr_t *zthr)
+{
+	(void) zthr;
+	spa_t *spa = arg;
+
+	mutex_enter(&spa->spa_ms_condense_lock);
+	boolean_t queued = !list_is_empty(&spa->spa_ms_condense_list);
+	mutex_exit(&spa->spa_ms_condense_lock);
+
+	return (queued);
+}
+
+/*
+ * Prepare the condensed space maps of the queued metaslabs. Holding the
+ * SCL_ALLOC config lock keeps the metaslab from being freed under us, as
+ * metaslab_fini() is only called with all config locks held as writer.
+ */
+static void
+metaslab_condense_thread(void *arg, zthr_t *zthr)
+{
+	spa_t *spa = arg;
+
+	while (!zthr_iscancelled(zthr)) {
+		spa_config_enter(spa, SCL_ALLOC, FTAG, RW_READER);
+		mutex_enter(&spa->spa_ms_condense_lock);
+		metaslab_t *msp = list_remove_head(&spa->spa_ms_condense_list);
+		if (msp != NULL)
+			msp->ms_condense_queued = B_FALSE;
+		mutex_exit(&spa->spa_ms_condense_lock);
+
+		if (msp != NULL)
+			metaslab_condense_prepare(msp);
+		spa_config_exit(spa, SCL_ALLOC, FTAG);
+
+		if (msp == NULL)
+			break;
+	}
+}
+
+void
+metaslab_condense_thread_start(spa_t *spa)
+{
+	ASSERT3P(spa->spa_ms_condense_zthr, ==, NULL);
+	spa->spa_ms_condense_zthr = zthr_create("z_metaslab_condense",
+	    metaslab_condense_thread_check, metaslab_condense_thread, spa,
+	    minclsyspri);
+}
+
+/*
+ * Write out the condensed space map prepared by metaslab_condense_prepare():
+ * an entry marking everything as allocated, the encoded snapshot of the
+ * free space, and the changes synced since the snapshot was taken. As with
+ * metaslab_condense(), the result describes all the entries of previous
+ * TXGs, and this TXG's entries still need to be written.
+ *
+ * Unlike metaslab_condense(), we do not read ms_allocatable, so we do not
+ * need to stop allocations from the metaslab while we write.
+ */
+static void
+metaslab_condense_commit(metaslab_t *msp, dmu_tx_t *tx)
+{
+	space_map_t *sm = msp->ms_sm;
+	spa_t *spa = msp->ms_group->mg_vd->vdev_spa;
+
+	ASSERT(MUTEX_HELD(&msp->ms_lock));
+	ASSERT3P(msp->ms_condense_allocs, !=, NULL);
+	ASSERT3U(spa_sync_pass(spa), ==, 1);
+	ASSERT(range_tree_is_empty(msp->ms_freed)); /* since it is pass 1 */
+
+	zfs_dbgmsg("condensing: txg %llu, msp[%llu] %px, vdev id %llu, "
+	    "spa %s, smp size %llu, prepared size %llu, changes %llu, "
+	    "forcing condense=%s", (u_longlong_t)dmu_tx_get_txg(tx),
+	    (u_longlong_t)msp->ms_id, msp,
+	    (u_longlong_t)msp->ms_group->mg_vd->vdev_id,
+	    spa->spa_name, (u_longlong_t)space_map_length(msp->ms_sm),
+	    (u_longlong_t)(msp->ms_condense_nwords * sizeof (uint64_t)),
+	    (u_longlong_t)(range_tree_numsegs(msp->ms_condense_allocs) +
+	    range_tree_numsegs(msp->ms_condense_frees)),
+	    msp->ms_condense_wanted ? "TRUE" : "FALSE");
+
+	msp->ms_condense_wanted = B_FALSE;
+
+	/*
+	 * Take the prepared space map off the metaslab, so that it cannot be
+	 * cancelled or prepared again while we write it out.
+	 */
+	range_tree_t *allocs = msp->ms_condense_allocs;
+	range_tree_t *frees = msp->ms_condense_frees;
+	uint64_t *buf = msp->ms_condense_buf;
+	uint64_t bufsize = msp->ms_condense_bufsize;
+	uint64_t nwords = msp->ms_condense_nwords;
+	uint64_t space = msp->ms_condense_space;
+	msp->ms_condense_allocs = NULL;
+	msp->ms_condense_frees = NULL;
+	msp->ms_condense_buf = NULL;
+	msp->ms_condense_bufsize = 0;
+	msp->ms_condense_nwords = 0;
+	msp->ms_condense_space = 0;
+
+	ASSERT3U(spa->spa_unflushed_stats.sus_memused, >=,
+	    metaslab_unflushed_changes_memused(msp));
+	spa->spa_unflushed_stats.sus_memused -=
+	    metaslab_unflushed_changes_memused(msp);
+	range_tree_vacate(msp->ms_unflushed_allocs, NULL, NULL);
+	range_tree_vacate(msp->ms_unflushed_frees, NULL, NULL);
+
+	range_seg_type_t type;
+	uint64_t shift, start;
+	type = metaslab_calculate_range_tree_type(msp->ms_group->mg_vd, msp,
+	    &start, &shift);
+
+	mutex_exit(&msp->ms_lock);
+	metaslab_condense_truncate(msp, tx);
+
+	range_tree_t *tmp_tree = range_tree_create(NULL, type, NULL, start,
+	    shift);
+	range_tree_add(tmp_tree, msp->ms_start, msp->ms_size);
+	space_map_write(sm, tmp_tree, SM_ALLOC, SM_NO_VDEVID, tx);
+	space_map_write_encoded(sm, buf, nwords, SM_FREE, space, tx);
+	space_map_write(sm, allocs, SM_ALLOC, SM_NO_VDEVID, tx);
+	space_map_write(sm, frees, SM_FREE, SM_NO_VDEVID, tx);
+
+	range_tree_vacate(tmp_tree, NULL, NULL);
+	range_tree_destroy(tmp_tree);
+	range_tree_vacate(allocs, NULL, NULL);
+	range_tree_destroy(allocs);
+	range_tree_vacate(frees, NULL, NULL);
+	range_tree_destroy(frees);
+	vmem_free(buf, bufsize);
+	mutex_enter(&msp->ms_lock);
+
+	metaslab_flush_update(msp, tx);
+	METASLABSTAT_BUMP(metaslabstat_condense_async);
+}
+
 /*
  * Condense the on-disk space map representation to its minimized form.
  * The minimized form consists of a small number of allocations followed
@@ -3663,6 +4459,15 @@ metaslab_condense(metaslab_t *msp, dmu_tx_t *tx)
 	ASSERT(msp->ms_loaded);
 	ASSERT(msp->ms_sm != NULL);
 
+	/*
+	 * If a condensed space map has been prepared in the background,
+	 * all that is left is to write it out.
+	 */
+	if (msp->ms_condense_allocs != NULL) {
+		metaslab_condense_commit(msp, tx);
+		return;
+	}
+
 	/*
 	 * In order to condense the space map, we need to change it so it
 	 * only describes which segments are currently allocated and free.
@@ -3753,21 +4558,7 @@ metaslab_condense(metaslab_t *msp, dmu_tx_t *tx)
 	msp->ms_condensing = B_TRUE;
 
 	mutex_exit(&msp->ms_lock);
-	uint64_t object = space_map_object(msp->ms_sm);
-	space_map_truncate(sm,
-	    spa_feature_is_enabled(spa, SPA_FEATURE_LOG_SPACEMAP) ?
-	    zfs_metaslab_sm_blksz_with_log : zfs_metaslab_sm_blksz_no_log, tx);
-
-	/*
-	 * space_map_truncate() may have reallocated the spacemap object.
-	 * If so, update the vdev_ms_array.
-	 */
-	if (space_map_object(msp->ms_sm) != object) {
-		object = space_map_object(msp->ms_sm);
-		dmu_write(spa->spa_meta_objset,
-		    msp->ms_group->mg_vd->vdev_ms_array, sizeof (uint64_t) *
-		    msp->ms_id, sizeof (uint64_t), &object, tx);
-	}
+	metaslab_condense_truncate(msp, tx);
 
 	/*
 	 * Note:
@@ -3795,6 +4586,7 @@ metaslab_condense(metaslab_t *msp, dmu_tx_t *tx)
 
 	msp->ms_condensing = B_FALSE;
 	metaslab_flush_update(msp, tx);
+	METASLABSTAT_BUMP(metaslabstat_condense_sync);
 }
 
 static void
@@ -3929,7 +4721,8 @@ metaslab_flush(metaslab_t *msp, dmu_tx_t *tx)
 	 * ms_flush_cv, even if we temporarily drop the ms_lock in
 	 * metaslab_condense(), as the metaslab is already loaded.
 	 */
-	if (msp->ms_loaded && metaslab_should_condense(msp)) {
+	if (msp->ms_loaded &&
+	    metaslab_condense_check(msp, dmu_tx_get_txg(tx))) {
 		metaslab_group_t *mg = msp->ms_group;
 
 		/*
@@ -4134,7 +4927,7 @@ metaslab_sync(metaslab_t *msp, uint64_t txg)
 	metaslab_group_histogram_remove(mg, msp);
 
 	if (spa->spa_sync_pass == 1 && msp->ms_loaded &&
-	    metaslab_should_condense(msp))
+	    metaslab_condense_check(msp, txg))
 		metaslab_condense(msp, tx);
 
 	/*
@@ -4253,6 +5046,19 @@ metaslab_sync(metaslab_t *msp, uint64_t txg)
 	metaslab_group_histogram_verify(mg);
 	metaslab_class_histogram_verify(mg->mg_class);
 
+	/*
+	 * If a condensed space map is being prepared for this metaslab,
+	 * record the changes written out above in it. This must be done
+	 * under the same hold of the ms_lock that moves them out of
+	 * alloctree and ms_freeing below [see metaslab_condense_prepare()].
+	 */
+	if (msp->ms_condense_allocs != NULL) {
+		range_tree_remove_xor_add(alloctree,
+		    msp->ms_condense_frees, msp->ms_condense_allocs);
+		range_tree_remove_xor_add(msp->ms_freeing,
+		    msp->ms_condense_allocs, msp->ms_condense_frees);
+	}
+
 	/*
 	 * For sync pass 1, we avoid traversing this txg's free range tree
 	 * and instead will just swap the pointers for freeing and freed.
@@ -4400,6 +5206,7 @@ metaslab_sync_done(metaslab_t *msp, uint64_t txg)
 	 * the defer_tree -- this is safe to do because we've
 	 * just emptied out the defer_tree.
 	 */
+	metaslab_condense_prepare_wait(msp);
 	range_tree_vacate(*defer_tree,
 	    msp->ms_loaded ? range_tree_add : NULL, msp->ms_allocatable);
 	if (defer_allowed) {
@@ -4729,7 +5536,8 @@ find_valid_metaslab(metaslab_group_t *mg, uint64_t activation_weight,
 		 * If the selected metaslab is condensing or disabled, or
 		 * hasn't gone through a metaslab_sync_done(), then skip it.
 		 */
-		if (msp->ms_condensing || msp->ms_disabled > 0 || msp->ms_new)
+		if (msp->ms_condensing || msp->ms_condense_preparing ||
+		    msp->ms_disabled > 0 || msp->ms_new)
 			continue;
 
 		*was_active = msp->ms_allocator != -1;
@@ -4997,7 +5805,7 @@ metaslab_group_alloc_normal(metaslab_group_t *mg, zio_alloc_list_t *zal,
 		 * allocate from it since the allocated region might be
 		 * overwritten after allocation.
 		 */
-		if (msp->ms_condensing) {
+		if (msp->ms_condensing || msp->ms_condense_preparing) {
 			metaslab_trace_add(zal, mg, msp, asize, d,
 			    TRACE_CONDENSING, allocator);
 			if (activated) {
@@ -5623,6 +6431,7 @@ metaslab_unalloc_dva(spa_t *spa, const dva_t *dva, uint64_t txg)
 	msp = vd->vdev_ms[offset >> vd->vdev_ms_shift];
 
 	mutex_enter(&msp->ms_lock);
+	metaslab_condense_prepare_wait(msp);
 	range_tree_remove(msp->ms_allocating[txg & TXG_MASK],
 	    offset, size);
 	msp->ms_allocating_total -= size;
@@ -5719,6 +6528,7 @@ metaslab_claim_concrete(vdev_t *vd, uint64_t offset, uint64_t size,
 	msp = vd->vdev_ms[offset >> vd->vdev_ms_shift];
 
 	mutex_enter(&msp->ms_lock);
+	metaslab_condense_prepare_wait(msp);
 
 	if ((txg != 0 && spa_writeable(spa)) || !msp->ms_loaded) {
 		error = metaslab_activate(msp, 0, METASLAB_WEIGHT_CLAIM);
@@ -6220,6 +7030,9 @@ ZFS_MODULE_PARAM(zfs_metaslab, metaslab_, preload_enabled, INT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_metaslab, metaslab_, preload_limit, UINT, ZMOD_RW,
 	"Max number of metaslabs per group to preload");
 
+ZFS_MODULE_PARAM(zfs_metaslab, metaslab_, preload_import_enabled, INT,
+	ZMOD_RW, "Preload the best metaslabs of all groups at pool import");
+
 ZFS_MODULE_PARAM(zfs_metaslab, metaslab_, unload_delay, UINT, ZMOD_RW,
 	"Delay in txgs after metaslab was last used before unloading");
 
@@ -6278,6 +7091,12 @@ ZFS_MODULE_PARAM(zfs_metaslab, zfs_metaslab_, try_hard_before_gang, INT,
 ZFS_MODULE_PARAM(zfs_metaslab, zfs_metaslab_, find_max_tries, UINT, ZMOD_RW,
 	"Normally only consider this many of the best metaslabs in each vdev");
 
+ZFS_MODULE_PARAM(zfs_metaslab, zfs_metaslab_, condense_async, INT, ZMOD_RW,
+	"Prepare condensed space maps outside of txg sync");
+
+ZFS_MODULE_PARAM(zfs_metaslab, zfs_metaslab_, condense_max_bytes, U64,
+	ZMOD_RW, "Max bytes of prepared space maps to condense per txg");
+
 ZFS_MODULE_PARAM_CALL(zfs, zfs_, active_allocator,
 	param_set_active_allocator, param_get_charp, ZMOD_RW,
 	"SPA active allocator");
@@ -190,14 +190,48 @@ range_tree_seg_gap_compare(const void *x1, const void *x2)
 	return ((r1->rs_start >= r2->rs_end) - (r1->rs_end <= r2->rs_start));
 }
 
-ZFS_BTREE_FIND_IN_BUF_FUNC(range_tree_seg32_find_in_buf, range_seg32_t,
-    range_tree_seg32_compare)
-
-ZFS_BTREE_FIND_IN_BUF_FUNC(range_tree_seg64_find_in_buf, range_seg64_t,
-    range_tree_seg64_compare)
-
-ZFS_BTREE_FIND_IN_BUF_FUNC(range_tree_seg_gap_find_in_buf, range_seg_gap_t,
-    range_tree_seg_gap_compare)
+/*
+ * The segments of a range tree never overlap, so they are sorted by their
+ * ends as well as by their starts, and a segment sorts before the range
+ * being searched for exactly when it ends at or before the range's start.
+ * This is the search ZFS_BTREE_FIND_IN_BUF_FUNC() generates, except that
+ * each step only has to load and compare rs_end; the rest of the
+ * comparison is done once, on the element the search ends on.
+ */
+/* BEGIN CSTYLED */
+#define	RANGE_TREE_FIND_IN_BUF_FUNC(NAME, T)				\
+_Pragma("GCC diagnostic push")						\
+_Pragma("GCC diagnostic ignored \"-Wunknown-pragmas\"")			\
+static void *								\
+NAME(zfs_btree_t *tree, uint8_t *buf, uint32_t nelems,			\
+    const void *value, zfs_btree_index_t *where)			\
+{									\
+	const T *r = value;						\
+	T *i = (T *)buf;						\
+	(void) tree;							\
+	_Pragma("GCC unroll 9")						\
+	while (nelems > 1) {						\
+		uint32_t half = nelems / 2;				\
+		nelems -= half;						\
+		i += (i[half - 1].rs_end <= r->rs_start) * half;	\
+	}								\
+									\
+	if (i->rs_end <= r->rs_start) {					\
+		where->bti_offset = (i - (T *)buf) + 1;			\
+		where->bti_before = B_TRUE;				\
+		return (NULL);						\
+	}								\
+	where->bti_offset = i - (T *)buf;				\
+	where->bti_before = (i->rs_start >= r->rs_end);			\
+									\
+	return (where->bti_before ? NULL : i);				\
+}									\
+_Pragma("GCC diagnostic pop")
+/* END CSTYLED */
+
+RANGE_TREE_FIND_IN_BUF_FUNC(range_tree_seg32_find_in_buf, range_seg32_t)
+RANGE_TREE_FIND_IN_BUF_FUNC(range_tree_seg64_find_in_buf, range_seg64_t)
+RANGE_TREE_FIND_IN_BUF_FUNC(range_tree_seg_gap_find_in_buf, range_seg_gap_t)
 
 range_tree_t *
 range_tree_create_gap(const range_tree_ops_t *ops, range_seg_type_t type,
@@ -291,12 +325,12 @@ static void
 range_tree_add_impl(void *arg, uint64_t start, uint64_t size, uint64_t fill)
 {
 	range_tree_t *rt = arg;
-	zfs_btree_index_t where;
-	range_seg_t *rs_before, *rs_after, *rs;
+	zfs_btree_index_t where, where_before, where_after;
+	range_seg_t *rs_before, *rs_after, *rs = NULL;
 	range_seg_max_t tmp, rsearch;
 	uint64_t end = start + size, gap = rt->rt_gap;
 	uint64_t bridge_size = 0;
-	boolean_t merge_before, merge_after;
+	boolean_t merge_before, merge_after, append;
 
 	ASSERT3U(size, !=, 0);
 	ASSERT3U(fill, <=, size);
@@ -304,7 +338,23 @@ range_tree_add_impl(void *arg, uint64_t start, uint64_t size, uint64_t fill)
 
 	rs_set_start(&rsearch, rt, start);
 	rs_set_end(&rsearch, rt, end);
-	rs = zfs_btree_find(&rt->rt_root, &rsearch, &where);
+
+	/*
+	 * Sorted input, such as one range tree being walked into another,
+	 * mostly adds segments after the last one in the tree. Check for
+	 * that first, since then neither the search nor the lookup of the
+	 * new segment's neighbors is needed.
+	 */
+	rs_before = zfs_btree_last(&rt->rt_root, &where_before);
+	append = (rs_before != NULL && rs_get_end(rs_before, rt) <= start);
+	if (append) {
+		where = where_before;
+		where.bti_offset++;
+		where.bti_before = B_TRUE;
+		rs_after = NULL;
+	} else {
+		rs = zfs_btree_find(&rt->rt_root, &rsearch, &where);
+	}
 
 	/*
 	 * If this is a gap-supporting range tree, it is possible that we
@@ -351,9 +401,10 @@ range_tree_add_impl(void *arg, uint64_t start, uint64_t size, uint64_t fill)
 	 * If gap != 0, we might need to merge with our neighbors even if we
 	 * aren't directly touching.
 	 */
-	zfs_btree_index_t where_before, where_after;
-	rs_before = zfs_btree_prev(&rt->rt_root, &where, &where_before);
-	rs_after = zfs_btree_next(&rt->rt_root, &where, &where_after);
+	if (!append) {
+		rs_before = zfs_btree_prev(&rt->rt_root, &where, &where_before);
+		rs_after = zfs_btree_next(&rt->rt_root, &where, &where_after);
+	}
 
 	merge_before = (rs_before != NULL && rs_get_end(rs_before, rt) >=
 	    start - gap);
@@ -90,6 +90,7 @@
 #include <sys/zfeature.h>
 #include <sys/dsl_destroy.h>
 #include <sys/zvol.h>
+#include <sys/spa_warm.h>
 
 #ifdef	_KERNEL
 #include <sys/fm/protocol.h>
@@ -2084,6 +2085,14 @@ spa_destroy_aux_threads(spa_t *spa)
 		zthr_destroy(spa->spa_raidz_expand_zthr);
 		spa->spa_raidz_expand_zthr = NULL;
 	}
+	if (spa->spa_warm_zthr != NULL) {
+		zthr_destroy(spa->spa_warm_zthr);
+		spa->spa_warm_zthr = NULL;
+	}
+	if (spa->spa_ms_condense_zthr != NULL) {
+		zthr_destroy(spa->spa_ms_condense_zthr);
+		spa->spa_ms_condense_zthr = NULL;
+	}
 }
 
 /*
@@ -3387,6 +3396,9 @@ spa_spawn_aux_threads(spa_t *spa)
 	    zthr_create("z_checkpoint_discard",
 	    spa_checkpoint_discard_thread_check,
 	    spa_checkpoint_discard_thread, spa, minclsyspri);
+
+	spa_start_warm_thread(spa);
+	metaslab_condense_thread_start(spa);
 }
 
 /*
@@ -5612,6 +5624,13 @@ spa_load_impl(spa_t *spa, spa_import_type_t type, const char **ereport)
 		txg_sync_start(spa->spa_dsl_pool);
 		mmp_thread_start(spa);
 
+		/*
+		 * Start loading the best metaslabs of every vdev in the
+		 * background, so that they are ready by the time the first
+		 * allocations come in.
+		 */
+		metaslab_preload_import(spa, B_FALSE);
+
 		/*
 		 * Wait for all claims to sync.  We sync up to the highest
 		 * claimed log block birth time so that claimed log blocks
@@ -9216,6 +9235,14 @@ spa_async_suspend(spa_t *spa)
 	zthr_t *ll_condense_thread = spa->spa_livelist_condense_zthr;
 	if (ll_condense_thread != NULL)
 		zthr_cancel(ll_condense_thread);
+
+	zthr_t *warm_thread = spa->spa_warm_zthr;
+	if (warm_thread != NULL)
+		zthr_cancel(warm_thread);
+
+	zthr_t *ms_condense_thread = spa->spa_ms_condense_zthr;
+	if (ms_condense_thread != NULL)
+		zthr_cancel(ms_condense_thread);
 }
 
 void
@@ -9246,6 +9273,14 @@ spa_async_resume(spa_t *spa)
 	zthr_t *ll_condense_thread = spa->spa_livelist_condense_zthr;
 	if (ll_condense_thread != NULL)
 		zthr_resume(ll_condense_thread);
+
+	zthr_t *warm_thread = spa->spa_warm_zthr;
+	if (warm_thread != NULL)
+		zthr_resume(warm_thread);
+
+	zthr_t *ms_condense_thread = spa->spa_ms_condense_zthr;
+	if (ms_condense_thread != NULL)
+		zthr_resume(ms_condense_thread);
 }
 
 static boolean_t
@@ -1265,14 +1265,12 @@ out:
 
 		spa->spa_unflushed_stats.sus_memused +=
 		    metaslab_unflushed_changes_memused(m);
-
-		if (metaslab_debug_load && m->ms_sm != NULL) {
-			VERIFY0(metaslab_load(m));
-			metaslab_set_selected_txg(m, 0);
-		}
 		mutex_exit(&m->ms_lock);
 	}
 
+	if (metaslab_debug_load)
+		metaslab_preload_import(spa, B_TRUE);
+
 	return (error);
 }
 
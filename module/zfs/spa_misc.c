@@ -397,7 +397,9 @@ static int spa_cpus_per_allocator = 4;
 
 /*
  * Spa active allocator.
- * Valid values are zfs_active_allocator=<dynamic|cursor|new-dynamic>.
+ * Valid values are
+ * zfs_active_allocator=<dynamic|cursor|new-dynamic|segregated>, though
+ * new-dynamic is refused until it works.
  */
 const char *zfs_active_allocator = "dynamic";
 
@@ -712,6 +714,7 @@ spa_add(const char *name, nvlist_t *config, const char *altroot)
 	mutex_init(&spa->spa_vdev_top_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&spa->spa_feat_stats_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&spa->spa_flushed_ms_lock, NULL, MUTEX_DEFAULT, NULL);
+	mutex_init(&spa->spa_ms_condense_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&spa->spa_activities_lock, NULL, MUTEX_DEFAULT, NULL);
 
 	cv_init(&spa->spa_async_cv, NULL, CV_DEFAULT, NULL);
@@ -778,6 +781,8 @@ spa_add(const char *name, nvlist_t *config, const char *altroot)
 	    sizeof (spa_log_sm_t), offsetof(spa_log_sm_t, sls_node));
 	list_create(&spa->spa_log_summary, sizeof (log_summary_entry_t),
 	    offsetof(log_summary_entry_t, lse_node));
+	list_create(&spa->spa_ms_condense_list, sizeof (metaslab_t),
+	    offsetof(metaslab_t, ms_condense_node));
 
 	/*
 	 * Every pool starts with the default cachefile
@@ -875,6 +880,7 @@ spa_remove(spa_t *spa)
 	avl_destroy(&spa->spa_metaslabs_by_flushed);
 	avl_destroy(&spa->spa_sm_logs_by_txg);
 	list_destroy(&spa->spa_log_summary);
+	list_destroy(&spa->spa_ms_condense_list);
 	list_destroy(&spa->spa_config_list);
 	list_destroy(&spa->spa_leaf_list);
 
@@ -902,6 +908,7 @@ spa_remove(spa_t *spa)
 	cv_destroy(&spa->spa_waiters_cv);
 
 	mutex_destroy(&spa->spa_flushed_ms_lock);
+	mutex_destroy(&spa->spa_ms_condense_lock);
 	mutex_destroy(&spa->spa_async_lock);
 	mutex_destroy(&spa->spa_errlist_lock);
 	mutex_destroy(&spa->spa_errlog_lock);
@@ -2600,6 +2607,7 @@ spa_init(spa_mode_t mode)
 	dmu_init();
 	zil_init();
 	vdev_mirror_stat_init();
+	vdev_queue_stat_init();
 	vdev_raidz_math_init();
 	vdev_file_init();
 	zfs_prop_init();
@@ -2624,6 +2632,7 @@ spa_fini(void)
 
 	vdev_file_fini();
 	vdev_mirror_stat_fini();
+	vdev_queue_stat_fini();
 	vdev_raidz_math_fini();
 	chksum_fini();
 	zil_fini();
@@ -446,12 +446,14 @@ spa_txg_history_fini_io(spa_t *spa, txg_stat_t *ts)
 
 /*
  * ==========================================================================
- * SPA TX Assign Histogram Routines
+ * SPA Time Histogram Routines
  * ==========================================================================
  */
 
 /*
- * Tx statistics - Information exported regarding dmu_tx_assign time.
+ * Time histograms - Power of two histograms of the time taken by
+ * dmu_tx_assign() (the "dmu_tx_assign" kstat) and by spa_sync() (the
+ * "txg_sync" kstat).
  */
 
 /*
@@ -460,10 +462,9 @@ spa_txg_history_fini_io(spa_t *spa, txg_stat_t *ts)
  * such that they are not output.
  */
 static int
-spa_tx_assign_update(kstat_t *ksp, int rw)
+spa_time_histogram_update(kstat_t *ksp, int rw)
 {
-	spa_t *spa = ksp->ks_private;
-	spa_history_kstat_t *shk = &spa->spa_stats.tx_assign_histogram;
+	spa_history_kstat_t *shk = ksp->ks_private;
 	int i;
 
 	if (rw == KSTAT_WRITE) {
@@ -482,9 +483,9 @@ spa_tx_assign_update(kstat_t *ksp, int rw)
 }
 
 static void
-spa_tx_assign_init(spa_t *spa)
+spa_time_histogram_init(spa_t *spa, spa_history_kstat_t *shk,
+    const char *kname)
 {
-	spa_history_kstat_t *shk = &spa->spa_stats.tx_assign_histogram;
 	char *name;
 	kstat_named_t *ks;
 	kstat_t *ksp;
@@ -506,7 +507,7 @@ spa_tx_assign_init(spa_t *spa)
 		    (u_longlong_t)1 << i);
 	}
 
-	ksp = kstat_create(name, 0, "dmu_tx_assign", "misc",
+	ksp = kstat_create(name, 0, kname, "misc",
 	    KSTAT_TYPE_NAMED, 0, KSTAT_FLAG_VIRTUAL);
 	shk->kstat = ksp;
 
@@ -515,17 +516,16 @@ spa_tx_assign_init(spa_t *spa)
 		ksp->ks_data = shk->priv;
 		ksp->ks_ndata = shk->count;
 		ksp->ks_data_size = shk->size;
-		ksp->ks_private = spa;
-		ksp->ks_update = spa_tx_assign_update;
+		ksp->ks_private = shk;
+		ksp->ks_update = spa_time_histogram_update;
 		kstat_install(ksp);
 	}
 	kmem_strfree(name);
 }
 
 static void
-spa_tx_assign_destroy(spa_t *spa)
+spa_time_histogram_destroy(spa_history_kstat_t *shk)
 {
-	spa_history_kstat_t *shk = &spa->spa_stats.tx_assign_histogram;
 	kstat_t *ksp;
 
 	ksp = shk->kstat;
@@ -536,18 +536,29 @@ spa_tx_assign_destroy(spa_t *spa)
 	mutex_destroy(&shk->lock);
 }
 
-void
-spa_tx_assign_add_nsecs(spa_t *spa, uint64_t nsecs)
+static void
+spa_time_histogram_add(spa_history_kstat_t *shk, uint64_t nsecs)
 {
-	spa_history_kstat_t *shk = &spa->spa_stats.tx_assign_histogram;
 	uint64_t idx = 0;
 
-	while (((1ULL << idx) < nsecs) && (idx < shk->size - 1))
+	while (((1ULL << idx) < nsecs) && (idx < shk->count - 1))
 		idx++;
 
 	atomic_inc_64(&((kstat_named_t *)shk->priv)[idx].value.ui64);
 }
 
+void
+spa_tx_assign_add_nsecs(spa_t *spa, uint64_t nsecs)
+{
+	spa_time_histogram_add(&spa->spa_stats.tx_assign_histogram, nsecs);
+}
+
+void
+spa_txg_sync_add_nsecs(spa_t *spa, uint64_t nsecs)
+{
+	spa_time_histogram_add(&spa->spa_stats.txg_sync_histogram, nsecs);
+}
+
 /*
  * ==========================================================================
  * SPA MMP History Routines
@@ -903,6 +914,13 @@ static const spa_iostats_t spa_iostats_template = {
 	{ "direct_read_bytes",			KSTAT_DATA_UINT64 },
 	{ "direct_write_count",			KSTAT_DATA_UINT64 },
 	{ "direct_write_bytes",			KSTAT_DATA_UINT64 },
+	{ "warm_saved_blocks",			KSTAT_DATA_UINT64 },
+	{ "warm_restore_blocks",		KSTAT_DATA_UINT64 },
+	{ "warm_restore_issued",		KSTAT_DATA_UINT64 },
+	{ "warm_restore_skipped",		KSTAT_DATA_UINT64 },
+	{ "warm_restore_failed",		KSTAT_DATA_UINT64 },
+	{ "scan_queues_drained",		KSTAT_DATA_UINT64 },
+	{ "scan_queues_held",			KSTAT_DATA_UINT64 },
 };
 
 #define	SPA_IOSTATS_ADD(stat, val) \
@@ -984,6 +1002,38 @@ spa_iostats_write_add(spa_t *spa, uint64_t size, uint64_t iops, uint32_t flags)
 	}
 }
 
+void
+spa_iostats_warm_add(spa_t *spa, uint64_t saved, uint64_t restore,
+    uint64_t issued, uint64_t skipped, uint64_t failed)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.iostats;
+	kstat_t *ksp = shk->kstat;
+
+	if (ksp == NULL)
+		return;
+
+	spa_iostats_t *iostats = ksp->ks_data;
+	SPA_IOSTATS_ADD(warm_saved_blocks, saved);
+	SPA_IOSTATS_ADD(warm_restore_blocks, restore);
+	SPA_IOSTATS_ADD(warm_restore_issued, issued);
+	SPA_IOSTATS_ADD(warm_restore_skipped, skipped);
+	SPA_IOSTATS_ADD(warm_restore_failed, failed);
+}
+
+void
+spa_iostats_scan_add(spa_t *spa, uint64_t drained, uint64_t held)
+{
+	spa_history_kstat_t *shk = &spa->spa_stats.iostats;
+	kstat_t *ksp = shk->kstat;
+
+	if (ksp == NULL)
+		return;
+
+	spa_iostats_t *iostats = ksp->ks_data;
+	SPA_IOSTATS_ADD(scan_queues_drained, drained);
+	SPA_IOSTATS_ADD(scan_queues_held, held);
+}
+
 static int
 spa_iostats_update(kstat_t *ksp, int rw)
 {
@@ -1039,7 +1089,10 @@ spa_stats_init(spa_t *spa)
 {
 	spa_read_history_init(spa);
 	spa_txg_history_init(spa);
-	spa_tx_assign_init(spa);
+	spa_time_histogram_init(spa, &spa->spa_stats.tx_assign_histogram,
+	    "dmu_tx_assign");
+	spa_time_histogram_init(spa, &spa->spa_stats.txg_sync_histogram,
+	    "txg_sync");
 	spa_mmp_history_init(spa);
 	spa_state_init(spa);
 	spa_guid_init(spa);
@@ -1051,7 +1104,8 @@ spa_stats_destroy(spa_t *spa)
 {
 	spa_iostats_destroy(spa);
 	spa_health_destroy(spa);
-	spa_tx_assign_destroy(spa);
+	spa_time_histogram_destroy(&spa->spa_stats.txg_sync_histogram);
+	spa_time_histogram_destroy(&spa->spa_stats.tx_assign_histogram);
 	spa_txg_history_destroy(spa);
 	spa_read_history_destroy(spa);
 	spa_mmp_history_destroy(spa);
@@ -0,0 +1,518 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Warm restart
+ *
+ * After an export/import, reboot or failover the ARC starts out empty and
+ * it can take a long time for a busy pool to reach its steady-state hit
+ * rate again.  When zfs_warm_restart is set, the z_warm zthr periodically
+ * records which blocks of the pool are cached, and after the next import
+ * prefetches them again in the background.
+ *
+ * The list is taken from the dbuf hash table rather than directly from the
+ * ARC: an ARC header only knows the DVA of its block, and a block pointer
+ * remembered from one import may have been freed and reallocated by the
+ * next one.  Instead each cached dbuf is recorded by its logical identity
+ * (dataset, object, level, block id), together with whether its ARC
+ * buffer was in the MFU or the MRU state, and the restore resolves it
+ * through dbuf_prefetch() against the current on-disk state.  Blocks which
+ * have since been freed or whose datasets were destroyed are simply
+ * skipped.
+ *
+ * The list is written to a MOS object referenced from the pool directory
+ * (DMU_POOL_WARM_LIST) every zfs_warm_restart_interval seconds, MFU blocks
+ * first, limited to zfs_warm_restart_max_blocks entries.  Since the
+ * datasets are unmounted and their dbufs evicted before a pool is
+ * exported, the list that survives an export is the last periodic one.
+ *
+ * On import the list is read back in batches.  Each dataset of a batch is
+ * held only while its prefetches are issued, so that it can still be
+ * destroyed while the restore is running; the reads themselves don't need
+ * the holds.  Each batch then waits for its reads to complete before the
+ * next one starts.  The restore is throttled to zfs_warm_restart_rate
+ * bytes per second and can be followed through the warm_* counters of the
+ * pool's iostats kstat.
+ */
+
+#include <sys/zfs_context.h>
+#include <sys/spa_impl.h>
+#include <sys/spa_warm.h>
+#include <sys/dmu.h>
+#include <sys/dmu_objset.h>
+#include <sys/dmu_tx.h>
+#include <sys/dbuf.h>
+#include <sys/dnode.h>
+#include <sys/dsl_pool.h>
+#include <sys/dsl_dataset.h>
+#include <sys/dsl_synctask.h>
+#include <sys/arc.h>
+#include <sys/btree.h>
+#include <sys/zap.h>
+#include <sys/zthr.h>
+
+/*
+ * Record the cached blocks of each pool and prefetch them after import.
+ */
+static int zfs_warm_restart = 0;
+
+/*
+ * Seconds between updates of the on-disk list.
+ */
+static uint_t zfs_warm_restart_interval = 600;
+
+/*
+ * Maximum number of blocks in the list.
+ */
+static uint_t zfs_warm_restart_max_blocks = 128 * 1024;
+
+/*
+ * Maximum rate, in bytes per second, at which the list is restored
+ * (0 = unlimited).
+ */
+static uint64_t zfs_warm_restart_rate = 100 << 20;
+
+/*
+ * Number of list entries restored at a time.
+ */
+#define	SPA_WARM_BATCH	256
+
+typedef struct spa_warm_capture {
+	spa_warm_ent_t	*swc_mfu;
+	spa_warm_ent_t	*swc_mru;
+	uint64_t	swc_nmfu;
+	uint64_t	swc_nmru;
+	uint64_t	swc_max;
+} spa_warm_capture_t;
+
+typedef struct spa_warm_save_arg {
+	void		*swa_buf;
+	uint64_t	swa_size;
+} spa_warm_save_arg_t;
+
+typedef struct spa_warm_restore {
+	kmutex_t	swr_lock;
+	kcondvar_t	swr_cv;
+	uint64_t	swr_pending;
+	uint64_t	swr_issued;	/* counters of the current batch */
+	uint64_t	swr_skipped;
+	uint64_t	swr_failed;
+	uint64_t	swr_bytes;
+	spa_warm_ent_t	swr_ents[SPA_WARM_BATCH];
+} spa_warm_restore_t;
+
+static int
+spa_warm_ent_compare(const void *x1, const void *x2)
+{
+	const spa_warm_ent_t *e1 = x1;
+	const spa_warm_ent_t *e2 = x2;
+
+	int cmp = TREE_CMP(e1->swe_objset, e2->swe_objset);
+	if (likely(cmp))
+		return (cmp);
+
+	cmp = TREE_CMP(e1->swe_object, e2->swe_object);
+	if (likely(cmp))
+		return (cmp);
+
+	cmp = TREE_CMP(e2->swe_blkid >> SPA_WARM_LEVEL_SHIFT,
+	    e1->swe_blkid >> SPA_WARM_LEVEL_SHIFT);
+	if (likely(cmp))
+		return (cmp);
+
+	return (TREE_CMP(e1->swe_blkid, e2->swe_blkid));
+}
+
+/*
+ * Called by dbuf_walk() with the dbuf's hash chain lock and db_mtx held.
+ */
+static void
+spa_warm_capture_cb(dmu_buf_impl_t *db, void *arg)
+{
+	spa_warm_capture_t *swc = arg;
+	arc_buf_info_t abi = { 0 };
+	spa_warm_ent_t *swe;
+
+	if (db->db_state != DB_CACHED || db->db_buf == NULL ||
+	    db->db_blkid == DMU_BONUS_BLKID ||
+	    db->db_blkid == DMU_SPILL_BLKID ||
+	    db->db_objset->os_dsl_dataset == NULL)
+		return;
+
+	arc_buf_info(db->db_buf, &abi, 0);
+	if (abi.abi_state_type == ARC_STATE_MFU) {
+		if (swc->swc_nmfu == swc->swc_max)
+			return;
+		swe = &swc->swc_mfu[swc->swc_nmfu++];
+	} else if (abi.abi_state_type == ARC_STATE_MRU) {
+		if (swc->swc_nmfu + swc->swc_nmru >= swc->swc_max)
+			return;
+		swe = &swc->swc_mru[swc->swc_nmru++];
+	} else {
+		return;
+	}
+
+	swe->swe_objset = dmu_objset_id(db->db_objset);
+	swe->swe_object = db->db.db_object;
+	swe->swe_blkid = ((uint64_t)db->db_level << SPA_WARM_LEVEL_SHIFT) |
+	    db->db_blkid;
+}
+
+/*
+ * Sort the captured entries and append them to the list buffer.
+ */
+static spa_warm_ent_t *
+spa_warm_sort(spa_warm_ent_t *out, spa_warm_ent_t *in, uint64_t count)
+{
+	zfs_btree_t tree;
+	zfs_btree_index_t where;
+
+	zfs_btree_create(&tree, spa_warm_ent_compare, NULL,
+	    sizeof (spa_warm_ent_t));
+	for (uint64_t i = 0; i < count; i++) {
+		if (zfs_btree_find(&tree, &in[i], &where) == NULL)
+			zfs_btree_add_idx(&tree, &in[i], &where);
+	}
+
+	for (spa_warm_ent_t *swe = zfs_btree_first(&tree, &where);
+	    swe != NULL; swe = zfs_btree_next(&tree, &where, &where)) {
+		*out++ = *swe;
+	}
+
+	zfs_btree_clear(&tree);
+	zfs_btree_destroy(&tree);
+
+	return (out);
+}
+
+static void
+spa_warm_save_sync(void *arg, dmu_tx_t *tx)
+{
+	spa_warm_save_arg_t *swa = arg;
+	spa_t *spa = dmu_tx_pool(tx)->dp_spa;
+	objset_t *mos = spa->spa_meta_objset;
+	uint64_t obj;
+
+	if (zap_lookup(mos, DMU_POOL_DIRECTORY_OBJECT, DMU_POOL_WARM_LIST,
+	    sizeof (obj), 1, &obj) == 0) {
+		VERIFY0(dmu_object_free(mos, obj, tx));
+	}
+
+	obj = dmu_object_alloc(mos, DMU_OTN_UINT64_METADATA,
+	    SPA_OLD_MAXBLOCKSIZE, DMU_OT_NONE, 0, tx);
+	dmu_write(mos, obj, 0, swa->swa_size, swa->swa_buf, tx);
+	VERIFY0(zap_update(mos, DMU_POOL_DIRECTORY_OBJECT, DMU_POOL_WARM_LIST,
+	    sizeof (obj), 1, &obj, tx));
+}
+
+static void
+spa_warm_save(spa_t *spa)
+{
+	spa_warm_capture_t swc = { 0 };
+
+	swc.swc_max = zfs_warm_restart_max_blocks;
+	if (swc.swc_max == 0)
+		return;
+
+	size_t entsz = swc.swc_max * sizeof (spa_warm_ent_t);
+	swc.swc_mfu = vmem_alloc(entsz, KM_SLEEP);
+	swc.swc_mru = vmem_alloc(entsz, KM_SLEEP);
+
+	dbuf_walk(spa, spa_warm_capture_cb, &swc);
+
+	/*
+	 * MRU entries were only taken while there was room for them, but
+	 * MFU entries found afterwards may since have used it up.
+	 */
+	swc.swc_nmru = MIN(swc.swc_nmru, swc.swc_max - swc.swc_nmfu);
+
+	spa_warm_save_arg_t swa;
+	swa.swa_size = sizeof (spa_warm_phys_t) +
+	    (swc.swc_nmfu + swc.swc_nmru) * sizeof (spa_warm_ent_t);
+	swa.swa_buf = vmem_alloc(swa.swa_size, KM_SLEEP);
+
+	spa_warm_phys_t *swp = swa.swa_buf;
+	spa_warm_ent_t *swe = (spa_warm_ent_t *)(swp + 1);
+	swe = spa_warm_sort(swe, swc.swc_mfu, swc.swc_nmfu);
+	swp->swp_mfu = swe - (spa_warm_ent_t *)(swp + 1);
+	swe = spa_warm_sort(swe, swc.swc_mru, swc.swc_nmru);
+	swp->swp_count = swe - (spa_warm_ent_t *)(swp + 1);
+	swp->swp_magic = SPA_WARM_MAGIC;
+	swa.swa_size = (uintptr_t)swe - (uintptr_t)swp;
+
+	vmem_free(swc.swc_mfu, entsz);
+	vmem_free(swc.swc_mru, entsz);
+
+	int error = dsl_sync_task(spa_name(spa), NULL, spa_warm_save_sync,
+	    &swa, swa.swa_size >> SPA_OLD_MAXBLOCKSHIFT,
+	    ZFS_SPACE_CHECK_NORMAL);
+	if (error == 0) {
+		spa_iostats_warm_add(spa, swp->swp_count, 0, 0, 0, 0);
+	} else {
+		zfs_dbgmsg("spa=%s warm list update failed, error=%d",
+		    spa_name(spa), error);
+	}
+
+	vmem_free(swa.swa_buf, sizeof (spa_warm_phys_t) +
+	    (swc.swc_nmfu + swc.swc_nmru) * sizeof (spa_warm_ent_t));
+}
+
+static void
+spa_warm_prefetch_done(void *arg, uint64_t level, uint64_t blkid,
+    boolean_t issued)
+{
+	(void) level, (void) blkid, (void) issued;
+	spa_warm_restore_t *swr = arg;
+
+	mutex_enter(&swr->swr_lock);
+	ASSERT3U(swr->swr_pending, >, 0);
+	if (--swr->swr_pending == 0)
+		cv_broadcast(&swr->swr_cv);
+	mutex_exit(&swr->swr_lock);
+}
+
+/*
+ * Issue the prefetches for a run of list entries which all belong to the
+ * same dataset.  The dataset and each dnode are only held while their
+ * prefetches are issued.
+ */
+static void
+spa_warm_restore_ds(dsl_pool_t *dp, spa_warm_restore_t *swr,
+    const spa_warm_ent_t *ents, uint64_t count)
+{
+	dsl_dataset_t *ds;
+	objset_t *os;
+
+	dsl_pool_config_enter(dp, FTAG);
+	if (dsl_dataset_hold_obj(dp, ents[0].swe_objset, FTAG, &ds) != 0) {
+		dsl_pool_config_exit(dp, FTAG);
+		swr->swr_failed += count;
+		return;
+	}
+	if (dmu_objset_from_ds(ds, &os) != 0) {
+		dsl_dataset_rele(ds, FTAG);
+		dsl_pool_config_exit(dp, FTAG);
+		swr->swr_failed += count;
+		return;
+	}
+	dsl_dataset_long_hold(ds, FTAG);
+	dsl_pool_config_exit(dp, FTAG);
+
+	dnode_t *dn = NULL;
+	boolean_t held = B_FALSE;
+
+	for (uint64_t i = 0; i < count; i++) {
+		const spa_warm_ent_t *swe = &ents[i];
+		int64_t level = swe->swe_blkid >> SPA_WARM_LEVEL_SHIFT;
+		uint64_t blkid = swe->swe_blkid &
+		    ((1ULL << SPA_WARM_LEVEL_SHIFT) - 1);
+
+		ASSERT3U(swe->swe_objset, ==, ents[0].swe_objset);
+		if (i == 0 || swe->swe_object != ents[i - 1].swe_object) {
+			if (held)
+				dnode_rele(dn, FTAG);
+			held = B_FALSE;
+			dn = NULL;
+			if (swe->swe_object == DMU_META_DNODE_OBJECT)
+				dn = DMU_META_DNODE(os);
+			else if (dnode_hold(os, swe->swe_object, FTAG,
+			    &dn) == 0)
+				held = B_TRUE;
+			else
+				dn = NULL;
+		}
+
+		if (dn == NULL) {
+			swr->swr_failed++;
+			continue;
+		}
+
+		mutex_enter(&swr->swr_lock);
+		swr->swr_pending++;
+		mutex_exit(&swr->swr_lock);
+
+		rw_enter(&dn->dn_struct_rwlock, RW_READER);
+		if (dbuf_prefetch_impl(dn, level, blkid,
+		    ZIO_PRIORITY_ASYNC_READ, 0, spa_warm_prefetch_done,
+		    swr) != 0) {
+			swr->swr_issued++;
+			swr->swr_bytes += (level == 0) ? dn->dn_datablksz :
+			    1ULL << dn->dn_indblkshift;
+		} else {
+			swr->swr_skipped++;
+		}
+		rw_exit(&dn->dn_struct_rwlock);
+	}
+
+	if (held)
+		dnode_rele(dn, FTAG);
+	dsl_dataset_long_rele(ds, FTAG);
+	dsl_dataset_rele(ds, FTAG);
+}
+
+/*
+ * Prefetch one batch of list entries.  Returns the number of bytes for
+ * which reads were issued.
+ */
+static uint64_t
+spa_warm_restore_batch(spa_t *spa, spa_warm_restore_t *swr, uint64_t count)
+{
+	const spa_warm_ent_t *ents = swr->swr_ents;
+
+	ASSERT3U(count, <=, SPA_WARM_BATCH);
+
+	swr->swr_issued = swr->swr_skipped = swr->swr_failed = 0;
+	swr->swr_bytes = 0;
+
+	/* The list is sorted, so each dataset's entries are together. */
+	for (uint64_t i = 0, end; i < count; i = end) {
+		for (end = i + 1; end < count &&
+		    ents[end].swe_objset == ents[i].swe_objset; end++)
+			;
+		spa_warm_restore_ds(spa_get_dsl(spa), swr, &ents[i], end - i);
+	}
+
+	mutex_enter(&swr->swr_lock);
+	while (swr->swr_pending > 0)
+		cv_wait(&swr->swr_cv, &swr->swr_lock);
+	mutex_exit(&swr->swr_lock);
+
+	spa_iostats_warm_add(spa, 0, 0, swr->swr_issued, swr->swr_skipped,
+	    swr->swr_failed);
+
+	return (swr->swr_bytes);
+}
+
+static void
+spa_warm_restore(spa_t *spa, zthr_t *zthr)
+{
+	objset_t *mos = spa->spa_meta_objset;
+	spa_warm_phys_t swp;
+	uint64_t obj;
+
+	if (zap_lookup(mos, DMU_POOL_DIRECTORY_OBJECT, DMU_POOL_WARM_LIST,
+	    sizeof (obj), 1, &obj) != 0 ||
+	    dmu_read(mos, obj, 0, sizeof (swp), &swp, DMU_READ_PREFETCH) != 0 ||
+	    swp.swp_magic != SPA_WARM_MAGIC) {
+		spa->spa_warm_restore_pending = B_FALSE;
+		return;
+	}
+
+	if (spa->spa_warm_restore_pos == 0)
+		spa_iostats_warm_add(spa, 0, swp.swp_count, 0, 0, 0);
+
+	spa_warm_restore_t *swr = kmem_zalloc(sizeof (*swr), KM_SLEEP);
+	mutex_init(&swr->swr_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&swr->swr_cv, NULL, CV_DEFAULT, NULL);
+
+	hrtime_t start = gethrtime();
+	uint64_t bytes = 0;
+
+	while (spa->spa_warm_restore_pos < swp.swp_count &&
+	    !zthr_iscancelled(zthr)) {
+		uint64_t pos = spa->spa_warm_restore_pos;
+		uint64_t n = MIN(SPA_WARM_BATCH, swp.swp_count - pos);
+
+		if (dmu_read(mos, obj, sizeof (swp) +
+		    pos * sizeof (spa_warm_ent_t), n * sizeof (spa_warm_ent_t),
+		    swr->swr_ents, DMU_READ_PREFETCH) != 0)
+			break;
+
+		bytes += spa_warm_restore_batch(spa, swr, n);
+		spa->spa_warm_restore_pos += n;
+
+		/* Throttle to zfs_warm_restart_rate. */
+		uint64_t rate = zfs_warm_restart_rate;
+		while (rate != 0 && !zthr_iscancelled(zthr) &&
+		    gethrtime() - start < (hrtime_t)(bytes / rate * NANOSEC +
+		    (bytes % rate) * NANOSEC / rate)) {
+			delay(MAX(hz / 10, 1));
+		}
+	}
+
+	if (!zthr_iscancelled(zthr))
+		spa->spa_warm_restore_pending = B_FALSE;
+
+	cv_destroy(&swr->swr_cv);
+	mutex_destroy(&swr->swr_lock);
+	kmem_free(swr, sizeof (*swr));
+}
+
+static boolean_t
+spa_warm_thread_check(void *arg, zthr_t *zthr)
+{
+	(void) zthr;
+	spa_t *spa = arg;
+
+	/*
+	 * Wait for the load to finish: the dataset holds taken here would
+	 * otherwise be counted in spa_minref.
+	 */
+	if (!zfs_warm_restart || spa->spa_load_state != SPA_LOAD_NONE)
+		return (B_FALSE);
+
+	if (spa->spa_warm_restore_pending)
+		return (B_TRUE);
+
+	return (spa_writeable(spa) && zfs_warm_restart_interval != 0 &&
+	    gethrtime() - spa->spa_warm_last_save >=
+	    SEC2NSEC(zfs_warm_restart_interval));
+}
+
+static void
+spa_warm_thread(void *arg, zthr_t *zthr)
+{
+	spa_t *spa = arg;
+
+	if (spa->spa_warm_restore_pending) {
+		spa_warm_restore(spa, zthr);
+		spa->spa_warm_last_save = gethrtime();
+		return;
+	}
+
+	spa_warm_save(spa);
+	spa->spa_warm_last_save = gethrtime();
+}
+
+void
+spa_start_warm_thread(spa_t *spa)
+{
+	ASSERT3P(spa->spa_warm_zthr, ==, NULL);
+
+	spa->spa_warm_restore_pending = (zfs_warm_restart != 0);
+	spa->spa_warm_restore_pos = 0;
+	spa->spa_warm_last_save = gethrtime();
+	spa->spa_warm_zthr = zthr_create_timer("z_warm",
+	    spa_warm_thread_check, spa_warm_thread, spa, SEC2NSEC(1),
+	    minclsyspri);
+}
+
+ZFS_MODULE_PARAM(zfs, zfs_, warm_restart, INT, ZMOD_RW,
+	"Record cached blocks and prefetch them after import");
+
+ZFS_MODULE_PARAM(zfs, zfs_, warm_restart_interval, UINT, ZMOD_RW,
+	"Seconds between updates of the warm restart list");
+
+ZFS_MODULE_PARAM(zfs, zfs_, warm_restart_max_blocks, UINT, ZMOD_RW,
+	"Max number of blocks in the warm restart list");
+
+ZFS_MODULE_PARAM(zfs, zfs_, warm_restart_rate, U64, ZMOD_RW,
+	"Max bytes per second prefetched when restoring the warm restart list");
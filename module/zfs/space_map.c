@@ -539,6 +539,66 @@ space_map_write_intro_debug(space_map_t *sm, maptype_t maptype, dmu_tx_t *tx)
 	sm->sm_phys->smp_length += sizeof (dentry);
 }
 
+/*
+ * Encodes a single space map entry of the given number of words at entry.
+ */
+static void
+space_map_encode_entry(uint64_t *entry, uint64_t start, uint64_t run_len,
+    maptype_t maptype, uint64_t vdev_id, uint8_t words)
+{
+	switch (words) {
+	case 1:
+		entry[0] = SM_OFFSET_ENCODE(start) |
+		    SM_TYPE_ENCODE(maptype) |
+		    SM_RUN_ENCODE(run_len);
+		break;
+	case 2:
+		entry[0] = SM_PREFIX_ENCODE(SM2_PREFIX) |
+		    SM2_RUN_ENCODE(run_len) |
+		    SM2_VDEV_ENCODE(vdev_id);
+		entry[1] = SM2_TYPE_ENCODE(maptype) |
+		    SM2_OFFSET_ENCODE(start);
+		break;
+	default:
+		panic("%d-word space map entries are not supported",
+		    words);
+		break;
+	}
+}
+
+/*
+ * Returns the number of words to use for the entries of a segment at the
+ * given offset and of the given length, both in units of the space map's
+ * shift.
+ */
+static uint8_t
+space_map_entry_words(spa_t *spa, uint64_t offset, uint64_t length,
+    uint64_t vdev_id)
+{
+	/*
+	 * We only write two-word entries when both of the following
+	 * are true:
+	 *
+	 * [1] The feature is enabled.
+	 * [2] The offset or run is too big for a single-word entry,
+	 *	or the vdev_id is set (meaning not equal to
+	 *	SM_NO_VDEVID).
+	 *
+	 * Note that for purposes of testing we've added the case that
+	 * we write two-word entries occasionally when the feature is
+	 * enabled and zfs_force_some_double_word_sm_entries has been
+	 * set.
+	 */
+	if (spa_feature_is_active(spa, SPA_FEATURE_SPACEMAP_V2) &&
+	    (offset >= (1ULL << SM_OFFSET_BITS) ||
+	    length > SM_RUN_MAX ||
+	    vdev_id != SM_NO_VDEVID ||
+	    (zfs_force_some_double_word_sm_entries &&
+	    random_in_range(100) == 0)))
+		return (2);
+	return (1);
+}
+
 /*
  * Writes one or more entries given a segment.
  *
@@ -628,31 +688,10 @@ space_map_write_seg(space_map_t *sm, uint64_t rstart, uint64_t rend,
 		}
 
 		uint64_t run_len = MIN(size, run_max);
-		switch (words) {
-		case 1:
-			*block_cursor = SM_OFFSET_ENCODE(start) |
-			    SM_TYPE_ENCODE(maptype) |
-			    SM_RUN_ENCODE(run_len);
-			block_cursor++;
-			break;
-		case 2:
-			/* write the first word of the entry */
-			*block_cursor = SM_PREFIX_ENCODE(SM2_PREFIX) |
-			    SM2_RUN_ENCODE(run_len) |
-			    SM2_VDEV_ENCODE(vdev_id);
-			block_cursor++;
-
-			/* move on to the second word of the entry */
-			ASSERT3P(block_cursor, <, block_end);
-			*block_cursor = SM2_TYPE_ENCODE(maptype) |
-			    SM2_OFFSET_ENCODE(start);
-			block_cursor++;
-			break;
-		default:
-			panic("%d-word space map entries are not supported",
-			    words);
-			break;
-		}
+		ASSERT3P(block_cursor + words, <=, block_end);
+		space_map_encode_entry(block_cursor, start, run_len, maptype,
+		    vdev_id, words);
+		block_cursor += words;
 		sm->sm_phys->smp_length += words * sizeof (uint64_t);
 
 		start += run_len;
@@ -706,29 +745,8 @@ space_map_write_impl(space_map_t *sm, range_tree_t *rt, maptype_t maptype,
 		    sm->sm_shift;
 		uint64_t length = (rs_get_end(rs, rt) - rs_get_start(rs, rt)) >>
 		    sm->sm_shift;
-		uint8_t words = 1;
-
-		/*
-		 * We only write two-word entries when both of the following
-		 * are true:
-		 *
-		 * [1] The feature is enabled.
-		 * [2] The offset or run is too big for a single-word entry,
-		 *	or the vdev_id is set (meaning not equal to
-		 *	SM_NO_VDEVID).
-		 *
-		 * Note that for purposes of testing we've added the case that
-		 * we write two-word entries occasionally when the feature is
-		 * enabled and zfs_force_some_double_word_sm_entries has been
-		 * set.
-		 */
-		if (spa_feature_is_active(spa, SPA_FEATURE_SPACEMAP_V2) &&
-		    (offset >= (1ULL << SM_OFFSET_BITS) ||
-		    length > SM_RUN_MAX ||
-		    vdev_id != SM_NO_VDEVID ||
-		    (zfs_force_some_double_word_sm_entries &&
-		    random_in_range(100) == 0)))
-			words = 2;
+		uint8_t words = space_map_entry_words(spa, offset, length,
+		    vdev_id);
 
 		space_map_write_seg(sm, rs_get_start(rs, rt), rs_get_end(rs,
 		    rt), maptype, vdev_id, words, &db, FTAG, tx);
@@ -791,6 +809,130 @@ space_map_write(space_map_t *sm, range_tree_t *rt, maptype_t maptype,
 	VERIFY3U(range_tree_space(rt), ==, rt_space);
 }
 
+/*
+ * Encodes the segments of rt as entries of the given type, the way
+ * space_map_write() would, into buf, which holds nwords words.  Returns the
+ * number of words used.  The space map object is not touched, so this can
+ * be called in open context; the entries are appended to the space map
+ * later with space_map_write_encoded().  A buffer of the size returned by
+ * space_map_estimate_optimal_size() is always large enough.
+ */
+uint64_t
+space_map_encode(space_map_t *sm, range_tree_t *rt, maptype_t maptype,
+    uint64_t *buf, uint64_t nwords)
+{
+	spa_t *spa = dmu_objset_spa(sm->sm_os);
+	uint64_t *cursor = buf;
+	uint64_t *end = buf + nwords;
+
+	zfs_btree_t *t = &rt->rt_root;
+	zfs_btree_index_t where;
+	for (range_seg_t *rs = zfs_btree_first(t, &where); rs != NULL;
+	    rs = zfs_btree_next(t, &where, &where)) {
+		uint64_t start = (rs_get_start(rs, rt) - sm->sm_start) >>
+		    sm->sm_shift;
+		uint64_t size = (rs_get_end(rs, rt) - rs_get_start(rs, rt)) >>
+		    sm->sm_shift;
+		uint8_t words = space_map_entry_words(spa, start, size,
+		    SM_NO_VDEVID);
+		uint64_t run_max = (words == 2) ? SM2_RUN_MAX : SM_RUN_MAX;
+
+		while (size != 0) {
+			uint64_t run_len = MIN(size, run_max);
+
+			VERIFY3P(cursor + words, <=, end);
+			space_map_encode_entry(cursor, start, run_len, maptype,
+			    SM_NO_VDEVID, words);
+			cursor += words;
+			start += run_len;
+			size -= run_len;
+		}
+	}
+
+	return (cursor - buf);
+}
+
+/*
+ * Appends nwords words of entries encoded by space_map_encode() to the
+ * space map.  The entries must all be of the given type and describe
+ * space bytes in total.  This only copies the entries into the space
+ * map's blocks, padding the end of a block where a two-word entry does not
+ * fit, so it is much cheaper than space_map_write() for a large tree.
+ */
+void
+space_map_write_encoded(space_map_t *sm, const uint64_t *buf,
+    uint64_t nwords, maptype_t maptype, uint64_t space, dmu_tx_t *tx)
+{
+	ASSERT(dsl_pool_sync_context(dmu_objset_pool(sm->sm_os)));
+	VERIFY3U(space_map_object(sm), !=, 0);
+
+	dmu_buf_will_dirty(sm->sm_dbuf, tx);
+	sm->sm_phys->smp_object = sm->sm_object;
+
+	if (nwords == 0)
+		return;
+
+	if (maptype == SM_ALLOC)
+		sm->sm_phys->smp_alloc += space;
+	else
+		sm->sm_phys->smp_alloc -= space;
+
+	space_map_write_intro_debug(sm, maptype, tx);
+
+	dmu_buf_t *db;
+	VERIFY0(dmu_buf_hold(sm->sm_os, space_map_object(sm),
+	    sm->sm_phys->smp_length, FTAG, &db, DMU_READ_PREFETCH));
+	dmu_buf_will_dirty(db, tx);
+
+	uint64_t i = 0;
+	while (i < nwords) {
+		ASSERT3U(db->db_size, ==, sm->sm_blksz);
+		uint64_t *block_base = db->db_data;
+		uint64_t first = (sm->sm_phys->smp_length - db->db_offset) /
+		    sizeof (uint64_t);
+		uint64_t avail = sm->sm_blksz / sizeof (uint64_t) - first;
+
+		if (avail == 0) {
+			dmu_buf_rele(db, FTAG);
+			VERIFY0(dmu_buf_hold(sm->sm_os, space_map_object(sm),
+			    sm->sm_phys->smp_length, FTAG, &db,
+			    DMU_READ_PREFETCH));
+			dmu_buf_will_dirty(db, tx);
+			continue;
+		}
+
+		/* Copy as many whole entries as fit in this block. */
+		uint64_t j = i;
+		while (j < nwords) {
+			uint64_t words =
+			    sm_entry_is_double_word(buf[j]) ? 2 : 1;
+			if (j + words - i > avail)
+				break;
+			j += words;
+		}
+		uint64_t copied = (j - i) * sizeof (uint64_t);
+		memcpy(block_base + first, buf + i, copied);
+		sm->sm_phys->smp_length += copied;
+
+		/*
+		 * If a two-word entry did not fit in the last word of the
+		 * block, pad it with an empty debug entry, as
+		 * space_map_write_seg() does.
+		 */
+		if (j < nwords && j - i == avail - 1) {
+			block_base[first + avail - 1] =
+			    SM_PREFIX_ENCODE(SM_DEBUG_PREFIX) |
+			    SM_DEBUG_ACTION_ENCODE(0) |
+			    SM_DEBUG_SYNCPASS_ENCODE(0) |
+			    SM_DEBUG_TXG_ENCODE(0);
+			sm->sm_phys->smp_length += sizeof (uint64_t);
+		}
+		i = j;
+	}
+
+	dmu_buf_rele(db, FTAG);
+}
+
 static int
 space_map_open_impl(space_map_t *sm)
 {
@@ -598,9 +598,11 @@ txg_sync_thread(void *arg)
 		mutex_exit(&tx->tx_sync_lock);
 
 		txg_stat_t *ts = spa_txg_history_init_io(spa, txg, dp);
+		hrtime_t sync_start = gethrtime();
 		start = ddi_get_lbolt();
 		spa_sync(spa, txg);
 		delta = ddi_get_lbolt() - start;
+		spa_txg_sync_add_nsecs(spa, gethrtime() - sync_start);
 		spa_txg_history_fini_io(spa, ts);
 
 		mutex_enter(&tx->tx_sync_lock);
@@ -1547,33 +1547,54 @@ vdev_metaslab_init(vdev_t *vd, uint64_t txg)
 	vd->vdev_ms = mspp;
 	vd->vdev_ms_count = newc;
 
-	for (uint64_t m = oldc; m < newc; m++) {
-		uint64_t object = 0;
-		/*
-		 * vdev_ms_array may be 0 if we are creating the "fake"
-		 * metaslabs for an indirect vdev for zdb's leak detection.
-		 * See zdb_leak_init().
-		 */
-		if (txg == 0 && vd->vdev_ms_array != 0) {
-			error = dmu_read(spa->spa_meta_objset,
-			    vd->vdev_ms_array,
-			    m * sizeof (uint64_t), sizeof (uint64_t), &object,
-			    DMU_READ_PREFETCH);
-			if (error != 0) {
-				vdev_dbgmsg(vd, "unable to read the metaslab "
-				    "array [error=%d]", error);
-				return (error);
+	/*
+	 * Read the space map object numbers of all new metaslabs at once
+	 * and prefetch their dnodes, so that the space_map_open() calls
+	 * from metaslab_init() below find them cached instead of waiting
+	 * for one dnode block read per metaslab.
+	 *
+	 * vdev_ms_array may be 0 if we are creating the "fake" metaslabs
+	 * for an indirect vdev for zdb's leak detection.  See
+	 * zdb_leak_init().
+	 */
+	uint64_t *objects = NULL;
+	if (txg == 0 && vd->vdev_ms_array != 0) {
+		objects = vmem_zalloc((newc - oldc) * sizeof (uint64_t),
+		    KM_SLEEP);
+		error = dmu_read(spa->spa_meta_objset, vd->vdev_ms_array,
+		    oldc * sizeof (uint64_t), (newc - oldc) * sizeof (uint64_t),
+		    objects, DMU_READ_PREFETCH);
+		if (error != 0) {
+			vdev_dbgmsg(vd, "unable to read the metaslab "
+			    "array [error=%d]", error);
+			vmem_free(objects, (newc - oldc) * sizeof (uint64_t));
+			return (error);
+		}
+		for (uint64_t m = 0; m < newc - oldc; m++) {
+			if (objects[m] != 0) {
+				dmu_prefetch_dnode(spa->spa_meta_objset,
+				    objects[m], ZIO_PRIORITY_SYNC_READ);
 			}
 		}
+	}
+
+	for (uint64_t m = oldc; m < newc; m++) {
+		uint64_t object = (objects != NULL) ? objects[m - oldc] : 0;
 
 		error = metaslab_init(vd->vdev_mg, m, object, txg,
 		    &(vd->vdev_ms[m]));
 		if (error != 0) {
 			vdev_dbgmsg(vd, "metaslab_init failed [error=%d]",
 			    error);
+			if (objects != NULL) {
+				vmem_free(objects,
+				    (newc - oldc) * sizeof (uint64_t));
+			}
 			return (error);
 		}
 	}
+	if (objects != NULL)
+		vmem_free(objects, (newc - oldc) * sizeof (uint64_t));
 
 	/*
 	 * Find the emptiest metaslab on the vdev and mark it for use for
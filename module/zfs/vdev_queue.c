@@ -115,6 +115,19 @@
  * maximum percentage, this indicates that the rate of incoming data is
  * greater than the rate that the backend storage can handle. In this case, we
  * must further throttle incoming writes (see dmu_tx_delay() for details).
+ *
+ * Deadlines
+ *
+ * The min/max active limits bound how many I/Os of each class are in flight,
+ * but not how long any one of them has been queued.  A sync read can still
+ * wait behind a long burst of aggregated async writes that were issued while
+ * the sync read class was at its maximum.  When zfs_vdev_deadline is set,
+ * each I/O of a class with a non-zero deadline (sync read, sync write and
+ * async read) must be issued within that many milliseconds of being queued.
+ * Before applying the min/max active rules, the scheduler checks the oldest
+ * queued I/O of each such class, and if its deadline has passed it issues
+ * from that class even if the class is already at its max_active.  Only the
+ * aggregate zfs_vdev_max_active limit still applies.
  */
 
 /*
@@ -160,6 +173,16 @@ static uint_t zfs_vdev_trim_max_active = 2;
 static uint_t zfs_vdev_rebuild_min_active = 1;
 static uint_t zfs_vdev_rebuild_max_active = 3;
 
+/*
+ * Enable deadline scheduling, and the per-class deadlines in milliseconds
+ * by which a queued I/O must have been issued.  A deadline of 0 disables it
+ * for that class.
+ */
+static int zfs_vdev_deadline = B_FALSE;
+static uint_t zfs_vdev_sync_read_deadline_ms = 50;
+static uint_t zfs_vdev_sync_write_deadline_ms = 50;
+static uint_t zfs_vdev_async_read_deadline_ms = 250;
+
 /*
  * When the pool has less than zfs_vdev_async_write_active_min_dirty_percent
  * dirty data, use zfs_vdev_async_write_min_active.  When it has more than
@@ -228,6 +251,51 @@ uint_t zfs_vdev_queue_depth_pct = 300;
  */
 uint_t zfs_vdev_def_queue_depth = 32;
 
+/*
+ * Vdev queue kstats
+ */
+static kstat_t *vdev_queue_ksp = NULL;
+
+typedef struct vdev_queue_stats {
+	kstat_named_t vdev_queue_stat_sync_read_expired;
+	kstat_named_t vdev_queue_stat_sync_write_expired;
+	kstat_named_t vdev_queue_stat_async_read_expired;
+} vdev_queue_stats_t;
+
+static vdev_queue_stats_t vdev_queue_stats = {
+	/* Sync reads issued past zfs_vdev_sync_read_deadline_ms */
+	{ "sync_read_expired",			KSTAT_DATA_UINT64 },
+	/* Sync writes issued past zfs_vdev_sync_write_deadline_ms */
+	{ "sync_write_expired",			KSTAT_DATA_UINT64 },
+	/* Async reads issued past zfs_vdev_async_read_deadline_ms */
+	{ "async_read_expired",			KSTAT_DATA_UINT64 },
+};
+
+#define	VDEV_QUEUE_STAT(stat)	(vdev_queue_stats.stat.value.ui64)
+#define	VDEV_QUEUE_BUMP(stat)	atomic_inc_64(&VDEV_QUEUE_STAT(stat))
+
+void
+vdev_queue_stat_init(void)
+{
+	vdev_queue_ksp = kstat_create("zfs", 0, "vdev_queue_stats",
+	    "misc", KSTAT_TYPE_NAMED,
+	    sizeof (vdev_queue_stats) / sizeof (kstat_named_t),
+	    KSTAT_FLAG_VIRTUAL);
+	if (vdev_queue_ksp != NULL) {
+		vdev_queue_ksp->ks_data = &vdev_queue_stats;
+		kstat_install(vdev_queue_ksp);
+	}
+}
+
+void
+vdev_queue_stat_fini(void)
+{
+	if (vdev_queue_ksp != NULL) {
+		kstat_delete(vdev_queue_ksp);
+		vdev_queue_ksp = NULL;
+	}
+}
+
 static int
 vdev_queue_offset_compare(const void *x1, const void *x2)
 {
@@ -268,6 +336,26 @@ vdev_queue_class_fifo(zio_priority_t p)
 	    p == ZIO_PRIORITY_TRIM);
 }
 
+/*
+ * The async read class is ordered by offset within VDQ_T_SHIFT (~0.5s)
+ * intervals, which is coarser than its deadline, so its queued i/os are
+ * also kept on a list in io_timestamp order to find the oldest one.  An
+ * i/o can only be older than the tail if its priority was changed.
+ */
+static void
+vdev_queue_deadline_add(vdev_queue_t *vq, zio_t *zio)
+{
+	list_t *list = &vq->vq_async_read_fifo;
+	zio_t *prev = list_tail(list);
+
+	while (prev != NULL && prev->io_timestamp > zio->io_timestamp)
+		prev = list_prev(list, prev);
+	if (prev == NULL)
+		list_insert_head(list, zio);
+	else
+		list_insert_after(list, prev, zio);
+}
+
 static void
 vdev_queue_class_add(vdev_queue_t *vq, zio_t *zio)
 {
@@ -279,6 +367,8 @@ vdev_queue_class_add(vdev_queue_t *vq, zio_t *zio)
 	}
 	else
 		avl_add(&vq->vq_class[p].vqc_tree, zio);
+	if (p == ZIO_PRIORITY_ASYNC_READ)
+		vdev_queue_deadline_add(vq, zio);
 }
 
 static void
@@ -296,6 +386,8 @@ vdev_queue_class_remove(vdev_queue_t *vq, zio_t *zio)
 		avl_remove(tree, zio);
 		empty = avl_is_empty(tree);
 	}
+	if (p == ZIO_PRIORITY_ASYNC_READ)
+		list_remove(&vq->vq_async_read_fifo, zio);
 	vq->vq_cqueued &= ~(empty << p);
 }
 
@@ -425,19 +517,93 @@ vdev_queue_class_max_active(vdev_queue_t *vq, zio_priority_t p)
 	}
 }
 
+static uint_t
+vdev_queue_class_deadline_ms(zio_priority_t p)
+{
+	switch (p) {
+	case ZIO_PRIORITY_SYNC_READ:
+		return (zfs_vdev_sync_read_deadline_ms);
+	case ZIO_PRIORITY_SYNC_WRITE:
+		return (zfs_vdev_sync_write_deadline_ms);
+	case ZIO_PRIORITY_ASYNC_READ:
+		return (zfs_vdev_async_read_deadline_ms);
+	default:
+		return (0);
+	}
+}
+
+#define	VDQ_DEADLINE_CLASSES	((1U << ZIO_PRIORITY_SYNC_READ) | \
+	(1U << ZIO_PRIORITY_SYNC_WRITE) | (1U << ZIO_PRIORITY_ASYNC_READ))
+
+/*
+ * Return the highest priority class whose oldest queued i/o has passed its
+ * deadline, and that i/o in *zp, or ZIO_PRIORITY_NUM_QUEUEABLE if there is
+ * none.
+ */
+static zio_priority_t
+vdev_queue_class_expired(vdev_queue_t *vq, uint32_t cq, zio_t **zp)
+{
+	hrtime_t now = gethrtime();
+	zio_priority_t p;
+	zio_t *zio;
+	uint_t ms;
+
+	for (p = 0; p < ZIO_PRIORITY_NUM_QUEUEABLE; p++) {
+		if ((cq & (1U << p)) == 0 ||
+		    (ms = vdev_queue_class_deadline_ms(p)) == 0)
+			continue;
+
+		if (vdev_queue_class_fifo(p))
+			zio = list_head(&vq->vq_class[p].vqc_list);
+		else
+			zio = list_head(&vq->vq_async_read_fifo);
+		ASSERT3U(zio->io_priority, ==, p);
+		if (now - zio->io_timestamp < MSEC2NSEC(ms))
+			continue;
+
+		switch (p) {
+		case ZIO_PRIORITY_SYNC_READ:
+			VDEV_QUEUE_BUMP(vdev_queue_stat_sync_read_expired);
+			break;
+		case ZIO_PRIORITY_SYNC_WRITE:
+			VDEV_QUEUE_BUMP(vdev_queue_stat_sync_write_expired);
+			break;
+		default:
+			VDEV_QUEUE_BUMP(vdev_queue_stat_async_read_expired);
+			break;
+		}
+		*zp = zio;
+		return (p);
+	}
+
+	return (ZIO_PRIORITY_NUM_QUEUEABLE);
+}
+
 /*
  * Return the i/o class to issue from, or ZIO_PRIORITY_NUM_QUEUEABLE if
- * there is no eligible class.
+ * there is no eligible class.  If an i/o has passed its deadline, it is
+ * returned in *zp and must be issued next; otherwise *zp is NULL.
  */
 static zio_priority_t
-vdev_queue_class_to_issue(vdev_queue_t *vq)
+vdev_queue_class_to_issue(vdev_queue_t *vq, zio_t **zp)
 {
 	uint32_t cq = vq->vq_cqueued;
 	zio_priority_t p, p1;
 
+	*zp = NULL;
 	if (cq == 0 || vq->vq_active >= zfs_vdev_max_active)
 		return (ZIO_PRIORITY_NUM_QUEUEABLE);
 
+	/*
+	 * An i/o which has been queued past its class deadline goes first,
+	 * regardless of the class min/max active limits.
+	 */
+	if (zfs_vdev_deadline && (cq & VDQ_DEADLINE_CLASSES) != 0) {
+		p = vdev_queue_class_expired(vq, cq, zp);
+		if (p != ZIO_PRIORITY_NUM_QUEUEABLE)
+			goto found;
+	}
+
 	/*
 	 * Find a queue that has not reached its minimum # outstanding i/os.
 	 * Do round-robin to reduce starvation due to zfs_vdev_max_active
@@ -497,6 +663,8 @@ vdev_queue_init(vdev_t *vd)
 	avl_create(&vq->vq_write_offset_tree,
 	    vdev_queue_offset_compare, sizeof (zio_t),
 	    offsetof(struct zio, io_offset_node));
+	list_create(&vq->vq_async_read_fifo, sizeof (zio_t),
+	    offsetof(struct zio, io_deadline_node));
 
 	vq->vq_last_offset = 0;
 	list_create(&vq->vq_active_list, sizeof (struct zio),
@@ -517,6 +685,7 @@ vdev_queue_fini(vdev_t *vd)
 	}
 	avl_destroy(&vq->vq_read_offset_tree);
 	avl_destroy(&vq->vq_write_offset_tree);
+	list_destroy(&vq->vq_async_read_fifo);
 
 	list_destroy(&vq->vq_active_list);
 	mutex_destroy(&vq->vq_lock);
@@ -843,14 +1012,16 @@ vdev_queue_io_to_issue(vdev_queue_t *vq)
 again:
 	ASSERT(MUTEX_HELD(&vq->vq_lock));
 
-	p = vdev_queue_class_to_issue(vq);
+	p = vdev_queue_class_to_issue(vq, &zio);
 
 	if (p == ZIO_PRIORITY_NUM_QUEUEABLE) {
 		/* No eligible queued i/os */
 		return (NULL);
 	}
 
-	if (vdev_queue_class_fifo(p)) {
+	if (zio != NULL) {
+		/* The oldest i/o of class p has passed its deadline. */
+	} else if (vdev_queue_class_fifo(p)) {
 		zio = list_head(&vq->vq_class[p].vqc_list);
 	} else {
 		/*
@@ -1077,6 +1248,24 @@ vdev_queue_class_length(vdev_t *vd, zio_priority_t p)
 		return (avl_numnodes(&vq->vq_class[p].vqc_tree));
 }
 
+/*
+ * Returns B_TRUE if the given class has no free active slots on this leaf,
+ * either because I/Os are already waiting in its queue or because all of
+ * the slots the scheduler currently allows it (which for the background
+ * classes shrinks while interactive I/O is present) are taken.  Callers
+ * that generate background I/O can use this to pace themselves against
+ * the device rather than against a fixed amount of outstanding data.
+ * Like vdev_queue_length(), this is an unlocked snapshot.
+ */
+boolean_t
+vdev_queue_class_saturated(vdev_t *vd, zio_priority_t p)
+{
+	vdev_queue_t *vq = &vd->vdev_queue;
+
+	return (vdev_queue_class_length(vd, p) > 0 ||
+	    vq->vq_cactive[p] >= vdev_queue_class_max_active(vq, p));
+}
+
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, aggregation_limit, UINT, ZMOD_RW,
 	"Max vdev I/O aggregation size");
 
@@ -1152,6 +1341,18 @@ ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, rebuild_max_active, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, rebuild_min_active, UINT, ZMOD_RW,
 	"Min active rebuild I/Os per vdev");
 
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, deadline, INT, ZMOD_RW,
+	"Issue queued I/Os that have passed their class deadline first");
+
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, sync_read_deadline_ms, UINT, ZMOD_RW,
+	"Deadline in ms for queued sync read I/Os");
+
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, sync_write_deadline_ms, UINT, ZMOD_RW,
+	"Deadline in ms for queued sync write I/Os");
+
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, async_read_deadline_ms, UINT, ZMOD_RW,
+	"Deadline in ms for queued async read I/Os");
+
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, nia_credit, UINT, ZMOD_RW,
 	"Number of non-interactive I/Os to allow in sequence");
 
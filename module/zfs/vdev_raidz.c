@@ -355,7 +355,10 @@ unsigned long raidz_expand_max_reflow_bytes = 0;
 uint_t raidz_expand_pause_point = 0;
 
 /*
- * Maximum amount of copy io's outstanding at once.
+ * Maximum amount of copy io's outstanding at once.  The rate at which new
+ * copy windows are issued is normally governed by the removal class of the
+ * child vdevs' queues (see raidz_reflow_throttled()); this only bounds the
+ * memory used by the windows in flight.
  */
 #ifdef _ILP32
 static unsigned long raidz_expand_max_copy_bytes = SPA_MAXBLOCKSIZE;
@@ -2646,7 +2649,9 @@ raidz_checksum_verify(zio_t *zio)
 	zio_bad_cksum_t zbc = {0};
 	raidz_map_t *rm = zio->io_vsd;
 
-	int ret = zio_checksum_error(zio, &zbc);
+	int ret = zio_checksum_verify_fused(zio, &zbc);
+	if (ret == ENOTSUP)
+		ret = zio_checksum_error(zio, &zbc);
 	/*
 	 * Any Direct I/O read that has a checksum error must be treated as
 	 * suspicious as the contents of the buffer could be getting
@@ -3952,6 +3957,43 @@ vdev_raidz_expand_child_replacing(vdev_t *raidz_vd)
 	return (B_FALSE);
 }
 
+/*
+ * Returns B_TRUE if no further copy window should be issued until some of
+ * the outstanding ones complete: either the memory limit has been reached,
+ * or the removal class of some child's queue has no free slots.  The vdev
+ * queue shrinks that class while there is interactive I/O, so this keeps
+ * the reflow at whatever rate the devices can spare, without letting
+ * queued copies hold their range locks (and thus stall user I/O to those
+ * offsets) for longer than necessary.  With nothing outstanding we are
+ * never throttled, so that the expansion always makes progress.
+ */
+static boolean_t
+raidz_reflow_throttled_impl(vdev_t *vd)
+{
+	if (vd->vdev_ops->vdev_op_leaf)
+		return (vdev_queue_class_saturated(vd, ZIO_PRIORITY_REMOVAL));
+
+	for (uint64_t c = 0; c < vd->vdev_children; c++) {
+		if (raidz_reflow_throttled_impl(vd->vdev_child[c]))
+			return (B_TRUE);
+	}
+	return (B_FALSE);
+}
+
+static boolean_t
+raidz_reflow_throttled(vdev_t *vd, vdev_raidz_expand_t *vre)
+{
+	mutex_enter(&vre->vre_lock);
+	uint64_t outstanding = vre->vre_outstanding_bytes;
+	mutex_exit(&vre->vre_lock);
+
+	if (outstanding == 0)
+		return (B_FALSE);
+	if (outstanding > raidz_expand_max_copy_bytes)
+		return (B_TRUE);
+	return (raidz_reflow_throttled_impl(vd));
+}
+
 static boolean_t
 raidz_reflow_impl(vdev_t *vd, vdev_raidz_expand_t *vre, range_tree_t *rt,
     dmu_tx_t *tx)
@@ -4519,10 +4561,18 @@ spa_raidz_expand_thread(void *arg, zthr_t *zthr)
 		}
 	}
 
+	mutex_enter(&vre->vre_lock);
+	vre->vre_pass_start = gethrestime_sec();
+	vre->vre_pass_copied_base = vre->vre_bytes_copied;
+	for (int i = 0; i < TXG_SIZE; i++)
+		vre->vre_pass_copied_base += vre->vre_bytes_copied_pertxg[i];
+	mutex_exit(&vre->vre_lock);
+
 	spa_config_enter(spa, SCL_CONFIG, FTAG, RW_READER);
 	vdev_t *raidvd = vdev_lookup_top(spa, vre->vre_vdev_id);
 
 	uint64_t guid = raidvd->vdev_guid;
+	boolean_t throttled = B_FALSE;
 
 	/* Iterate over all the remaining metaslabs */
 	for (uint64_t i = vre->vre_offset >> raidvd->vdev_ms_shift;
@@ -4613,10 +4663,19 @@ spa_raidz_expand_thread(void *arg, zthr_t *zthr)
 				delay(hz);
 			}
 
+			/*
+			 * If we stopped issuing because of the throttle, wait
+			 * for at least one outstanding copy to complete.
+			 */
 			mutex_enter(&vre->vre_lock);
-			while (vre->vre_outstanding_bytes >
-			    raidz_expand_max_copy_bytes) {
-				cv_wait(&vre->vre_cv, &vre->vre_lock);
+			if (throttled) {
+				uint64_t outstanding =
+				    vre->vre_outstanding_bytes;
+				while (vre->vre_outstanding_bytes != 0 &&
+				    vre->vre_outstanding_bytes >= outstanding &&
+				    vre->vre_failed_offset == UINT64_MAX) {
+					cv_wait(&vre->vre_cv, &vre->vre_lock);
+				}
 			}
 			mutex_exit(&vre->vre_lock);
 
@@ -4633,8 +4692,25 @@ spa_raidz_expand_thread(void *arg, zthr_t *zthr)
 			spa_config_enter(spa, SCL_CONFIG, FTAG, RW_READER);
 			raidvd = vdev_lookup_top(spa, vre->vre_vdev_id);
 
-			boolean_t needsync =
-			    raidz_reflow_impl(raidvd, vre, rt, tx);
+			/*
+			 * Issue as many non-overlapping copy windows in this
+			 * txg as the child queues will take.  Each window
+			 * holds its own range lock and advances the progress
+			 * recorded for this txg, so they may complete in any
+			 * order.
+			 */
+			boolean_t needsync = B_FALSE;
+			throttled = B_FALSE;
+			while (!needsync && !range_tree_is_empty(rt) &&
+			    vre->vre_failed_offset == UINT64_MAX &&
+			    !zthr_iscancelled(zthr)) {
+				if (raidz_reflow_throttled(raidvd, vre)) {
+					throttled = B_TRUE;
+					break;
+				}
+				needsync = raidz_reflow_impl(raidvd, vre,
+				    rt, tx);
+			}
 
 			dmu_tx_commit(tx);
 
@@ -4905,6 +4981,10 @@ spa_raidz_expand_get_stats(spa_t *spa, pool_raidz_expand_stat_t *pres)
 	pres->pres_start_time = vre->vre_start_time;
 	pres->pres_end_time = vre->vre_end_time;
 	pres->pres_waiting_for_resilver = vre->vre_waiting_for_resilver;
+	pres->pres_pass_start = vre->vre_pass_start;
+	pres->pres_pass_reflowed = (vre->vre_pass_start == 0) ? 0 :
+	    pres->pres_reflowed - MIN(pres->pres_reflowed,
+	    vre->vre_pass_copied_base);
 
 	return (0);
 }
@@ -5114,7 +5194,7 @@ vdev_ops_t vdev_raidz_ops = {
 ZFS_MODULE_PARAM(zfs_vdev, raidz_, expand_max_reflow_bytes, ULONG, ZMOD_RW,
 	"For testing, pause RAIDZ expansion after reflowing this many bytes");
 ZFS_MODULE_PARAM(zfs_vdev, raidz_, expand_max_copy_bytes, ULONG, ZMOD_RW,
-	"Max amount of concurrent i/o for RAIDZ expansion");
+	"Max amount of memory for outstanding RAIDZ expansion i/o");
 ZFS_MODULE_PARAM(zfs_vdev, raidz_, io_aggregate_rows, ULONG, ZMOD_RW,
 	"For expanded RAIDZ, aggregate reads that have more rows than this");
 ZFS_MODULE_PARAM(zfs, zfs_, scrub_after_expand, INT, ZMOD_RW,
@@ -61,6 +61,9 @@ static const raidz_impl_ops_t *const raidz_all_maths[] = {
 #if defined(__x86_64) && defined(HAVE_AVX512BW)	/* only x86_64 for now */
 	&vdev_raidz_avx512bw_impl,
 #endif
+#if defined(__x86_64) && defined(HAVE_AVX512F) && defined(HAVE_GFNI)
+	&vdev_raidz_gfni_impl,
+#endif
 #if defined(__aarch64__) && !defined(__FreeBSD__)
 	&vdev_raidz_aarch64_neon_impl,
 	&vdev_raidz_aarch64_neonx2_impl,
@@ -510,6 +510,17 @@ vdev_rebuild_cb(zio_t *zio)
 	vr->vr_bytes_inflight -= zio->io_size;
 	cv_broadcast(&vr->vr_io_cv);
 	mutex_exit(&vr->vr_io_lock);
+}
+
+/*
+ * Called once all of the rebuild reads issued by vdev_rebuild_range() for
+ * a batch have completed.
+ */
+static void
+vdev_rebuild_batch_done(zio_t *zio)
+{
+	vdev_rebuild_t *vr = zio->io_private;
+	vdev_t *vd = vr->vr_top_vdev;
 
 	spa_config_exit(vd->vdev_spa, SCL_STATE_ALL, vd);
 }
@@ -549,9 +560,33 @@ vdev_rebuild_blkptr_init(blkptr_t *bp, vdev_t *vd, uint64_t start,
 }
 
 /*
- * Issues a rebuild I/O and takes care of rate limiting the number of queued
- * rebuild I/Os.  The provided start and size must be properly aligned for the
- * top-level vdev type being rebuilt.
+ * Returns the size of the next batch of rebuild I/O to issue from the range
+ * [start, start + size).  For dRAID this is up to a full group row, so that
+ * every child in the redundancy group receives one contiguous run of up to
+ * VDEV_DRAID_ROWHEIGHT bytes, and a segment which continues into the next
+ * group is issued as part of the same batch.  Other vdev types issue one
+ * chunk at a time.
+ */
+static uint64_t
+vdev_rebuild_batch_asize(vdev_t *vd, uint64_t start, uint64_t size)
+{
+	if (vd->vdev_ops == &vdev_draid_ops) {
+		vdev_draid_config_t *vdc = vd->vdev_tsd;
+		return (MIN(size, vdc->vdc_groupsz));
+	}
+
+	return (vd->vdev_ops->vdev_op_rebuild_asize(vd, start, size,
+	    zfs_rebuild_max_segment));
+}
+
+/*
+ * Issues the rebuild I/Os for a batch and takes care of rate limiting the
+ * number of queued rebuild I/Os.  The batch is split into legally-sized
+ * chunks for the top-level vdev type being rebuilt; the provided start and
+ * size must be properly aligned for it.  All chunks are issued under a
+ * single tx as children of one parent zio, so the per-child I/Os for the
+ * whole batch reach the vdev queues together and can be serviced as
+ * sequential runs.
  */
 static int
 vdev_rebuild_range(vdev_rebuild_t *vr, uint64_t start, uint64_t size)
@@ -559,6 +594,8 @@ vdev_rebuild_range(vdev_rebuild_t *vr, uint64_t start, uint64_t size)
 	uint64_t ms_id __maybe_unused = vr->vr_scan_msp->ms_id;
 	vdev_t *vd = vr->vr_top_vdev;
 	spa_t *spa = vd->vdev_spa;
+	uint64_t end = start + size;
+	uint64_t chunk_size, batch_psize = 0, batch_issued = 0;
 	blkptr_t blk;
 
 	ASSERT3U(ms_id, ==, start >> vd->vdev_ms_shift);
@@ -568,26 +605,37 @@ vdev_rebuild_range(vdev_rebuild_t *vr, uint64_t start, uint64_t size)
 	vr->vr_rebuild_phys.vrp_bytes_scanned += size;
 
 	/*
-	 * Rebuild the data in this range by constructing a special block
+	 * Rebuild the data in each chunk by constructing a special block
 	 * pointer.  It has no relation to any existing blocks in the pool.
 	 * However, by disabling checksum verification and issuing a scrub IO
 	 * we can reconstruct and repair any children with missing data.
+	 * Chunks which need no repair are skipped.
 	 */
-	vdev_rebuild_blkptr_init(&blk, vd, start, size);
-	uint64_t psize = BP_GET_PSIZE(&blk);
+	for (uint64_t off = start; off < end; off += chunk_size) {
+		chunk_size = vd->vdev_ops->vdev_op_rebuild_asize(vd, off,
+		    end - off, zfs_rebuild_max_segment);
+		vdev_rebuild_blkptr_init(&blk, vd, off, chunk_size);
+		uint64_t psize = BP_GET_PSIZE(&blk);
+
+		if (vdev_dtl_need_resilver(vd, &blk.blk_dva[0], psize,
+		    TXG_UNKNOWN)) {
+			batch_psize += psize;
+		} else {
+			vr->vr_pass_bytes_skipped += chunk_size;
+		}
+	}
 
-	if (!vdev_dtl_need_resilver(vd, &blk.blk_dva[0], psize, TXG_UNKNOWN)) {
-		vr->vr_pass_bytes_skipped += size;
+	if (batch_psize == 0)
 		return (0);
-	}
 
 	mutex_enter(&vr->vr_io_lock);
 
 	/* Limit in flight rebuild I/Os */
-	while (vr->vr_bytes_inflight >= vr->vr_bytes_inflight_max)
+	while (vr->vr_bytes_inflight > 0 &&
+	    vr->vr_bytes_inflight + batch_psize > vr->vr_bytes_inflight_max)
 		cv_wait(&vr->vr_io_cv, &vr->vr_io_lock);
 
-	vr->vr_bytes_inflight += psize;
+	vr->vr_bytes_inflight += batch_psize;
 	mutex_exit(&vr->vr_io_lock);
 
 	dmu_tx_t *tx = dmu_tx_create_dd(spa_get_dsl(spa)->dp_mos_dir);
@@ -608,7 +656,7 @@ vdev_rebuild_range(vdev_rebuild_t *vr, uint64_t start, uint64_t size)
 	/* When exiting write out our progress. */
 	if (vdev_rebuild_should_stop(vd)) {
 		mutex_enter(&vr->vr_io_lock);
-		vr->vr_bytes_inflight -= psize;
+		vr->vr_bytes_inflight -= batch_psize;
 		mutex_exit(&vr->vr_io_lock);
 		spa_config_exit(vd->vdev_spa, SCL_STATE_ALL, vd);
 		mutex_exit(&vd->vdev_rebuild_lock);
@@ -618,14 +666,54 @@ vdev_rebuild_range(vdev_rebuild_t *vr, uint64_t start, uint64_t size)
 	mutex_exit(&vd->vdev_rebuild_lock);
 	dmu_tx_commit(tx);
 
-	vr->vr_scan_offset[txg & TXG_MASK] = start + size;
-	vr->vr_pass_bytes_issued += size;
-	vr->vr_rebuild_phys.vrp_bytes_issued += size;
+	/*
+	 * SCL_STATE_ALL will be released by vdev_rebuild_batch_done() once
+	 * all of the reads in this batch have completed.
+	 */
+	zio_t *pio = zio_null(spa->spa_txg_zio[txg & TXG_MASK], spa, NULL,
+	    vdev_rebuild_batch_done, vr, ZIO_FLAG_CANFAIL);
+
+	for (uint64_t off = start; off < end; off += chunk_size) {
+		chunk_size = vd->vdev_ops->vdev_op_rebuild_asize(vd, off,
+		    end - off, zfs_rebuild_max_segment);
+		vdev_rebuild_blkptr_init(&blk, vd, off, chunk_size);
+		uint64_t psize = BP_GET_PSIZE(&blk);
+
+		if (!vdev_dtl_need_resilver(vd, &blk.blk_dva[0], psize,
+		    TXG_UNKNOWN))
+			continue;
+
+		/*
+		 * The DTL may have changed since the first pass; account
+		 * for any chunk which was not included in the reservation.
+		 */
+		if (psize > batch_psize) {
+			mutex_enter(&vr->vr_io_lock);
+			vr->vr_bytes_inflight += psize - batch_psize;
+			mutex_exit(&vr->vr_io_lock);
+			batch_psize = psize;
+		}
+		batch_psize -= psize;
+		batch_issued += chunk_size;
+
+		zio_nowait(zio_read(pio, spa, &blk, abd_alloc(psize, B_FALSE),
+		    psize, vdev_rebuild_cb, vr, ZIO_PRIORITY_REBUILD,
+		    ZIO_FLAG_RAW | ZIO_FLAG_CANFAIL | ZIO_FLAG_RESILVER, NULL));
+	}
+
+	/* Release the reservation for chunks which no longer need repair. */
+	if (batch_psize != 0) {
+		mutex_enter(&vr->vr_io_lock);
+		vr->vr_bytes_inflight -= batch_psize;
+		cv_broadcast(&vr->vr_io_cv);
+		mutex_exit(&vr->vr_io_lock);
+	}
+
+	vr->vr_scan_offset[txg & TXG_MASK] = end;
+	vr->vr_pass_bytes_issued += batch_issued;
+	vr->vr_rebuild_phys.vrp_bytes_issued += batch_issued;
 
-	zio_nowait(zio_read(spa->spa_txg_zio[txg & TXG_MASK], spa, &blk,
-	    abd_alloc(psize, B_FALSE), psize, vdev_rebuild_cb, vr,
-	    ZIO_PRIORITY_REBUILD, ZIO_FLAG_RAW | ZIO_FLAG_CANFAIL |
-	    ZIO_FLAG_RESILVER, NULL));
+	zio_nowait(pio);
 
 	return (0);
 }
@@ -656,23 +744,23 @@ vdev_rebuild_ranges(vdev_rebuild_t *vr)
 		}
 
 		while (size > 0) {
-			uint64_t chunk_size;
+			uint64_t batch_size;
 
 			/*
-			 * Split range into legally-sized logical chunks
-			 * given the constraints of the top-level vdev
-			 * being rebuilt (dRAID or mirror).
+			 * Split range into batches which are then issued as
+			 * legally-sized logical chunks given the constraints
+			 * of the top-level vdev being rebuilt (dRAID or
+			 * mirror).
 			 */
 			ASSERT3P(vd->vdev_ops, !=, NULL);
-			chunk_size = vd->vdev_ops->vdev_op_rebuild_asize(vd,
-			    start, size, zfs_rebuild_max_segment);
+			batch_size = vdev_rebuild_batch_asize(vd, start, size);
 
-			error = vdev_rebuild_range(vr, start, chunk_size);
+			error = vdev_rebuild_range(vr, start, batch_size);
 			if (error != 0)
 				return (error);
 
-			size -= chunk_size;
-			start += chunk_size;
+			size -= batch_size;
+			start += batch_size;
 		}
 	}
 
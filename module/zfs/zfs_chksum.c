@@ -45,6 +45,7 @@ typedef struct {
 	uint64_t bs1m;
 	uint64_t bs4m;
 	uint64_t bs16m;
+	boolean_t scatter;	/* time every size on a scattered abd */
 	zio_cksum_salt_t salt;
 	zio_checksum_t *(func);
 	zio_checksum_tmpl_init_t *(init);
@@ -136,6 +137,43 @@ chksum_kstat_addr(kstat_t *ksp, loff_t n)
 	return (ksp->ks_private);
 }
 
+/*
+ * Reading a scattered compressed block costs a checksum pass and a copy
+ * into the linear buffer that the decompressors need.  These two entries
+ * compare doing that in two walks of the data with the single fused walk
+ * used by zio_checksum_verify_fused().  The template is the destination,
+ * and the source is scattered at every size, as it is on that path.
+ */
+#define	CHKSUM_COPY_SIZE	(1<<24)
+
+static void *
+chksum_copy_init(const zio_cksum_salt_t *salt)
+{
+	(void) salt;
+	return (vmem_alloc(CHKSUM_COPY_SIZE, KM_SLEEP));
+}
+
+static void
+chksum_copy_free(void *ctx)
+{
+	vmem_free(ctx, CHKSUM_COPY_SIZE);
+}
+
+static void
+chksum_fletcher_4_2pass(abd_t *abd, uint64_t size, const void *ctx,
+    zio_cksum_t *zcp)
+{
+	abd_fletcher_4_native(abd, size, NULL, zcp);
+	abd_copy_to_buf((void *)ctx, abd, size);
+}
+
+static void
+chksum_fletcher_4_fused(abd_t *abd, uint64_t size, const void *ctx,
+    zio_cksum_t *zcp)
+{
+	abd_fletcher_4_copy_native(abd, (void *)ctx, size, zcp);
+}
+
 static void
 chksum_run(chksum_stat_t *cs, abd_t *abd, void *ctx, int round,
     uint64_t *result)
@@ -195,8 +233,11 @@ chksum_benchit(chksum_stat_t *cs)
 	if (cs->init)
 		ctx = cs->init(&cs->salt);
 
-	/* allocate test memory via abd linear interface */
-	abd = abd_alloc_linear(1<<20, B_FALSE);
+	/* allocate test memory via abd linear interface, unless scattered */
+	if (cs->scatter)
+		abd = abd_alloc(1<<20, B_FALSE);
+	else
+		abd = abd_alloc_linear(1<<20, B_FALSE);
 	chksum_run(cs, abd, ctx, 1, &cs->bs1k);
 	chksum_run(cs, abd, ctx, 2, &cs->bs4k);
 	chksum_run(cs, abd, ctx, 3, &cs->bs16k);
@@ -251,7 +292,7 @@ chksum_benchmark(void)
 	const zfs_impl_t *sha512 = zfs_impl_get_ops("sha512");
 
 	/* count implementations */
-	chksum_stat_cnt = 2;
+	chksum_stat_cnt = 4;
 	chksum_stat_cnt += sha256->getcnt();
 	chksum_stat_cnt += sha512->getcnt();
 	chksum_stat_cnt += blake3->getcnt();
@@ -278,6 +319,25 @@ chksum_benchmark(void)
 	cs->impl = "generic";
 	chksum_benchit(cs);
 
+	/* fletcher_4 verify and copy, in two passes and fused */
+	cs = &chksum_stat_data[cbid++];
+	cs->init = chksum_copy_init;
+	cs->func = chksum_fletcher_4_2pass;
+	cs->free = chksum_copy_free;
+	cs->name = "fletcher_4";
+	cs->impl = "2pass";
+	cs->scatter = B_TRUE;
+	chksum_benchit(cs);
+
+	cs = &chksum_stat_data[cbid++];
+	cs->init = chksum_copy_init;
+	cs->func = chksum_fletcher_4_fused;
+	cs->free = chksum_copy_free;
+	cs->name = "fletcher_4";
+	cs->impl = "fused";
+	cs->scatter = B_TRUE;
+	chksum_benchit(cs);
+
 	/* sha256 */
 	id_save = sha256->getid();
 	for (max = 0, id = 0; id < sha256->getcnt(); id++) {
@@ -2106,6 +2106,38 @@ zfs_ioc_vdev_setfru(zfs_cmd_t *zc)
 	return (error);
 }
 
+/*
+ * Gather the properties and stats of an objset, as returned by
+ * zfs_ioc_objset_stats() and ZFS_IOC_LIST_BATCH.
+ */
+static int
+zfs_objset_stats_nvlist(objset_t *os, boolean_t inconsistent, nvlist_t **nvp)
+{
+	nvlist_t *nv;
+	int error;
+
+	if ((error = dsl_prop_get_all(os, &nv)) != 0)
+		return (error);
+	dmu_objset_stats(os, nv);
+	/*
+	 * NB: zvol_get_stats() will read the objset contents,
+	 * which we aren't supposed to do with a
+	 * DS_MODE_USER hold, because it could be
+	 * inconsistent.  So this is a bit of a workaround...
+	 * XXX reading without owning
+	 */
+	if (!inconsistent && dmu_objset_type(os) == DMU_OST_ZVOL) {
+		error = zvol_get_stats(os, nv);
+		if (error == EIO) {
+			nvlist_free(nv);
+			return (error);
+		}
+		VERIFY0(error);
+	}
+	*nvp = nv;
+	return (0);
+}
+
 static int
 zfs_ioc_objset_stats_impl(zfs_cmd_t *zc, objset_t *os)
 {
@@ -2115,26 +2147,9 @@ zfs_ioc_objset_stats_impl(zfs_cmd_t *zc, objset_t *os)
 	dmu_objset_fast_stat(os, &zc->zc_objset_stats);
 
 	if (!zc->zc_simple && zc->zc_nvlist_dst != 0 &&
-	    (error = dsl_prop_get_all(os, &nv)) == 0) {
-		dmu_objset_stats(os, nv);
-		/*
-		 * NB: zvol_get_stats() will read the objset contents,
-		 * which we aren't supposed to do with a
-		 * DS_MODE_USER hold, because it could be
-		 * inconsistent.  So this is a bit of a workaround...
-		 * XXX reading without owning
-		 */
-		if (!zc->zc_objset_stats.dds_inconsistent &&
-		    dmu_objset_type(os) == DMU_OST_ZVOL) {
-			error = zvol_get_stats(os, nv);
-			if (error == EIO) {
-				nvlist_free(nv);
-				return (error);
-			}
-			VERIFY0(error);
-		}
-		if (error == 0)
-			error = put_nvlist(zc, nv);
+	    (error = zfs_objset_stats_nvlist(os,
+	    zc->zc_objset_stats.dds_inconsistent, &nv)) == 0) {
+		error = put_nvlist(zc, nv);
 		nvlist_free(nv);
 	}
 
@@ -2166,6 +2181,48 @@ zfs_ioc_objset_stats(zfs_cmd_t *zc)
 	return (error);
 }
 
+/*
+ * inputs:
+ * zc_name		name of dataset
+ * zc_nvlist_dst[_size] buffer to fill (not really an nvlist)
+ *
+ * outputs:
+ * zc_nvlist_dst[_size]	zfs_space_stats_t, truncated to the buffer size
+ *
+ * Returns the most commonly monitored space and identity properties of a
+ * dataset in a fixed layout, without gathering, packing and copying out
+ * every property as ZFS_IOC_OBJSET_STATS does.
+ */
+static int
+zfs_ioc_objset_space(zfs_cmd_t *zc)
+{
+	zfs_space_stats_t zss;
+	dsl_pool_t *dp;
+	dsl_dataset_t *ds;
+	int error;
+
+	if (zc->zc_nvlist_dst == 0)
+		return (SET_ERROR(EINVAL));
+
+	error = dsl_pool_hold(zc->zc_name, FTAG, &dp);
+	if (error != 0)
+		return (error);
+	error = dsl_dataset_hold(dp, zc->zc_name, FTAG, &ds);
+	if (error == 0) {
+		dsl_dataset_space_stats(ds, &zss);
+		dsl_dataset_rele(ds, FTAG);
+	}
+	dsl_pool_rele(dp, FTAG);
+	if (error != 0)
+		return (error);
+
+	zc->zc_nvlist_dst_size = MIN(zc->zc_nvlist_dst_size, sizeof (zss));
+	if (ddi_copyout(&zss, (void *)(uintptr_t)zc->zc_nvlist_dst,
+	    zc->zc_nvlist_dst_size, zc->zc_iflags) != 0)
+		return (SET_ERROR(EFAULT));
+	return (0);
+}
+
 /*
  * inputs:
  * zc_name		name of filesystem
@@ -2425,6 +2482,253 @@ zfs_ioc_snapshot_list_next(zfs_cmd_t *zc)
 	return (error);
 }
 
+/*
+ * Upper bound on the packed size of the entries that ZFS_IOC_LIST_BATCH
+ * returns in one call.  It is kept below the 128K output buffer that
+ * libzfs_core starts with, so that a batch rarely needs to be retried with
+ * a larger buffer.
+ */
+#define	ZFS_LIST_BATCH_BYTES	(96 * 1024)
+
+/*
+ * Number of entries ZFS_IOC_LIST_BATCH gathers before it drops the pool
+ * config lock and takes it again, so that a large batch does not hold off
+ * txg sync and other writers of the config for its whole duration.
+ */
+#define	ZFS_LIST_BATCH_CHUNK	16
+
+/*
+ * Gather the stats of one dataset for ZFS_IOC_LIST_BATCH.  Unless the
+ * selection is empty, the properties are gathered as zfs_ioc_objset_stats()
+ * would, and only the selected ones are kept.
+ */
+static int
+zfs_list_batch_entry(dsl_dataset_t *ds, nvlist_t *sel, boolean_t userprops,
+    nvlist_t **entryp)
+{
+	dmu_objset_stats_t stat = { 0 };
+	objset_t *os = NULL;
+	nvlist_t *nv = NULL;
+	int error;
+
+	if (ds->ds_is_snapshot && sel != NULL && nvlist_empty(sel) &&
+	    !userprops) {
+		/* Same as zc_simple for ZFS_IOC_SNAPSHOT_LIST_NEXT. */
+		dsl_dataset_fast_stat(ds, &stat);
+	} else {
+		if ((error = dmu_objset_from_ds(ds, &os)) != 0)
+			return (error);
+		dmu_objset_fast_stat(os, &stat);
+	}
+
+	if (sel == NULL || !nvlist_empty(sel) || userprops) {
+		error = zfs_objset_stats_nvlist(os, stat.dds_inconsistent,
+		    &nv);
+		if (error != 0)
+			return (error);
+		if (sel != NULL) {
+			nvlist_t *all = nv;
+			nvpair_t *pair = NULL;
+
+			nv = fnvlist_alloc();
+			while ((pair = nvlist_next_nvpair(all, pair)) != NULL) {
+				const char *name = nvpair_name(pair);
+
+				if (nvlist_exists(sel, name) ||
+				    (userprops && zfs_prop_user(name)))
+					fnvlist_add_nvpair(nv, pair);
+			}
+			fnvlist_free(all);
+		}
+	}
+
+	*entryp = fnvlist_alloc();
+	fnvlist_add_uint8_array(*entryp, ZFS_LIST_BATCH_STATS,
+	    (uint8_t *)&stat, sizeof (stat));
+	if (nv != NULL) {
+		fnvlist_add_nvlist(*entryp, ZFS_LIST_BATCH_PROPS, nv);
+		fnvlist_free(nv);
+	}
+	return (0);
+}
+
+/*
+ * List the child filesystems or the snapshots of a dataset, many at a time.
+ * This does the work of a series of ZFS_IOC_DATASET_LIST_NEXT or
+ * ZFS_IOC_SNAPSHOT_LIST_NEXT calls in one call, and only returns the
+ * properties that the caller asks for.  The pool config lock is dropped
+ * every ZFS_LIST_BATCH_CHUNK entries; the cookie carries the position
+ * across, just as it does between calls.
+ *
+ * innvl: {
+ *     "list_snapshots" (optional) -> list snapshots rather than children
+ *     "list_cookie" -> uint64 (optional) cursor returned by the last call
+ *     "list_count" -> uint64 (optional) maximum number of entries
+ *     "list_props" -> { prop1, prop2, ... } (optional) properties to return,
+ *         all of them if not given, none if empty
+ *     "list_userprops" (optional) -> also return all user properties
+ *     "snap_iter_min_txg" -> uint64 (optional) as for SNAPSHOT_LIST_NEXT
+ *     "snap_iter_max_txg" -> uint64 (optional) as for SNAPSHOT_LIST_NEXT
+ * }
+ *
+ * outnvl: {
+ *     "list_cookie" -> uint64, absent once the listing is complete
+ *     "list_entries" -> {
+ *         name1 -> {
+ *             "list_stats" -> uint8 array, a dmu_objset_stats_t
+ *             "list_props" -> { prop1 -> { "value" -> ..., ... }, ... }
+ *         },
+ *         name2 -> { ... }
+ *     }
+ * }
+ */
+static const zfs_ioc_key_t zfs_keys_list_batch[] = {
+	{ZFS_LIST_BATCH_SNAPSHOTS,	DATA_TYPE_BOOLEAN,	ZK_OPTIONAL},
+	{ZFS_LIST_BATCH_COOKIE,		DATA_TYPE_UINT64,	ZK_OPTIONAL},
+	{ZFS_LIST_BATCH_COUNT,		DATA_TYPE_UINT64,	ZK_OPTIONAL},
+	{ZFS_LIST_BATCH_PROPS,		DATA_TYPE_NVLIST,	ZK_OPTIONAL},
+	{ZFS_LIST_BATCH_USERPROPS,	DATA_TYPE_BOOLEAN,	ZK_OPTIONAL},
+	{SNAP_ITER_MIN_TXG,		DATA_TYPE_UINT64,	ZK_OPTIONAL},
+	{SNAP_ITER_MAX_TXG,		DATA_TYPE_UINT64,	ZK_OPTIONAL},
+};
+
+static int
+zfs_ioc_list_batch(const char *fsname, nvlist_t *innvl, nvlist_t *outnvl)
+{
+	boolean_t snapshots = nvlist_exists(innvl, ZFS_LIST_BATCH_SNAPSHOTS);
+	boolean_t userprops = nvlist_exists(innvl, ZFS_LIST_BATCH_USERPROPS);
+	boolean_t done = B_FALSE;
+	uint64_t cookie = 0, count = UINT64_MAX;
+	uint64_t min_txg = 0, max_txg = 0;
+	nvlist_t *sel = NULL, *entries;
+	char *name;
+	size_t len, size = 0;
+	uint_t chunk = 0;
+	uint64_t dsobj;
+	dsl_dataset_t *pds;
+	objset_t *os;
+	dsl_pool_t *dp;
+	int error;
+
+	(void) nvlist_lookup_uint64(innvl, ZFS_LIST_BATCH_COOKIE, &cookie);
+	(void) nvlist_lookup_uint64(innvl, ZFS_LIST_BATCH_COUNT, &count);
+	(void) nvlist_lookup_nvlist(innvl, ZFS_LIST_BATCH_PROPS, &sel);
+	(void) nvlist_lookup_uint64(innvl, SNAP_ITER_MIN_TXG, &min_txg);
+	(void) nvlist_lookup_uint64(innvl, SNAP_ITER_MAX_TXG, &max_txg);
+
+	error = dsl_pool_hold(fsname, FTAG, &dp);
+	if (error != 0)
+		return (error);
+	error = dsl_dataset_hold(dp, fsname, FTAG, &pds);
+	if (error != 0) {
+		dsl_pool_rele(dp, FTAG);
+		return (error);
+	}
+	error = dmu_objset_from_ds(pds, &os);
+	if (error != 0) {
+		dsl_dataset_rele(pds, FTAG);
+		dsl_pool_rele(dp, FTAG);
+		return (error);
+	}
+	dsobj = pds->ds_object;
+
+	name = kmem_alloc(ZFS_MAX_DATASET_NAME_LEN, KM_SLEEP);
+	(void) strlcpy(name, fsname, ZFS_MAX_DATASET_NAME_LEN);
+	len = strlcat(name, snapshots ? "@" : "/", ZFS_MAX_DATASET_NAME_LEN);
+	/* A dataset name of maximum length cannot have any children. */
+	if (len >= ZFS_MAX_DATASET_NAME_LEN - 1)
+		done = B_TRUE;
+
+	entries = fnvlist_alloc();
+	while (!done && count > 0 && size < ZFS_LIST_BATCH_BYTES) {
+		dsl_dataset_t *ds;
+		nvlist_t *entry;
+		uint64_t obj;
+
+		if (issig()) {
+			error = SET_ERROR(EINTR);
+			break;
+		}
+
+		if (++chunk > ZFS_LIST_BATCH_CHUNK) {
+			chunk = 1;
+			dsl_dataset_rele(pds, FTAG);
+			pds = NULL;
+			dsl_pool_config_exit(dp, FTAG);
+			dsl_pool_config_enter(dp, FTAG);
+			error = dsl_dataset_hold_obj(dp, dsobj, FTAG, &pds);
+			if (error == 0) {
+				error = dmu_objset_from_ds(pds, &os);
+			} else {
+				pds = NULL;
+			}
+			if (error != 0)
+				break;
+		}
+
+		name[len] = '\0';
+		if (snapshots) {
+			error = dmu_snapshot_list_next(os,
+			    ZFS_MAX_DATASET_NAME_LEN - len, name + len, &obj,
+			    &cookie, NULL);
+		} else {
+			error = dmu_dir_list_next(os,
+			    ZFS_MAX_DATASET_NAME_LEN - len, name + len, NULL,
+			    &cookie);
+		}
+		if (error == ENOENT) {
+			error = 0;
+			done = B_TRUE;
+			break;
+		} else if (error != 0) {
+			break;
+		}
+
+		if (snapshots) {
+			error = dsl_dataset_hold_obj(dp, obj, FTAG, &ds);
+		} else if (zfs_dataset_name_hidden(name)) {
+			continue;
+		} else {
+			error = dsl_dataset_hold(dp, name, FTAG, &ds);
+			/* We lost a race with destroy, get the next one. */
+			if (error == ENOENT)
+				continue;
+		}
+		if (error != 0)
+			break;
+
+		if (snapshots &&
+		    ((min_txg != 0 && dsl_get_creationtxg(ds) < min_txg) ||
+		    (max_txg != 0 && dsl_get_creationtxg(ds) > max_txg))) {
+			dsl_dataset_rele(ds, FTAG);
+			continue;
+		}
+
+		error = zfs_list_batch_entry(ds, sel, userprops, &entry);
+		dsl_dataset_rele(ds, FTAG);
+		if (error != 0)
+			break;
+
+		size += fnvlist_size(entry) + strlen(name) + 1;
+		fnvlist_add_nvlist(entries, name, entry);
+		fnvlist_free(entry);
+		count--;
+	}
+	if (pds != NULL)
+		dsl_dataset_rele(pds, FTAG);
+	dsl_pool_rele(dp, FTAG);
+
+	if (error == 0) {
+		if (!done)
+			fnvlist_add_uint64(outnvl, ZFS_LIST_BATCH_COOKIE,
+			    cookie);
+		fnvlist_add_nvlist(outnvl, ZFS_LIST_BATCH_ENTRIES, entries);
+	}
+	fnvlist_free(entries);
+	kmem_free(name, ZFS_MAX_DATASET_NAME_LEN);
+	return (error);
+}
+
 static int
 zfs_prop_set_userquota(const char *dsname, nvpair_t *pair)
 {
@@ -7409,6 +7713,11 @@ zfs_ioctl_init(void)
 	    POOL_CHECK_SUSPENDED, B_FALSE, B_FALSE,
 	    zfs_keys_get_bookmarks, ARRAY_SIZE(zfs_keys_get_bookmarks));
 
+	zfs_ioctl_register("list_batch", ZFS_IOC_LIST_BATCH,
+	    zfs_ioc_list_batch, zfs_secpolicy_read, DATASET_NAME,
+	    POOL_CHECK_SUSPENDED, B_FALSE, B_FALSE,
+	    zfs_keys_list_batch, ARRAY_SIZE(zfs_keys_list_batch));
+
 	zfs_ioctl_register("get_bookmark_props", ZFS_IOC_GET_BOOKMARK_PROPS,
 	    zfs_ioc_get_bookmark_props, zfs_secpolicy_read, ENTITY_NAME,
 	    POOL_CHECK_SUSPENDED, B_FALSE, B_FALSE, zfs_keys_get_bookmark_props,
@@ -7614,6 +7923,8 @@ zfs_ioctl_init(void)
 	    zfs_ioc_objset_stats);
 	zfs_ioctl_register_dataset_read(ZFS_IOC_OBJSET_ZPLPROPS,
 	    zfs_ioc_objset_zplprops);
+	zfs_ioctl_register_dataset_read(ZFS_IOC_OBJSET_SPACE,
+	    zfs_ioc_objset_space);
 	zfs_ioctl_register_dataset_read(ZFS_IOC_DATASET_LIST_NEXT,
 	    zfs_ioc_dataset_list_next);
 	zfs_ioctl_register_dataset_read(ZFS_IOC_SNAPSHOT_LIST_NEXT,
@@ -2491,6 +2491,72 @@ zil_aitx_compare(const void *x1, const void *x2)
 	return (TREE_CMP(o1, o2));
 }
 
+/*
+ * Upper bound on the number of per-CPU sync itx lists for each itxg.  Each
+ * zilog has TXG_SIZE of these sets, so this bounds the per-dataset cost.
+ */
+#define	ZIL_ITX_SUBLISTS_MAX	16
+
+/*
+ * Merge the itxs on src into dst.  Both lists must be sorted by itx_seq;
+ * dst stays sorted and src is left empty.
+ */
+static void
+zil_itx_list_merge(list_t *dst, list_t *src)
+{
+	itx_t *ditx = list_head(dst);
+	itx_t *sitx;
+
+	while ((sitx = list_head(src)) != NULL) {
+		while (ditx != NULL && ditx->itx_seq < sitx->itx_seq)
+			ditx = list_next(dst, ditx);
+		if (ditx == NULL) {
+			list_move_tail(dst, src);
+			return;
+		}
+		list_remove(src, sitx);
+		list_insert_before(dst, ditx, sitx);
+	}
+}
+
+static void
+zil_itxg_sublists_enter(zilog_t *zilog, itxg_t *itxg)
+{
+	ASSERT(MUTEX_HELD(&itxg->itxg_lock));
+	for (uint_t i = 0; i < zilog->zl_itx_nsublists; i++)
+		mutex_enter(&itxg->itxg_sublists[i].is_lock);
+}
+
+static void
+zil_itxg_sublists_exit(zilog_t *zilog, itxg_t *itxg)
+{
+	for (uint_t i = 0; i < zilog->zl_itx_nsublists; i++)
+		mutex_exit(&itxg->itxg_sublists[i].is_lock);
+}
+
+/*
+ * Move the sync itxs queued on the per-CPU sublists onto i_sync_list,
+ * keeping them in assignment order.  All of the sublist locks must be held
+ * at once, so that no itx can slip onto a sublist that was already merged
+ * while a later one is merged from another.
+ */
+static void
+zil_itxg_sublists_gather(zilog_t *zilog, itxg_t *itxg)
+{
+	ASSERT(MUTEX_HELD(&itxg->itxg_lock));
+
+	for (uint_t i = 0; i < zilog->zl_itx_nsublists; i++) {
+		itx_sublist_t *is = &itxg->itxg_sublists[i];
+
+		ASSERT(MUTEX_HELD(&is->is_lock));
+		if (list_is_empty(&is->is_list))
+			continue;
+		ASSERT3P(itxg->itxg_itxs, !=, NULL);
+		zil_itx_list_merge(&itxg->itxg_itxs->i_sync_list,
+		    &is->is_list);
+	}
+}
+
 /*
  * Remove all async itx with the given oid.
  */
@@ -2558,9 +2624,31 @@ zil_itx_assign(zilog_t *zilog, itx_t *itx, dmu_tx_t *tx)
 		txg = dmu_tx_get_txg(tx);
 
 	itxg = &zilog->zl_itxg[txg & TXG_MASK];
+
+	/*
+	 * Sync itxs normally only need the lock of this CPU's sublist.
+	 * Fall back to itxg_lock if the itxg has to be set up for this txg.
+	 */
+	if (itx->itx_sync) {
+		itx_sublist_t *is = &itxg->itxg_sublists[CPU_SEQID_UNSTABLE %
+		    zilog->zl_itx_nsublists];
+
+		mutex_enter(&is->is_lock);
+		if (itxg->itxg_txg == txg) {
+			itx->itx_lr.lrc_txg = dmu_tx_get_txg(tx);
+			itx->itx_seq = atomic_inc_64_nv(&zilog->zl_itx_seq);
+			list_insert_tail(&is->is_list, itx);
+			zilog_dirty(zilog, dmu_tx_get_txg(tx));
+			mutex_exit(&is->is_lock);
+			return;
+		}
+		mutex_exit(&is->is_lock);
+	}
+
 	mutex_enter(&itxg->itxg_lock);
 	itxs = itxg->itxg_itxs;
 	if (itxg->itxg_txg != txg) {
+		zil_itxg_sublists_enter(zilog, itxg);
 		if (itxs != NULL) {
 			/*
 			 * The zil_clean callback hasn't got around to cleaning
@@ -2569,6 +2657,7 @@ zil_itx_assign(zilog_t *zilog, itx_t *itx, dmu_tx_t *tx)
 			 */
 			zfs_dbgmsg("zil_itx_assign: missed itx cleanup for "
 			    "txg %llu", (u_longlong_t)itxg->itxg_txg);
+			zil_itxg_sublists_gather(zilog, itxg);
 			clean = itxg->itxg_itxs;
 		}
 		itxg->itxg_txg = txg;
@@ -2580,7 +2669,9 @@ zil_itx_assign(zilog_t *zilog, itx_t *itx, dmu_tx_t *tx)
 		avl_create(&itxs->i_async_tree, zil_aitx_compare,
 		    sizeof (itx_async_node_t),
 		    offsetof(itx_async_node_t, ia_node));
+		zil_itxg_sublists_exit(zilog, itxg);
 	}
+	itx->itx_seq = atomic_inc_64_nv(&zilog->zl_itx_seq);
 	if (itx->itx_sync) {
 		list_insert_tail(&itxs->i_sync_list, itx);
 	} else {
@@ -2640,9 +2731,12 @@ zil_clean(zilog_t *zilog, uint64_t synced_txg)
 	}
 	ASSERT3U(itxg->itxg_txg, <=, synced_txg);
 	ASSERT3U(itxg->itxg_txg, !=, 0);
+	zil_itxg_sublists_enter(zilog, itxg);
+	zil_itxg_sublists_gather(zilog, itxg);
 	clean_me = itxg->itxg_itxs;
 	itxg->itxg_itxs = NULL;
 	itxg->itxg_txg = 0;
+	zil_itxg_sublists_exit(zilog, itxg);
 	mutex_exit(&itxg->itxg_lock);
 	/*
 	 * Preferably start a task queue to free up the old itxs but
@@ -2699,6 +2793,8 @@ zil_get_commit_list(zilog_t *zilog)
 		 */
 		ASSERT(zilog_is_dirty_in_txg(zilog, txg) ||
 		    spa_freeze_txg(zilog->zl_spa) != UINT64_MAX);
+		zil_itxg_sublists_enter(zilog, itxg);
+		zil_itxg_sublists_gather(zilog, itxg);
 		list_t *sync_list = &itxg->itxg_itxs->i_sync_list;
 		itx_t *itx = NULL;
 		if (unlikely(zilog->zl_suspend > 0)) {
@@ -2714,6 +2810,7 @@ zil_get_commit_list(zilog_t *zilog)
 			list_move_tail(commit_list, sync_list);
 		}
 
+		zil_itxg_sublists_exit(zilog, itxg);
 		mutex_exit(&itxg->itxg_lock);
 
 		while (itx != NULL) {
@@ -2728,6 +2825,56 @@ zil_get_commit_list(zilog_t *zilog)
 	return (wtxg);
 }
 
+/*
+ * Merge the async itxs of every object into the sync list.  Merging each
+ * object's list straight into the sync list would walk the sync list once
+ * per object, so the lists are first combined pairwise, as in a bottom-up
+ * merge sort: slots[i] holds the merge of up to 2^i object lists.  The
+ * result is merged into the sync list once, for O(n log k) work on n itxs
+ * spread over k objects.
+ */
+static void
+zil_async_merge_all(itxs_t *itxs)
+{
+	avl_tree_t *t = &itxs->i_async_tree;
+	ulong_t nodes = avl_numnodes(t);
+	itx_async_node_t *ian;
+	void *cookie = NULL;
+	list_t *slots;
+	uint_t nslots, i;
+
+	if (nodes == 0)
+		return;
+
+	nslots = highbit64(nodes);
+	slots = kmem_alloc(nslots * sizeof (list_t), KM_SLEEP);
+	for (i = 0; i < nslots; i++) {
+		list_create(&slots[i], sizeof (itx_t),
+		    offsetof(itx_t, itx_node));
+	}
+
+	while ((ian = avl_destroy_nodes(t, &cookie)) != NULL) {
+		list_t *carry = &ian->ia_list;
+
+		for (i = 0; !list_is_empty(&slots[i]); i++) {
+			zil_itx_list_merge(carry, &slots[i]);
+			ASSERT3U(i + 1, <, nslots);
+		}
+		list_move_tail(&slots[i], carry);
+
+		list_destroy(&ian->ia_list);
+		kmem_free(ian, sizeof (itx_async_node_t));
+	}
+
+	for (i = 0; i + 1 < nslots; i++)
+		zil_itx_list_merge(&slots[i + 1], &slots[i]);
+	zil_itx_list_merge(&itxs->i_sync_list, &slots[nslots - 1]);
+
+	for (i = 0; i < nslots; i++)
+		list_destroy(&slots[i]);
+	kmem_free(slots, nslots * sizeof (list_t));
+}
+
 /*
  * Move the async itxs for a specified object to commit into sync lists.
  */
@@ -2758,28 +2905,22 @@ zil_async_to_sync(zilog_t *zilog, uint64_t foid)
 		}
 
 		/*
-		 * If a foid is specified then find that node and append its
-		 * list. Otherwise walk the tree appending all the lists
-		 * to the sync list. We add to the end rather than the
-		 * beginning to ensure the create has happened.
+		 * If a foid is specified then find that node and merge its
+		 * list. Otherwise walk the tree merging all the lists
+		 * into the sync list. The sync list is kept in assignment
+		 * order to ensure the create has happened.
 		 */
 		t = &itxg->itxg_itxs->i_async_tree;
 		if (foid != 0) {
 			ian_search.ia_foid = foid;
 			ian = avl_find(t, &ian_search, &where);
 			if (ian != NULL) {
-				list_move_tail(&itxg->itxg_itxs->i_sync_list,
+				zil_itx_list_merge(
+				    &itxg->itxg_itxs->i_sync_list,
 				    &ian->ia_list);
 			}
 		} else {
-			void *cookie = NULL;
-
-			while ((ian = avl_destroy_nodes(t, &cookie)) != NULL) {
-				list_move_tail(&itxg->itxg_itxs->i_sync_list,
-				    &ian->ia_list);
-				list_destroy(&ian->ia_list);
-				kmem_free(ian, sizeof (itx_async_node_t));
-			}
+			zil_async_merge_all(itxg->itxg_itxs);
 		}
 		mutex_exit(&itxg->itxg_lock);
 	}
@@ -3143,6 +3284,19 @@ zil_commit_writer(zilog_t *zilog, zil_commit_waiter_t *zcw)
 	ASSERT(!MUTEX_HELD(&zilog->zl_lock));
 	ASSERT(spa_writeable(zilog->zl_spa));
 
+	/*
+	 * When many threads commit at once, the thread holding the
+	 * zl_issuer_lock usually picks up the commit itxs of the others
+	 * queued before it gathered the commit list.  Check for that
+	 * before queueing on the lock, so those threads go straight to
+	 * waiting for their lwb instead of taking the lock in turn.
+	 */
+	mutex_enter(&zcw->zcw_lock);
+	boolean_t linked = (zcw->zcw_lwb != NULL || zcw->zcw_done);
+	mutex_exit(&zcw->zcw_lock);
+	if (linked)
+		return (0);
+
 	list_create(&ilwbs, sizeof (lwb_t), offsetof(lwb_t, lwb_issue_node));
 	mutex_enter(&zilog->zl_issuer_lock);
 
@@ -3877,9 +4031,21 @@ zil_alloc(objset_t *os, zil_header_t *zh_phys)
 	mutex_init(&zilog->zl_issuer_lock, NULL, MUTEX_DEFAULT, NULL);
 	mutex_init(&zilog->zl_lwb_io_lock, NULL, MUTEX_DEFAULT, NULL);
 
+	zilog->zl_itx_nsublists = MAX(MIN(boot_ncpus, ZIL_ITX_SUBLISTS_MAX),
+	    1);
 	for (int i = 0; i < TXG_SIZE; i++) {
-		mutex_init(&zilog->zl_itxg[i].itxg_lock, NULL,
-		    MUTEX_DEFAULT, NULL);
+		itxg_t *itxg = &zilog->zl_itxg[i];
+
+		mutex_init(&itxg->itxg_lock, NULL, MUTEX_DEFAULT, NULL);
+		itxg->itxg_sublists = kmem_zalloc(zilog->zl_itx_nsublists *
+		    sizeof (itx_sublist_t), KM_SLEEP);
+		for (uint_t j = 0; j < zilog->zl_itx_nsublists; j++) {
+			itx_sublist_t *is = &itxg->itxg_sublists[j];
+
+			mutex_init(&is->is_lock, NULL, MUTEX_DEFAULT, NULL);
+			list_create(&is->is_list, sizeof (itx_t),
+			    offsetof(itx_t, itx_node));
+		}
 	}
 
 	list_create(&zilog->zl_lwb_list, sizeof (lwb_t),
@@ -3923,9 +4089,24 @@ zil_free(zilog_t *zilog)
 		 *
 		 * Also free up the ziltest itxs.
 		 */
-		if (zilog->zl_itxg[i].itxg_itxs)
-			zil_itxg_clean(zilog->zl_itxg[i].itxg_itxs);
-		mutex_destroy(&zilog->zl_itxg[i].itxg_lock);
+		itxg_t *itxg = &zilog->zl_itxg[i];
+
+		mutex_enter(&itxg->itxg_lock);
+		zil_itxg_sublists_enter(zilog, itxg);
+		zil_itxg_sublists_gather(zilog, itxg);
+		zil_itxg_sublists_exit(zilog, itxg);
+		mutex_exit(&itxg->itxg_lock);
+		if (itxg->itxg_itxs)
+			zil_itxg_clean(itxg->itxg_itxs);
+		for (uint_t j = 0; j < zilog->zl_itx_nsublists; j++) {
+			itx_sublist_t *is = &itxg->itxg_sublists[j];
+
+			list_destroy(&is->is_list);
+			mutex_destroy(&is->is_lock);
+		}
+		kmem_free(itxg->itxg_sublists, zilog->zl_itx_nsublists *
+		    sizeof (itx_sublist_t));
+		mutex_destroy(&itxg->itxg_lock);
 	}
 
 	mutex_destroy(&zilog->zl_issuer_lock);
@@ -139,6 +139,13 @@ static uint_t zfs_sync_pass_rewrite = 2;
 int zio_exclude_metadata = 0;
 static int zio_requeue_io_start_cut_in_line = 1;
 
+/*
+ * Verify the checksum of a scattered compressed block while copying it into
+ * the linear buffer its decompression needs, instead of walking the
+ * compressed data twice.
+ */
+static int zio_fused_verify = B_TRUE;
+
 #ifdef ZFS_DEBUG
 static const int zio_buf_debug_limit = 16384;
 #else
@@ -233,6 +240,7 @@ zio_init(void)
 	}
 
 	zio_inject_init();
+	zio_compress_init();
 
 	lz4_init();
 }
@@ -289,6 +297,7 @@ zio_fini(void)
 	kmem_cache_destroy(zio_link_cache);
 	kmem_cache_destroy(zio_cache);
 
+	zio_compress_fini();
 	zio_inject_fini();
 
 	lz4_fini();
@@ -441,6 +450,7 @@ zio_push_transform(zio_t *zio, abd_t *data, uint64_t size, uint64_t bufsize,
 	zt->zt_orig_size = zio->io_size;
 	zt->zt_bufsize = bufsize;
 	zt->zt_transform = transform;
+	zt->zt_linear_abd = NULL;
 
 	zt->zt_next = zio->io_transform_stack;
 	zio->io_transform_stack = zt;
@@ -455,6 +465,16 @@ zio_pop_transforms(zio_t *zio)
 	zio_transform_t *zt;
 
 	while ((zt = zio->io_transform_stack) != NULL) {
+		/*
+		 * A linear copy of our buffer was made while verifying its
+		 * checksum; see zio_checksum_verify_fused().
+		 */
+		if (zt->zt_linear_abd != NULL) {
+			ASSERT3U(zt->zt_bufsize, !=, 0);
+			abd_free(zio->io_abd);
+			zio->io_abd = zt->zt_linear_abd;
+		}
+
 		if (zt->zt_transform != NULL)
 			zt->zt_transform(zio,
 			    zt->zt_orig_abd, zt->zt_orig_size);
@@ -998,6 +1018,8 @@ zio_create(zio_t *pio, spa_t *spa, uint64_t txg, const blkptr_t *bp,
 void
 zio_destroy(zio_t *zio)
 {
+	if (zio->io_verified_abd != NULL)
+		abd_free(zio->io_verified_abd);
 	metaslab_trace_fini(&zio->io_alloc_list);
 	list_destroy(&zio->io_parent_list);
 	list_destroy(&zio->io_child_list);
@@ -1908,11 +1930,27 @@ zio_write_compress(zio_t *zio)
 	if (compress != ZIO_COMPRESS_OFF &&
 	    !(zio->io_flags & ZIO_FLAG_RAW_COMPRESS)) {
 		abd_t *cabd = NULL;
+		compress = zio_compress_for_block(spa, compress, lsize);
 		if (abd_cmp_zero(zio->io_abd, lsize) == 0)
 			psize = 0;
 		else if (compress == ZIO_COMPRESS_EMPTY)
 			psize = lsize;
-		else
+		else if (!zp->zp_dedup && !zp->zp_nopwrite &&
+		    zio_compress_hopeless(zio->io_abd, lsize)) {
+			/*
+			 * Dedup and nopwrite match on the checksum of the
+			 * stored data, so for them keep compressing exactly
+			 * as blocks written before this check were.
+			 */
+			psize = lsize;
+			if (zp->zp_compress_sums != NULL) {
+				wmsum_add(&zp->zp_compress_sums->zcs_skipped,
+				    1);
+				wmsum_add(
+				    &zp->zp_compress_sums->zcs_skipped_bytes,
+				    lsize);
+			}
+		} else
 			psize = zio_compress_data(compress, zio->io_abd, &cabd,
 			    lsize,
 			    zio_get_compression_max_size(compress,
@@ -3139,6 +3177,7 @@ zio_write_gang_block(zio_t *pio, metaslab_class_t *mc)
 		zp.zp_encrypt = gio->io_prop.zp_encrypt;
 		zp.zp_byteorder = gio->io_prop.zp_byteorder;
 		zp.zp_direct_write = B_FALSE;
+		zp.zp_compress_sums = NULL;
 		memset(zp.zp_salt, 0, ZIO_DATA_SALT_LEN);
 		memset(zp.zp_iv, 0, ZIO_DATA_IV_LEN);
 		memset(zp.zp_mac, 0, ZIO_DATA_MAC_LEN);
@@ -4844,6 +4883,74 @@ zio_checksum_generate(zio_t *zio)
 	return (zio);
 }
 
+/*
+ * The checksum of a read is verified by the vdev zio closest to the leaves
+ * (or by the RAID-Z/dRAID zio, in raidz_checksum_verify()), while the block
+ * is decompressed much later, either by the logical zio when it pops its
+ * transforms or, with compressed ARC, by arc_read_done().  Both borrow a
+ * linear copy of a scattered buffer to decompress it.  If this zio read
+ * straight into the logical zio's buffer, verify the checksum with
+ * zio_checksum_error_copy() while making that linear copy and hand it over:
+ *
+ * - to the decompress transform, if the logical zio has one, which
+ *   zio_pop_transforms() then decompresses from;
+ * - otherwise, for a compressed block read raw into the ARC, to the logical
+ *   zio's io_verified_abd, which arc_read_done() decompresses from.
+ *
+ * This does not fuse the checksum into the decompressor itself; it only
+ * saves the second walk over the compressed data.  Returns ENOTSUP if the
+ * fused path does not apply.
+ */
+int
+zio_checksum_verify_fused(zio_t *zio, zio_bad_cksum_t *info)
+{
+	zio_t *lio = zio->io_logical;
+	blkptr_t *bp = zio->io_bp;
+	zio_transform_t *zt;
+	abd_t **labdp;
+	abd_t *labd;
+	int error;
+
+	if (!zio_fused_verify || lio == NULL || lio == zio || bp == NULL ||
+	    zio->io_abd != lio->io_abd || abd_is_linear(zio->io_abd) ||
+	    (zio->io_flags & ZIO_FLAG_DIO_READ))
+		return (SET_ERROR(ENOTSUP));
+
+	zt = lio->io_transform_stack;
+	if (zt != NULL) {
+		if (zt->zt_transform != zio_decompress || zt->zt_bufsize == 0)
+			return (SET_ERROR(ENOTSUP));
+		labdp = &zt->zt_linear_abd;
+	} else {
+		if (!(lio->io_flags & ZIO_FLAG_RAW_COMPRESS) ||
+		    (lio->io_flags & ZIO_FLAG_RAW_ENCRYPT) ||
+		    BP_GET_COMPRESS(bp) == ZIO_COMPRESS_OFF ||
+		    BP_IS_PROTECTED(bp) || lio->io_size != BP_GET_PSIZE(bp))
+			return (SET_ERROR(ENOTSUP));
+		labdp = &lio->io_verified_abd;
+	}
+
+	labd = abd_alloc_linear(abd_get_size(zio->io_abd),
+	    (zio->io_abd->abd_flags & ABD_FLAG_META) != 0);
+	error = zio_checksum_error_copy(zio, labd, info);
+	if (error != 0) {
+		abd_free(labd);
+		return (error);
+	}
+
+	/*
+	 * Only verified data is handed over.  Children that read into the
+	 * logical zio's buffer run one at a time (scrubs read each copy into
+	 * its own buffer), so if an earlier copy is still attached, it came
+	 * from a retry or a RAID-Z reconstruction attempt; replace it.
+	 */
+	if (*labdp != NULL)
+		abd_free(*labdp);
+	*labdp = labd;
+
+	return (0);
+}
+
 static zio_t *
 zio_checksum_verify(zio_t *zio)
 {
@@ -4868,7 +4975,10 @@ zio_checksum_verify(zio_t *zio)
 	IMPLY(zio->io_flags & ZIO_FLAG_DIO_READ,
 	    !(zio->io_flags & ZIO_FLAG_SPECULATIVE));
 
-	if ((error = zio_checksum_error(zio, &info)) != 0) {
+	error = zio_checksum_verify_fused(zio, &info);
+	if (error == ENOTSUP)
+		error = zio_checksum_error(zio, &info);
+	if (error != 0) {
 		zio->io_error = error;
 		if (error == ECKSUM &&
 		    !(zio->io_flags & ZIO_FLAG_SPECULATIVE)) {
@@ -5709,6 +5819,9 @@ EXPORT_SYMBOL(zio_data_buf_free);
 ZFS_MODULE_PARAM(zfs_zio, zio_, slow_io_ms, INT, ZMOD_RW,
 	"Max I/O completion time (milliseconds) before marking it as slow");
 
+ZFS_MODULE_PARAM(zfs_zio, zio_, fused_verify, INT, ZMOD_RW,
+	"Verify checksum while linearizing data for decompression");
+
 ZFS_MODULE_PARAM(zfs_zio, zio_, requeue_io_start_cut_in_line, INT, ZMOD_RW,
 	"Prioritize requeued I/O");
 
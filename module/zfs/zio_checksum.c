@@ -160,6 +160,48 @@ abd_fletcher_4_byteswap(abd_t *abd, uint64_t size,
 	abd_fletcher_4_impl(abd, size, &acd);
 }
 
+typedef struct abd_fletcher_4_copy {
+	zio_abd_checksum_data_t	fc_acd;
+	char			*fc_buf;
+} abd_fletcher_4_copy_t;
+
+static int
+abd_fletcher_4_copy_iter(void *data, size_t size, void *private)
+{
+	abd_fletcher_4_copy_t *fc = private;
+
+	memcpy(fc->fc_buf, data, size);
+	(void) fletcher_4_abd_ops.acf_iter(fc->fc_buf, size, &fc->fc_acd);
+	fc->fc_buf += size;
+
+	return (0);
+}
+
+/*
+ * Copy the first size bytes of abd into the linear buffer buf and compute
+ * their native Fletcher-4 checksum in the same pass.  Every ABD chunk is
+ * checksummed right after it has been copied, while it is still hot in the
+ * CPU cache, using the currently selected fletcher_4 implementation.
+ */
+void
+abd_fletcher_4_copy_native(abd_t *abd, void *buf, uint64_t size,
+    zio_cksum_t *zcp)
+{
+	fletcher_4_ctx_t ctx;
+	abd_fletcher_4_copy_t fc = {
+		.fc_acd = {
+			.acd_byteorder	= ZIO_CHECKSUM_NATIVE,
+			.acd_zcp	= zcp,
+			.acd_ctx	= &ctx
+		},
+		.fc_buf = buf
+	};
+
+	fletcher_4_abd_ops.acf_init(&fc.fc_acd);
+	(void) abd_iterate_func(abd, 0, size, abd_fletcher_4_copy_iter, &fc);
+	fletcher_4_abd_ops.acf_fini(&fc.fc_acd);
+}
+
 /*
  * Checksum vectors.
  *
@@ -417,6 +459,50 @@ zio_checksum_compute(zio_t *zio, enum zio_checksum checksum,
 	}
 }
 
+/*
+ * Compare a computed block checksum against the expected one and fill in
+ * the checksum error info for the caller.
+ */
+static int
+zio_checksum_compare(const blkptr_t *bp, zio_checksum_info_t *ci,
+    int byteswap, zio_cksum_t *actualp, zio_cksum_t *expectedp,
+    zio_bad_cksum_t *info)
+{
+	zio_cksum_t actual_cksum = *actualp, expected_cksum = *expectedp;
+
+	/*
+	 * MAC checksums are a special case since half of this checksum will
+	 * actually be the encryption MAC. This will be verified by the
+	 * decryption process, so we just check the truncated checksum now.
+	 * Objset blocks use embedded MACs so we don't truncate the checksum
+	 * for them.
+	 */
+	if (bp != NULL && BP_USES_CRYPT(bp) &&
+	    BP_GET_TYPE(bp) != DMU_OT_OBJSET) {
+		if (!(ci->ci_flags & ZCHECKSUM_FLAG_DEDUP)) {
+			actual_cksum.zc_word[0] ^= actual_cksum.zc_word[2];
+			actual_cksum.zc_word[1] ^= actual_cksum.zc_word[3];
+		}
+
+		actual_cksum.zc_word[2] = 0;
+		actual_cksum.zc_word[3] = 0;
+		expected_cksum.zc_word[2] = 0;
+		expected_cksum.zc_word[3] = 0;
+	}
+
+	if (info != NULL) {
+		info->zbc_checksum_name = ci->ci_name;
+		info->zbc_byteswapped = byteswap;
+		info->zbc_injected = 0;
+		info->zbc_has_cksum = 1;
+	}
+
+	if (!ZIO_CHECKSUM_EQUAL(actual_cksum, expected_cksum))
+		return (SET_ERROR(ECKSUM));
+
+	return (0);
+}
+
 int
 zio_checksum_error_impl(spa_t *spa, const blkptr_t *bp,
     enum zio_checksum checksum, abd_t *abd, uint64_t size, uint64_t offset,
@@ -504,37 +590,8 @@ zio_checksum_error_impl(spa_t *spa, const blkptr_t *bp,
 		    spa->spa_cksum_tmpls[checksum], &actual_cksum);
 	}
 
-	/*
-	 * MAC checksums are a special case since half of this checksum will
-	 * actually be the encryption MAC. This will be verified by the
-	 * decryption process, so we just check the truncated checksum now.
-	 * Objset blocks use embedded MACs so we don't truncate the checksum
-	 * for them.
-	 */
-	if (bp != NULL && BP_USES_CRYPT(bp) &&
-	    BP_GET_TYPE(bp) != DMU_OT_OBJSET) {
-		if (!(ci->ci_flags & ZCHECKSUM_FLAG_DEDUP)) {
-			actual_cksum.zc_word[0] ^= actual_cksum.zc_word[2];
-			actual_cksum.zc_word[1] ^= actual_cksum.zc_word[3];
-		}
-
-		actual_cksum.zc_word[2] = 0;
-		actual_cksum.zc_word[3] = 0;
-		expected_cksum.zc_word[2] = 0;
-		expected_cksum.zc_word[3] = 0;
-	}
-
-	if (info != NULL) {
-		info->zbc_checksum_name = ci->ci_name;
-		info->zbc_byteswapped = byteswap;
-		info->zbc_injected = 0;
-		info->zbc_has_cksum = 1;
-	}
-
-	if (!ZIO_CHECKSUM_EQUAL(actual_cksum, expected_cksum))
-		return (SET_ERROR(ECKSUM));
-
-	return (0);
+	return (zio_checksum_compare(bp, ci, byteswap, &actual_cksum,
+	    &expected_cksum, info));
 }
 
 int
@@ -562,6 +619,48 @@ zio_checksum_error(zio_t *zio, zio_bad_cksum_t *info)
 	return (error);
 }
 
+/*
+ * Like zio_checksum_error(), but also copies the block into the linear
+ * ABD dst in the same pass that computes its checksum.  This is used when
+ * the block is about to be decompressed, since the decompressors need a
+ * linear copy of a scattered source anyway.  Only native Fletcher-4 blocks
+ * are handled; for anything else ENOTSUP is returned without touching dst
+ * and the caller should fall back to zio_checksum_error().
+ */
+int
+zio_checksum_error_copy(zio_t *zio, abd_t *dst, zio_bad_cksum_t *info)
+{
+	blkptr_t *bp = zio->io_bp;
+	zio_checksum_info_t *ci = &zio_checksum_table[ZIO_CHECKSUM_FLETCHER_4];
+	zio_cksum_t actual_cksum, expected_cksum;
+	uint64_t size;
+	int error;
+
+	if (bp == NULL || BP_IS_GANG(bp) ||
+	    BP_GET_CHECKSUM(bp) != ZIO_CHECKSUM_FLETCHER_4 ||
+	    BP_SHOULD_BYTESWAP(bp))
+		return (SET_ERROR(ENOTSUP));
+
+	size = BP_GET_PSIZE(bp);
+	ASSERT(abd_is_linear(dst));
+	ASSERT3U(abd_get_size(dst), >=, size);
+
+	abd_fletcher_4_copy_native(zio->io_abd, abd_to_buf(dst), size,
+	    &actual_cksum);
+	expected_cksum = bp->blk_cksum;
+
+	error = zio_checksum_compare(bp, ci, B_FALSE, &actual_cksum,
+	    &expected_cksum, info);
+
+	if (zio_injection_enabled && error == 0 && zio->io_error == 0) {
+		error = zio_handle_fault_injection(zio, ECKSUM);
+		if (error != 0)
+			info->zbc_injected = 1;
+	}
+
+	return (error);
+}
+
 /*
  * Called by a spa_t that's about to be deallocated. This steps through
  * all of the checksum context templates and deallocates any that were
@@ -42,6 +42,28 @@
  */
 static unsigned long zio_decompress_fail_fraction = 0;
 
+/*
+ * Writes whose sampled byte entropy is at least this percentage of the
+ * maximum (8 bits per byte) are stored without calling the compressor,
+ * see zio_compress_hopeless().  Lower values skip more blocks, at the risk
+ * of storing some blocks uncompressed that would have compressed by just
+ * enough to be kept.  100 disables the estimate.
+ */
+static uint_t zfs_compress_skip_entropy = 98;
+
+/*
+ * The estimate samples ZIO_COMPRESS_SAMPLE_RUN byte runs spread evenly
+ * over the block, at most ZIO_COMPRESS_SAMPLE_MAX bytes in total and never
+ * more than 1/8 of the block.  Blocks smaller than ZIO_COMPRESS_SAMPLE_MIN
+ * are always compressed; the compressor is cheap there and a sample of a
+ * few hundred bytes says little about them.
+ */
+#define	ZIO_COMPRESS_SAMPLE_RUN		32
+#define	ZIO_COMPRESS_SAMPLE_MAX		4096
+#define	ZIO_COMPRESS_SAMPLE_MIN		(8 * 1024)
+#define	ZIO_COMPRESS_GRAM_SHIFT		11
+#define	ZIO_COMPRESS_GRAM_SLOTS		(1 << ZIO_COMPRESS_GRAM_SHIFT)
+
 /*
  * Compression vectors.
  */
@@ -76,6 +98,9 @@ zio_compress_info_t zio_compress_table[ZIO_COMPRESS_FUNCTIONS] = {
 	    zfs_lz4_compress,	zfs_lz4_decompress, NULL},
 	{"zstd",	ZIO_ZSTD_LEVEL_DEFAULT,
 	    zfs_zstd_compress,	zfs_zstd_decompress, zfs_zstd_decompress_level},
+	{"zstd-frames",	ZIO_ZSTD_LEVEL_DEFAULT,
+	    zfs_zstd_compress_frames, zfs_zstd_decompress_frames,
+	    zfs_zstd_decompress_frames_level},
 };
 
 uint8_t
@@ -119,6 +144,218 @@ zio_compress_select(spa_t *spa, enum zio_compress child,
 	return (result);
 }
 
+/*
+ * Pick the on-disk compression function for a block of the given logical
+ * size.  Large zstd records are stored as independent frames once the pool
+ * supports it, see zfs_zstd_compress_frames().  The choice only depends on
+ * the block and the pool, so a block compresses the same way every time.
+ */
+enum zio_compress
+zio_compress_for_block(spa_t *spa, enum zio_compress c, uint64_t lsize)
+{
+	if (c == ZIO_COMPRESS_ZSTD && lsize >= ZFS_ZSTD_FRAMES_MIN_SIZE &&
+	    spa_feature_is_enabled(spa, SPA_FEATURE_ZSTD_FRAMES))
+		return (ZIO_COMPRESS_ZSTD_FRAMES);
+	return (c);
+}
+
+typedef struct zio_compress_sample {
+	uint64_t	zsm_off;	/* offset of the current chunk */
+	uint64_t	zsm_next;	/* offset of the next run */
+	uint64_t	zsm_stride;	/* distance between runs */
+	uint_t		zsm_run;	/* index of the next run */
+	uint_t		zsm_count;	/* bytes sampled */
+	uint_t		zsm_matches;	/* 4-byte sequences seen before */
+	uint16_t	zsm_hist[256];
+	uint32_t	zsm_table[ZIO_COMPRESS_GRAM_SLOTS];
+} zio_compress_sample_t;
+
+/*
+ * The sample is too large for the stack, and a kmem_zalloc() of it for
+ * every compressible write is far from free, so keep them in a cache.
+ */
+static kmem_cache_t *zio_compress_sample_cache;
+
+/*
+ * Look up a 4-byte sequence among those seen so far in the sample, and
+ * remember it if asked to.  Remembering only every fourth sequence keeps
+ * the table small while still catching any repeat of 7 bytes or more.
+ */
+static void
+zio_compress_sample_gram(zio_compress_sample_t *zsm, uint32_t gram,
+    boolean_t insert)
+{
+	uint_t slot = (gram * 0x9e3779b1U) >> (32 - ZIO_COMPRESS_GRAM_SHIFT);
+
+	for (;;) {
+		if (zsm->zsm_table[slot] == gram) {
+			zsm->zsm_matches++;
+			return;
+		}
+		if (zsm->zsm_table[slot] == 0) {
+			if (insert)
+				zsm->zsm_table[slot] = gram;
+			return;
+		}
+		slot = (slot + 1) & (ZIO_COMPRESS_GRAM_SLOTS - 1);
+	}
+}
+
+/*
+ * Runs start at a fixed pseudo-random offset within each stride, so that
+ * repeats with a period that happens to line up with the stride are still
+ * sampled at different phases.
+ */
+static uint64_t
+zio_compress_sample_next(zio_compress_sample_t *zsm)
+{
+	uint_t run = zsm->zsm_run++;
+	uint32_t h = run * 0x9e3779b1U;
+
+	h = (h ^ (h >> 16)) * 0x85ebca6bU;
+	h = (h ^ (h >> 13)) * 0xc2b2ae35U;
+	h ^= h >> 16;
+	uint64_t jitter = h % (zsm->zsm_stride - ZIO_COMPRESS_SAMPLE_RUN + 1);
+
+	return (run * zsm->zsm_stride + jitter);
+}
+
+static int
+zio_compress_sample_cb(void *buf, size_t size, void *private)
+{
+	zio_compress_sample_t *zsm = private;
+	const uint8_t *p = buf;
+	uint64_t end = zsm->zsm_off + size;
+
+	while (zsm->zsm_next < end &&
+	    zsm->zsm_count < ZIO_COMPRESS_SAMPLE_MAX) {
+		uint64_t start = zsm->zsm_next - zsm->zsm_off;
+		uint64_t len = MIN(ZIO_COMPRESS_SAMPLE_RUN, size - start);
+		uint32_t gram = 0;
+
+		for (uint64_t i = 0; i < len; i++) {
+			zsm->zsm_hist[p[start + i]]++;
+			gram = (gram << 8) | p[start + i];
+			if (i >= 3)
+				zio_compress_sample_gram(zsm, gram, i % 4 == 3);
+		}
+		zsm->zsm_count += len;
+		zsm->zsm_next = zio_compress_sample_next(zsm);
+	}
+	zsm->zsm_off = end;
+
+	return (0);
+}
+
+/*
+ * log2(x) in 1/256ths of a bit, for x >= 1.
+ */
+static uint64_t
+zio_compress_log2(uint64_t x)
+{
+	int b = highbit64(x) - 1;
+	uint64_t m = (b > 15) ? x >> (b - 15) : x << (15 - b);
+	uint64_t frac = 0;
+
+	/* m is x scaled into [1, 2) as 1.15 fixed point; square it out. */
+	for (int i = 0; i < 8; i++) {
+		m = (m * m) >> 15;
+		frac <<= 1;
+		if (m >= (2ULL << 15)) {
+			m >>= 1;
+			frac |= 1;
+		}
+	}
+
+	return (((uint64_t)b << 8) | frac);
+}
+
+/*
+ * Cheaply guess whether compressing a block would be a waste of time.
+ * The order-0 entropy of a sample of the block is compared against
+ * zfs_compress_skip_entropy; already compressed or encrypted data sits
+ * at close to 8 bits per byte while anything the compressors can shrink
+ * by the required 1/8 nearly always sits well below that.  Data made of
+ * repeated random-looking content is the exception, so a block is never
+ * reported hopeless if any part of the sample repeats itself; for random
+ * data a repeated 4-byte sequence within a few KiB is very unlikely.
+ *
+ * The result depends only on the block contents, so the same data is
+ * always treated the same way.
+ */
+boolean_t
+zio_compress_hopeless(abd_t *src, size_t s_len)
+{
+	uint_t pct = zfs_compress_skip_entropy;
+
+	if (pct >= 100 || s_len < ZIO_COMPRESS_SAMPLE_MIN)
+		return (B_FALSE);
+
+	zio_compress_sample_t *zsm =
+	    kmem_cache_alloc(zio_compress_sample_cache, KM_SLEEP);
+	memset(zsm, 0, sizeof (*zsm));
+	zsm->zsm_stride = MAX(s_len /
+	    (ZIO_COMPRESS_SAMPLE_MAX / ZIO_COMPRESS_SAMPLE_RUN),
+	    8 * ZIO_COMPRESS_SAMPLE_RUN);
+	zsm->zsm_next = zio_compress_sample_next(zsm);
+	(void) abd_iterate_func(src, 0, s_len, zio_compress_sample_cb, zsm);
+
+	boolean_t hopeless = B_FALSE;
+	uint64_t n = zsm->zsm_count;
+	uint64_t sum = 0, used = 0;
+
+	for (int i = 0; i < 256; i++) {
+		uint64_t c = zsm->zsm_hist[i];
+		if (c != 0) {
+			sum += c * zio_compress_log2(c);
+			used++;
+		}
+	}
+
+	/*
+	 * H = log2(n) - sum(c * log2(c)) / n, in 1/256ths of a bit, plus the
+	 * Miller-Madow correction (used - 1) / (2n ln 2) for the bias of
+	 * estimating entropy from a small sample.
+	 */
+	int64_t entropy = (int64_t)zio_compress_log2(n) - (int64_t)(sum / n) +
+	    (int64_t)((used - 1) * 256 * 10000 / (13863 * n));
+
+	if (entropy * 100 >= (int64_t)pct * 8 * 256 && zsm->zsm_matches == 0)
+		hopeless = B_TRUE;
+
+	kmem_cache_free(zio_compress_sample_cache, zsm);
+
+	return (hopeless);
+}
+
+void
+zio_compress_init(void)
+{
+	zio_compress_sample_cache = kmem_cache_create("zio_compress_sample",
+	    sizeof (zio_compress_sample_t), 0, NULL, NULL, NULL, NULL, NULL, 0);
+}
+
+void
+zio_compress_fini(void)
+{
+	kmem_cache_destroy(zio_compress_sample_cache);
+	zio_compress_sample_cache = NULL;
+}
+
+void
+zio_compress_sums_init(zio_compress_sums_t *zcs)
+{
+	wmsum_init(&zcs->zcs_skipped, 0);
+	wmsum_init(&zcs->zcs_skipped_bytes, 0);
+}
+
+void
+zio_compress_sums_fini(zio_compress_sums_t *zcs)
+{
+	wmsum_fini(&zcs->zcs_skipped);
+	wmsum_fini(&zcs->zcs_skipped_bytes);
+}
+
 size_t
 zio_compress_data(enum zio_compress c, abd_t *src, abd_t **dst, size_t s_len,
     size_t d_len, uint8_t level)
@@ -132,7 +369,7 @@ zio_compress_data(enum zio_compress c, abd_t *src, abd_t **dst, size_t s_len,
 
 	complevel = ci->ci_level;
 
-	if (c == ZIO_COMPRESS_ZSTD) {
+	if (c == ZIO_COMPRESS_ZSTD || c == ZIO_COMPRESS_ZSTD_FRAMES) {
 		/* If we don't know the level, we can't compress it */
 		if (level == ZIO_COMPLEVEL_INHERIT)
 			return (s_len);
@@ -188,8 +425,14 @@ zio_compress_to_feature(enum zio_compress comp)
 	switch (comp) {
 	case ZIO_COMPRESS_ZSTD:
 		return (SPA_FEATURE_ZSTD_COMPRESS);
+	case ZIO_COMPRESS_ZSTD_FRAMES:
+		return (SPA_FEATURE_ZSTD_FRAMES);
 	default:
 		break;
 	}
 	return (SPA_FEATURE_NONE);
 }
+
+ZFS_MODULE_PARAM(zfs, zfs_, compress_skip_entropy, UINT, ZMOD_RW,
+	"Skip compressing blocks whose sampled entropy is at least this "
+	"percentage of the maximum (100 disables)");
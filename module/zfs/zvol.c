@@ -1055,6 +1055,7 @@ zvol_setup_zv(zvol_state_t *zv)
 
 	zv->zv_zilog = NULL;
 	zv->zv_flags &= ~ZVOL_WRITTEN_TO;
+	dataset_kstats_attach(&zv->zv_kstat, os);
 
 	error = dsl_prop_get_integer(zv->zv_name, "readonly", &ro, NULL);
 	if (error)
@@ -53,6 +53,10 @@
 static uint_t zstd_earlyabort_pass = 1;
 static int zstd_cutoff_level = ZIO_ZSTD_LEVEL_3;
 static unsigned int zstd_abort_size = (128 * 1024);
+static uint_t zstd_frame_threads = 4;
+
+/* Helper threads for compressing and decompressing frames in parallel */
+static taskq_t *zstd_frame_taskq = NULL;
 
 static kstat_t *zstd_ksp = NULL;
 
@@ -81,6 +85,11 @@ typedef struct zstd_stats {
 	 */
 	kstat_named_t	zstd_stat_passignored;
 	kstat_named_t	zstd_stat_passignored_size;
+	/*
+	 * Blocks compressed or decompressed as parallel frames
+	 */
+	kstat_named_t	zstd_stat_frame_compress;
+	kstat_named_t	zstd_stat_frame_decompress;
 	kstat_named_t	zstd_stat_buffers;
 	kstat_named_t	zstd_stat_size;
 } zstd_stats_t;
@@ -101,6 +110,8 @@ static zstd_stats_t zstd_stats = {
 	{ "zstdpass_rejected",		KSTAT_DATA_UINT64 },
 	{ "passignored",		KSTAT_DATA_UINT64 },
 	{ "passignored_size",		KSTAT_DATA_UINT64 },
+	{ "frame_compress",		KSTAT_DATA_UINT64 },
+	{ "frame_decompress",		KSTAT_DATA_UINT64 },
 	{ "buffers",			KSTAT_DATA_UINT64 },
 	{ "size",			KSTAT_DATA_UINT64 },
 };
@@ -429,26 +440,14 @@ zstd_enum_to_level(enum zio_zstd_levels level, int16_t *zstd_level)
 	return (1);
 }
 
-/* Compress block using zstd */
+/* Compress a single magicless frame, returning 0 on failure */
 static size_t
-zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
-    int level)
+zstd_compress_frame(const void *src, size_t s_len, void *dst, size_t d_len,
+    int16_t zstd_level)
 {
 	size_t c_len;
-	int16_t zstd_level;
-	zfs_zstdhdr_t *hdr;
 	ZSTD_CCtx *cctx;
 
-	hdr = (zfs_zstdhdr_t *)d_start;
-
-	/* Skip compression if the specified level is invalid */
-	if (zstd_enum_to_level(level, &zstd_level)) {
-		ZSTDSTAT_BUMP(zstd_stat_com_inval);
-		return (s_len);
-	}
-
-	ASSERT3U(d_len, >=, sizeof (*hdr));
-	ASSERT3U(d_len, <=, s_len);
 	ASSERT3U(zstd_level, !=, 0);
 
 	cctx = ZSTD_createCCtx_advanced(zstd_malloc);
@@ -459,7 +458,7 @@ zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
 	 */
 	if (!cctx) {
 		ZSTDSTAT_BUMP(zstd_stat_com_alloc_fail);
-		return (s_len);
+		return (0);
 	}
 
 	/* Set the compression level */
@@ -475,10 +474,7 @@ zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
 	ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 0);
 	ZSTD_CCtx_setParameter(cctx, ZSTD_c_contentSizeFlag, 0);
 
-	c_len = ZSTD_compress2(cctx,
-	    hdr->data,
-	    d_len - sizeof (*hdr),
-	    s_start, s_len);
+	c_len = ZSTD_compress2(cctx, dst, d_len, src, s_len);
 
 	ZSTD_freeCCtx(cctx);
 
@@ -494,9 +490,43 @@ zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
 			ZSTDSTAT_BUMP(zstd_stat_com_fail);
 			dprintf("Error: %s", ZSTD_getErrorString(err));
 		}
-		return (s_len);
+		return (0);
 	}
 
+	return (c_len);
+}
+
+/* Decompress one or more magicless frames, returning 0 on failure */
+static size_t
+zstd_decompress_frame(const void *src, size_t s_len, void *dst, size_t d_len)
+{
+	ZSTD_DCtx *dctx;
+	size_t result;
+
+	dctx = ZSTD_createDCtx_advanced(zstd_dctx_malloc);
+	if (!dctx) {
+		ZSTDSTAT_BUMP(zstd_stat_dec_alloc_fail);
+		return (0);
+	}
+
+	/* Set header type to "magicless" */
+	ZSTD_DCtx_setParameter(dctx, ZSTD_d_format, ZSTD_f_zstd1_magicless);
+
+	/* Decompress the data and release the context */
+	result = ZSTD_decompressDCtx(dctx, dst, d_len, src, s_len);
+	ZSTD_freeDCtx(dctx);
+
+	if (ZSTD_isError(result)) {
+		ZSTDSTAT_BUMP(zstd_stat_dec_fail);
+		return (0);
+	}
+
+	return (result);
+}
+
+static void
+zstd_set_header(zfs_zstdhdr_t *hdr, size_t c_len, int level)
+{
 	/*
 	 * Encode the compressed buffer size at the start. We'll need this in
 	 * decompression to counter the effects of padding which might be added
@@ -531,14 +561,373 @@ zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
 	zfs_set_hdrversion(hdr, ZSTD_VERSION_NUMBER);
 	zfs_set_hdrlevel(hdr, level);
 	hdr->raw_version_level = BE_32(hdr->raw_version_level);
+}
+
+/* Compress block using zstd */
+static size_t
+zfs_zstd_compress_impl(void *s_start, void *d_start, size_t s_len, size_t d_len,
+    int level)
+{
+	size_t c_len;
+	int16_t zstd_level;
+	zfs_zstdhdr_t *hdr;
+
+	hdr = (zfs_zstdhdr_t *)d_start;
+
+	/* Skip compression if the specified level is invalid */
+	if (zstd_enum_to_level(level, &zstd_level)) {
+		ZSTDSTAT_BUMP(zstd_stat_com_inval);
+		return (s_len);
+	}
+
+	ASSERT3U(d_len, >=, sizeof (*hdr));
+	ASSERT3U(d_len, <=, s_len);
+
+	c_len = zstd_compress_frame(s_start, s_len, hdr->data,
+	    d_len - sizeof (*hdr), zstd_level);
+	if (c_len == 0)
+		return (s_len);
+
+	zstd_set_header(hdr, c_len, level);
 
 	return (c_len + sizeof (*hdr));
 }
 
+/*
+ * Parallel frame handling.
+ *
+ * A job describes all of the frames of one block.  The calling thread and
+ * any helpers it managed to dispatch to zstd_frame_taskq claim frames from
+ * the job one at a time until none are left.  Since the caller always works
+ * on the job itself, it completes even if no helper ever gets to run.
+ *
+ * Compressed frames are committed to the output strictly in order.  The
+ * thread holding the oldest uncommitted frame compresses it straight into
+ * the output, since its offset is already known.  Any other thread
+ * compresses into a scratch buffer of its own and waits for its turn to
+ * copy the frame out, so a job never needs more than one scratch buffer per
+ * thread, rather than one per frame.
+ */
+typedef struct zstd_frame {
+	const uint8_t	*zf_src;
+	size_t		zf_src_len;
+	uint8_t		*zf_dst;	/* decompression only */
+	size_t		zf_dst_len;	/* decompression only */
+	size_t		zf_len;		/* output size, 0 on failure */
+} zstd_frame_t;
+
+typedef struct zstd_frame_job {
+	kmutex_t	zfj_lock;
+	kcondvar_t	zfj_cv;		/* last helper is done */
+	kcondvar_t	zfj_commit_cv;	/* a frame was committed */
+	zstd_frame_t	*zfj_frames;
+	uint_t		zfj_nframes;
+	uint_t		zfj_next;	/* next frame to be claimed */
+	uint_t		zfj_helpers;	/* dispatched helpers not yet done */
+	boolean_t	zfj_failed;
+	boolean_t	zfj_compress;
+	int16_t		zfj_level;
+	uint8_t		*zfj_out;	/* compression only, see above */
+	size_t		zfj_out_size;
+	size_t		zfj_out_len;	/* bytes committed */
+	uint_t		zfj_committed;	/* frames committed */
+	size_t		zfj_scratch_len;
+} zstd_frame_job_t;
+
+static inline void
+zstd_put_be32(uint8_t *p, uint32_t val)
+{
+	val = BE_32(val);
+	memcpy(p, &val, sizeof (val));
+}
+
+static inline uint32_t
+zstd_get_be32(const uint8_t *p)
+{
+	uint32_t val;
+	memcpy(&val, p, sizeof (val));
+	return (BE_32(val));
+}
+
+static void
+zstd_frame_fail(zstd_frame_job_t *job)
+{
+	ASSERT(MUTEX_HELD(&job->zfj_lock));
+	job->zfj_failed = B_TRUE;
+	cv_broadcast(&job->zfj_commit_cv);
+}
+
+/* Compress frame i and commit it to the output once all before it are */
+static void
+zstd_frame_compress_one(zstd_frame_job_t *job, uint_t i, uint8_t **scratchp)
+{
+	zstd_frame_t *zf = &job->zfj_frames[i];
+	uint8_t *dst = NULL;
+	size_t dst_len = 0;
+
+	mutex_enter(&job->zfj_lock);
+	boolean_t inplace = (job->zfj_committed == i);
+	if (inplace) {
+		dst = job->zfj_out + job->zfj_out_len;
+		dst_len = job->zfj_out_size - job->zfj_out_len;
+	}
+	mutex_exit(&job->zfj_lock);
+
+	if (!inplace) {
+		if (*scratchp == NULL)
+			*scratchp = vmem_alloc(job->zfj_scratch_len, KM_SLEEP);
+		dst = *scratchp;
+		dst_len = job->zfj_scratch_len;
+	}
+
+	size_t len = zstd_compress_frame(zf->zf_src, zf->zf_src_len, dst,
+	    dst_len, job->zfj_level);
+
+	mutex_enter(&job->zfj_lock);
+	while (!job->zfj_failed && job->zfj_committed != i)
+		cv_wait(&job->zfj_commit_cv, &job->zfj_lock);
+	size_t off = job->zfj_out_len;
+	if (job->zfj_failed || len == 0 || len > job->zfj_out_size - off) {
+		zstd_frame_fail(job);
+		mutex_exit(&job->zfj_lock);
+		return;
+	}
+	zf->zf_len = len;
+	job->zfj_out_len += len;
+	job->zfj_committed++;
+	cv_broadcast(&job->zfj_commit_cv);
+	mutex_exit(&job->zfj_lock);
+
+	/* Nobody else writes to our part of the output. */
+	if (!inplace)
+		memcpy(job->zfj_out + off, dst, len);
+}
+
+static void
+zstd_frame_run(zstd_frame_job_t *job)
+{
+	uint8_t *scratch = NULL;
+
+	for (;;) {
+		mutex_enter(&job->zfj_lock);
+		if (job->zfj_failed || job->zfj_next == job->zfj_nframes) {
+			mutex_exit(&job->zfj_lock);
+			break;
+		}
+		uint_t i = job->zfj_next++;
+		mutex_exit(&job->zfj_lock);
+
+		if (job->zfj_compress) {
+			zstd_frame_compress_one(job, i, &scratch);
+			continue;
+		}
+
+		zstd_frame_t *zf = &job->zfj_frames[i];
+		zf->zf_len = zstd_decompress_frame(zf->zf_src,
+		    zf->zf_src_len, zf->zf_dst, zf->zf_dst_len);
+		/* Only the last frame may be short. */
+		if (zf->zf_len != zf->zf_dst_len && i != job->zfj_nframes - 1)
+			zf->zf_len = 0;
+		if (zf->zf_len == 0) {
+			mutex_enter(&job->zfj_lock);
+			zstd_frame_fail(job);
+			mutex_exit(&job->zfj_lock);
+		}
+	}
+
+	if (scratch != NULL)
+		vmem_free(scratch, job->zfj_scratch_len);
+}
+
+static void
+zstd_frame_helper(void *arg)
+{
+	zstd_frame_job_t *job = arg;
+
+	zstd_frame_run(job);
+
+	mutex_enter(&job->zfj_lock);
+	if (--job->zfj_helpers == 0)
+		cv_signal(&job->zfj_cv);
+	mutex_exit(&job->zfj_lock);
+}
+
+/* Process every frame of the job, returning B_FALSE if any of them failed */
+static boolean_t
+zstd_frame_process(zstd_frame_job_t *job)
+{
+	mutex_init(&job->zfj_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&job->zfj_cv, NULL, CV_DEFAULT, NULL);
+	cv_init(&job->zfj_commit_cv, NULL, CV_DEFAULT, NULL);
+	job->zfj_next = 0;
+	job->zfj_helpers = 0;
+	job->zfj_failed = B_FALSE;
+	job->zfj_out_len = 0;
+	job->zfj_committed = 0;
+
+	/*
+	 * Only hand frames to helpers which can start on them right away;
+	 * if the taskq is busy, we're better off doing the work ourselves.
+	 */
+	uint_t nthreads = MIN(MIN(job->zfj_nframes, boot_ncpus),
+	    MAX(zstd_frame_threads, 1));
+	for (uint_t i = 1; zstd_frame_taskq != NULL && i < nthreads; i++) {
+		mutex_enter(&job->zfj_lock);
+		job->zfj_helpers++;
+		mutex_exit(&job->zfj_lock);
+		if (taskq_dispatch(zstd_frame_taskq, zstd_frame_helper, job,
+		    TQ_NOSLEEP | TQ_NOQUEUE) == TASKQID_INVALID) {
+			mutex_enter(&job->zfj_lock);
+			job->zfj_helpers--;
+			mutex_exit(&job->zfj_lock);
+			break;
+		}
+	}
+
+	zstd_frame_run(job);
 
+	mutex_enter(&job->zfj_lock);
+	while (job->zfj_helpers != 0)
+		cv_wait(&job->zfj_cv, &job->zfj_lock);
+	mutex_exit(&job->zfj_lock);
+
+	cv_destroy(&job->zfj_commit_cv);
+	cv_destroy(&job->zfj_cv);
+	mutex_destroy(&job->zfj_lock);
+	return (!job->zfj_failed);
+}
+
+/*
+ * Compress a block as a series of ZFS_ZSTD_FRAME_SIZE frames in parallel,
+ * see zfs_zstd_frametable_t for the layout.
+ */
 static size_t
-zfs_zstd_compress_buf(void *s_start, void *d_start, size_t s_len, size_t d_len,
-    int level)
+zstd_compress_frames_impl(void *s_start, void *d_start, size_t s_len,
+    size_t d_len, int level)
+{
+	zfs_zstdhdr_t *hdr = (zfs_zstdhdr_t *)d_start;
+	size_t fsize = ZFS_ZSTD_FRAME_SIZE;
+	uint_t nframes = DIV_ROUND_UP(s_len, fsize);
+	size_t table_len = ZFS_ZSTD_FRAMETABLE_SIZE(nframes);
+	int16_t zstd_level;
+
+	if (zstd_enum_to_level(level, &zstd_level)) {
+		ZSTDSTAT_BUMP(zstd_stat_com_inval);
+		return (s_len);
+	}
+	if (d_len <= sizeof (*hdr) + table_len)
+		return (s_len);
+
+	zstd_frame_job_t job;
+	job.zfj_frames = kmem_alloc(nframes * sizeof (zstd_frame_t), KM_SLEEP);
+	job.zfj_nframes = nframes;
+	job.zfj_compress = B_TRUE;
+	job.zfj_level = zstd_level;
+	job.zfj_out = (uint8_t *)hdr->data;
+	job.zfj_out_size = d_len - sizeof (*hdr) - table_len;
+	/* No frame that fits can be larger than the whole output. */
+	job.zfj_scratch_len = MIN(ZSTD_compressBound(fsize), job.zfj_out_size);
+	for (uint_t i = 0; i < nframes; i++) {
+		zstd_frame_t *zf = &job.zfj_frames[i];
+		zf->zf_src = (const uint8_t *)s_start + i * fsize;
+		zf->zf_src_len = MIN(fsize, s_len - i * fsize);
+		zf->zf_dst = NULL;
+		zf->zf_dst_len = 0;
+		zf->zf_len = 0;
+	}
+
+	boolean_t ok = zstd_frame_process(&job);
+	size_t c_len = job.zfj_out_len;
+	if (ok) {
+		uint8_t *table = job.zfj_out + c_len;
+
+		zstd_put_be32(table + offsetof(zfs_zstd_frametable_t,
+		    zft_magic), ZFS_ZSTD_FRAME_MAGIC);
+		zstd_put_be32(table + offsetof(zfs_zstd_frametable_t,
+		    zft_nframes), nframes);
+		zstd_put_be32(table + offsetof(zfs_zstd_frametable_t,
+		    zft_frame_size), fsize);
+		for (uint_t i = 0; i < nframes; i++) {
+			zstd_put_be32(table + ZFS_ZSTD_FRAMETABLE_SIZE(i),
+			    job.zfj_frames[i].zf_len);
+		}
+		zstd_set_header(hdr, c_len, level);
+		ZSTDSTAT_BUMP(zstd_stat_frame_compress);
+	}
+
+	kmem_free(job.zfj_frames, nframes * sizeof (zstd_frame_t));
+
+	if (!ok)
+		return (s_len);
+	return (sizeof (*hdr) + c_len + table_len);
+}
+
+/*
+ * Decompress a block by running the frames listed in its frame table in
+ * parallel.  Returns 0 on success.
+ */
+static int
+zstd_decompress_frames_impl(const zfs_zstdhdr_t *hdr, size_t c_len,
+    size_t s_len, void *d_start, size_t d_len)
+{
+	const uint8_t *table = (const uint8_t *)hdr->data + c_len;
+	size_t room = s_len - sizeof (*hdr) - c_len;
+
+	if (room < ZFS_ZSTD_FRAMETABLE_SIZE(0) ||
+	    zstd_get_be32(table + offsetof(zfs_zstd_frametable_t,
+	    zft_magic)) != ZFS_ZSTD_FRAME_MAGIC) {
+		ZSTDSTAT_BUMP(zstd_stat_dec_header_inval);
+		return (1);
+	}
+
+	uint_t nframes = zstd_get_be32(table +
+	    offsetof(zfs_zstd_frametable_t, zft_nframes));
+	size_t fsize = zstd_get_be32(table +
+	    offsetof(zfs_zstd_frametable_t, zft_frame_size));
+	if (nframes == 0 || fsize == 0 ||
+	    room < ZFS_ZSTD_FRAMETABLE_SIZE(nframes) ||
+	    (uint64_t)fsize * (nframes - 1) >= d_len) {
+		ZSTDSTAT_BUMP(zstd_stat_dec_header_inval);
+		return (1);
+	}
+
+	zstd_frame_job_t job;
+	job.zfj_frames = kmem_alloc(nframes * sizeof (zstd_frame_t), KM_SLEEP);
+	job.zfj_nframes = nframes;
+	job.zfj_compress = B_FALSE;
+	job.zfj_level = 0;
+	job.zfj_out = NULL;
+	job.zfj_out_size = 0;
+	job.zfj_scratch_len = 0;
+
+	size_t off = 0;
+	for (uint_t i = 0; i < nframes; i++) {
+		zstd_frame_t *zf = &job.zfj_frames[i];
+		zf->zf_src = (const uint8_t *)hdr->data + off;
+		zf->zf_src_len = zstd_get_be32(table +
+		    ZFS_ZSTD_FRAMETABLE_SIZE(i));
+		zf->zf_dst = (uint8_t *)d_start + i * fsize;
+		zf->zf_dst_len = (i == nframes - 1) ?
+		    d_len - i * fsize : fsize;
+		zf->zf_len = 0;
+		off += zf->zf_src_len;
+	}
+
+	int err = 1;
+	if (off != c_len) {
+		ZSTDSTAT_BUMP(zstd_stat_dec_header_inval);
+	} else if (zstd_frame_process(&job)) {
+		ZSTDSTAT_BUMP(zstd_stat_frame_decompress);
+		err = 0;
+	}
+
+	kmem_free(job.zfj_frames, nframes * sizeof (zstd_frame_t));
+	return (err);
+}
+
+static size_t
+zstd_compress_common(void *s_start, void *d_start, size_t s_len, size_t d_len,
+    int level, boolean_t frames)
 {
 	int16_t zstd_level;
 	if (zstd_enum_to_level(level, &zstd_level)) {
@@ -595,17 +984,36 @@ zfs_zstd_compress_buf(void *s_start, void *d_start, size_t s_len, size_t d_len,
 		}
 	}
 keep_trying:
+	if (frames) {
+		return (zstd_compress_frames_impl(s_start, d_start, s_len,
+		    d_len, level));
+	}
 	return (zfs_zstd_compress_impl(s_start, d_start, s_len, d_len, level));
 
 }
 
+static size_t
+zfs_zstd_compress_buf(void *s_start, void *d_start, size_t s_len, size_t d_len,
+    int level)
+{
+	return (zstd_compress_common(s_start, d_start, s_len, d_len, level,
+	    B_FALSE));
+}
+
+static size_t
+zfs_zstd_compress_frames_buf(void *s_start, void *d_start, size_t s_len,
+    size_t d_len, int level)
+{
+	return (zstd_compress_common(s_start, d_start, s_len, d_len, level,
+	    B_TRUE));
+}
+
 /* Decompress block using zstd and return its stored level */
 static int
-zfs_zstd_decompress_level_buf(void *s_start, void *d_start, size_t s_len,
-    size_t d_len, uint8_t *level)
+zstd_decompress_level_common(void *s_start, void *d_start, size_t s_len,
+    size_t d_len, uint8_t *level, boolean_t frames)
 {
-	ZSTD_DCtx *dctx;
-	size_t result;
+	int result;
 	int16_t zstd_level;
 	uint32_t c_len;
 	const zfs_zstdhdr_t *hdr;
@@ -646,27 +1054,19 @@ zfs_zstd_decompress_level_buf(void *s_start, void *d_start, size_t s_len,
 		return (1);
 	}
 
-	dctx = ZSTD_createDCtx_advanced(zstd_dctx_malloc);
-	if (!dctx) {
-		ZSTDSTAT_BUMP(zstd_stat_dec_alloc_fail);
-		return (1);
-	}
-
-	/* Set header type to "magicless" */
-	ZSTD_DCtx_setParameter(dctx, ZSTD_d_format, ZSTD_f_zstd1_magicless);
-
-	/* Decompress the data and release the context */
-	result = ZSTD_decompressDCtx(dctx, d_start, d_len, hdr->data, c_len);
-	ZSTD_freeDCtx(dctx);
-
 	/*
 	 * Returns 0 on success (decompression function returned non-negative)
 	 * and non-zero on failure (decompression function returned negative.
 	 */
-	if (ZSTD_isError(result)) {
-		ZSTDSTAT_BUMP(zstd_stat_dec_fail);
-		return (1);
+	if (frames) {
+		result = zstd_decompress_frames_impl(hdr, c_len, s_len,
+		    d_start, d_len);
+	} else {
+		result = (zstd_decompress_frame(hdr->data, c_len, d_start,
+		    d_len) == 0);
 	}
+	if (result != 0)
+		return (1);
 
 	if (level) {
 		*level = curlevel;
@@ -675,6 +1075,22 @@ zfs_zstd_decompress_level_buf(void *s_start, void *d_start, size_t s_len,
 	return (0);
 }
 
+static int
+zfs_zstd_decompress_level_buf(void *s_start, void *d_start, size_t s_len,
+    size_t d_len, uint8_t *level)
+{
+	return (zstd_decompress_level_common(s_start, d_start, s_len, d_len,
+	    level, B_FALSE));
+}
+
+static int
+zfs_zstd_decompress_frames_level_buf(void *s_start, void *d_start,
+    size_t s_len, size_t d_len, uint8_t *level)
+{
+	return (zstd_decompress_level_common(s_start, d_start, s_len, d_len,
+	    level, B_TRUE));
+}
+
 /* Decompress datablock using zstd */
 static int
 zfs_zstd_decompress_buf(void *s_start, void *d_start, size_t s_len,
@@ -685,9 +1101,21 @@ zfs_zstd_decompress_buf(void *s_start, void *d_start, size_t s_len,
 	    NULL));
 }
 
+/* Decompress a framed datablock using zstd */
+static int
+zfs_zstd_decompress_frames_buf(void *s_start, void *d_start, size_t s_len,
+    size_t d_len, int level __maybe_unused)
+{
+	return (zfs_zstd_decompress_frames_level_buf(s_start, d_start, s_len,
+	    d_len, NULL));
+}
+
 ZFS_COMPRESS_WRAP_DECL(zfs_zstd_compress)
 ZFS_DECOMPRESS_WRAP_DECL(zfs_zstd_decompress)
 ZFS_DECOMPRESS_LEVEL_WRAP_DECL(zfs_zstd_decompress_level)
+ZFS_COMPRESS_WRAP_DECL(zfs_zstd_compress_frames)
+ZFS_DECOMPRESS_WRAP_DECL(zfs_zstd_decompress_frames)
+ZFS_DECOMPRESS_LEVEL_WRAP_DECL(zfs_zstd_decompress_frames_level)
 
 
 /* Allocator for zstd compression context using mempool_allocator */
@@ -876,6 +1304,9 @@ zstd_init(void)
 	pool_count = (boot_ncpus * 4);
 	zstd_meminit();
 
+	zstd_frame_taskq = taskq_create("z_zstd_frame", MAX(boot_ncpus, 1),
+	    defclsyspri, 1, INT_MAX, TASKQ_PREPOPULATE);
+
 	/* Initialize kstat */
 	zstd_ksp = kstat_create("zfs", 0, "zstd", "misc",
 	    KSTAT_TYPE_NAMED, sizeof (zstd_stats) / sizeof (kstat_named_t),
@@ -894,6 +1325,11 @@ zstd_init(void)
 extern void
 zstd_fini(void)
 {
+	if (zstd_frame_taskq != NULL) {
+		taskq_destroy(zstd_frame_taskq);
+		zstd_frame_taskq = NULL;
+	}
+
 	/* Deinitialize kstat */
 	if (zstd_ksp != NULL) {
 		kstat_delete(zstd_ksp);
@@ -918,4 +1354,6 @@ ZFS_MODULE_PARAM(zfs, zstd_, earlyabort_pass, UINT, ZMOD_RW,
 	"Enable early abort attempts when using zstd");
 ZFS_MODULE_PARAM(zfs, zstd_, abort_size, UINT, ZMOD_RW,
 	"Minimal size of block to attempt early abort");
+ZFS_MODULE_PARAM(zfs, zstd_, frame_threads, UINT, ZMOD_RW,
+	"Maximum number of threads working on the frames of one block");
 #endif
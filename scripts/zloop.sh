@@ -264,6 +264,9 @@ while (( timeout == 0 )) || (( curtime <= (starttime + timeout) )); do
 	# randomly use special classes
 	class="special=random"
 
+	# randomly pick the metaslab allocator of each pass
+	allocator="random"
+
 	# choose between four types of configs
 	# (basic, raidz mix, raidz expansion, and draid mix)
 	case $((RANDOM % 4)) in
@@ -325,6 +328,7 @@ while (( timeout == 0 )) || (( curtime <= (starttime + timeout) )); do
 	zopt="$zopt -v $vdevs"
 	zopt="$zopt -a $align"
 	zopt="$zopt -C $class"
+	zopt="$zopt -A $allocator"
 	zopt="$zopt -s $size"
 	zopt="$zopt -f $workdir"
 
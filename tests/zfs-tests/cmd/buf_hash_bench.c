@@ -0,0 +1,209 @@
+/*
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ */
+
+/*
+ * Time ARC hash table lookups from 1 up to -t threads, doubling the number
+ * of threads each step.  The ARC is first filled with -b small blocks
+ * without any I/O, and every thread then looks up -n random blocks, of
+ * which -m percent are not cached.  Cached blocks take the hash lock of
+ * their bucket; uncached blocks mostly land on an empty bucket and do not.
+ *
+ * With -v, every lookup is checked against whether its block was cached,
+ * and the program exits with status 1 if any is wrong.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/zfs_context.h>
+#include <sys/arc.h>
+
+static uint64_t nblocks = 100000;
+static uint64_t nlookups = 1000000;
+static uint64_t maxthreads = 64;
+static uint64_t miss_pct = 0;
+static uint64_t seed = 0;
+static boolean_t verify = B_FALSE;
+
+#define	BENCH_GUID	0x5eed
+#define	BENCH_BLKSZ	SPA_MINBLOCKSIZE
+
+typedef struct bench_thread {
+	pthread_t bt_thread;
+	uint64_t bt_state;
+	uint64_t bt_errors;
+} bench_thread_t;
+
+static void
+usage(int exit_value)
+{
+	(void) fprintf(stderr, "Usage:\tbuf_hash_bench [-b blocks] "
+	    "[-m miss] [-n lookups] [-r seed] [-t threads] [-v]\n");
+	(void) fprintf(stderr, "\t-b number of cached blocks "
+	    "[default: 100000]\n");
+	(void) fprintf(stderr, "\t-m percent of lookups that miss "
+	    "[default: 0]\n");
+	(void) fprintf(stderr, "\t-n lookups per thread [default: 1M]\n");
+	(void) fprintf(stderr, "\t-r random seed [default: from "
+	    "gethrtime()]\n");
+	(void) fprintf(stderr, "\t-t maximum number of threads "
+	    "[default: 64]\n");
+	(void) fprintf(stderr, "\t-v verify the result of every lookup\n");
+	exit(exit_value);
+}
+
+static uint64_t
+xorshift64(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return (x);
+}
+
+/* Blocks [0, nblocks) are cached, the ones after them are not. */
+static void
+block_bp(uint64_t i, blkptr_t *bp)
+{
+	BP_ZERO(bp);
+	DVA_SET_VDEV(&bp->blk_dva[0], 0);
+	DVA_SET_OFFSET(&bp->blk_dva[0], i * BENCH_BLKSZ);
+	DVA_SET_ASIZE(&bp->blk_dva[0], BENCH_BLKSZ);
+	BP_SET_LSIZE(bp, BENCH_BLKSZ);
+	BP_SET_PSIZE(bp, BENCH_BLKSZ);
+	BP_SET_COMPRESS(bp, ZIO_COMPRESS_OFF);
+	BP_SET_TYPE(bp, DMU_OT_PLAIN_FILE_CONTENTS);
+	BP_SET_BIRTH(bp, 1, 1);
+}
+
+static void *
+lookup_thread(void *arg)
+{
+	bench_thread_t *bt = arg;
+	blkptr_t bp;
+
+	for (uint64_t i = 0; i < nlookups; i++) {
+		uint64_t r = xorshift64(&bt->bt_state);
+		boolean_t miss = (r >> 32) % 100 < miss_pct;
+		uint64_t blk = (r & UINT32_MAX) % nblocks;
+
+		if (miss)
+			blk += nblocks;
+
+		block_bp(blk, &bp);
+		if (arc_bench_hash_find(BENCH_GUID, &bp) == miss && verify)
+			bt->bt_errors++;
+	}
+	return (NULL);
+}
+
+static uint64_t
+run(uint64_t nthreads)
+{
+	bench_thread_t *bts = umem_zalloc(nthreads * sizeof (bench_thread_t),
+	    UMEM_NOFAIL);
+	uint64_t errors = 0;
+
+	hrtime_t start = gethrtime();
+	for (uint64_t t = 0; t < nthreads; t++) {
+		bts[t].bt_state = seed + t;
+		VERIFY0(pthread_create(&bts[t].bt_thread, NULL, lookup_thread,
+		    &bts[t]));
+	}
+	for (uint64_t t = 0; t < nthreads; t++) {
+		VERIFY0(pthread_join(bts[t].bt_thread, NULL));
+		errors += bts[t].bt_errors;
+	}
+	hrtime_t elapsed = gethrtime() - start;
+
+	uint64_t ops = nthreads * nlookups;
+	(void) printf("%4llu threads %12llu lookups %8.2f Mops/s "
+	    "%8.1f ns/op\n", (u_longlong_t)nthreads, (u_longlong_t)ops,
+	    (double)ops * 1000 / elapsed, (double)elapsed / ops);
+	if (errors != 0) {
+		(void) fprintf(stderr, "%llu threads: %llu wrong lookups\n",
+		    (u_longlong_t)nthreads, (u_longlong_t)errors);
+	}
+
+	umem_free(bts, nthreads * sizeof (bench_thread_t));
+	return (errors);
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint64_t errors = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "b:m:n:r:t:v")) != -1) {
+		switch (c) {
+		case 'b':
+			nblocks = strtoull(optarg, NULL, 0);
+			break;
+		case 'm':
+			miss_pct = strtoull(optarg, NULL, 0);
+			break;
+		case 'n':
+			nlookups = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 't':
+			maxthreads = strtoull(optarg, NULL, 0);
+			break;
+		case 'v':
+			verify = B_TRUE;
+			break;
+		case 'h':
+		default:
+			usage(c == 'h' ? 0 : 1);
+		}
+	}
+	if (optind != argc || nblocks == 0 || nblocks > UINT32_MAX ||
+	    miss_pct > 100 || maxthreads == 0)
+		usage(1);
+
+	if (seed == 0)
+		seed = gethrtime();
+	(void) printf("buf_hash_bench: %llu blocks, %llu%% misses, seed "
+	    "%llu\n", (u_longlong_t)nblocks, (u_longlong_t)miss_pct,
+	    (u_longlong_t)seed);
+
+	kernel_init(SPA_MODE_READ);
+
+	blkptr_t bp;
+	for (uint64_t i = 0; i < nblocks; i++) {
+		block_bp(i, &bp);
+		(void) arc_sim_access(BENCH_GUID, &bp, 0, 0);
+	}
+	for (uint64_t i = 0; i < nblocks; i++) {
+		block_bp(i, &bp);
+		if (!arc_bench_hash_find(BENCH_GUID, &bp)) {
+			(void) fprintf(stderr, "block %llu was evicted; "
+			    "use fewer blocks\n", (u_longlong_t)i);
+			kernel_fini();
+			return (1);
+		}
+	}
+
+	for (uint64_t n = 1; n <= maxthreads; n *= 2)
+		errors += run(n);
+
+	kernel_fini();
+
+	return (errors == 0 ? 0 : 1);
+}
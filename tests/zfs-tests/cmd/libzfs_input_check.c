@@ -102,6 +102,7 @@ static const zfs_ioc_t ioc_skip[] = {
 	ZFS_IOC_SPACE_WRITTEN,
 	ZFS_IOC_POOL_REGUID,
 	ZFS_IOC_SEND_PROGRESS,
+	ZFS_IOC_OBJSET_SPACE,
 	ZFS_IOC_EVENTS_NEXT,
 	ZFS_IOC_EVENTS_CLEAR,
 	ZFS_IOC_EVENTS_SEEK,
@@ -409,6 +410,27 @@ test_get_bookmarks(const char *dataset)
 	nvlist_free(optional);
 }
 
+static void
+test_list_batch(const char *dataset)
+{
+	nvlist_t *optional = fnvlist_alloc();
+	nvlist_t *props = fnvlist_alloc();
+
+	fnvlist_add_boolean(props, "used");
+	fnvlist_add_boolean(optional, ZFS_LIST_BATCH_SNAPSHOTS);
+	fnvlist_add_uint64(optional, ZFS_LIST_BATCH_COOKIE, 0);
+	fnvlist_add_uint64(optional, ZFS_LIST_BATCH_COUNT, 10);
+	fnvlist_add_nvlist(optional, ZFS_LIST_BATCH_PROPS, props);
+	fnvlist_add_boolean(optional, ZFS_LIST_BATCH_USERPROPS);
+	fnvlist_add_uint64(optional, SNAP_ITER_MIN_TXG, 1);
+	fnvlist_add_uint64(optional, SNAP_ITER_MAX_TXG, UINT64_MAX);
+
+	IOC_INPUT_TEST(ZFS_IOC_LIST_BATCH, dataset, NULL, optional, 0);
+
+	nvlist_free(props);
+	nvlist_free(optional);
+}
+
 static void
 test_destroy_bookmarks(const char *pool, const char *bookmark)
 {
@@ -849,6 +871,7 @@ zfs_ioc_input_tests(const char *pool)
 
 	test_bookmark(pool, snapshot, bookmark);
 	test_get_bookmarks(dataset);
+	test_list_batch(dataset);
 	test_get_bookmark_props(bookmark);
 	test_destroy_bookmarks(pool, bookmark);
 
@@ -1039,6 +1062,8 @@ validate_ioc_values(void)
 	CHECK(ZFS_IOC_BASE + 83 == ZFS_IOC_WAIT);
 	CHECK(ZFS_IOC_BASE + 84 == ZFS_IOC_WAIT_FS);
 	CHECK(ZFS_IOC_BASE + 87 == ZFS_IOC_POOL_SCRUB);
+	CHECK(ZFS_IOC_BASE + 90 == ZFS_IOC_LIST_BATCH);
+	CHECK(ZFS_IOC_BASE + 91 == ZFS_IOC_OBJSET_SPACE);
 	CHECK(ZFS_IOC_PLATFORM_BASE + 1 == ZFS_IOC_EVENTS_NEXT);
 	CHECK(ZFS_IOC_PLATFORM_BASE + 2 == ZFS_IOC_EVENTS_CLEAR);
 	CHECK(ZFS_IOC_PLATFORM_BASE + 3 == ZFS_IOC_EVENTS_SEEK);
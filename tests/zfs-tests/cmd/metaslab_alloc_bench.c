@@ -0,0 +1,297 @@
+/*
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ */
+
+/*
+ * Time the metaslab allocators on the same sequence of allocations and
+ * frees.  Each allocator gets its own metaslab, which is not part of any
+ * pool, and the sizes and the blocks to free are drawn from a random
+ * number generator seeded the same way for every allocator.  Half of the
+ * allocations are full 128k records, the rest are any multiple of the
+ * sector size up to 128k, as compressed records and metadata would be.
+ *
+ * The phases are, in order:
+ *
+ * fill         - allocate until the metaslab is -f percent full
+ * churn_free   - free a random allocated block, -n times ...
+ * churn_alloc  - ... and allocate a new block after each free
+ * drain        - free the remaining blocks in random order
+ *
+ * After the churn, the number of free segments and the largest of them
+ * are reported, to compare how each allocator fragments the metaslab.
+ *
+ * With -v, the free space of the metaslab is checked after each phase,
+ * and the program exits with status 1 if it is wrong.  An allocation that
+ * overlaps an allocated block panics in range_tree_remove().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/zfs_context.h>
+#include <sys/metaslab_impl.h>
+
+static const char *allocators[] = { "dynamic", "cursor", "segregated" };
+
+static uint64_t ms_shift = 34;
+static uint64_t nops = 1000000;
+static uint64_t fill_pct = 70;
+static uint64_t seed = 0;
+static boolean_t verify = B_FALSE;
+
+#define	SECTOR_SHIFT	12
+#define	SECTOR_SIZE	(1ULL << SECTOR_SHIFT)
+#define	RECORD_SIZE	(128ULL << 10)
+
+typedef struct bench_block {
+	uint64_t bb_offset;
+	uint64_t bb_size;
+} bench_block_t;
+
+static bench_block_t *blocks;
+static uint64_t nblocks;
+static uint64_t maxblocks;
+
+static void
+usage(int exit_value)
+{
+	(void) fprintf(stderr, "Usage:\tmetaslab_alloc_bench [-a allocator] "
+	    "[-f fill] [-m shift] [-n ops] [-r seed] [-v]\n");
+	(void) fprintf(stderr, "\t-a allocator to time [default: dynamic, "
+	    "cursor and segregated]\n");
+	(void) fprintf(stderr, "\t-f percent of the metaslab to fill "
+	    "[default: 70]\n");
+	(void) fprintf(stderr, "\t-m metaslab size shift [default: 34]\n");
+	(void) fprintf(stderr, "\t-n number of frees and allocations "
+	    "[default: 1M]\n");
+	(void) fprintf(stderr, "\t-r random seed [default: from "
+	    "gethrtime()]\n");
+	(void) fprintf(stderr, "\t-v verify the free space after each "
+	    "phase\n");
+	exit(exit_value);
+}
+
+static uint64_t
+xorshift64(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return (x);
+}
+
+static uint64_t
+block_size(uint64_t *state)
+{
+	uint64_t r = xorshift64(state);
+
+	if (r & 1)
+		return (RECORD_SIZE);
+	return (((r >> 1) % (RECORD_SIZE / SECTOR_SIZE) + 1) * SECTOR_SIZE);
+}
+
+static void
+block_add(uint64_t offset, uint64_t size)
+{
+	if (nblocks == maxblocks) {
+		uint64_t newmax = MAX(maxblocks * 2, 1024);
+		bench_block_t *newblocks = umem_alloc(newmax *
+		    sizeof (bench_block_t), UMEM_NOFAIL);
+		if (blocks != NULL) {
+			memcpy(newblocks, blocks,
+			    nblocks * sizeof (bench_block_t));
+			umem_free(blocks, maxblocks * sizeof (bench_block_t));
+		}
+		blocks = newblocks;
+		maxblocks = newmax;
+	}
+	blocks[nblocks].bb_offset = offset;
+	blocks[nblocks].bb_size = size;
+	nblocks++;
+}
+
+/* Remove a random block from the array and return it in *bbp. */
+static void
+block_pick(uint64_t *state, bench_block_t *bbp)
+{
+	uint64_t i = xorshift64(state) % nblocks;
+
+	*bbp = blocks[i];
+	blocks[i] = blocks[--nblocks];
+}
+
+static void
+report(const char *phase, uint64_t ops, hrtime_t elapsed)
+{
+	(void) printf("  %-12s %10llu ops %8.1f ns/op\n", phase,
+	    (u_longlong_t)ops, ops == 0 ? 0.0 : (double)elapsed / ops);
+}
+
+static int
+check_space(metaslab_t *msp, const char *phase, uint64_t allocated)
+{
+	uint64_t space = range_tree_space(msp->ms_allocatable);
+
+	if (space + allocated != msp->ms_size) {
+		(void) fprintf(stderr, "%s: %llu bytes free, %llu allocated; "
+		    "expected %llu in total\n", phase, (u_longlong_t)space,
+		    (u_longlong_t)allocated, (u_longlong_t)msp->ms_size);
+		return (1);
+	}
+	return (0);
+}
+
+static int
+run(const char *allocator)
+{
+	metaslab_t *msp = metaslab_bench_create(allocator, 1ULL << ms_shift,
+	    SECTOR_SHIFT);
+	uint64_t state = seed;
+	uint64_t allocated = 0, failed = 0, ops = 0;
+	hrtime_t start, elapsed;
+	bench_block_t bb;
+	int errors = 0;
+
+	if (msp == NULL) {
+		(void) fprintf(stderr, "unknown allocator %s\n", allocator);
+		return (1);
+	}
+	(void) printf("%s:\n", allocator);
+
+	elapsed = 0;
+	while (allocated < msp->ms_size / 100 * fill_pct) {
+		uint64_t size = block_size(&state);
+		start = gethrtime();
+		uint64_t offset = metaslab_bench_alloc(msp, size);
+		elapsed += gethrtime() - start;
+		ops++;
+		if (offset == -1ULL) {
+			failed++;
+			break;
+		}
+		block_add(offset, size);
+		allocated += size;
+	}
+	report("fill", ops, elapsed);
+	if (verify)
+		errors += check_space(msp, "fill", allocated);
+
+	hrtime_t free_elapsed = 0;
+	elapsed = 0;
+	for (uint64_t i = 0; i < nops && nblocks != 0; i++) {
+		block_pick(&state, &bb);
+		start = gethrtime();
+		metaslab_bench_free(msp, bb.bb_offset, bb.bb_size);
+		free_elapsed += gethrtime() - start;
+		allocated -= bb.bb_size;
+
+		uint64_t size = block_size(&state);
+		start = gethrtime();
+		uint64_t offset = metaslab_bench_alloc(msp, size);
+		elapsed += gethrtime() - start;
+		if (offset == -1ULL) {
+			failed++;
+			continue;
+		}
+		block_add(offset, size);
+		allocated += size;
+	}
+	report("churn_free", nops, free_elapsed);
+	report("churn_alloc", nops, elapsed);
+	if (verify)
+		errors += check_space(msp, "churn", allocated);
+
+	range_seg_t *rs = zfs_btree_last(&msp->ms_allocatable_by_size, NULL);
+	(void) printf("  %llu free segments, largest %llu bytes, "
+	    "%llu failed allocations\n",
+	    (u_longlong_t)range_tree_numsegs(msp->ms_allocatable),
+	    rs == NULL ? 0ULL : (u_longlong_t)(rs_get_end(rs,
+	    msp->ms_allocatable) - rs_get_start(rs, msp->ms_allocatable)),
+	    (u_longlong_t)failed);
+
+	ops = nblocks;
+	start = gethrtime();
+	while (nblocks != 0) {
+		block_pick(&state, &bb);
+		metaslab_bench_free(msp, bb.bb_offset, bb.bb_size);
+		allocated -= bb.bb_size;
+	}
+	report("drain", ops, gethrtime() - start);
+	if (verify) {
+		errors += check_space(msp, "drain", allocated);
+		if (range_tree_numsegs(msp->ms_allocatable) != 1) {
+			(void) fprintf(stderr, "drain: %llu free segments\n",
+			    (u_longlong_t)range_tree_numsegs(
+			    msp->ms_allocatable));
+			errors++;
+		}
+	}
+
+	metaslab_bench_destroy(msp);
+	return (errors);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *allocator = NULL;
+	int c, errors = 0;
+
+	while ((c = getopt(argc, argv, "a:f:m:n:r:v")) != -1) {
+		switch (c) {
+		case 'a':
+			allocator = optarg;
+			break;
+		case 'f':
+			fill_pct = strtoull(optarg, NULL, 0);
+			break;
+		case 'm':
+			ms_shift = strtoull(optarg, NULL, 0);
+			break;
+		case 'n':
+			nops = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'v':
+			verify = B_TRUE;
+			break;
+		case 'h':
+		default:
+			usage(c == 'h' ? 0 : 1);
+		}
+	}
+	if (optind != argc || fill_pct > 99 || ms_shift < 20 || ms_shift > 40)
+		usage(1);
+
+	if (seed == 0)
+		seed = gethrtime();
+	(void) printf("metaslab_alloc_bench: 2^%llu byte metaslab, %llu%% "
+	    "full, %llu ops, seed %llu\n", (u_longlong_t)ms_shift,
+	    (u_longlong_t)fill_pct, (u_longlong_t)nops, (u_longlong_t)seed);
+
+	kernel_init(SPA_MODE_READ);
+	if (allocator != NULL) {
+		errors += run(allocator);
+	} else {
+		for (int a = 0; a < ARRAY_SIZE(allocators); a++)
+			errors += run(allocators[a]);
+	}
+	if (blocks != NULL)
+		umem_free(blocks, maxblocks * sizeof (bench_block_t));
+	kernel_fini();
+
+	return (errors == 0 ? 0 : 1);
+}
@@ -0,0 +1,248 @@
+/*
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ */
+
+/*
+ * Time range_tree_add(), range_tree_find() and range_tree_remove() on a
+ * tree of many disjoint segments, the way metaslabs and the scan code use
+ * them.  Segment i covers [2 * i * size, (2 * i + 1) * size), so segments
+ * never merge and every other segment-sized range is a hole.
+ *
+ * The phases are, in order:
+ *
+ * add_random   - add the first half of the segments in random order
+ * add_append   - add the second half in ascending order, after the
+ *                segments already in the tree
+ * find_hit     - look up every segment in random order
+ * find_miss    - look up every hole in random order
+ * remove       - remove every segment in random order
+ * add_sorted   - add every segment in ascending order to the empty tree
+ *
+ * With -v, the contents of the tree are checked after each phase, and the
+ * program exits with status 1 if they are wrong.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/zfs_context.h>
+#include <sys/range_tree.h>
+
+static uint64_t nsegs = 10000000;
+static uint64_t seed = 0;
+static range_seg_type_t seg_type = RANGE_SEG32;
+static boolean_t verify = B_FALSE;
+
+/* Segment size and tree shift; range_seg32_t needs offsets >> shift. */
+#define	SEG_SHIFT	9
+#define	SEG_SIZE	(1ULL << SEG_SHIFT)
+
+static void
+usage(int exit_value)
+{
+	(void) fprintf(stderr, "Usage:\trange_tree_bench [-n segments] "
+	    "[-r seed] [-t 32|64|gap] [-v]\n");
+	(void) fprintf(stderr, "\t-n number of segments [default: 10M]\n");
+	(void) fprintf(stderr, "\t-r random seed [default: from "
+	    "gethrtime()]\n");
+	(void) fprintf(stderr, "\t-t range segment type [default: 32]\n");
+	(void) fprintf(stderr, "\t-v verify the tree after each phase\n");
+	exit(exit_value);
+}
+
+static uint64_t
+xorshift64(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return (x);
+}
+
+/* Fisher-Yates shuffle of the segment indices [0, n). */
+static uint32_t *
+shuffled(uint64_t n, uint64_t *state)
+{
+	uint32_t *order = umem_alloc(n * sizeof (uint32_t), UMEM_NOFAIL);
+
+	for (uint64_t i = 0; i < n; i++)
+		order[i] = i;
+	for (uint64_t i = n - 1; i > 0; i--) {
+		uint64_t j = xorshift64(state) % (i + 1);
+		uint32_t tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	return (order);
+}
+
+static inline uint64_t
+seg_start(uint64_t i)
+{
+	return (2 * i * SEG_SIZE);
+}
+
+static void
+report(const char *phase, uint64_t ops, hrtime_t elapsed)
+{
+	(void) printf("%-12s %10llu ops %8.1f ns/op\n", phase,
+	    (u_longlong_t)ops, ops == 0 ? 0.0 : (double)elapsed / ops);
+}
+
+static int
+check_tree(range_tree_t *rt, const char *phase, uint64_t first,
+    uint64_t last)
+{
+	uint64_t n = last - first;
+	int errors = 0;
+
+	if (range_tree_numsegs(rt) != n ||
+	    range_tree_space(rt) != n * SEG_SIZE) {
+		(void) fprintf(stderr, "%s: %llu segments, %llu bytes; "
+		    "expected %llu, %llu\n", phase,
+		    (u_longlong_t)range_tree_numsegs(rt),
+		    (u_longlong_t)range_tree_space(rt), (u_longlong_t)n,
+		    (u_longlong_t)(n * SEG_SIZE));
+		errors++;
+	}
+
+	uint64_t i = first;
+	zfs_btree_index_t where;
+	for (range_seg_t *rs = zfs_btree_first(&rt->rt_root, &where);
+	    rs != NULL; rs = zfs_btree_next(&rt->rt_root, &where, &where)) {
+		if (i >= last || rs_get_start(rs, rt) != seg_start(i) ||
+		    rs_get_end(rs, rt) != seg_start(i) + SEG_SIZE) {
+			(void) fprintf(stderr, "%s: unexpected segment "
+			    "[%llx, %llx)\n", phase,
+			    (u_longlong_t)rs_get_start(rs, rt),
+			    (u_longlong_t)rs_get_end(rs, rt));
+			return (errors + 1);
+		}
+		i++;
+	}
+	return (errors);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int c, errors = 0;
+
+	while ((c = getopt(argc, argv, "n:r:t:v")) != -1) {
+		switch (c) {
+		case 'n':
+			nsegs = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 't':
+			if (strcmp(optarg, "32") == 0)
+				seg_type = RANGE_SEG32;
+			else if (strcmp(optarg, "64") == 0)
+				seg_type = RANGE_SEG64;
+			else if (strcmp(optarg, "gap") == 0)
+				seg_type = RANGE_SEG_GAP;
+			else
+				usage(1);
+			break;
+		case 'v':
+			verify = B_TRUE;
+			break;
+		case 'h':
+		default:
+			usage(c == 'h' ? 0 : 1);
+		}
+	}
+	if (optind != argc || nsegs < 2 || nsegs > UINT32_MAX / 2)
+		usage(1);
+
+	if (seed == 0)
+		seed = gethrtime();
+	(void) printf("range_tree_bench: %llu segments, type %s, seed %llu\n",
+	    (u_longlong_t)nsegs, seg_type == RANGE_SEG32 ? "32" :
+	    seg_type == RANGE_SEG64 ? "64" : "gap", (u_longlong_t)seed);
+
+	uint64_t state = seed;
+	uint64_t half = nsegs / 2;
+	uint32_t *order = shuffled(nsegs, &state);
+	uint32_t *half_order = shuffled(half, &state);
+
+	zfs_btree_init();
+	range_tree_t *rt = range_tree_create(NULL, seg_type, NULL, 0,
+	    SEG_SHIFT);
+	hrtime_t start;
+
+	start = gethrtime();
+	for (uint64_t i = 0; i < half; i++)
+		range_tree_add(rt, seg_start(half_order[i]), SEG_SIZE);
+	report("add_random", half, gethrtime() - start);
+	if (verify)
+		errors += check_tree(rt, "add_random", 0, half);
+
+	start = gethrtime();
+	for (uint64_t i = half; i < nsegs; i++)
+		range_tree_add(rt, seg_start(i), SEG_SIZE);
+	report("add_append", nsegs - half, gethrtime() - start);
+	if (verify)
+		errors += check_tree(rt, "add_append", 0, nsegs);
+
+	uint64_t found = 0;
+	start = gethrtime();
+	for (uint64_t i = 0; i < nsegs; i++) {
+		found += (range_tree_find(rt, seg_start(order[i]),
+		    SEG_SIZE) != NULL);
+	}
+	report("find_hit", nsegs, gethrtime() - start);
+	if (verify && found != nsegs) {
+		(void) fprintf(stderr, "find_hit: found %llu of %llu\n",
+		    (u_longlong_t)found, (u_longlong_t)nsegs);
+		errors++;
+	}
+
+	found = 0;
+	start = gethrtime();
+	for (uint64_t i = 0; i < nsegs; i++) {
+		found += (range_tree_find(rt, seg_start(order[i]) + SEG_SIZE,
+		    SEG_SIZE) != NULL);
+	}
+	report("find_miss", nsegs, gethrtime() - start);
+	if (verify && found != 0) {
+		(void) fprintf(stderr, "find_miss: found %llu holes\n",
+		    (u_longlong_t)found);
+		errors++;
+	}
+
+	start = gethrtime();
+	for (uint64_t i = 0; i < nsegs; i++)
+		range_tree_remove(rt, seg_start(order[i]), SEG_SIZE);
+	report("remove", nsegs, gethrtime() - start);
+	if (verify)
+		errors += check_tree(rt, "remove", 0, 0);
+
+	start = gethrtime();
+	for (uint64_t i = 0; i < nsegs; i++)
+		range_tree_add(rt, seg_start(i), SEG_SIZE);
+	report("add_sorted", nsegs, gethrtime() - start);
+	if (verify)
+		errors += check_tree(rt, "add_sorted", 0, nsegs);
+
+	range_tree_vacate(rt, NULL, NULL);
+	range_tree_destroy(rt);
+	zfs_btree_fini();
+	umem_free(order, nsegs * sizeof (uint32_t));
+	umem_free(half_order, half * sizeof (uint32_t));
+
+	return (errors == 0 ? 0 : 1);
+}
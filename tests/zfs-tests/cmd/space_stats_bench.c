@@ -0,0 +1,205 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Compare lzc_get_space_stats() with fetching the same properties through
+ * the nvlist of all properties (ZFS_IOC_OBJSET_STATS), as libzfs does.
+ *
+ * The values returned by both must agree; the program exits with status 1
+ * if they do not.  With -n, both are then timed over that many calls, and
+ * the average time per call is printed.  The dataset should be idle while
+ * this runs, or the space usage may change between the two fetches.
+ */
+
+#include <libzfs.h>
+#include <libzfs_core.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sysexits.h>
+
+static const struct {
+	zfs_prop_t	prop;
+	size_t		offset;
+	uint64_t	flags;	/* zss_flags needed for the field to be set */
+	boolean_t	fs;	/* only set for filesystems and volumes */
+} fields[] = {
+	{ ZFS_PROP_GUID, offsetof(zfs_space_stats_t, zss_guid), 0, 0 },
+	{ ZFS_PROP_CREATION, offsetof(zfs_space_stats_t, zss_creation), 0, 0 },
+	{ ZFS_PROP_CREATETXG,
+	    offsetof(zfs_space_stats_t, zss_createtxg), 0, 0 },
+	{ ZFS_PROP_USED, offsetof(zfs_space_stats_t, zss_used), 0, 0 },
+	{ ZFS_PROP_REFERENCED,
+	    offsetof(zfs_space_stats_t, zss_referenced), 0, 0 },
+	{ ZFS_PROP_AVAILABLE,
+	    offsetof(zfs_space_stats_t, zss_available), 0, 0 },
+	{ ZFS_PROP_LOGICALREFERENCED,
+	    offsetof(zfs_space_stats_t, zss_logicalreferenced), 0, 0 },
+	{ ZFS_PROP_COMPRESSRATIO,
+	    offsetof(zfs_space_stats_t, zss_compressratio), 0, 0 },
+	{ ZFS_PROP_REFRATIO, offsetof(zfs_space_stats_t, zss_refratio), 0, 0 },
+	{ ZFS_PROP_REFQUOTA, offsetof(zfs_space_stats_t, zss_refquota), 0, 0 },
+	{ ZFS_PROP_REFRESERVATION,
+	    offsetof(zfs_space_stats_t, zss_refreservation), 0, 0 },
+	{ ZFS_PROP_QUOTA, offsetof(zfs_space_stats_t, zss_quota), 0, 1 },
+	{ ZFS_PROP_RESERVATION,
+	    offsetof(zfs_space_stats_t, zss_reservation), 0, 1 },
+	{ ZFS_PROP_LOGICALUSED,
+	    offsetof(zfs_space_stats_t, zss_logicalused), 0, 1 },
+	{ ZFS_PROP_USEDSNAP, offsetof(zfs_space_stats_t, zss_usedsnap),
+	    ZSS_USED_BREAKDOWN, 1 },
+	{ ZFS_PROP_USEDDS, offsetof(zfs_space_stats_t, zss_usedds),
+	    ZSS_USED_BREAKDOWN, 1 },
+	{ ZFS_PROP_USEDCHILD, offsetof(zfs_space_stats_t, zss_usedchild),
+	    ZSS_USED_BREAKDOWN, 1 },
+	{ ZFS_PROP_USEDREFRESERV,
+	    offsetof(zfs_space_stats_t, zss_usedrefreserv),
+	    ZSS_USED_BREAKDOWN, 1 },
+	{ ZFS_PROP_WRITTEN, offsetof(zfs_space_stats_t, zss_written),
+	    ZSS_WRITTEN, 0 },
+};
+
+#define	FIELD(zss, i)	(*(uint64_t *)((char *)(zss) + fields[i].offset))
+
+static boolean_t
+field_valid(const zfs_space_stats_t *zss, int i)
+{
+	if ((zss->zss_flags & fields[i].flags) != fields[i].flags)
+		return (B_FALSE);
+	return (!fields[i].fs || !(zss->zss_flags & ZSS_SNAPSHOT));
+}
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+static void
+usage(const char *name)
+{
+	(void) fprintf(stderr, "usage: %s [-n count] dataset\n", name);
+	exit(EX_USAGE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	libzfs_handle_t *hdl;
+	zfs_handle_t *zhp;
+	zfs_space_stats_t zss;
+	const char *dsname;
+	uint64_t count = 0, start, nvl_ns, flat_ns, sum = 0;
+	int c, error, mismatches = 0;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			count = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+	dsname = argv[optind];
+
+	if ((hdl = libzfs_init()) == NULL) {
+		(void) fprintf(stderr, "%s\n", libzfs_error_init(errno));
+		return (EX_OSERR);
+	}
+	if ((error = libzfs_core_init()) != 0) {
+		(void) fprintf(stderr, "libzfs_core_init: %s\n",
+		    strerror(error));
+		return (EX_OSERR);
+	}
+	if ((zhp = zfs_open(hdl, dsname, ZFS_TYPE_DATASET)) == NULL)
+		return (EX_NOINPUT);
+
+	if ((error = lzc_get_space_stats(dsname, &zss)) != 0) {
+		(void) fprintf(stderr, "lzc_get_space_stats(%s): %s\n",
+		    dsname, strerror(error));
+		return (EX_OSERR);
+	}
+	for (int i = 0; i < ARRAY_SIZE(fields); i++) {
+		uint64_t value;
+
+		if (!field_valid(&zss, i))
+			continue;
+		value = zfs_prop_get_int(zhp, fields[i].prop);
+		if (value != FIELD(&zss, i)) {
+			(void) printf("%s: %llu (nvlist) != %llu (flat)\n",
+			    zfs_prop_to_name(fields[i].prop),
+			    (u_longlong_t)value,
+			    (u_longlong_t)FIELD(&zss, i));
+			mismatches++;
+		}
+	}
+	if (mismatches != 0)
+		return (1);
+
+	if (count == 0)
+		goto out;
+
+	start = now_ns();
+	for (uint64_t n = 0; n < count; n++) {
+		zfs_refresh_properties(zhp);
+		for (int i = 0; i < ARRAY_SIZE(fields); i++) {
+			if (field_valid(&zss, i))
+				sum += zfs_prop_get_int(zhp, fields[i].prop);
+		}
+	}
+	nvl_ns = (now_ns() - start) / count;
+
+	start = now_ns();
+	for (uint64_t n = 0; n < count; n++) {
+		if ((error = lzc_get_space_stats(dsname, &zss)) != 0) {
+			(void) fprintf(stderr, "lzc_get_space_stats(%s): %s\n",
+			    dsname, strerror(error));
+			return (EX_OSERR);
+		}
+		for (int i = 0; i < ARRAY_SIZE(fields); i++) {
+			if (field_valid(&zss, i))
+				sum -= FIELD(&zss, i);
+		}
+	}
+	flat_ns = (now_ns() - start) / count;
+
+	(void) printf("nvlist: %llu ns/call\n", (u_longlong_t)nvl_ns);
+	(void) printf("flat:   %llu ns/call\n", (u_longlong_t)flat_ns);
+	(void) printf("speedup: %.1fx\n", (double)nvl_ns / MAX(flat_ns, 1));
+	if (sum != 0)
+		(void) printf("note: values changed during the run\n");
+out:
+	zfs_close(zhp);
+	libzfs_core_fini();
+	libzfs_fini(hdl);
+	return (0);
+}